@@ -0,0 +1,221 @@
+// ============================================================================
+// aho_corasick.c - Multi-Pattern Literal Search Implementation
+// ============================================================================
+// Construction:
+//   1. Give every (folded) code unit used by a term a class number.
+//   2. Insert the terms into a trie stored directly in the dense table.
+//   3. Breadth-first pass: compute failure states and fill every missing
+//      transition from the failure state's row, which turns the trie into
+//      a DFA. Each state also gets a dictionary link: the nearest proper
+//      suffix state that ends a term, so all outputs are found in a chain.
+//   4. Rewrite transitions as row offsets and flag states with outputs.
+// ============================================================================
+
+#include "aho_corasick.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_STATE     UINT32_MAX
+#define OUTPUT_FLAG  0x80000000u     // Target state ends at least one term
+
+struct AhoCorasick {
+    uint16_t *classMap;     // Code unit -> class (65536 entries)
+    uint8_t *startsTerm;    // Code unit begins some term (65536 entries)
+    size_t alphabetSize;
+    uint32_t *table;        // stateCount x alphabetSize: next row offset | OUTPUT_FLAG
+    size_t stateCount;
+    uint32_t *termAt;       // Per state: a term ending exactly here, or NO_STATE
+    uint32_t *dictLink;     // Per state: nearest suffix state ending a term, or NO_STATE
+    uint32_t *sameTerm;     // Per term: next term with identical text, or NO_STATE
+    size_t *lengths;        // Per term
+    size_t termCount;
+};
+
+static uint16_t FoldUnit(const uint16_t *fold, uint16_t ch) {
+    return fold ? fold[ch] : ch;
+}
+
+// ============================================================================
+// AhoBuild - Construct the Automaton
+// ============================================================================
+AhoError AhoBuild(const uint16_t *const *patterns, const size_t *lengths, size_t count,
+                  const uint16_t *fold, AhoCorasick **automatonOut) {
+    *automatonOut = NULL;
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += lengths[i];
+    if (total == 0) return AHO_ERROR_EMPTY;
+    if (count >= NO_STATE) return AHO_ERROR_TOO_BIG;
+
+    AhoCorasick *ac = (AhoCorasick *)calloc(1, sizeof(AhoCorasick));
+    if (!ac) return AHO_ERROR_MEMORY;
+    ac->termCount = count;
+    ac->classMap = (uint16_t *)calloc(0x10000, sizeof(uint16_t));
+    ac->startsTerm = (uint8_t *)calloc(0x10000, 1);
+    ac->lengths = (size_t *)malloc(count * sizeof(size_t));
+    ac->sameTerm = (uint32_t *)malloc(count * sizeof(uint32_t));
+    uint16_t *classOfFolded = fold ? (uint16_t *)calloc(0x10000, sizeof(uint16_t)) : ac->classMap;
+    AhoError error = AHO_ERROR_MEMORY;
+    uint32_t *fail = NULL, *queue = NULL;
+    if (!ac->classMap || !ac->startsTerm || !ac->lengths || !ac->sameTerm || !classOfFolded) goto cleanup;
+    memcpy(ac->lengths, lengths, count * sizeof(size_t));
+
+    // 1. Alphabet: class 0 is every unit that occurs in no term
+    size_t classes = 1;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 0; k < lengths[i]; ++k) {
+            uint16_t unit = FoldUnit(fold, patterns[i][k]);
+            if (classOfFolded[unit] == 0) {
+                if (classes == 0xFFFF) {
+                    error = AHO_ERROR_TOO_BIG;
+                    goto cleanup;
+                }
+                classOfFolded[unit] = (uint16_t)classes++;
+            }
+        }
+    }
+    if (fold) {
+        for (uint32_t ch = 0; ch <= 0xFFFF; ++ch) ac->classMap[ch] = classOfFolded[fold[ch]];
+    }
+    ac->alphabetSize = classes;
+
+    // 2. Trie, at most one state per term code unit plus the start state
+    size_t maxStates = total + 1;
+    if (maxStates > (OUTPUT_FLAG - 1) / classes ||
+        maxStates * classes * sizeof(uint32_t) > AHO_MAX_TABLE_BYTES) {
+        error = AHO_ERROR_TOO_BIG;
+        goto cleanup;
+    }
+    ac->table = (uint32_t *)malloc(maxStates * classes * sizeof(uint32_t));
+    ac->termAt = (uint32_t *)malloc(maxStates * sizeof(uint32_t));
+    ac->dictLink = (uint32_t *)malloc(maxStates * sizeof(uint32_t));
+    fail = (uint32_t *)malloc(maxStates * sizeof(uint32_t));
+    queue = (uint32_t *)malloc(maxStates * sizeof(uint32_t));
+    if (!ac->table || !ac->termAt || !ac->dictLink || !fail || !queue) goto cleanup;
+
+    memset(ac->table, 0xFF, classes * sizeof(uint32_t));
+    ac->termAt[0] = NO_STATE;
+    ac->dictLink[0] = NO_STATE;
+    ac->stateCount = 1;
+    for (size_t i = 0; i < count; ++i) {
+        ac->sameTerm[i] = NO_STATE;
+        if (lengths[i] == 0) continue;
+        uint32_t state = 0;
+        for (size_t k = 0; k < lengths[i]; ++k) {
+            uint32_t *slot = &ac->table[state * classes + ac->classMap[patterns[i][k]]];
+            if (*slot == NO_STATE) {
+                uint32_t created = (uint32_t)ac->stateCount++;
+                memset(ac->table + (size_t)created * classes, 0xFF, classes * sizeof(uint32_t));
+                ac->termAt[created] = NO_STATE;
+                ac->dictLink[created] = NO_STATE;
+                *slot = created;
+            }
+            state = *slot;
+        }
+        // Identical terms share the state; chain them
+        ac->sameTerm[i] = ac->termAt[state];
+        ac->termAt[state] = (uint32_t)i;
+    }
+
+    // 3. Failure states in breadth-first order complete the transitions
+    size_t head = 0, tail = 0;
+    for (size_t c = 0; c < classes; ++c) {
+        uint32_t child = ac->table[c];
+        if (child == NO_STATE) {
+            ac->table[c] = 0;
+        } else {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t *row = ac->table + (size_t)state * classes;
+        const uint32_t *failRow = ac->table + (size_t)fail[state] * classes;
+        for (size_t c = 0; c < classes; ++c) {
+            if (row[c] == NO_STATE) {
+                row[c] = failRow[c];
+                continue;
+            }
+            uint32_t child = row[c];
+            uint32_t childFail = failRow[c];
+            fail[child] = childFail;
+            ac->dictLink[child] = ac->termAt[childFail] != NO_STATE ? childFail : ac->dictLink[childFail];
+            queue[tail++] = child;
+        }
+    }
+
+    // 4. Row offsets with output flags
+    for (size_t i = 0; i < ac->stateCount * classes; ++i) {
+        uint32_t target = ac->table[i];
+        bool output = ac->termAt[target] != NO_STATE || ac->dictLink[target] != NO_STATE;
+        ac->table[i] = target * (uint32_t)classes | (output ? OUTPUT_FLAG : 0);
+    }
+    for (uint32_t ch = 0; ch <= 0xFFFF; ++ch) {
+        ac->startsTerm[ch] = (ac->table[ac->classMap[ch]] & ~OUTPUT_FLAG) != 0;
+    }
+    error = AHO_OK;
+
+cleanup:
+    if (fold) free(classOfFolded);
+    free(fail);
+    free(queue);
+    if (error != AHO_OK) {
+        AhoFree(ac);
+        return error;
+    }
+    *automatonOut = ac;
+    return AHO_OK;
+}
+
+// ============================================================================
+// AhoFree
+// ============================================================================
+void AhoFree(AhoCorasick *automaton) {
+    if (!automaton) return;
+    free(automaton->classMap);
+    free(automaton->startsTerm);
+    free(automaton->table);
+    free(automaton->termAt);
+    free(automaton->dictLink);
+    free(automaton->sameTerm);
+    free(automaton->lengths);
+    free(automaton);
+}
+
+// ============================================================================
+// AhoScan - Report Every Occurrence
+// ============================================================================
+size_t AhoScan(const AhoCorasick *automaton, const uint16_t *text, size_t length,
+               AhoCallback callback, void *context) {
+    const uint32_t *table = automaton->table;
+    const uint16_t *classMap = automaton->classMap;
+    const uint8_t *startsTerm = automaton->startsTerm;
+    uint32_t row = 0;
+    size_t found = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (row == 0) {
+            // In the start state: skip units that cannot begin a term
+            while (i < length && !startsTerm[text[i]]) i++;
+            if (i == length) break;
+        }
+        uint32_t next = table[row + classMap[text[i]]];
+        row = next & ~OUTPUT_FLAG;
+        if (!(next & OUTPUT_FLAG)) continue;
+
+        // Walk this state and its dictionary links: longest terms first
+        uint32_t state = row / (uint32_t)automaton->alphabetSize;
+        if (automaton->termAt[state] == NO_STATE) state = automaton->dictLink[state];
+        for (; state != NO_STATE; state = automaton->dictLink[state]) {
+            for (uint32_t term = automaton->termAt[state]; term != NO_STATE; term = automaton->sameTerm[term]) {
+                AhoMatch match;
+                match.length = automaton->lengths[term];
+                match.start = i + 1 - match.length;
+                match.pattern = term;
+                found++;
+                if (!callback(context, &match)) return found;
+            }
+        }
+    }
+    return found;
+}
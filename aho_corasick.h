@@ -0,0 +1,58 @@
+// ============================================================================
+// aho_corasick.h - Multi-Pattern Literal Search Header
+// ============================================================================
+// Finds every occurrence of any number of literal terms in one pass over
+// UTF-16 text. The automaton is a fully resolved DFA (no failure links to
+// follow while scanning) stored as one dense table:
+//   - Code units that occur in no term share class 0; the others get small
+//     class numbers through a 64K-entry map, so table rows stay short.
+//   - Each row holds the next row's offset, with the top bit set when the
+//     target state ends a term; the scan loop is a load, an add and a test.
+//   - While in the start state the scan skips units that begin no term.
+// Matching is exact unless a fold table is given: fold[u] maps every code
+// unit to its comparison form (e.g. lowercase), applied to terms and text.
+// This module is plain C with no Windows dependencies. A built automaton is
+// read-only, so several threads may scan with it at once.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHO_MAX_TABLE_BYTES   (64u * 1024u * 1024u)  // Cap on the transition table
+
+typedef enum AhoError {
+    AHO_OK = 0,
+    AHO_ERROR_EMPTY = 1,        // No non-empty terms
+    AHO_ERROR_TOO_BIG = 2,      // Table would exceed AHO_MAX_TABLE_BYTES
+    AHO_ERROR_MEMORY = 3        // Out of memory
+} AhoError;
+
+typedef struct AhoCorasick AhoCorasick;
+
+// One occurrence. 'pattern' is the index of the term in the build list.
+typedef struct AhoMatch {
+    size_t start;
+    size_t length;
+    uint32_t pattern;
+} AhoMatch;
+
+// Receives matches in order of their end position. Return false to stop.
+typedef bool (*AhoCallback)(void *context, const AhoMatch *match);
+
+// Builds an automaton for 'count' terms. Empty terms never match.
+// Parameters:
+//   patterns, lengths - The terms
+//   fold              - 65536-entry folding table, or NULL for exact matching
+//   automatonOut      - Receives the automaton
+AhoError AhoBuild(const uint16_t *const *patterns, const size_t *lengths, size_t count,
+                  const uint16_t *fold, AhoCorasick **automatonOut);
+
+void AhoFree(AhoCorasick *automaton);
+
+// Reports every occurrence of every term in the text, overlapping ones
+// included. Returns the number of matches reported.
+size_t AhoScan(const AhoCorasick *automaton, const uint16_t *text, size_t length,
+               AhoCallback callback, void *context);
@@ -27,7 +27,7 @@ param(
 # Configuration
 $ProjectRoot = $PSScriptRoot
 $BinariesDir = Join-Path $ProjectRoot "binaries"
-$SourceFiles = @("retropad.c", "file_io.c")
+$SourceFiles = @("retropad.c", "file_io.c", "line_index.c", "meta_cache.c", "undo_log.c", "journal.c", "session.c", "settings.c", "settings_store.c", "regex.c", "aho_corasick.c", "results_pane.c", "match_index.c", "text_search.c", "search_bar.c", "parallel_search.c", "file_search.c", "find_in_files.c", "trigram_index.c", "match_counter.c", "fuzzy_match.c", "line_palette.c", "line_filter.c", "highlight.c", "line_gutter.c", "line_layout.c", "text_metrics.c", "pagination.c", "print_job.c", "print_preview.c")
 $ResourceFile = "retropad.rc"
 $OutputExe = "retropad.exe"
 
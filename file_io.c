@@ -15,22 +15,15 @@
 #include <stdlib.h>    // For standard library functions
 
 // ============================================================================
-// DetectEncoding - Automatically Detect Text File Encoding
+// DetectBOM - Identify an Encoding from its Byte Order Mark
 // ============================================================================
-// Examines the first few bytes of a file to determine its encoding by looking
-// for a Byte Order Mark (BOM) or attempting UTF-8 validation.
-// Detection logic:
-//   1. Check for UTF-16LE BOM (0xFF 0xFE)
-//   2. Check for UTF-16BE BOM (0xFE 0xFF)
-//   3. Check for UTF-8 BOM (0xEF 0xBB 0xBF)
-//   4. Try to convert as UTF-8 - if successful, assume UTF-8
-//   5. Otherwise, assume ANSI (Windows code page)
+// Checks only the first few bytes of the file for a BOM.
 // Parameters:
 //   data - Pointer to the file data buffer
 //   size - Size of the data in bytes
-// Returns: Detected TextEncoding value
+// Returns: Encoding indicated by the BOM, or ENC_AUTO if there is none
 // ============================================================================
-static TextEncoding DetectEncoding(const BYTE *data, DWORD size) {
+TextEncoding DetectBOM(const BYTE *data, DWORD size) {
     // Check for UTF-16 Little Endian BOM (most common on Windows)
     if (size >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
         return ENC_UTF16LE;
@@ -43,6 +36,31 @@ static TextEncoding DetectEncoding(const BYTE *data, DWORD size) {
     if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
         return ENC_UTF8;
     }
+    return ENC_AUTO;
+}
+
+// ============================================================================
+// DetectEncoding - Automatically Detect Text File Encoding
+// ============================================================================
+// Examines the first few bytes of a file to determine its encoding by looking
+// for a Byte Order Mark (BOM) or attempting UTF-8 validation.
+// Detection logic:
+//   1. Check for UTF-16LE BOM (0xFF 0xFE)
+//   2. Check for UTF-16BE BOM (0xFE 0xFF)
+//   3. Check for UTF-8 BOM (0xEF 0xBB 0xBF)
+//   4. Try to convert as UTF-8 - if successful, assume UTF-8
+//   5. Otherwise, assume ANSI (Windows code page)
+// Parameters:
+//   data - Pointer to the file data buffer
+//   size - Size of the data in bytes
+// Returns: Detected TextEncoding value
+// ============================================================================
+TextEncoding DetectEncoding(const BYTE *data, DWORD size) {
+    // BOM-marked files need no further inspection
+    TextEncoding bom = DetectBOM(data, size);
+    if (bom != ENC_AUTO) {
+        return bom;
+    }
     // No BOM found - try to validate as UTF-8
     // If conversion succeeds with strict validation, assume UTF-8
     // MB_ERR_INVALID_CHARS causes failure if invalid UTF-8 sequences exist
@@ -64,7 +82,7 @@ static TextEncoding DetectEncoding(const BYTE *data, DWORD size) {
 //   outLength   - Receives length of string in characters (can be NULL)
 // Returns: TRUE on success, FALSE on failure
 // ============================================================================
-static BOOL DecodeToWide(const BYTE *data, DWORD size, TextEncoding encoding, WCHAR **outText, size_t *outLength) {
+BOOL DecodeToWide(const BYTE *data, DWORD size, TextEncoding encoding, WCHAR **outText, size_t *outLength) {
     int chars = 0;
     WCHAR *buffer = NULL;
 
@@ -149,21 +167,34 @@ static BOOL DecodeToWide(const BYTE *data, DWORD size, TextEncoding encoding, WC
 // LoadTextFile - Load and Decode a Text File
 // ============================================================================
 // Loads a complete text file into memory, automatically detecting its encoding
-// and converting it to wide character format. The function:
+// and converting it to wide character format. See LoadTextFileWithHint.
+// ============================================================================
+BOOL LoadTextFile(HWND owner, LPCWSTR path, WCHAR **textOut, size_t *lengthOut, TextEncoding *encodingOut) {
+    return LoadTextFileWithHint(owner, path, ENC_AUTO, textOut, lengthOut, encodingOut);
+}
+
+// ============================================================================
+// LoadTextFileWithHint - Load and Decode a Text File
+// ============================================================================
+// Loads a complete text file into memory and converts it to wide character
+// format. The function:
 //   1. Opens the file for reading
 //   2. Reads entire file into memory
-//   3. Detects the encoding
+//   3. Detects the encoding (or uses the caller's hint if one is given)
 //   4. Converts to wide character (UTF-16LE)
 //   5. Returns allocated buffer (caller must free with HeapFree)
+// A hint comes from the metadata cache and lets large files skip the full
+// UTF-8 validation pass; a BOM in the file always takes precedence.
 // Parameters:
 //   owner       - Parent window for error dialogs
 //   path        - Full path to file to load
+//   hint        - Previously detected encoding, or ENC_AUTO to detect
 //   textOut     - Receives allocated text buffer
 //   lengthOut   - Receives text length in characters (optional)
 //   encodingOut - Receives detected encoding (optional)
 // Returns: TRUE on success, FALSE on failure (shows error message)
 // ============================================================================
-BOOL LoadTextFile(HWND owner, LPCWSTR path, WCHAR **textOut, size_t *lengthOut, TextEncoding *encodingOut) {
+BOOL LoadTextFileWithHint(HWND owner, LPCWSTR path, TextEncoding hint, WCHAR **textOut, size_t *lengthOut, TextEncoding *encodingOut) {
     // Initialize outputs to safe defaults
     *textOut = NULL;
     if (lengthOut) *lengthOut = 0;
@@ -220,8 +251,11 @@ BOOL LoadTextFile(HWND owner, LPCWSTR path, WCHAR **textOut, size_t *lengthOut,
         return TRUE;
     }
 
-    // Detect the file's encoding
-    TextEncoding enc = DetectEncoding(buffer, read);
+    // Detect the file's encoding (a BOM always wins over a cached hint)
+    TextEncoding enc = DetectBOM(buffer, read);
+    if (enc == ENC_AUTO) {
+        enc = (hint != ENC_AUTO) ? hint : DetectEncoding(buffer, read);
+    }
     
     // Convert to wide character format
     WCHAR *text = NULL;
@@ -431,3 +465,40 @@ BOOL SaveFileDialog(HWND owner, WCHAR *pathOut, DWORD pathLen) {
     return GetSaveFileNameW(&ofn);
 }
 
+
+// ============================================================================
+// GetAppDataPath - Locate a File in retropad's Per-User Data Directory
+// ============================================================================
+// Resolves %LOCALAPPDATA%\retropad (falling back to the temp directory when
+// the variable is missing), creates it on first use, and appends 'leaf'.
+// Parameters:
+//   leaf    - File or subdirectory name to append (can be NULL or empty)
+//   pathOut - Buffer to receive the full path
+//   pathLen - Size of the pathOut buffer in WCHARs
+// Returns: TRUE on success, FALSE if the directory is unavailable
+// ============================================================================
+BOOL GetAppDataPath(LPCWSTR leaf, WCHAR *pathOut, DWORD pathLen) {
+    WCHAR base[MAX_PATH];
+    DWORD len = GetEnvironmentVariableW(L"LOCALAPPDATA", base, ARRAYSIZE(base));
+    if (len == 0 || len >= ARRAYSIZE(base)) {
+        len = GetTempPathW(ARRAYSIZE(base), base);
+        if (len == 0 || len >= ARRAYSIZE(base)) return FALSE;
+    }
+
+    // Append the application directory and make sure it exists
+    if (FAILED(StringCchPrintfW(pathOut, pathLen, L"%s%sretropad", base,
+                                base[len - 1] == L'\\' ? L"" : L"\\"))) {
+        return FALSE;
+    }
+    if (!CreateDirectoryW(pathOut, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        return FALSE;
+    }
+
+    if (leaf && leaf[0]) {
+        if (FAILED(StringCchCatW(pathOut, pathLen, L"\\")) ||
+            FAILED(StringCchCatW(pathOut, pathLen, leaf))) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
@@ -17,6 +17,7 @@
 // the presence of a Byte Order Mark (BOM) or character analysis.
 // ============================================================================
 typedef enum TextEncoding {
+    ENC_AUTO = 0,      // Not known yet - detect from file contents
     ENC_UTF8 = 1,      // UTF-8 encoding (with or without BOM: 0xEF, 0xBB, 0xBF)
     ENC_UTF16LE = 2,   // UTF-16 Little Endian (BOM: 0xFF, 0xFE)
     ENC_UTF16BE = 3,   // UTF-16 Big Endian (BOM: 0xFE, 0xFF)
@@ -71,6 +72,11 @@ BOOL SaveFileDialog(HWND owner, WCHAR *pathOut, DWORD pathLen);
 // Returns: TRUE on success, FALSE on failure (displays error message)
 BOOL LoadTextFile(HWND owner, LPCWSTR path, WCHAR **textOut, size_t *lengthOut, TextEncoding *encodingOut);
 
+// Same as LoadTextFile, but trusts a previously detected encoding instead of
+// validating the whole file as UTF-8. BOMs are still honored. Pass ENC_AUTO
+// to detect normally.
+BOOL LoadTextFileWithHint(HWND owner, LPCWSTR path, TextEncoding hint, WCHAR **textOut, size_t *lengthOut, TextEncoding *encodingOut);
+
 // Saves text to a file with the specified encoding.
 // Automatically adds appropriate BOM (Byte Order Mark) for UTF encodings.
 // Parameters:
@@ -81,3 +87,33 @@ BOOL LoadTextFile(HWND owner, LPCWSTR path, WCHAR **textOut, size_t *lengthOut,
 //   encoding - Encoding to use when saving
 // Returns: TRUE on success, FALSE on failure (displays error message)
 BOOL SaveTextFile(HWND owner, LPCWSTR path, LPCWSTR text, size_t length, TextEncoding encoding);
+
+// ============================================================================
+// Encoding Detection and Decoding
+// ============================================================================
+
+// Returns the encoding named by a Byte Order Mark at the start of the data,
+// or ENC_AUTO if there is none. Looks at the first three bytes only.
+TextEncoding DetectBOM(const BYTE *data, DWORD size);
+
+// Detects the encoding of file data: a BOM if present, else UTF-8 if the
+// whole data is valid UTF-8, else ANSI.
+TextEncoding DetectEncoding(const BYTE *data, DWORD size);
+
+// Converts file data in the given encoding to UTF-16 (a BOM is skipped).
+// Caller must free the text with HeapFree().
+// Returns: TRUE on success, FALSE if the data cannot be decoded
+BOOL DecodeToWide(const BYTE *data, DWORD size, TextEncoding encoding, WCHAR **outText, size_t *outLength);
+
+// ============================================================================
+// Application Data Location
+// ============================================================================
+
+// Builds the full path of a file inside retropad's per-user data directory
+// (%LOCALAPPDATA%\retropad), creating the directory if necessary.
+// Parameters:
+//   leaf    - File or subdirectory name to append (can be NULL or empty)
+//   pathOut - Buffer to receive the full path
+//   pathLen - Size of the pathOut buffer in WCHARs
+// Returns: TRUE on success, FALSE if the directory is unavailable
+BOOL GetAppDataPath(LPCWSTR leaf, WCHAR *pathOut, DWORD pathLen);
@@ -0,0 +1,199 @@
+// ============================================================================
+// file_search.c - Literal Search of File Contents Implementation
+// ============================================================================
+
+#include "file_search.h"
+#include "text_search.h"
+#include <string.h>
+
+#define NOT_FOUND ((size_t)-1)
+
+static uint8_t AsciiLower(uint8_t ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (uint8_t)(ch + ('a' - 'A')) : ch;
+}
+
+// ============================================================================
+// ByteNeedleInit
+// ============================================================================
+bool ByteNeedleInit(ByteNeedle *needle, const uint16_t *text, size_t length, bool matchCase) {
+    memset(needle, 0, sizeof(*needle));
+    if (length == 0 || length > FILE_SEARCH_MAX_NEEDLE) return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] >= 0x80) return false;
+        needle->bytes[i] = matchCase ? (uint8_t)text[i] : AsciiLower((uint8_t)text[i]);
+    }
+    needle->length = length;
+    needle->foldAscii = !matchCase;
+    return true;
+}
+
+// ============================================================================
+// Helpers for FileSearchBytes
+// ============================================================================
+// Position of the next 'ch' in data[from, end), or NOT_FOUND
+static size_t NextByte(const uint8_t *data, size_t from, size_t end, uint8_t ch) {
+    if (from >= end) return NOT_FOUND;
+    const uint8_t *p = (const uint8_t *)memchr(data + from, ch, end - from);
+    return p ? (size_t)(p - data) : NOT_FOUND;
+}
+
+// UTF-16 code units that UTF-8 bytes decode to: one per lead byte, two for
+// the four-byte sequences that become surrogate pairs
+static uint64_t Utf16Units(const uint8_t *data, size_t size) {
+    uint64_t units = 0;
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t ch = data[i];
+        if (ch < 0x80 || ch >= 0xC0) units++;
+        if (ch >= 0xF0) units++;
+    }
+    return units;
+}
+
+// ============================================================================
+// FileSearchBytes
+// ============================================================================
+// Candidates come from memchr on the first needle byte (on both of its
+// cases when folding; the later of the two positions is kept for the next
+// round). Line breaks are counted with memchr between matches only.
+// ============================================================================
+size_t FileSearchBytes(const ByteNeedle *needle, const uint8_t *data, size_t size, bool utf8,
+                       FileHitProc proc, void *context) {
+    size_t n = needle->length;
+    if (n == 0 || size < n) return 0;
+    size_t end = size - n + 1;        // Candidates lie in [0, end)
+
+    uint8_t lower = needle->bytes[0];
+    uint8_t upper = (needle->foldAscii && lower >= 'a' && lower <= 'z') ? (uint8_t)(lower - ('a' - 'A')) : lower;
+    size_t lowerAt = NextByte(data, 0, end, lower);
+    size_t upperAt = upper != lower ? NextByte(data, 0, end, upper) : NOT_FOUND;
+
+    FileHit hit;
+    memset(&hit, 0, sizeof(hit));
+    size_t counted = 0;               // Line breaks before this offset are counted
+    size_t columnAt = 0;              // hit.column is the column of this offset
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (pos < end) {
+        if (lowerAt < pos) lowerAt = NextByte(data, pos, end, lower);
+        if (upperAt < pos && upper != lower) upperAt = NextByte(data, pos, end, upper);
+        size_t i = lowerAt < upperAt ? lowerAt : upperAt;
+        if (i == NOT_FOUND) break;
+
+        size_t k = 1;
+        if (needle->foldAscii) {
+            while (k < n && AsciiLower(data[i + k]) == needle->bytes[k]) k++;
+        } else {
+            while (k < n && data[i + k] == needle->bytes[k]) k++;
+        }
+        if (k < n) {
+            pos = i + 1;
+            continue;
+        }
+
+        // Line and column of the match
+        size_t lineBefore = hit.lineStart;
+        for (size_t br = NextByte(data, counted, i, '\n'); br != NOT_FOUND; br = NextByte(data, br + 1, i, '\n')) {
+            hit.line++;
+            hit.lineStart = br + 1;
+        }
+        counted = i;
+        if (hit.lineStart != lineBefore || count == 0) {
+            hit.column = 0;
+            columnAt = hit.lineStart;
+        }
+        hit.column += utf8 ? Utf16Units(data + columnAt, i - columnAt) : (uint64_t)(i - columnAt);
+        columnAt = i;
+
+        hit.matchStart = i;
+        hit.matchLength = n;
+        count++;
+        if (!proc(context, &hit)) break;
+        pos = i + n;
+    }
+    return count;
+}
+
+// ============================================================================
+// FileSearchWide
+// ============================================================================
+size_t FileSearchWide(const uint16_t *needle, size_t needleLength, const uint16_t *fold,
+                      const uint16_t *text, size_t length, FileHitProc proc, void *context) {
+    FileHit hit;
+    memset(&hit, 0, sizeof(hit));
+    size_t counted = 0;
+    size_t count = 0;
+    size_t pos = 0;
+    TextNeedle prepared;
+    TextNeedleInit(&prepared, needle, needleLength, fold);
+    size_t i;
+    while ((i = TextNeedleFind(&prepared, text, length, pos)) != TEXT_NOT_FOUND) {
+        for (; counted < i; ++counted) {
+            if (text[counted] == '\n') {
+                hit.line++;
+                hit.lineStart = counted + 1;
+            }
+        }
+        hit.column = i - hit.lineStart;
+        hit.matchStart = i;
+        hit.matchLength = needleLength;
+        count++;
+        if (!proc(context, &hit)) break;
+        pos = i + needleLength;
+    }
+    return count;
+}
+
+// ============================================================================
+// FileSearchLooksBinary
+// ============================================================================
+bool FileSearchLooksBinary(const uint8_t *data, size_t size) {
+    return memchr(data, 0, size < FILE_SEARCH_BINARY_PROBE ? size : FILE_SEARCH_BINARY_PROBE) != NULL;
+}
+
+// ============================================================================
+// FileSearchMatchSpec - Wildcard File Name Filter
+// ============================================================================
+static uint16_t LowerUnit(uint16_t ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (uint16_t)(ch + ('a' - 'A')) : ch;
+}
+
+// Matches a whole name against pattern[0, patternLength); '*' backtracks to
+// the most recent star only, which is enough for wildcards
+static bool MatchWildcard(const uint16_t *name, const uint16_t *pattern, size_t patternLength) {
+    size_t p = 0, starP = NOT_FOUND;
+    const uint16_t *starName = NULL;
+    while (*name) {
+        if (p < patternLength && pattern[p] == '*') {
+            starP = ++p;
+            starName = name;
+        } else if (p < patternLength && (pattern[p] == '?' || LowerUnit(pattern[p]) == LowerUnit(*name))) {
+            p++;
+            name++;
+        } else if (starP != NOT_FOUND) {
+            p = starP;
+            name = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (p < patternLength && pattern[p] == '*') p++;
+    return p == patternLength;
+}
+
+bool FileSearchMatchSpec(const uint16_t *name, const uint16_t *spec) {
+    bool any = false;
+    while (*spec) {
+        while (*spec == ' ' || *spec == ';') spec++;
+        size_t length = 0;
+        while (spec[length] && spec[length] != ';') length++;
+        while (length > 0 && spec[length - 1] == ' ') length--;
+        if (length > 0) {
+            any = true;
+            if (MatchWildcard(name, spec, length)) return true;
+        }
+        spec += length;
+        while (*spec && *spec != ';') spec++;
+    }
+    return !any;
+}
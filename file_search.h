@@ -0,0 +1,76 @@
+// ============================================================================
+// file_search.h - Literal Search of File Contents Header
+// ============================================================================
+// The per-file part of Find in Files: searches one file's contents, as they
+// lie in memory, for a literal and reports every match with its line and
+// column. Three scanners cover the encodings:
+//   - FileSearchBytes: UTF-8 and single-byte ANSI text searched as bytes,
+//     with no transcoding. Only for needles that are pure ASCII, whose bytes
+//     are the same in every ASCII-compatible encoding.
+//   - FileSearchWide: UTF-16 text (a mapped UTF-16LE file, or any other file
+//     after decoding).
+// Matches do not overlap. Lines end at '\n'. Columns and match lengths are
+// counted in UTF-16 code units, as in the editor.
+// Also holds the file name filter ("*.c;*.h") and the binary file check.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FILE_SEARCH_MAX_NEEDLE   127      // Longest needle (as the Find box)
+#define FILE_SEARCH_BINARY_PROBE 8192     // Bytes checked for NUL by FileSearchLooksBinary
+
+// ============================================================================
+// Byte Needles
+// ============================================================================
+typedef struct ByteNeedle {
+    uint8_t bytes[FILE_SEARCH_MAX_NEEDLE];  // Lowercased if 'foldAscii'
+    size_t length;
+    bool foldAscii;                         // Match A-Z and a-z alike
+} ByteNeedle;
+
+// Prepares a needle for FileSearchBytes. Returns false if the needle is
+// empty, too long, or has characters outside ASCII (search it as UTF-16).
+bool ByteNeedleInit(ByteNeedle *needle, const uint16_t *text, size_t length, bool matchCase);
+
+// ============================================================================
+// Matches
+// ============================================================================
+typedef struct FileHit {
+    uint64_t line;          // 0-based line number
+    uint64_t column;        // UTF-16 code units from the start of the line
+    size_t lineStart;       // Buffer offset of the line (bytes or UTF-16 units)
+    size_t matchStart;      // Buffer offset of the match
+    size_t matchLength;     // Length in the buffer's units
+} FileHit;
+
+// Receives each match in order. Return false to stop the scan.
+typedef bool (*FileHitProc)(void *context, const FileHit *hit);
+
+// Searches bytes. 'utf8' counts columns in UTF-16 units of the decoded
+// UTF-8; otherwise every byte is one character (single-byte code pages).
+// Returns the number of matches reported.
+size_t FileSearchBytes(const ByteNeedle *needle, const uint8_t *data, size_t size, bool utf8,
+                       FileHitProc proc, void *context);
+
+// Searches UTF-16 text; 'fold' as in TextFind (65536 entries, or NULL).
+// Returns the number of matches reported.
+size_t FileSearchWide(const uint16_t *needle, size_t needleLength, const uint16_t *fold,
+                      const uint16_t *text, size_t length, FileHitProc proc, void *context);
+
+// ============================================================================
+// File Selection
+// ============================================================================
+
+// True if the data has a NUL byte in its first FILE_SEARCH_BINARY_PROBE
+// bytes (and so is not text in any byte encoding).
+bool FileSearchLooksBinary(const uint8_t *data, size_t size);
+
+// True if the file name matches one of the ';'-separated wildcard patterns
+// in 'spec' ('*' and '?', ASCII case-insensitive). An empty spec matches
+// everything. Both strings are NUL-terminated.
+bool FileSearchMatchSpec(const uint16_t *name, const uint16_t *spec);
@@ -0,0 +1,508 @@
+// ============================================================================
+// find_in_files.c - Find in Files Implementation
+// ============================================================================
+// Work items live on one stack guarded by a critical section; idle workers
+// sleep on a condition variable. 'pending' counts items pushed but not yet
+// finished, so the worker that finishes the last one knows the search is
+// over. Matches are first collected per file by the worker, then published
+// under the result lock in one step; their strings go to an append-only
+// arena so that published pointers never move.
+// ============================================================================
+
+#include "find_in_files.h"
+#include "file_io.h"
+#include "file_search.h"
+#include <strsafe.h>   // For safe string operations
+
+#define TEXT_BLOCK_CHARS  (64u * 1024)      // Arena block size
+
+typedef struct WorkItem {
+    BOOL folder;                        // List it (TRUE) or search it (FALSE)
+    WCHAR path[1];                      // Allocated to fit
+} WorkItem;
+
+typedef struct TextBlock {
+    struct TextBlock *next;
+    size_t used;
+    size_t capacity;
+    WCHAR text[1];                      // Allocated to fit
+} TextBlock;
+
+// Matches of one file, collected by a worker before they are published
+typedef struct FileScan {
+    FileHit *hits;
+    size_t count;                       // Hits stored
+    size_t capacity;
+    WCHAR *texts;                       // Line text of each stored hit, NUL-terminated, in order
+    size_t textsUsed;
+    size_t textsCapacity;
+} FileScan;
+
+struct FindInFiles {
+    // Query
+    WCHAR folder[MAX_PATH];
+    WCHAR fileTypes[MAX_PATH];
+    WCHAR needle[FILE_SEARCH_MAX_NEEDLE + 1];
+    size_t needleLength;
+    const uint16_t *fold;
+    ByteNeedle byteNeedle;
+    BOOL byteNeedleValid;               // The needle is ASCII: search byte encodings as bytes
+    BOOL singleByteAnsi;                // The ANSI code page has one byte per character
+    HWND notify;
+    UINT message;
+
+    // Work stack
+    CRITICAL_SECTION queueLock;
+    CONDITION_VARIABLE queueReady;
+    WorkItem **stack;
+    size_t stackCount;
+    size_t stackCapacity;
+    size_t pending;                     // Items pushed and not yet finished
+    volatile LONG cancel;
+
+    // Results
+    CRITICAL_SECTION resultLock;        // Guards everything up to 'filesMatched'
+    FileMatch *matches;
+    size_t matchCount;
+    size_t matchCapacity;
+    TextBlock *blocks;                  // Newest first
+    ULONGLONG totalMatches;
+    ULONGLONG filesMatched;
+    volatile LONGLONG filesSearched;
+    volatile LONG done;
+    volatile LONG notifyPending;        // A message is posted and not yet polled
+
+    HANDLE threads[FIND_IN_FILES_MAX_THREADS];
+    DWORD threadCount;
+};
+
+// ============================================================================
+// Notify - Post the Owner's Message Unless One Is Pending
+// ============================================================================
+static void Notify(FindInFiles *search) {
+    if (InterlockedExchange(&search->notifyPending, 1) == 0) {
+        PostMessageW(search->notify, search->message, 0, 0);
+    }
+}
+
+// ============================================================================
+// Work Stack
+// ============================================================================
+// Pushes "<folder>\<name>", or just the folder if 'name' is NULL
+static BOOL PushItem(FindInFiles *search, const WCHAR *folder, size_t folderLength, const WCHAR *name, BOOL isFolder) {
+    size_t nameLength = name ? wcslen(name) + 1 : 0;
+    size_t pathLength = folderLength + nameLength;
+    WorkItem *item = (WorkItem *)HeapAlloc(GetProcessHeap(), 0, sizeof(WorkItem) + pathLength * sizeof(WCHAR));
+    if (!item) return FALSE;
+    item->folder = isFolder;
+    CopyMemory(item->path, folder, folderLength * sizeof(WCHAR));
+    if (name) {
+        item->path[folderLength] = L'\\';
+        CopyMemory(item->path + folderLength + 1, name, nameLength * sizeof(WCHAR));
+    }
+    item->path[pathLength] = L'\0';
+
+    EnterCriticalSection(&search->queueLock);
+    BOOL ok = TRUE;
+    if (search->stackCount == search->stackCapacity) {
+        size_t newCapacity = search->stackCapacity ? search->stackCapacity * 2 : 256;
+        WorkItem **grown = search->stack
+            ? (WorkItem **)HeapReAlloc(GetProcessHeap(), 0, search->stack, newCapacity * sizeof(WorkItem *))
+            : (WorkItem **)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(WorkItem *));
+        if (grown) {
+            search->stack = grown;
+            search->stackCapacity = newCapacity;
+        } else {
+            ok = FALSE;
+        }
+    }
+    if (ok) {
+        search->stack[search->stackCount++] = item;
+        search->pending++;
+        WakeConditionVariable(&search->queueReady);
+    }
+    LeaveCriticalSection(&search->queueLock);
+    if (!ok) HeapFree(GetProcessHeap(), 0, item);
+    return ok;
+}
+
+// ============================================================================
+// ListFolder - Push a Folder's Subfolders and Matching Files
+// ============================================================================
+static void ListFolder(FindInFiles *search, const WCHAR *folder) {
+    size_t folderLength = wcslen(folder);
+    WCHAR *pattern = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (folderLength + 3) * sizeof(WCHAR));
+    if (!pattern) return;
+    CopyMemory(pattern, folder, folderLength * sizeof(WCHAR));
+    CopyMemory(pattern + folderLength, L"\\*", 3 * sizeof(WCHAR));
+
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileExW(pattern, FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+                                   FIND_FIRST_EX_LARGE_FETCH);
+    HeapFree(GetProcessHeap(), 0, pattern);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        if (search->cancel) break;
+        // ".", "..", and names hidden by convention (.git, .vs)
+        if (data.cFileName[0] == L'.') continue;
+        if (data.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_REPARSE_POINT)) {
+            continue;
+        }
+        BOOL isFolder = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (!isFolder && !FileSearchMatchSpec((const uint16_t *)data.cFileName, (const uint16_t *)search->fileTypes)) {
+            continue;
+        }
+        PushItem(search, folder, folderLength, data.cFileName, isFolder);
+    } while (FindNextFileW(find, &data));
+    FindClose(find);
+}
+
+// ============================================================================
+// Collecting the Matches of One File
+// ============================================================================
+static bool CollectHit(void *context, const FileHit *hit) {
+    FileScan *scan = (FileScan *)context;
+    if (scan->count == FIND_IN_FILES_MAX_MATCHES) return true;   // Counted only
+    if (scan->count == scan->capacity) {
+        size_t newCapacity = scan->capacity ? scan->capacity * 2 : 64;
+        FileHit *grown = scan->hits
+            ? (FileHit *)HeapReAlloc(GetProcessHeap(), 0, scan->hits, newCapacity * sizeof(FileHit))
+            : (FileHit *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(FileHit));
+        if (!grown) return true;
+        scan->hits = grown;
+        scan->capacity = newCapacity;
+    }
+    scan->hits[scan->count++] = *hit;
+    return true;
+}
+
+// Appends one line of text (tabs as spaces, no CR) to scan->texts
+static BOOL AddText(FileScan *scan, const WCHAR *text, size_t length) {
+    size_t needed = scan->textsUsed + length + 1;
+    if (needed > scan->textsCapacity) {
+        size_t newCapacity = scan->textsCapacity ? scan->textsCapacity : 4096;
+        while (newCapacity < needed) newCapacity *= 2;
+        WCHAR *grown = scan->texts
+            ? (WCHAR *)HeapReAlloc(GetProcessHeap(), 0, scan->texts, newCapacity * sizeof(WCHAR))
+            : (WCHAR *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(WCHAR));
+        if (!grown) return FALSE;
+        scan->texts = grown;
+        scan->textsCapacity = newCapacity;
+    }
+    WCHAR *out = scan->texts + scan->textsUsed;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] == L'\r') continue;
+        *out++ = text[i] == L'\t' ? L' ' : text[i];
+    }
+    *out++ = L'\0';
+    scan->textsUsed = (size_t)(out - scan->texts);
+    return TRUE;
+}
+
+// Line text around a match in byte-encoded data
+static BOOL AddByteContext(FileScan *scan, const uint8_t *data, size_t size, const FileHit *hit, UINT codePage) {
+    size_t begin = hit->matchStart - hit->lineStart > FIND_IN_FILES_BEFORE
+                 ? hit->matchStart - FIND_IN_FILES_BEFORE : hit->lineStart;
+    if (codePage == CP_UTF8) {
+        while (begin < hit->matchStart && (data[begin] & 0xC0) == 0x80) begin++;
+    }
+    size_t end = begin;
+    while (end < size && end - begin < FIND_IN_FILES_CONTEXT && data[end] != '\n') end++;
+    if (codePage == CP_UTF8 && end < size) {
+        while (end > hit->matchStart && (data[end] & 0xC0) == 0x80) end--;   // Keep sequences whole
+    }
+    // No more characters than bytes in UTF-8 and ANSI, so the buffer is enough
+    WCHAR line[FIND_IN_FILES_CONTEXT];
+    int chars = end > begin ? MultiByteToWideChar(codePage, 0, (LPCSTR)(data + begin), (int)(end - begin),
+                                                  line, FIND_IN_FILES_CONTEXT) : 0;
+    return AddText(scan, line, chars > 0 ? (size_t)chars : 0);
+}
+
+// Line text around a match in UTF-16 text
+static BOOL AddWideContext(FileScan *scan, const uint16_t *text, size_t length, const FileHit *hit) {
+    size_t begin = hit->matchStart - hit->lineStart > FIND_IN_FILES_BEFORE
+                 ? hit->matchStart - FIND_IN_FILES_BEFORE : hit->lineStart;
+    size_t end = begin;
+    while (end < length && end - begin < FIND_IN_FILES_CONTEXT && text[end] != '\n') end++;
+    return AddText(scan, (const WCHAR *)text + begin, end - begin);
+}
+
+// ============================================================================
+// PublishFile - Hand One File's Matches to the Owner
+// ============================================================================
+static WCHAR *ArenaAlloc(FindInFiles *search, size_t chars) {
+    TextBlock *block = search->blocks;
+    if (!block || block->capacity - block->used < chars) {
+        size_t capacity = chars > TEXT_BLOCK_CHARS ? chars : TEXT_BLOCK_CHARS;
+        block = (TextBlock *)HeapAlloc(GetProcessHeap(), 0, sizeof(TextBlock) + capacity * sizeof(WCHAR));
+        if (!block) return NULL;
+        block->next = search->blocks;
+        block->used = 0;
+        block->capacity = capacity;
+        search->blocks = block;
+    }
+    WCHAR *result = block->text + block->used;
+    block->used += chars;
+    return result;
+}
+
+static void PublishFile(FindInFiles *search, const WCHAR *path, const FileScan *scan, size_t found) {
+    size_t pathChars = wcslen(path) + 1;
+    EnterCriticalSection(&search->resultLock);
+    search->totalMatches += found;
+    search->filesMatched++;
+
+    // Keep what still fits, and only hits whose text could be made
+    size_t room = FIND_IN_FILES_MAX_MATCHES - search->matchCount;
+    size_t keep = 0, textChars = 0;
+    while (keep < room && keep < scan->count && textChars < scan->textsUsed) {
+        textChars += wcslen(scan->texts + textChars) + 1;
+        keep++;
+    }
+    if (keep > 0 && search->matchCount + keep > search->matchCapacity) {
+        size_t newCapacity = search->matchCapacity ? search->matchCapacity : 1024;
+        while (newCapacity < search->matchCount + keep) newCapacity *= 2;
+        FileMatch *grown = search->matches
+            ? (FileMatch *)HeapReAlloc(GetProcessHeap(), 0, search->matches, newCapacity * sizeof(FileMatch))
+            : (FileMatch *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(FileMatch));
+        if (grown) {
+            search->matches = grown;
+            search->matchCapacity = newCapacity;
+        } else {
+            keep = 0;
+        }
+    }
+    WCHAR *strings = keep > 0 ? ArenaAlloc(search, pathChars + textChars) : NULL;
+    if (strings) {
+        CopyMemory(strings, path, pathChars * sizeof(WCHAR));
+        CopyMemory(strings + pathChars, scan->texts, textChars * sizeof(WCHAR));
+        const WCHAR *text = strings + pathChars;
+        for (size_t i = 0; i < keep; ++i) {
+            FileMatch *match = &search->matches[search->matchCount++];
+            match->path = strings;
+            match->line = scan->hits[i].line;
+            match->column = scan->hits[i].column;
+            match->length = (DWORD)search->needleLength;
+            match->text = text;
+            text += wcslen(text) + 1;
+        }
+    }
+    LeaveCriticalSection(&search->resultLock);
+    Notify(search);
+}
+
+// ============================================================================
+// SearchFile - Search One Memory-Mapped File
+// ============================================================================
+static void SearchFile(FindInFiles *search, FileScan *scan, const WCHAR *path) {
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+    InterlockedIncrement64(&search->filesSearched);
+
+    // Same size limit as opening a file; empty files have nothing to map
+    LARGE_INTEGER fileSize = {0};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > (LONGLONG)UINT_MAX) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const uint8_t *data = mapping ? (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    DWORD size = (DWORD)fileSize.QuadPart;
+
+    scan->count = 0;
+    scan->textsUsed = 0;
+    size_t found = 0;
+    WCHAR *decoded = NULL;
+    TextEncoding encoding = DetectBOM(data, size);
+
+    if (encoding == ENC_UTF16LE && size >= 2) {
+        // Already UTF-16: search the mapped view itself
+        const uint16_t *text = (const uint16_t *)(data + 2);
+        size_t length = (size - 2) / 2;
+        found = FileSearchWide((const uint16_t *)search->needle, search->needleLength, search->fold,
+                               text, length, CollectHit, scan);
+        for (size_t i = 0; i < scan->count && AddWideContext(scan, text, length, &scan->hits[i]); ++i) {}
+    } else if (encoding != ENC_UTF16BE && FileSearchLooksBinary(data, size)) {
+        // Not text
+    } else {
+        // An ASCII needle has the same bytes in UTF-8 and single-byte ANSI.
+        // Multi-byte ANSI can hide ASCII bytes inside characters, so such
+        // files go through decoding unless they are UTF-8.
+        if (encoding == ENC_AUTO && search->byteNeedleValid && !search->singleByteAnsi) {
+            encoding = DetectEncoding(data, size);
+        }
+        BOOL bytes = search->byteNeedleValid && encoding != ENC_UTF16BE && encoding != ENC_ANSI;
+        if (bytes) {
+            size_t skip = (encoding == ENC_UTF8 && size >= 3 && data[0] == 0xEF) ? 3 : 0;
+            found = FileSearchBytes(&search->byteNeedle, data + skip, size - skip, true, CollectHit, scan);
+            // The encoding matters only for files with matches: ANSI text
+            // has one column per byte
+            if (found && encoding == ENC_AUTO) encoding = DetectEncoding(data, size);
+            UINT codePage = encoding == ENC_UTF8 ? CP_UTF8 : CP_ACP;
+            for (size_t i = 0; i < scan->count; ++i) {
+                FileHit *hit = &scan->hits[i];
+                if (codePage == CP_ACP) hit->column = hit->matchStart - hit->lineStart;
+                if (!AddByteContext(scan, data + skip, size - skip, hit, codePage)) break;
+            }
+        } else {
+            if (encoding == ENC_AUTO) encoding = DetectEncoding(data, size);
+            size_t length = 0;
+            if (DecodeToWide(data, size, encoding, &decoded, &length)) {
+                found = FileSearchWide((const uint16_t *)search->needle, search->needleLength, search->fold,
+                                       (const uint16_t *)decoded, length, CollectHit, scan);
+                for (size_t i = 0; i < scan->count &&
+                     AddWideContext(scan, (const uint16_t *)decoded, length, &scan->hits[i]); ++i) {}
+            }
+        }
+    }
+
+    if (found) PublishFile(search, path, scan, found);
+    if (decoded) HeapFree(GetProcessHeap(), 0, decoded);
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+}
+
+// ============================================================================
+// FindWorker - Worker Thread: Take Items Until the Tree Is Done
+// ============================================================================
+static DWORD WINAPI FindWorker(LPVOID param) {
+    FindInFiles *search = (FindInFiles *)param;
+    FileScan scan;
+    ZeroMemory(&scan, sizeof(scan));
+
+    for (;;) {
+        EnterCriticalSection(&search->queueLock);
+        while (search->stackCount == 0 && search->pending > 0 && !search->cancel) {
+            SleepConditionVariableCS(&search->queueReady, &search->queueLock, INFINITE);
+        }
+        if (search->stackCount == 0 || search->cancel) {
+            LeaveCriticalSection(&search->queueLock);
+            break;
+        }
+        WorkItem *item = search->stack[--search->stackCount];
+        LeaveCriticalSection(&search->queueLock);
+
+        if (item->folder) {
+            ListFolder(search, item->path);
+        } else {
+            SearchFile(search, &scan, item->path);
+        }
+        HeapFree(GetProcessHeap(), 0, item);
+
+        EnterCriticalSection(&search->queueLock);
+        BOOL finished = --search->pending == 0;
+        if (finished) WakeAllConditionVariable(&search->queueReady);
+        LeaveCriticalSection(&search->queueLock);
+        if (finished) {
+            InterlockedExchange(&search->done, 1);
+            Notify(search);
+        }
+    }
+
+    if (scan.hits) HeapFree(GetProcessHeap(), 0, scan.hits);
+    if (scan.texts) HeapFree(GetProcessHeap(), 0, scan.texts);
+    return 0;
+}
+
+// ============================================================================
+// FindInFilesStart
+// ============================================================================
+FindInFiles *FindInFilesStart(const FindInFilesQuery *query, HWND notify, UINT message) {
+    size_t needleLength = wcslen(query->needle);
+    if (needleLength == 0 || needleLength > FILE_SEARCH_MAX_NEEDLE) return NULL;
+    FindInFiles *search = (FindInFiles *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(FindInFiles));
+    if (!search) return NULL;
+
+    StringCchCopyW(search->folder, ARRAYSIZE(search->folder), query->folder);
+    size_t folderLength = wcslen(search->folder);
+    while (folderLength > 0 && search->folder[folderLength - 1] == L'\\') search->folder[--folderLength] = L'\0';
+    StringCchCopyW(search->fileTypes, ARRAYSIZE(search->fileTypes), query->fileTypes ? query->fileTypes : L"");
+    StringCchCopyW(search->needle, ARRAYSIZE(search->needle), query->needle);
+    search->needleLength = needleLength;
+    search->fold = query->matchCase ? NULL : query->fold;
+    search->byteNeedleValid = ByteNeedleInit(&search->byteNeedle, (const uint16_t *)search->needle, needleLength,
+                                             query->matchCase != FALSE);
+    CPINFO codePage;
+    search->singleByteAnsi = GetCPInfo(CP_ACP, &codePage) && codePage.MaxCharSize == 1;
+    search->notify = notify;
+    search->message = message;
+    InitializeCriticalSection(&search->queueLock);
+    InitializeCriticalSection(&search->resultLock);
+    InitializeConditionVariable(&search->queueReady);
+
+    // The folder itself is the first work item
+    BOOL pushed = PushItem(search, search->folder, folderLength, NULL, TRUE);
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    DWORD threads = info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+    if (threads > FIND_IN_FILES_MAX_THREADS) threads = FIND_IN_FILES_MAX_THREADS;
+    for (DWORD i = 0; pushed && i < threads; ++i) {
+        HANDLE thread = CreateThread(NULL, 0, FindWorker, search, 0, NULL);
+        if (thread) search->threads[search->threadCount++] = thread;
+    }
+    if (search->threadCount == 0) {
+        FindInFilesFree(search);
+        return NULL;
+    }
+    return search;
+}
+
+// ============================================================================
+// FindInFilesFree
+// ============================================================================
+void FindInFilesFree(FindInFiles *search) {
+    if (!search) return;
+    EnterCriticalSection(&search->queueLock);
+    InterlockedExchange(&search->cancel, 1);
+    WakeAllConditionVariable(&search->queueReady);
+    LeaveCriticalSection(&search->queueLock);
+    if (search->threadCount) WaitForMultipleObjects(search->threadCount, search->threads, TRUE, INFINITE);
+    for (DWORD i = 0; i < search->threadCount; ++i) CloseHandle(search->threads[i]);
+
+    for (size_t i = 0; i < search->stackCount; ++i) HeapFree(GetProcessHeap(), 0, search->stack[i]);
+    if (search->stack) HeapFree(GetProcessHeap(), 0, search->stack);
+    while (search->blocks) {
+        TextBlock *next = search->blocks->next;
+        HeapFree(GetProcessHeap(), 0, search->blocks);
+        search->blocks = next;
+    }
+    if (search->matches) HeapFree(GetProcessHeap(), 0, search->matches);
+    DeleteCriticalSection(&search->queueLock);
+    DeleteCriticalSection(&search->resultLock);
+    HeapFree(GetProcessHeap(), 0, search);
+}
+
+// ============================================================================
+// FindInFilesPoll / FindInFilesGetMatch / FindInFilesFolder
+// ============================================================================
+void FindInFilesPoll(FindInFiles *search, FindInFilesStatus *status) {
+    // Re-arm first: anything published from here on posts a new message
+    InterlockedExchange(&search->notifyPending, 0);
+    status->done = InterlockedCompareExchange(&search->done, 0, 0) != 0;
+    EnterCriticalSection(&search->resultLock);
+    status->matches = search->matchCount;
+    status->totalMatches = search->totalMatches;
+    status->filesMatched = search->filesMatched;
+    LeaveCriticalSection(&search->resultLock);
+    status->filesSearched = (ULONGLONG)InterlockedCompareExchange64(&search->filesSearched, 0, 0);
+}
+
+BOOL FindInFilesGetMatch(FindInFiles *search, size_t index, FileMatch *match) {
+    EnterCriticalSection(&search->resultLock);
+    BOOL ok = index < search->matchCount;
+    if (ok) *match = search->matches[index];
+    LeaveCriticalSection(&search->resultLock);
+    return ok;
+}
+
+const WCHAR *FindInFilesFolder(const FindInFiles *search) {
+    return search->folder;
+}
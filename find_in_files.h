@@ -0,0 +1,69 @@
+// ============================================================================
+// find_in_files.h - Find in Files Header
+// ============================================================================
+// Searches every file under a folder for a literal, in the background.
+//   - A pool of worker threads shares one stack of work items. An item is a
+//     folder (listed, its children pushed back onto the stack) or a file
+//     (searched), so listing the tree is as parallel as searching it.
+//   - Files are memory-mapped, not read. UTF-16LE files are searched in
+//     place. UTF-8 and ANSI files are searched as bytes when the needle is
+//     ASCII (see file_search.h): no transcoding, and encoding detection only
+//     for files with matches. Anything else is decoded with DecodeToWide.
+//   - Binary files (a NUL in the first 8 KB), hidden and system files,
+//     names starting with '.' and reparse points are skipped.
+// Matches collect in the search object. The owner window gets a posted
+// message whenever new matches are available and when the search ends;
+// FindInFilesPoll re-arms that message.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+
+#define FIND_IN_FILES_MAX_THREADS  16
+#define FIND_IN_FILES_MAX_MATCHES  (1u << 20)     // Matches kept; later ones are only counted
+#define FIND_IN_FILES_CONTEXT      160            // Line text kept per match
+#define FIND_IN_FILES_BEFORE       40             // Of which at most this much precedes it
+
+typedef struct FindInFiles FindInFiles;
+
+typedef struct FindInFilesQuery {
+    const WCHAR *folder;                // Folder to search (with subfolders)
+    const WCHAR *fileTypes;             // "*.c;*.h"; empty for all files
+    const WCHAR *needle;                // Literal to find
+    BOOL matchCase;
+    const uint16_t *fold;               // Lowercase table for !matchCase (see TextFind)
+} FindInFilesQuery;
+
+typedef struct FileMatch {
+    const WCHAR *path;                  // Full path of the file
+    ULONGLONG line;                     // 0-based line ('\n'-terminated lines)
+    ULONGLONG column;                   // UTF-16 code units from the line start
+    DWORD length;                       // Match length in UTF-16 code units
+    const WCHAR *text;                  // Line text around the match
+} FileMatch;
+
+typedef struct FindInFilesStatus {
+    size_t matches;                     // Matches kept (rows)
+    ULONGLONG totalMatches;             // Matches found, including those not kept
+    ULONGLONG filesSearched;
+    ULONGLONG filesMatched;
+    BOOL done;                          // Every file has been searched
+} FindInFilesStatus;
+
+// Starts a search. 'message' is posted to 'notify' as results arrive.
+// Returns NULL if the search could not be started.
+FindInFiles *FindInFilesStart(const FindInFilesQuery *query, HWND notify, UINT message);
+
+// Stops the search, waits for the workers and frees everything.
+void FindInFilesFree(FindInFiles *search);
+
+// Reads the progress and re-arms the notification message.
+void FindInFilesPoll(FindInFiles *search, FindInFilesStatus *status);
+
+// Copies match 'index'. The strings stay valid until FindInFilesFree.
+BOOL FindInFilesGetMatch(FindInFiles *search, size_t index, FileMatch *match);
+
+// The folder the search started in (no trailing backslash).
+const WCHAR *FindInFilesFolder(const FindInFiles *search);
@@ -0,0 +1,284 @@
+// ============================================================================
+// fuzzy_match.c - Fuzzy Line Matching Implementation
+// ============================================================================
+// The scoring constants follow the usual fuzzy finder weights: a match is
+// worth 16, a word boundary adds half that, and the consecutive bonus
+// equals what a one-character gap costs, so "abc" in "abc" beats "a_b_c".
+// ============================================================================
+
+#include "fuzzy_match.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SCORE_MATCH             16
+#define SCORE_GAP_START         (-3)
+#define SCORE_GAP_EXTENSION     (-1)
+#define BONUS_BOUNDARY          8       // First character of a word
+#define BONUS_NONWORD           8       // Punctuation matched as such
+#define BONUS_CAMEL             7       // Lower-to-upper hump, or the start of a number
+#define BONUS_CONSECUTIVE       4       // Right after the previous match
+#define BONUS_FIRST_MULTIPLIER  2       // The query's first character counts double
+
+typedef enum CharClass {
+    CLASS_NONWORD = 0,
+    CLASS_LOWER = 1,
+    CLASS_UPPER = 2,
+    CLASS_DIGIT = 3
+} CharClass;
+
+static uint16_t FoldUnit(const uint16_t *fold, uint16_t ch) {
+    if (fold) return fold[ch];
+    return (ch >= 'A' && ch <= 'Z') ? (uint16_t)(ch + ('a' - 'A')) : ch;
+}
+
+// Bit of a folded character in a class mask: one per letter and digit, and
+// hashed bins for other ASCII and for everything else
+static unsigned MaskBit(uint16_t ch) {
+    if (ch >= 'a' && ch <= 'z') return ch - 'a';
+    if (ch >= '0' && ch <= '9') return 26 + (ch - '0');
+    if (ch < 0x80) return 36 + (ch & 15);
+    return 52 + (ch % 12);
+}
+
+static CharClass ClassOf(const uint16_t *fold, uint16_t ch) {
+    if (ch >= 'a' && ch <= 'z') return CLASS_LOWER;
+    if (ch >= 'A' && ch <= 'Z') return CLASS_UPPER;
+    if (ch >= '0' && ch <= '9') return CLASS_DIGIT;
+    if (ch < 0x80) return CLASS_NONWORD;
+    if (ch == 0x00A0 || ch == 0x3000 || (ch >= 0x2000 && ch <= 0x206F)) return CLASS_NONWORD;
+    if (fold && fold[ch] != ch) return CLASS_UPPER;
+    return CLASS_LOWER;
+}
+
+static int Bonus(CharClass previous, CharClass current) {
+    if (previous == CLASS_NONWORD && current != CLASS_NONWORD) return BONUS_BOUNDARY;
+    if ((previous == CLASS_LOWER && current == CLASS_UPPER) ||
+        (previous != CLASS_DIGIT && current == CLASS_DIGIT)) {
+        return BONUS_CAMEL;
+    }
+    if (current == CLASS_NONWORD) return BONUS_NONWORD;
+    return 0;
+}
+
+// ============================================================================
+// FuzzyQueryInit / FuzzyTextMask
+// ============================================================================
+bool FuzzyQueryInit(FuzzyQuery *query, const uint16_t *text, size_t length, const uint16_t *fold) {
+    memset(query, 0, sizeof(*query));
+    query->fold = fold;
+    for (size_t i = 0; i < length && query->length < FUZZY_MAX_QUERY; ++i) {
+        if (text[i] == ' ' || text[i] == '\t') continue;
+        if (FoldUnit(fold, text[i]) != text[i]) query->matchCase = true;
+        query->units[query->length++] = text[i];
+    }
+    for (size_t i = 0; i < query->length; ++i) {
+        uint16_t folded = FoldUnit(fold, query->units[i]);
+        query->mask |= (uint64_t)1 << MaskBit(folded);
+        if (!query->matchCase) query->units[i] = folded;
+    }
+    return query->length > 0;
+}
+
+uint64_t FuzzyTextMask(const uint16_t *text, size_t length, const uint16_t *fold) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < length; ++i) mask |= (uint64_t)1 << MaskBit(FoldUnit(fold, text[i]));
+    return mask;
+}
+
+// ============================================================================
+// FuzzyScore
+// ============================================================================
+// Finds where the first in-order match ends, walks back from there to the
+// latest start (the shortest window ending at that point), then scores the
+// window left to right. A run of matches keeps the best boundary bonus it
+// started with, so "FileOpen" scores every letter of "file" as a word start.
+// ============================================================================
+int32_t FuzzyScore(const FuzzyQuery *query, const uint16_t *line, size_t length) {
+    size_t m = query->length;
+    if (m == 0 || length < m) return FUZZY_NO_MATCH;
+    const uint16_t *fold = query->fold;
+    bool matchCase = query->matchCase;
+
+    size_t j = 0, end = 0;
+    for (size_t i = 0; i < length; ++i) {
+        uint16_t ch = matchCase ? line[i] : FoldUnit(fold, line[i]);
+        if (ch == query->units[j] && ++j == m) {
+            end = i + 1;
+            break;
+        }
+    }
+    if (j < m) return FUZZY_NO_MATCH;
+
+    size_t start = end;
+    while (j > 0) {
+        --start;
+        uint16_t ch = matchCase ? line[start] : FoldUnit(fold, line[start]);
+        if (ch == query->units[j - 1]) j--;
+    }
+
+    int64_t score = 0;
+    int firstBonus = 0;
+    size_t consecutive = 0;
+    bool inGap = false;
+    CharClass previous = start > 0 ? ClassOf(fold, line[start - 1]) : CLASS_NONWORD;
+    for (size_t i = start; i < end; ++i) {
+        CharClass current = ClassOf(fold, line[i]);
+        uint16_t ch = matchCase ? line[i] : FoldUnit(fold, line[i]);
+        if (ch == query->units[j]) {
+            int bonus = Bonus(previous, current);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                if (bonus >= BONUS_BOUNDARY && bonus > firstBonus) firstBonus = bonus;
+                if (firstBonus > bonus) bonus = firstBonus;
+                if (BONUS_CONSECUTIVE > bonus) bonus = BONUS_CONSECUTIVE;
+            }
+            score += SCORE_MATCH + (j == 0 ? bonus * BONUS_FIRST_MULTIPLIER : bonus);
+            inGap = false;
+            consecutive++;
+            j++;
+        } else {
+            score += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            inGap = true;
+            consecutive = 0;
+            firstBonus = 0;
+        }
+        previous = current;
+    }
+    return score > INT32_MIN ? (int32_t)score : INT32_MIN + 1;
+}
+
+// ============================================================================
+// FuzzyLinesBuild / FuzzyLinesFree / FuzzyLineLength
+// ============================================================================
+static bool EndsLine(const uint16_t *text, size_t length, size_t i) {
+    return text[i] == '\n' || (text[i] == '\r' && (i + 1 >= length || text[i + 1] != '\n'));
+}
+
+bool FuzzyLinesBuild(FuzzyLines *lines, const uint16_t *text, size_t length, const uint16_t *fold) {
+    memset(lines, 0, sizeof(*lines));
+    size_t count = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if (EndsLine(text, length, i)) count++;
+    }
+    lines->starts = (size_t *)malloc((count + 1) * sizeof(size_t));
+    lines->masks = (uint64_t *)malloc(count * sizeof(uint64_t));
+    if (!lines->starts || !lines->masks) {
+        FuzzyLinesFree(lines);
+        return false;
+    }
+
+    size_t line = 0;
+    uint64_t mask = 0;
+    lines->starts[0] = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (EndsLine(text, length, i)) {
+            lines->masks[line] = mask;
+            lines->starts[++line] = i + 1;
+            mask = 0;
+        } else if (text[i] != '\r') {
+            mask |= (uint64_t)1 << MaskBit(FoldUnit(fold, text[i]));
+        }
+    }
+    lines->masks[line] = mask;
+    lines->starts[count] = length;
+    lines->count = count;
+    return true;
+}
+
+void FuzzyLinesFree(FuzzyLines *lines) {
+    free(lines->starts);
+    free(lines->masks);
+    memset(lines, 0, sizeof(*lines));
+}
+
+size_t FuzzyLineLength(const FuzzyLines *lines, const uint16_t *text, size_t line) {
+    size_t start = lines->starts[line];
+    size_t end = lines->starts[line + 1];
+    if (line + 1 < lines->count) {
+        if (end > start && text[end - 1] == '\n') end--;
+        if (end > start && text[end - 1] == '\r') end--;
+    }
+    return end - start;
+}
+
+// ============================================================================
+// FuzzyTop - Heap of the Best Hits
+// ============================================================================
+static bool Better(const FuzzyHit *a, const FuzzyHit *b) {
+    if (a->score != b->score) return a->score > b->score;
+    if (a->length != b->length) return a->length < b->length;
+    return a->line < b->line;
+}
+
+void FuzzyTopInit(FuzzyTop *top, FuzzyHit *storage, size_t capacity) {
+    top->hits = storage;
+    top->count = 0;
+    top->capacity = capacity;
+}
+
+static void SiftDown(FuzzyTop *top, size_t i) {
+    for (;;) {
+        size_t worst = i;
+        size_t left = 2 * i + 1, right = left + 1;
+        if (left < top->count && Better(&top->hits[worst], &top->hits[left])) worst = left;
+        if (right < top->count && Better(&top->hits[worst], &top->hits[right])) worst = right;
+        if (worst == i) return;
+        FuzzyHit swap = top->hits[i];
+        top->hits[i] = top->hits[worst];
+        top->hits[worst] = swap;
+        i = worst;
+    }
+}
+
+void FuzzyTopOffer(FuzzyTop *top, const FuzzyHit *hit) {
+    if (top->count < top->capacity) {
+        size_t i = top->count++;
+        top->hits[i] = *hit;
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!Better(&top->hits[parent], &top->hits[i])) break;
+            FuzzyHit swap = top->hits[i];
+            top->hits[i] = top->hits[parent];
+            top->hits[parent] = swap;
+            i = parent;
+        }
+    } else if (top->capacity > 0 && Better(hit, &top->hits[0])) {
+        top->hits[0] = *hit;
+        SiftDown(top, 0);
+    }
+}
+
+static int CompareHits(const void *a, const void *b) {
+    const FuzzyHit *x = (const FuzzyHit *)a;
+    const FuzzyHit *y = (const FuzzyHit *)b;
+    if (Better(x, y)) return -1;
+    if (Better(y, x)) return 1;
+    return 0;
+}
+
+void FuzzyTopSort(FuzzyTop *top) {
+    qsort(top->hits, top->count, sizeof(FuzzyHit), CompareHits);
+}
+
+// ============================================================================
+// FuzzyScanLines
+// ============================================================================
+size_t FuzzyScanLines(const FuzzyQuery *query, const FuzzyLines *lines, const uint16_t *text,
+                      size_t first, size_t last, FuzzyTop *top) {
+    uint64_t need = query->mask;
+    size_t matched = 0;
+    for (size_t i = first; i < last; ++i) {
+        if ((lines->masks[i] & need) != need) continue;
+        size_t length = FuzzyLineLength(lines, text, i);
+        int32_t score = FuzzyScore(query, text + lines->starts[i], length);
+        if (score == FUZZY_NO_MATCH) continue;
+        FuzzyHit hit;
+        hit.score = score;
+        hit.length = length > UINT32_MAX ? UINT32_MAX : (uint32_t)length;
+        hit.line = i;
+        FuzzyTopOffer(top, &hit);
+        matched++;
+    }
+    return matched;
+}
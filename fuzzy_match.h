@@ -0,0 +1,99 @@
+// ============================================================================
+// fuzzy_match.h - Fuzzy Line Matching Header
+// ============================================================================
+// Scores lines of a document against a short query the way fuzzy finders
+// do: the query's characters must appear in the line in order, but not
+// next to each other ("opfl" finds "OpenFile").
+//   - A match is scored over the shortest window that ends where the
+//     first left-to-right match ends. Each matched character earns points,
+//     more at the start of a word, after a camelCase hump or a digit run,
+//     and when it follows the previous match; gaps cost a little per
+//     character skipped.
+//   - Spaces in the query are dropped, so "open file" finds "open_file"
+//     and "OpenFile" alike. A query with an uppercase letter matches case;
+//     otherwise case is folded through a lowercase table.
+//   - Every line gets a 64-bit mask of the character classes it contains
+//     (letters, digits, and hashed bins for the rest). A line whose mask
+//     lacks one of the query's bits cannot match and is skipped with one
+//     AND, so most lines are never scored.
+//   - The best lines are kept in a fixed-size heap (FuzzyTop); threads can
+//     each fill their own and merge them.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FUZZY_MAX_QUERY   64            // Query characters used (after dropping spaces)
+#define FUZZY_NO_MATCH    INT32_MIN     // Score of a line that does not match
+
+// ============================================================================
+// Queries and Scoring
+// ============================================================================
+typedef struct FuzzyQuery {
+    uint16_t units[FUZZY_MAX_QUERY];    // As compared: folded unless matching case
+    size_t length;
+    uint64_t mask;                      // Character classes every matching line contains
+    bool matchCase;                     // The query had an uppercase letter
+    const uint16_t *fold;               // Lowercase table (65536 entries), or NULL for ASCII only
+} FuzzyQuery;
+
+// Prepares a query; 'fold' must outlive it. Returns false if nothing is
+// left to match once spaces are dropped.
+bool FuzzyQueryInit(FuzzyQuery *query, const uint16_t *text, size_t length, const uint16_t *fold);
+
+// Character class mask of a stretch of text (see FuzzyQuery.mask).
+uint64_t FuzzyTextMask(const uint16_t *text, size_t length, const uint16_t *fold);
+
+// Score of one line (without its terminator), or FUZZY_NO_MATCH.
+int32_t FuzzyScore(const FuzzyQuery *query, const uint16_t *line, size_t length);
+
+// ============================================================================
+// Line Table
+// ============================================================================
+// Where each line of a text starts, and its class mask. "\r\n", "\n" and
+// "\r" each end one line, as in LineIndex.
+// ============================================================================
+typedef struct FuzzyLines {
+    size_t count;                       // Lines (an empty text has 1)
+    size_t *starts;                     // count + 1 offsets; the last is the text length
+    uint64_t *masks;                    // count class masks
+} FuzzyLines;
+
+// Builds the table for a text. Returns false if out of memory.
+bool FuzzyLinesBuild(FuzzyLines *lines, const uint16_t *text, size_t length, const uint16_t *fold);
+void FuzzyLinesFree(FuzzyLines *lines);
+
+// Length of line 'line' without its terminator.
+size_t FuzzyLineLength(const FuzzyLines *lines, const uint16_t *text, size_t line);
+
+// ============================================================================
+// Best Matches
+// ============================================================================
+typedef struct FuzzyHit {
+    int32_t score;
+    uint32_t length;                    // Line length (capped); shorter wins a tie
+    size_t line;                        // Zero-based line number; earlier wins a tie
+} FuzzyHit;
+
+// The 'capacity' best hits offered, in caller-provided storage. Until
+// FuzzyTopSort it is a heap with the worst kept hit on top.
+typedef struct FuzzyTop {
+    FuzzyHit *hits;
+    size_t count;
+    size_t capacity;
+} FuzzyTop;
+
+void FuzzyTopInit(FuzzyTop *top, FuzzyHit *storage, size_t capacity);
+void FuzzyTopOffer(FuzzyTop *top, const FuzzyHit *hit);
+
+// Orders the kept hits best first; offer nothing afterwards.
+void FuzzyTopSort(FuzzyTop *top);
+
+// Scores lines [first, last) of 'text' and offers each match to 'top'.
+// Returns how many lines matched.
+size_t FuzzyScanLines(const FuzzyQuery *query, const FuzzyLines *lines, const uint16_t *text,
+                      size_t first, size_t last, FuzzyTop *top);
@@ -0,0 +1,698 @@
+// ============================================================================
+// highlight.c - Syntax Highlighting Implementation
+// ============================================================================
+// A lexer state byte holds a mode in its low nibble and, for strings, which
+// of the language's quote characters opened it in the next two bits.
+// Modes that end at a line break (line comments, preprocessor lines, INI
+// keys and sections) are only ever carried into the next line when the
+// break was escaped, or when the line was wrapped rather than ended.
+// ============================================================================
+
+#include "highlight.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MODE_NORMAL         0
+#define MODE_BLOCK_COMMENT  1
+#define MODE_LINE_COMMENT   2
+#define MODE_STRING         3
+#define MODE_PREPROCESSOR   4
+#define MODE_TAG            5
+#define MODE_TAG_STRING     6
+#define MODE_KEY            7
+#define MODE_SECTION        8
+
+#define STATE_MODE(state)       ((unsigned)(state) & 0x0F)
+#define STATE_QUOTE(state)      (((unsigned)(state) >> 4) & 0x03)
+#define MAKE_STATE(mode, quote) ((uint8_t)((mode) | ((quote) << 4)))
+
+#define MAX_WORD    32      // Longer words are never in a table
+#define MAX_ENTITY  32      // Longest "&name;" taken as an entity
+
+#define INITIAL_CAPACITY  1024
+
+// ============================================================================
+// Language Tables
+// ============================================================================
+static const HighlightWord s_cWords[] = {
+    { "NULL", HL_KEYWORD }, { "_Bool", HL_TYPE }, { "alignas", HL_KEYWORD }, { "alignof", HL_KEYWORD },
+    { "asm", HL_KEYWORD }, { "auto", HL_KEYWORD }, { "bool", HL_TYPE }, { "break", HL_KEYWORD },
+    { "case", HL_KEYWORD }, { "catch", HL_KEYWORD }, { "char", HL_TYPE }, { "char16_t", HL_TYPE },
+    { "char32_t", HL_TYPE }, { "char8_t", HL_TYPE }, { "class", HL_KEYWORD }, { "co_await", HL_KEYWORD },
+    { "co_return", HL_KEYWORD }, { "co_yield", HL_KEYWORD }, { "const", HL_KEYWORD },
+    { "const_cast", HL_KEYWORD }, { "consteval", HL_KEYWORD }, { "constexpr", HL_KEYWORD },
+    { "constinit", HL_KEYWORD }, { "continue", HL_KEYWORD }, { "decltype", HL_KEYWORD },
+    { "default", HL_KEYWORD }, { "delete", HL_KEYWORD }, { "do", HL_KEYWORD }, { "double", HL_TYPE },
+    { "dynamic_cast", HL_KEYWORD }, { "else", HL_KEYWORD }, { "enum", HL_KEYWORD },
+    { "explicit", HL_KEYWORD }, { "export", HL_KEYWORD }, { "extern", HL_KEYWORD },
+    { "false", HL_KEYWORD }, { "final", HL_KEYWORD }, { "float", HL_TYPE }, { "for", HL_KEYWORD },
+    { "friend", HL_KEYWORD }, { "goto", HL_KEYWORD }, { "if", HL_KEYWORD }, { "inline", HL_KEYWORD },
+    { "int", HL_TYPE }, { "int16_t", HL_TYPE }, { "int32_t", HL_TYPE }, { "int64_t", HL_TYPE },
+    { "int8_t", HL_TYPE }, { "intptr_t", HL_TYPE }, { "long", HL_TYPE }, { "mutable", HL_KEYWORD },
+    { "namespace", HL_KEYWORD }, { "new", HL_KEYWORD }, { "noexcept", HL_KEYWORD },
+    { "nullptr", HL_KEYWORD }, { "operator", HL_KEYWORD }, { "override", HL_KEYWORD },
+    { "private", HL_KEYWORD }, { "protected", HL_KEYWORD }, { "ptrdiff_t", HL_TYPE },
+    { "public", HL_KEYWORD }, { "register", HL_KEYWORD }, { "reinterpret_cast", HL_KEYWORD },
+    { "requires", HL_KEYWORD }, { "restrict", HL_KEYWORD }, { "return", HL_KEYWORD }, { "short", HL_TYPE },
+    { "signed", HL_TYPE }, { "size_t", HL_TYPE }, { "sizeof", HL_KEYWORD }, { "static", HL_KEYWORD },
+    { "static_assert", HL_KEYWORD }, { "static_cast", HL_KEYWORD }, { "struct", HL_KEYWORD },
+    { "switch", HL_KEYWORD }, { "template", HL_KEYWORD }, { "this", HL_KEYWORD },
+    { "thread_local", HL_KEYWORD }, { "throw", HL_KEYWORD }, { "true", HL_KEYWORD }, { "try", HL_KEYWORD },
+    { "typedef", HL_KEYWORD }, { "typeid", HL_KEYWORD }, { "typename", HL_KEYWORD },
+    { "uint16_t", HL_TYPE }, { "uint32_t", HL_TYPE }, { "uint64_t", HL_TYPE }, { "uint8_t", HL_TYPE },
+    { "uintptr_t", HL_TYPE }, { "union", HL_KEYWORD }, { "unsigned", HL_TYPE }, { "using", HL_KEYWORD },
+    { "virtual", HL_KEYWORD }, { "void", HL_TYPE }, { "volatile", HL_KEYWORD }, { "wchar_t", HL_TYPE },
+    { "while", HL_KEYWORD },
+};
+
+static const HighlightWord s_jsonWords[] = {
+    { "false", HL_KEYWORD }, { "null", HL_KEYWORD }, { "true", HL_KEYWORD },
+};
+
+static const HighlightWord s_iniWords[] = {
+    { "false", HL_KEYWORD }, { "no", HL_KEYWORD }, { "off", HL_KEYWORD }, { "on", HL_KEYWORD },
+    { "true", HL_KEYWORD }, { "yes", HL_KEYWORD },
+};
+
+static const HighlightWord s_logWords[] = {
+    { "alert", HL_ERROR }, { "crit", HL_ERROR }, { "critical", HL_ERROR }, { "debug", HL_DEBUG },
+    { "emerg", HL_ERROR }, { "err", HL_ERROR }, { "error", HL_ERROR }, { "exception", HL_ERROR },
+    { "fail", HL_ERROR }, { "failed", HL_ERROR }, { "failure", HL_ERROR }, { "fatal", HL_ERROR },
+    { "info", HL_INFO }, { "notice", HL_INFO }, { "panic", HL_ERROR }, { "severe", HL_ERROR },
+    { "trace", HL_DEBUG }, { "verbose", HL_DEBUG }, { "warn", HL_WARNING }, { "warning", HL_WARNING },
+};
+
+#define WORDS(table)  table, sizeof(table) / sizeof(table[0])
+
+const HighlightLanguage g_highlightLanguages[] = {
+    { "C/C++", "c h cpp cc cxx c++ hpp hh hxx h++ inl ipp", WORDS(s_cWords),
+      "//", "/*", "*/", "\"'", HL_FLAG_ESCAPES | HL_FLAG_PREPROCESSOR | HL_FLAG_NUMBERS },
+    { "JSON", "json jsonc geojson", WORDS(s_jsonWords),
+      "//", "/*", "*/", "\"", HL_FLAG_ESCAPES | HL_FLAG_QUOTED_KEYS | HL_FLAG_NUMBERS },
+    { "INI", "ini cfg conf inf properties reg", WORDS(s_iniWords),
+      "; #", NULL, NULL, "\"",
+      HL_FLAG_SECTIONS | HL_FLAG_KEYS | HL_FLAG_NUMBERS | HL_FLAG_IGNORE_CASE | HL_FLAG_COMMENT_AT_START },
+    { "XML", "xml xsd xsl xslt svg xaml config manifest resx plist csproj vcxproj props targets nuspec",
+      NULL, 0, NULL, "<!--", "-->", "\"'", HL_FLAG_MARKUP },
+    { "Log", "log", WORDS(s_logWords),
+      NULL, NULL, NULL, "\"", HL_FLAG_NUMBERS | HL_FLAG_IGNORE_CASE },
+};
+
+const size_t g_highlightLanguageCount = sizeof(g_highlightLanguages) / sizeof(g_highlightLanguages[0]);
+
+// ============================================================================
+// HighlightLanguageForPath
+// ============================================================================
+static bool HasToken(const char *list, const char *token) {
+    size_t n = strlen(token);
+    while (*list) {
+        while (*list == ' ') list++;
+        size_t k = 0;
+        while (list[k] && list[k] != ' ') k++;
+        if (k == n && memcmp(list, token, n) == 0) return true;
+        list += k;
+    }
+    return false;
+}
+
+const HighlightLanguage *HighlightLanguageForPath(const uint16_t *path) {
+    if (!path) return NULL;
+    const uint16_t *dot = NULL;
+    for (const uint16_t *p = path; *p; ++p) {
+        if (*p == '.') dot = p;
+        else if (*p == '\\' || *p == '/') dot = NULL;
+    }
+    if (!dot) return NULL;
+
+    char extension[16];
+    size_t n = 0;
+    for (const uint16_t *p = dot + 1; *p; ++p) {
+        uint16_t ch = *p;
+        if (ch >= 0x80 || ch == ' ' || n + 1 >= sizeof(extension)) return NULL;
+        extension[n++] = (char)((ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch);
+    }
+    extension[n] = '\0';
+    if (n == 0) return NULL;
+    for (size_t i = 0; i < g_highlightLanguageCount; ++i) {
+        if (HasToken(g_highlightLanguages[i].extensions, extension)) return &g_highlightLanguages[i];
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Lexer Helpers
+// ============================================================================
+typedef struct Lexer {
+    const HighlightLanguage *language;
+    const uint16_t *text;
+    size_t length;
+    size_t start;
+    size_t end;
+    HighlightSpan *spans;
+    size_t capacity;
+    size_t count;
+} Lexer;
+
+static bool IsBreak(uint16_t ch) {
+    return ch == '\r' || ch == '\n';
+}
+
+static bool IsBlank(uint16_t ch) {
+    return ch == ' ' || ch == '\t' || ch == 0x00A0;
+}
+
+static bool IsWordStart(uint16_t ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch >= 0x80;
+}
+
+static bool IsWordChar(uint16_t ch) {
+    return IsWordStart(ch) || (ch >= '0' && ch <= '9');
+}
+
+static bool IsDigit(uint16_t ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+// True if the ASCII delimiter 'token' (of length n) is at 'pos'
+static bool Matches(const Lexer *lx, size_t pos, const char *token, size_t n) {
+    if (n == 0 || lx->length - pos < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (lx->text[pos + i] != (uint8_t)token[i]) return false;
+    }
+    return true;
+}
+
+// Length of the line comment start at 'pos', or 0
+static size_t LineCommentAt(const Lexer *lx, size_t pos) {
+    const char *list = lx->language->lineComments;
+    if (!list) return 0;
+    while (*list) {
+        while (*list == ' ') list++;
+        size_t k = 0;
+        while (list[k] && list[k] != ' ') k++;
+        if (Matches(lx, pos, list, k)) return k;
+        list += k;
+    }
+    return 0;
+}
+
+static bool BlockOpenAt(const Lexer *lx, size_t pos) {
+    const char *open = lx->language->blockOpen;
+    return open && Matches(lx, pos, open, strlen(open));
+}
+
+// Index of 'ch' among the language's quotes, or -1
+static int QuoteIndex(const Lexer *lx, uint16_t ch) {
+    const char *quotes = lx->language->quotes;
+    for (int i = 0; quotes && quotes[i] && i < 4; ++i) {
+        if (ch == (uint8_t)quotes[i]) return i;
+    }
+    return -1;
+}
+
+// True if the break at 'pos' is escaped by a backslash (C line continuation)
+static bool EscapedBreak(const Lexer *lx, size_t pos) {
+    if (!(lx->language->flags & HL_FLAG_ESCAPES) || pos == 0) return false;
+    if (lx->text[pos] == '\n' && lx->text[pos - 1] == '\r') pos--;
+    return pos > 0 && lx->text[pos - 1] == '\\';
+}
+
+// Position after the break at 'pos' ("\r\n" counts as one)
+static size_t SkipBreak(const Lexer *lx, size_t pos) {
+    if (lx->text[pos] == '\r' && pos + 1 < lx->length && lx->text[pos + 1] == '\n') return pos + 2;
+    return pos + 1;
+}
+
+static void Emit(Lexer *lx, size_t s, size_t e, HighlightKind kind) {
+    if (!lx->spans || kind == HL_PLAIN) return;
+    if (s < lx->start) s = lx->start;
+    if (e > lx->end) e = lx->end;
+    if (s >= e) return;
+    if (lx->count > 0) {
+        HighlightSpan *last = &lx->spans[lx->count - 1];
+        if (last->kind == kind && last->end == s) {
+            last->end = e;
+            return;
+        }
+    }
+    if (lx->count == lx->capacity) return;
+    HighlightSpan *span = &lx->spans[lx->count++];
+    span->start = s;
+    span->end = e;
+    span->kind = kind;
+}
+
+static HighlightKind LookupWord(const Lexer *lx, size_t s, size_t e) {
+    const HighlightLanguage *language = lx->language;
+    if (!language->wordCount || e - s >= MAX_WORD) return HL_PLAIN;
+    char word[MAX_WORD];
+    for (size_t i = s; i < e; ++i) {
+        uint16_t ch = lx->text[i];
+        if (ch >= 0x80) return HL_PLAIN;
+        if ((language->flags & HL_FLAG_IGNORE_CASE) && ch >= 'A' && ch <= 'Z') ch += 'a' - 'A';
+        word[i - s] = (char)ch;
+    }
+    word[e - s] = '\0';
+    size_t lo = 0, hi = language->wordCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int order = strcmp(language->words[mid].word, word);
+        if (order == 0) return language->words[mid].kind;
+        if (order < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return HL_PLAIN;
+}
+
+// ============================================================================
+// Lexer Modes
+// ============================================================================
+// Each scanner starts at 'pos' in its mode, stops at 'end' or where the
+// mode ends, emits what it read and returns the new position; *mode is
+// updated when the mode ends. Delimiters straddling 'end' are read whole.
+// ============================================================================
+
+// The rest of a string; the opening quote has been read
+static size_t ScanString(Lexer *lx, size_t pos, size_t s, unsigned quote, unsigned *mode) {
+    uint16_t close = (uint8_t)lx->language->quotes[quote];
+    bool inTag = *mode == MODE_TAG_STRING;
+    bool closed = false;
+    while (pos < lx->end) {
+        uint16_t ch = lx->text[pos];
+        if (IsBreak(ch) && !inTag) {
+            *mode = MODE_NORMAL;    // Unterminated: the string ends with its line
+            break;
+        }
+        if (ch == '\\' && (lx->language->flags & HL_FLAG_ESCAPES) && pos + 1 < lx->length) {
+            pos = IsBreak(lx->text[pos + 1]) ? SkipBreak(lx, pos + 1) : pos + 2;
+            continue;
+        }
+        pos++;
+        if (ch == close) {
+            closed = true;
+            *mode = inTag ? MODE_TAG : MODE_NORMAL;
+            break;
+        }
+    }
+
+    HighlightKind kind = HL_STRING;
+    if (closed && *mode == MODE_NORMAL && (lx->language->flags & HL_FLAG_QUOTED_KEYS)) {
+        size_t look = pos;
+        while (look < lx->length && IsBlank(lx->text[look])) look++;
+        if (look < lx->length && lx->text[look] == ':') kind = HL_KEY;
+    }
+    Emit(lx, s, pos, kind);
+    return pos;
+}
+
+// Runs to the end of the line, unless the break is escaped
+static size_t ScanToBreak(Lexer *lx, size_t pos, HighlightKind kind, unsigned *mode) {
+    size_t s = pos;
+    while (pos < lx->end) {
+        uint16_t ch = lx->text[pos];
+        if (IsBreak(ch)) {
+            if (!EscapedBreak(lx, pos)) {
+                *mode = MODE_NORMAL;
+                break;
+            }
+            pos = SkipBreak(lx, pos);
+            continue;
+        }
+        // A comment ends a preprocessor line's highlighting
+        if (*mode == MODE_PREPROCESSOR && (LineCommentAt(lx, pos) || BlockOpenAt(lx, pos))) {
+            *mode = MODE_NORMAL;
+            break;
+        }
+        pos++;
+    }
+    Emit(lx, s, pos, kind);
+    return pos;
+}
+
+static size_t ScanBlockComment(Lexer *lx, size_t pos, unsigned *mode) {
+    const char *close = lx->language->blockClose;
+    size_t closeLength = strlen(close);
+    size_t s = pos;
+    while (pos < lx->end) {
+        if (Matches(lx, pos, close, closeLength)) {
+            pos += closeLength;
+            *mode = MODE_NORMAL;
+            break;
+        }
+        pos++;
+    }
+    Emit(lx, s, pos, HL_COMMENT);
+    return pos;
+}
+
+// An INI key runs to the first '=' or ':'; a section to its ']'
+static size_t ScanKeyOrSection(Lexer *lx, size_t pos, unsigned *mode) {
+    bool section = *mode == MODE_SECTION;
+    size_t s = pos;
+    while (pos < lx->end) {
+        uint16_t ch = lx->text[pos];
+        if (IsBreak(ch)) {
+            *mode = MODE_NORMAL;
+            break;
+        }
+        if (section && ch == ']') {
+            pos++;
+            *mode = MODE_NORMAL;
+            break;
+        }
+        if (!section && (ch == '=' || ch == ':')) {
+            *mode = MODE_NORMAL;
+            break;
+        }
+        pos++;
+    }
+    Emit(lx, s, pos, section ? HL_SECTION : HL_KEY);
+    return pos;
+}
+
+// Inside <...>: names, attributes and quoted values up to the closing '>'
+static size_t ScanTag(Lexer *lx, size_t pos, bool nameNext, unsigned *mode, unsigned *quote) {
+    while (pos < lx->end) {
+        uint16_t ch = lx->text[pos];
+        if (ch == '>') {
+            Emit(lx, pos, pos + 1, HL_TAG);
+            *mode = MODE_NORMAL;
+            return pos + 1;
+        }
+        if ((ch == '/' || ch == '?') && pos + 1 < lx->length && lx->text[pos + 1] == '>') {
+            Emit(lx, pos, pos + 2, HL_TAG);
+            *mode = MODE_NORMAL;
+            return pos + 2;
+        }
+        int q = QuoteIndex(lx, ch);
+        if (q >= 0) {
+            *mode = MODE_TAG_STRING;
+            *quote = (unsigned)q;
+            return ScanString(lx, pos + 1, pos, *quote, mode);
+        }
+        if (IsWordChar(ch) || ch == ':' || ch == '-' || ch == '.') {
+            size_t s = pos;
+            while (pos < lx->length && (IsWordChar(lx->text[pos]) || lx->text[pos] == ':' ||
+                                        lx->text[pos] == '-' || lx->text[pos] == '.')) {
+                pos++;
+            }
+            Emit(lx, s, pos, nameNext ? HL_TAG : HL_ATTRIBUTE);
+            nameNext = false;
+            continue;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+// ============================================================================
+// HighlightLex
+// ============================================================================
+uint8_t HighlightLex(const HighlightLanguage *language, uint8_t state, const uint16_t *text, size_t length,
+                     size_t start, size_t end, HighlightSpan *spans, size_t capacity, size_t *countOut) {
+    if (countOut) *countOut = 0;
+    if (!language) return HL_STATE_START;
+    if (end > length) end = length;
+
+    Lexer lexer = { language, text, length, start, end, spans, spans ? capacity : 0, 0 };
+    Lexer *lx = &lexer;
+    uint32_t flags = language->flags;
+    unsigned mode = STATE_MODE(state);
+    unsigned quote = STATE_QUOTE(state);
+    if (quote >= (language->quotes ? strlen(language->quotes) : 0)) quote = 0;
+
+    // Only blanks have been seen since a real line start
+    bool lineStart = start == 0 || IsBreak(text[start - 1]);
+    size_t pos = start;
+    while (pos < end) {
+        switch (mode) {
+        case MODE_BLOCK_COMMENT:
+            pos = ScanBlockComment(lx, pos, &mode);
+            continue;
+        case MODE_LINE_COMMENT:
+            pos = ScanToBreak(lx, pos, HL_COMMENT, &mode);
+            continue;
+        case MODE_PREPROCESSOR:
+            pos = ScanToBreak(lx, pos, HL_PREPROCESSOR, &mode);
+            continue;
+        case MODE_STRING:
+        case MODE_TAG_STRING:
+            pos = ScanString(lx, pos, pos, quote, &mode);
+            continue;
+        case MODE_TAG:
+            pos = ScanTag(lx, pos, false, &mode, &quote);
+            continue;
+        case MODE_KEY:
+        case MODE_SECTION:
+            pos = ScanKeyOrSection(lx, pos, &mode);
+            lineStart = false;
+            continue;
+        }
+
+        uint16_t ch = text[pos];
+        if (IsBreak(ch)) {
+            pos = SkipBreak(lx, pos);
+            lineStart = true;
+            continue;
+        }
+        if (IsBlank(ch)) {
+            pos++;
+            continue;
+        }
+        bool atStart = lineStart;
+        lineStart = false;
+
+        if (atStart && (flags & HL_FLAG_PREPROCESSOR) && ch == '#') {
+            mode = MODE_PREPROCESSOR;
+            continue;
+        }
+        if (atStart && (flags & HL_FLAG_SECTIONS) && ch == '[') {
+            mode = MODE_SECTION;
+            continue;
+        }
+        size_t commentLength = LineCommentAt(lx, pos);
+        if (commentLength && (atStart || !(flags & HL_FLAG_COMMENT_AT_START))) {
+            mode = MODE_LINE_COMMENT;
+            continue;
+        }
+        if (BlockOpenAt(lx, pos)) {
+            size_t s = pos;
+            pos += strlen(language->blockOpen);
+            Emit(lx, s, pos, HL_COMMENT);
+            mode = MODE_BLOCK_COMMENT;
+            continue;
+        }
+        if (atStart && (flags & HL_FLAG_KEYS)) {
+            mode = MODE_KEY;
+            continue;
+        }
+
+        if (flags & HL_FLAG_MARKUP) {
+            if (ch == '<') {
+                size_t s = pos++;
+                if (pos < length && (text[pos] == '/' || text[pos] == '?' || text[pos] == '!')) pos++;
+                Emit(lx, s, pos, HL_TAG);
+                mode = MODE_TAG;
+                pos = ScanTag(lx, pos, true, &mode, &quote);
+                continue;
+            }
+            if (ch == '&') {
+                size_t e = pos + 1;
+                while (e < length && e - pos < MAX_ENTITY && (IsWordChar(text[e]) || text[e] == '#')) e++;
+                if (e < length && text[e] == ';' && e > pos + 1) {
+                    Emit(lx, pos, e + 1, HL_ENTITY);
+                    pos = e + 1;
+                    continue;
+                }
+            }
+            pos++;      // Element content is plain text
+            continue;
+        }
+
+        int q = QuoteIndex(lx, ch);
+        if (q >= 0) {
+            quote = (unsigned)q;
+            mode = MODE_STRING;
+            pos = ScanString(lx, pos + 1, pos, quote, &mode);
+            continue;
+        }
+        bool sign = (ch == '-' || ch == '.') && pos + 1 < length && IsDigit(text[pos + 1]) &&
+                    (pos == 0 || !(IsWordChar(text[pos - 1]) || text[pos - 1] == ')'));
+        if ((flags & HL_FLAG_NUMBERS) && (IsDigit(ch) || sign)) {
+            size_t s = pos++;
+            while (pos < length) {
+                uint16_t c = text[pos];
+                if (IsWordChar(c) || c == '.') {
+                    pos++;
+                } else if ((c == '+' || c == '-') && (text[pos - 1] == 'e' || text[pos - 1] == 'E')) {
+                    pos++;
+                } else {
+                    break;
+                }
+            }
+            Emit(lx, s, pos, HL_NUMBER);
+            continue;
+        }
+        if (IsWordStart(ch)) {
+            size_t s = pos;
+            while (pos < length && IsWordChar(text[pos])) pos++;
+            Emit(lx, s, pos, LookupWord(lx, s, pos));
+            continue;
+        }
+        pos++;
+    }
+
+    if (countOut) *countOut = lx->count;
+    return MAKE_STATE(mode, mode == MODE_STRING || mode == MODE_TAG_STRING ? quote : 0);
+}
+
+// ============================================================================
+// HighlightCacheInit / HighlightCacheFree / HighlightCacheReset
+// ============================================================================
+void HighlightCacheInit(HighlightCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+void HighlightCacheFree(HighlightCache *cache) {
+    free(cache->states);
+    HighlightCacheInit(cache);
+}
+
+static bool Reserve(HighlightCache *cache, size_t needed) {
+    if (needed <= cache->capacity) return true;
+    size_t newCapacity = cache->capacity ? cache->capacity : INITIAL_CAPACITY;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2) return false;
+        newCapacity *= 2;
+    }
+    uint8_t *grown = (uint8_t *)realloc(cache->states, newCapacity);
+    if (!grown) return false;
+    cache->states = grown;
+    cache->capacity = newCapacity;
+    return true;
+}
+
+bool HighlightCacheReset(HighlightCache *cache, const HighlightLanguage *language, size_t lineCount) {
+    if (lineCount == 0) lineCount = 1;
+    cache->language = language;
+    cache->lineCount = 0;
+    cache->valid = cache->resume = cache->settled = 0;
+    if (!language) return true;
+    if (!Reserve(cache, lineCount)) {
+        HighlightCacheFree(cache);
+        return false;
+    }
+    cache->lineCount = lineCount;
+    cache->states[0] = HL_STATE_START;
+    cache->valid = cache->resume = cache->settled = 1;
+    return true;
+}
+
+// ============================================================================
+// HighlightCacheEdit
+// ============================================================================
+// The states after the edit are kept as tentative ones. Convergence may
+// only be trusted at a line past every edit made since those states were
+// computed, and within one unbroken run of states computed one from the
+// next, so 'resume' never moves back; the lines between 'valid' and
+// 'resume' will be lexed whatever they hold.
+// ============================================================================
+bool HighlightCacheEdit(HighlightCache *cache, size_t first, size_t removedLines, size_t insertedLines) {
+    if (!cache->language || cache->lineCount == 0) return true;
+    if (first >= cache->lineCount || removedLines > cache->lineCount - first - 1) {
+        HighlightCacheReset(cache, NULL, 0);
+        return false;
+    }
+    size_t oldCount = cache->lineCount;
+    size_t newCount = oldCount - removedLines + insertedLines;
+    size_t known = cache->valid > cache->settled ? cache->valid : cache->settled;
+    if (!Reserve(cache, newCount)) {
+        HighlightCacheFree(cache);
+        return false;
+    }
+    size_t oldAfter = first + 1 + removedLines;     // First old line past the edit
+    size_t newAfter = first + 1 + insertedLines;
+    if (oldCount > oldAfter) {
+        memmove(cache->states + newAfter, cache->states + oldAfter, oldCount - oldAfter);
+    }
+    cache->lineCount = newCount;
+    if (known <= first + 1) return true;   // The edit is past every known state
+
+    // Known states (current or tentative) that survive, past the edit. A
+    // pending tentative run does not follow on from the current states
+    // before it, so it is kept on its own and trusted from its own start.
+    bool pending = cache->settled > cache->valid;
+    size_t chain = cache->resume > cache->valid ? cache->resume : cache->valid;
+    size_t resume = newAfter;
+    if (pending && chain > oldAfter && chain - oldAfter + newAfter > resume) {
+        resume = chain - oldAfter + newAfter;
+    }
+    size_t settled = known > oldAfter ? known - oldAfter + newAfter : 0;
+
+    if (cache->valid > first + 1) cache->valid = first + 1;
+    if (settled > resume) {
+        cache->resume = resume;
+        cache->settled = settled;
+    } else {
+        cache->resume = cache->settled = cache->valid;
+    }
+    return true;
+}
+
+// ============================================================================
+// HighlightCacheAdvance / HighlightCacheState / HighlightCacheComplete
+// ============================================================================
+bool HighlightCacheAdvance(HighlightCache *cache, const uint16_t *text, size_t length,
+                           HighlightLineStartProc lineStart, void *context, size_t target, size_t budget) {
+    if (!cache->language) return false;
+    if (target >= cache->lineCount) target = cache->lineCount - 1;
+    size_t lexed = 0;
+    while (cache->valid <= target && lexed < budget) {
+        size_t line = cache->valid;
+        size_t end = lineStart(context, line);
+        if (end == 0 || end > length) {
+            // The caller's lines do not match the text any more
+            HighlightCacheReset(cache, cache->language, cache->lineCount);
+            return false;
+        }
+        lexed++;
+
+        // A wrapped line shares the state of the line it continues
+        if (!IsBreak(text[end - 1])) {
+            cache->states[line] = cache->states[line - 1];
+            cache->valid = line + 1;
+            if (cache->settled < cache->valid) cache->resume = cache->settled = cache->valid;
+            continue;
+        }
+
+        // Lex the whole line before, from where it really starts
+        size_t from = line - 1;
+        size_t start = lineStart(context, from);
+        while (from > 0 && start > 0 && !IsBreak(text[start - 1])) start = lineStart(context, --from);
+        if (start > end) {
+            HighlightCacheReset(cache, cache->language, cache->lineCount);
+            return false;
+        }
+        uint8_t state = HighlightLex(cache->language, cache->states[from], text, length, start, end,
+                                     NULL, 0, NULL);
+        if (line >= cache->resume && line < cache->settled && cache->states[line] == state) {
+            // Converged: the tentative states from here on hold
+            cache->valid = cache->resume = cache->settled;
+            continue;
+        }
+        cache->states[line] = state;
+        cache->valid = line + 1;
+        if (cache->settled < cache->valid) cache->resume = cache->settled = cache->valid;
+    }
+    return cache->valid > target;
+}
+
+bool HighlightCacheState(const HighlightCache *cache, size_t line, uint8_t *stateOut) {
+    if (!cache->language || line >= cache->valid) return false;
+    *stateOut = cache->states[line];
+    return true;
+}
+
+bool HighlightCacheComplete(const HighlightCache *cache) {
+    return cache->language && cache->valid >= cache->lineCount;
+}
@@ -0,0 +1,153 @@
+// ============================================================================
+// highlight.h - Syntax Highlighting Header
+// ============================================================================
+// A table-driven lexer for a few common formats (C/C++, JSON, INI, XML and
+// log files) and a cache of the lexer state at the start of every line.
+//   - Each language is one HighlightLanguage entry: its comment and string
+//     delimiters, a sorted word table (keywords, or log levels) and flags
+//     for the rules that do not fit a table (preprocessor lines, INI keys,
+//     XML tags).
+//   - A lexer state is one byte and says everything needed to resume at a
+//     line start: inside a block comment, a string, a tag, and so on.
+//   - The cache follows edits without lexing: the lines of an edit lose
+//     their states, the lines after it keep theirs as "tentative". Lexing
+//     resumes at the edited line and stops as soon as it reproduces a
+//     tentative state after the edit; every state beyond that still holds.
+//     An edit therefore costs a memmove of one byte per line, and lexing
+//     after a keystroke usually ends on the very next line.
+//   - Lexing is lazy: HighlightCacheAdvance computes states up to a line
+//     with a budget, for the part of the text about to be drawn, and the
+//     rest of the document can be covered a budget at a time in the
+//     background.
+// Lines are whatever the caller's HighlightLineStartProc says they are
+// (the edit control's lines, which are screen lines when word wrap is on).
+// The cache always lexes whole lines: a line that continues a wrapped one
+// gets the state of the line it continues, which is what a caller drawing
+// from a real line start needs.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ============================================================================
+// Token Kinds
+// ============================================================================
+typedef enum HighlightKind {
+    HL_PLAIN = 0,
+    HL_KEYWORD,         // Language keyword, or a JSON literal
+    HL_TYPE,            // Built-in type name
+    HL_STRING,
+    HL_NUMBER,
+    HL_COMMENT,
+    HL_PREPROCESSOR,    // C preprocessor line
+    HL_KEY,             // INI key, JSON object member name
+    HL_SECTION,         // INI [section]
+    HL_TAG,             // XML tag name and brackets
+    HL_ATTRIBUTE,       // XML attribute name
+    HL_ENTITY,          // XML &entity;
+    HL_ERROR,           // Log level words, most severe first
+    HL_WARNING,
+    HL_INFO,
+    HL_DEBUG,
+    HL_KIND_COUNT
+} HighlightKind;
+
+// ============================================================================
+// Language Tables
+// ============================================================================
+#define HL_FLAG_ESCAPES         0x0001  // Backslash escapes in strings, and continues lines
+#define HL_FLAG_PREPROCESSOR    0x0002  // A line starting with '#' is a directive
+#define HL_FLAG_SECTIONS        0x0004  // "[name]" at a line start is a section
+#define HL_FLAG_KEYS            0x0008  // Text before the first '=' or ':' of a line is a key
+#define HL_FLAG_QUOTED_KEYS     0x0010  // A string followed by ':' is a key
+#define HL_FLAG_MARKUP          0x0020  // XML tags, attributes and entities
+#define HL_FLAG_NUMBERS         0x0040  // Numbers are highlighted
+#define HL_FLAG_IGNORE_CASE     0x0080  // Words match in any case (the table is lower case)
+#define HL_FLAG_COMMENT_AT_START 0x0100 // Line comments only start a line
+
+typedef struct HighlightWord {
+    const char *word;
+    HighlightKind kind;
+} HighlightWord;
+
+typedef struct HighlightLanguage {
+    const char *name;                   // Shown to the user
+    const char *extensions;             // Space-separated file extensions, lower case
+    const HighlightWord *words;         // Sorted by strcmp
+    size_t wordCount;
+    const char *lineComments;           // Space-separated line comment starts, or NULL
+    const char *blockOpen;              // Block comment delimiters, or NULL
+    const char *blockClose;
+    const char *quotes;                 // String quote characters (at most 4), or ""
+    uint32_t flags;
+} HighlightLanguage;
+
+extern const HighlightLanguage g_highlightLanguages[];
+extern const size_t g_highlightLanguageCount;
+
+// Returns the language for a file name (by extension, any case), or NULL
+// for plain text.
+const HighlightLanguage *HighlightLanguageForPath(const uint16_t *path);
+
+// ============================================================================
+// Lexer
+// ============================================================================
+#define HL_STATE_START  0       // State at the start of a document
+
+typedef struct HighlightSpan {
+    size_t start;               // Text offsets; [start, end)
+    size_t end;
+    HighlightKind kind;         // Never HL_PLAIN
+} HighlightSpan;
+
+// Lexes text[start, end) beginning in 'state' and returns the state at
+// 'end'. Tokens running past 'end' are read to their end (up to 'length').
+// Up to 'capacity' spans of highlighted text, clipped to the range, go to
+// 'spans' (which may be NULL when only the state is wanted); *countOut
+// receives how many were written.
+uint8_t HighlightLex(const HighlightLanguage *language, uint8_t state, const uint16_t *text, size_t length,
+                     size_t start, size_t end, HighlightSpan *spans, size_t capacity, size_t *countOut);
+
+// ============================================================================
+// Line State Cache
+// ============================================================================
+// Returns the offset where zero-based 'line' starts.
+typedef size_t (*HighlightLineStartProc)(void *context, size_t line);
+
+typedef struct HighlightCache {
+    const HighlightLanguage *language;  // NULL: nothing to lex
+    uint8_t *states;                    // Lexer state at the start of each line
+    size_t lineCount;
+    size_t capacity;
+    size_t valid;                       // states[0, valid) are current
+    size_t resume;                      // From this line on, a tentative state may be trusted...
+    size_t settled;                     // ...up to here, once lexing reproduces one
+} HighlightCache;
+
+void HighlightCacheInit(HighlightCache *cache);
+void HighlightCacheFree(HighlightCache *cache);
+
+// Starts over for a document of 'lineCount' lines in 'language' (which may
+// be NULL). Returns false if out of memory; the cache is then empty.
+bool HighlightCacheReset(HighlightCache *cache, const HighlightLanguage *language, size_t lineCount);
+
+// Follows an edit that replaced 'removedLines' line starts after line
+// 'first' with 'insertedLines' new ones: old line first + removedLines + k
+// is new line first + insertedLines + k. Nothing is lexed. Returns false
+// if out of memory; the cache is then empty and must be reset.
+bool HighlightCacheEdit(HighlightCache *cache, size_t first, size_t removedLines, size_t insertedLines);
+
+// Lexes forward until the state at the start of 'target' is known, or
+// 'budget' lines have been visited. Returns true if the state is known.
+bool HighlightCacheAdvance(HighlightCache *cache, const uint16_t *text, size_t length,
+                           HighlightLineStartProc lineStart, void *context, size_t target, size_t budget);
+
+// Returns true with the state at the start of 'line' if it is known.
+bool HighlightCacheState(const HighlightCache *cache, size_t line, uint8_t *stateOut);
+
+// True if every line's state is known.
+bool HighlightCacheComplete(const HighlightCache *cache);
@@ -0,0 +1,575 @@
+// ============================================================================
+// journal.c - Crash Recovery Edit Journal Implementation
+// ============================================================================
+// Journal file layout:
+//   JournalHeader        - fixed 40-byte header (magic, version, base identity)
+//   JournalRecord + text - one per edit, in the order the edits happened
+// The writer appends raw ring contents, so a record may briefly be split
+// across two writes; recovery stops at the first incomplete or corrupt
+// record, which can only be the last one.
+// ============================================================================
+
+#include "journal.h"
+#include <strsafe.h>   // For safe string operations
+
+#define JOURNAL_MAGIC    0x4C4A5052u   // "RPJL" in little endian
+#define JOURNAL_VERSION  1
+#define JOURNAL_DIR      L"journal"
+#define UNTITLED_PREFIX  L"untitled-"
+
+// ============================================================================
+// On-Disk Structures
+// ============================================================================
+typedef struct JournalHeader {
+    DWORD magic;              // JOURNAL_MAGIC
+    DWORD version;            // JOURNAL_VERSION
+    ULONGLONG baseSize;       // Document size in bytes (0 if untitled)
+    ULONGLONG baseWriteTime;  // Document last write time (FILETIME ticks)
+    ULONGLONG baseLength;     // Base text length in characters
+    DWORD encoding;           // TextEncoding value
+    DWORD reserved;
+} JournalHeader;
+
+typedef struct JournalRecord {
+    DWORD crc;                // CRC-32 of the rest of the record and the text
+    DWORD insertLength;       // Characters of inserted text that follow
+    ULONGLONG offset;         // Position of the edit
+    ULONGLONG removeLength;   // Characters removed at 'offset'
+} JournalRecord;
+
+// ============================================================================
+// CRC-32 (IEEE 802.3, reflected)
+// ============================================================================
+static DWORD g_crcTable[256];
+
+static void InitCrcTable(void) {
+    for (DWORD i = 0; i < 256; ++i) {
+        DWORD c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crcTable[i] = c;
+    }
+}
+
+static DWORD UpdateCrc(DWORD crc, const void *data, size_t size) {
+    const BYTE *p = (const BYTE *)data;
+    for (size_t i = 0; i < size; ++i) {
+        crc = g_crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static DWORD RecordCrc(const JournalRecord *record, const WCHAR *insert) {
+    DWORD crc = UpdateCrc(0xFFFFFFFFu, &record->insertLength, sizeof(*record) - sizeof(record->crc));
+    crc = UpdateCrc(crc, insert, (size_t)record->insertLength * sizeof(WCHAR));
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// ============================================================================
+// Ring Counters - Acquire Loads and Release Stores
+// ============================================================================
+static LONGLONG LoadAcquire(volatile LONGLONG *value) {
+    return InterlockedCompareExchange64(value, 0, 0);
+}
+
+static void StoreRelease(volatile LONGLONG *value, LONGLONG newValue) {
+    InterlockedExchange64(value, newValue);
+}
+
+// ============================================================================
+// Journal Paths
+// ============================================================================
+static BOOL GetUntitledDirectory(WCHAR *pathOut, DWORD pathLen) {
+    if (!GetAppDataPath(JOURNAL_DIR, pathOut, pathLen)) return FALSE;
+    return CreateDirectoryW(pathOut, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static BOOL GetJournalPath(LPCWSTR documentPath, WCHAR *pathOut, DWORD pathLen) {
+    if (documentPath) {
+        return SUCCEEDED(StringCchPrintfW(pathOut, pathLen, L"%s%s", documentPath, JOURNAL_EXTENSION));
+    }
+    // Untitled documents get one journal per process so instances do not collide
+    WCHAR dir[MAX_PATH];
+    if (!GetUntitledDirectory(dir, ARRAYSIZE(dir))) return FALSE;
+    return SUCCEEDED(StringCchPrintfW(pathOut, pathLen, L"%s\\%s%lu%s", dir, UNTITLED_PREFIX,
+                                      GetCurrentProcessId(), JOURNAL_EXTENSION));
+}
+
+// Reads the size and last write time of a document (zero if untitled)
+static void GetBaseIdentity(LPCWSTR documentPath, ULONGLONG *sizeOut, ULONGLONG *writeTimeOut) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    *sizeOut = 0;
+    *writeTimeOut = 0;
+    if (documentPath && GetFileAttributesExW(documentPath, GetFileExInfoStandard, &data)) {
+        *sizeOut = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        *writeTimeOut = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    }
+}
+
+// ============================================================================
+// OpenJournalFile - Create the Journal on the First Edit
+// ============================================================================
+// Called with fileLock held. Journals are hidden and opened without write
+// sharing, which also tells other instances that this journal is live.
+// ============================================================================
+static void OpenJournalFile(Journal *journal) {
+    journal->file = CreateFileW(journal->path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_HIDDEN, NULL);
+    if (journal->file == INVALID_HANDLE_VALUE) {
+        journal->fileFailed = TRUE;  // e.g. read-only folder; run without a journal
+        return;
+    }
+
+    JournalHeader header = {0};
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.baseSize = journal->baseSize;
+    header.baseWriteTime = journal->baseWriteTime;
+    header.baseLength = journal->baseLength;
+    header.encoding = (DWORD)journal->encoding;
+    DWORD written = 0;
+    if (!WriteFile(journal->file, &header, sizeof(header), &written, NULL) || written != sizeof(header)) {
+        CloseHandle(journal->file);
+        DeleteFileW(journal->path);
+        journal->file = INVALID_HANDLE_VALUE;
+        journal->fileFailed = TRUE;
+    }
+}
+
+// Closes the current journal (fileLock held), deleting it if requested
+static void CloseJournalFile(Journal *journal, BOOL deleteFile) {
+    if (journal->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(journal->file);
+        journal->file = INVALID_HANDLE_VALUE;
+        if (deleteFile) DeleteFileW(journal->path);
+    }
+    journal->fileFailed = FALSE;
+    journal->path[0] = L'\0';
+}
+
+// ============================================================================
+// DrainRing - Write Everything Queued So Far
+// ============================================================================
+// Runs on the writer thread. One WriteFile per contiguous ring segment and
+// one FlushFileBuffers per batch keeps the disk cost independent of how
+// many edits the batch holds.
+// ============================================================================
+static void DrainRing(Journal *journal) {
+    LONGLONG head = LoadAcquire(&journal->head);
+    LONGLONG tail = journal->tail;
+    if (head != tail) {
+        EnterCriticalSection(&journal->fileLock);
+        if (journal->file == INVALID_HANDLE_VALUE && !journal->fileFailed && journal->path[0]) {
+            OpenJournalFile(journal);
+        }
+        BOOL wrote = FALSE;
+        while (tail < head) {
+            size_t pos = (size_t)(tail & (JOURNAL_RING_SIZE - 1));
+            size_t chunk = (size_t)(head - tail);
+            if (chunk > JOURNAL_RING_SIZE - pos) chunk = JOURNAL_RING_SIZE - pos;
+            if (journal->file != INVALID_HANDLE_VALUE) {
+                DWORD written = 0;
+                if (WriteFile(journal->file, journal->ring + pos, (DWORD)chunk, &written, NULL) && written == chunk) {
+                    wrote = TRUE;
+                } else {
+                    // A partial journal is useless; stop journaling this document
+                    CloseHandle(journal->file);
+                    DeleteFileW(journal->path);
+                    journal->file = INVALID_HANDLE_VALUE;
+                    journal->fileFailed = TRUE;
+                }
+            }
+            tail += chunk;
+        }
+        if (wrote) FlushFileBuffers(journal->file);
+        LeaveCriticalSection(&journal->fileLock);
+        StoreRelease(&journal->tail, tail);
+    }
+    SetEvent(journal->drained);
+}
+
+// ============================================================================
+// WriterThread - Background Journal Writer
+// ============================================================================
+static DWORD WINAPI WriterThread(LPVOID param) {
+    Journal *journal = (Journal *)param;
+    while (!journal->stopping) {
+        // Sleep until the producer queues something. Publishing 'idle' before
+        // the final check means a record queued in between still wakes us.
+        InterlockedExchange(&journal->writerIdle, 1);
+        if (LoadAcquire(&journal->head) == journal->tail && !journal->stopping) {
+            WaitForSingleObject(journal->wake, INFINITE);
+        }
+        InterlockedExchange(&journal->writerIdle, 0);
+
+        // Let a burst of typing accumulate into one write and one flush
+        if (!journal->stopping && !journal->syncRequested) {
+            WaitForSingleObject(journal->wake, JOURNAL_BATCH_MS);
+        }
+        DrainRing(journal);
+    }
+    DrainRing(journal);
+    return 0;
+}
+
+// ============================================================================
+// WaitForWriter - Block Until Everything Queued Is on Disk
+// ============================================================================
+static void WaitForWriter(Journal *journal) {
+    LONGLONG target = journal->head;
+    InterlockedExchange(&journal->syncRequested, 1);
+    SetEvent(journal->wake);
+    while (LoadAcquire(&journal->tail) < target) {
+        WaitForSingleObject(journal->drained, 50);
+    }
+    InterlockedExchange(&journal->syncRequested, 0);
+}
+
+// ============================================================================
+// RingWrite - Copy Bytes into the Ring (UI Thread)
+// ============================================================================
+// Normally a memcpy and one interlocked store. Only when the ring is full
+// (a paste larger than the ring, or a stalled disk) does the producer wait.
+// ============================================================================
+static void RingWrite(Journal *journal, const void *data, size_t size) {
+    const BYTE *src = (const BYTE *)data;
+    while (size > 0) {
+        LONGLONG head = journal->head;
+        size_t space = JOURNAL_RING_SIZE - (size_t)(head - LoadAcquire(&journal->tail));
+        if (space == 0) {
+            InterlockedExchange(&journal->syncRequested, 1);
+            SetEvent(journal->wake);
+            WaitForSingleObject(journal->drained, 10);
+            continue;
+        }
+        size_t pos = (size_t)(head & (JOURNAL_RING_SIZE - 1));
+        size_t chunk = size < space ? size : space;
+        if (chunk > JOURNAL_RING_SIZE - pos) chunk = JOURNAL_RING_SIZE - pos;
+        CopyMemory(journal->ring + pos, src, chunk);
+        StoreRelease(&journal->head, head + (LONGLONG)chunk);
+        src += chunk;
+        size -= chunk;
+    }
+    InterlockedExchange(&journal->syncRequested, 0);
+}
+
+// ============================================================================
+// JournalStart / JournalStop
+// ============================================================================
+BOOL JournalStart(Journal *journal) {
+    ZeroMemory(journal, sizeof(*journal));
+    journal->file = INVALID_HANDLE_VALUE;
+    InitCrcTable();
+    InitializeCriticalSection(&journal->fileLock);
+
+    journal->ring = (BYTE *)HeapAlloc(GetProcessHeap(), 0, JOURNAL_RING_SIZE);
+    journal->wake = CreateEventW(NULL, FALSE, FALSE, NULL);
+    journal->drained = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (journal->ring && journal->wake && journal->drained) {
+        journal->thread = CreateThread(NULL, 0, WriterThread, journal, 0, NULL);
+    }
+    if (!journal->thread) {
+        if (journal->ring) HeapFree(GetProcessHeap(), 0, journal->ring);
+        if (journal->wake) CloseHandle(journal->wake);
+        if (journal->drained) CloseHandle(journal->drained);
+        DeleteCriticalSection(&journal->fileLock);
+        journal->ring = NULL;
+        return FALSE;
+    }
+    // The writer only touches the disk; keep it out of the UI's way
+    SetThreadPriority(journal->thread, THREAD_PRIORITY_BELOW_NORMAL);
+    return TRUE;
+}
+
+void JournalStop(Journal *journal, BOOL keepFile) {
+    if (!journal->ring) return;
+    InterlockedExchange(&journal->stopping, 1);
+    SetEvent(journal->wake);
+    WaitForSingleObject(journal->thread, INFINITE);
+    CloseHandle(journal->thread);
+
+    CloseJournalFile(journal, !keepFile);
+    CloseHandle(journal->wake);
+    CloseHandle(journal->drained);
+    DeleteCriticalSection(&journal->fileLock);
+    HeapFree(GetProcessHeap(), 0, journal->ring);
+    journal->ring = NULL;
+}
+
+// ============================================================================
+// JournalDetach - Keep the Journal for the Next Session
+// ============================================================================
+BOOL JournalDetach(Journal *journal, WCHAR *pathOut, DWORD pathLen) {
+    if (!journal->ring) return FALSE;
+    WaitForWriter(journal);
+
+    EnterCriticalSection(&journal->fileLock);
+    BOOL kept = journal->file != INVALID_HANDLE_VALUE &&
+                SUCCEEDED(StringCchCopyW(pathOut, pathLen, journal->path));
+    if (kept) CloseJournalFile(journal, FALSE);
+    LeaveCriticalSection(&journal->fileLock);
+    return kept;
+}
+
+// ============================================================================
+// JournalBegin - Switch the Journal to a New Base Document
+// ============================================================================
+void JournalBegin(Journal *journal, LPCWSTR documentPath, size_t baseLength, TextEncoding encoding,
+                  LPCWSTR resumeFrom, ULONGLONG resumeAt) {
+    if (!journal->ring) return;
+
+    // Edits made to the previous document must not land in the new journal
+    WaitForWriter(journal);
+
+    EnterCriticalSection(&journal->fileLock);
+    CloseJournalFile(journal, TRUE);
+    if (!GetJournalPath(documentPath, journal->path, ARRAYSIZE(journal->path))) {
+        journal->path[0] = L'\0';
+    }
+    GetBaseIdentity(documentPath, &journal->baseSize, &journal->baseWriteTime);
+    journal->baseLength = baseLength;
+    journal->encoding = encoding;
+
+    // Continue a recovered journal right away, so a second crash before the
+    // next edit still finds it, and so other instances see it as live
+    if (resumeFrom && journal->path[0]) {
+        if (lstrcmpiW(resumeFrom, journal->path) != 0) {
+            MoveFileExW(resumeFrom, journal->path, MOVEFILE_REPLACE_EXISTING);
+        }
+        journal->file = CreateFileW(journal->path, GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_HIDDEN, NULL);
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)resumeAt;
+        if (journal->file == INVALID_HANDLE_VALUE) {
+            journal->fileFailed = TRUE;
+        } else if (!SetFilePointerEx(journal->file, pos, NULL, FILE_BEGIN) || !SetEndOfFile(journal->file)) {
+            CloseHandle(journal->file);
+            journal->file = INVALID_HANDLE_VALUE;
+            journal->fileFailed = TRUE;
+        }
+    }
+    LeaveCriticalSection(&journal->fileLock);
+}
+
+// ============================================================================
+// JournalAppend - Queue One Edit (UI Thread)
+// ============================================================================
+void JournalAppend(Journal *journal, ULONGLONG offset, ULONGLONG removeLength,
+                   const WCHAR *insert, size_t insertLength) {
+    if (!journal->ring || (removeLength == 0 && insertLength == 0)) return;
+
+    JournalRecord record;
+    record.insertLength = (DWORD)insertLength;
+    record.offset = offset;
+    record.removeLength = removeLength;
+    record.crc = RecordCrc(&record, insert);
+
+    RingWrite(journal, &record, sizeof(record));
+    RingWrite(journal, insert, insertLength * sizeof(WCHAR));
+
+    // Wake the writer only if it is asleep; a busy writer picks this up anyway
+    if (InterlockedExchange(&journal->writerIdle, 0)) {
+        SetEvent(journal->wake);
+    }
+}
+
+// ============================================================================
+// OpenOrphan - Open a Journal No Running Instance Is Using
+// ============================================================================
+// Live journals are held open without write sharing, so an exclusive open
+// only succeeds for journals whose owner has gone away.
+// ============================================================================
+static HANDLE OpenOrphan(LPCWSTR journalPath, ULONGLONG *sizeOut) {
+    HANDLE file = CreateFileW(journalPath, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return INVALID_HANDLE_VALUE;
+    }
+    *sizeOut = (ULONGLONG)size.QuadPart;
+    return file;
+}
+
+// Returns TRUE if the journal holds edits; deletes empty leftovers
+static BOOL HasRecords(LPCWSTR journalPath) {
+    ULONGLONG size = 0;
+    HANDLE file = OpenOrphan(journalPath, &size);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    CloseHandle(file);
+    if (size >= sizeof(JournalHeader) + sizeof(JournalRecord)) return TRUE;
+    DeleteFileW(journalPath);
+    return FALSE;
+}
+
+// ============================================================================
+// JournalFindOrphan - Look for Work Left by a Crashed Session
+// ============================================================================
+BOOL JournalFindOrphan(LPCWSTR documentPath, WCHAR *pathOut, DWORD pathLen) {
+    if (documentPath) {
+        return GetJournalPath(documentPath, pathOut, pathLen) && HasRecords(pathOut);
+    }
+
+    // Untitled journals are per process; check every one that is not live
+    WCHAR dir[MAX_PATH], pattern[MAX_PATH];
+    if (!GetUntitledDirectory(dir, ARRAYSIZE(dir))) return FALSE;
+    if (FAILED(StringCchPrintfW(pattern, ARRAYSIZE(pattern), L"%s\\%s*%s", dir, UNTITLED_PREFIX, JOURNAL_EXTENSION))) {
+        return FALSE;
+    }
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileW(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) return FALSE;
+    BOOL found = FALSE;
+    do {
+        if (SUCCEEDED(StringCchPrintfW(pathOut, pathLen, L"%s\\%s", dir, data.cFileName)) && HasRecords(pathOut)) {
+            found = TRUE;
+        }
+    } while (!found && FindNextFileW(find, &data));
+    FindClose(find);
+    return found;
+}
+
+void JournalDiscard(LPCWSTR journalPath) {
+    DeleteFileW(journalPath);
+}
+
+// ============================================================================
+// Gap Buffer - Replay Storage
+// ============================================================================
+// Edits cluster (typing, Replace All walking forward), so moving the gap
+// between consecutive edits is usually a short memmove even in a huge
+// document. The base text buffer is grown in place rather than copied.
+// ============================================================================
+typedef struct GapBuffer {
+    WCHAR *data;
+    size_t capacity;          // Characters allocated
+    size_t gapStart;          // First character of the gap
+    size_t gapEnd;            // First character after the gap
+} GapBuffer;
+
+static size_t GapLength(const GapBuffer *gap) {
+    return gap->capacity - (gap->gapEnd - gap->gapStart);
+}
+
+static BOOL GapReserve(GapBuffer *gap, size_t needed) {
+    if (gap->gapEnd - gap->gapStart >= needed) return TRUE;
+    size_t newCapacity = gap->capacity + needed + gap->capacity / 2 + 4096;
+    WCHAR *grown = (WCHAR *)HeapReAlloc(GetProcessHeap(), 0, gap->data, newCapacity * sizeof(WCHAR));
+    if (!grown) return FALSE;
+    size_t tail = gap->capacity - gap->gapEnd;
+    MoveMemory(grown + newCapacity - tail, grown + gap->gapEnd, tail * sizeof(WCHAR));
+    gap->data = grown;
+    gap->gapEnd = newCapacity - tail;
+    gap->capacity = newCapacity;
+    return TRUE;
+}
+
+static void GapMove(GapBuffer *gap, size_t pos) {
+    if (pos < gap->gapStart) {
+        size_t count = gap->gapStart - pos;
+        MoveMemory(gap->data + gap->gapEnd - count, gap->data + pos, count * sizeof(WCHAR));
+        gap->gapStart -= count;
+        gap->gapEnd -= count;
+    } else if (pos > gap->gapStart) {
+        size_t count = pos - gap->gapStart;
+        MoveMemory(gap->data + gap->gapStart, gap->data + gap->gapEnd, count * sizeof(WCHAR));
+        gap->gapStart += count;
+        gap->gapEnd += count;
+    }
+}
+
+static BOOL GapReplace(GapBuffer *gap, ULONGLONG offset, ULONGLONG removeLength, const WCHAR *insert, size_t insertLength) {
+    size_t length = GapLength(gap);
+    if (offset > length || removeLength > length - offset) return FALSE;
+    if (!GapReserve(gap, insertLength + 1)) return FALSE;
+    GapMove(gap, (size_t)offset);
+    gap->gapEnd += (size_t)removeLength;
+    CopyMemory(gap->data + gap->gapStart, insert, insertLength * sizeof(WCHAR));
+    gap->gapStart += insertLength;
+    return TRUE;
+}
+
+// ============================================================================
+// ReadWholeFile - Load a Journal into Memory
+// ============================================================================
+static BYTE *ReadWholeFile(LPCWSTR path, size_t *sizeOut) {
+    ULONGLONG size = 0;
+    HANDLE file = OpenOrphan(path, &size);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    BYTE *data = (size < ((ULONGLONG)1 << 31)) ? (BYTE *)HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size + 1) : NULL;
+    size_t done = 0;
+    while (data && done < size) {
+        DWORD chunk = (DWORD)((size - done) > (1u << 24) ? (1u << 24) : (size - done));
+        DWORD read = 0;
+        if (!ReadFile(file, data + done, chunk, &read, NULL) || read == 0) break;
+        done += read;
+    }
+    CloseHandle(file);
+    if (data && done != size) {
+        HeapFree(GetProcessHeap(), 0, data);
+        return NULL;
+    }
+    *sizeOut = done;
+    return data;
+}
+
+// ============================================================================
+// JournalRecover - Replay a Journal on Top of the Base Text
+// ============================================================================
+// Checks that the journal was written against exactly this version of the
+// document before touching the text. After that, replay cannot fail: it
+// stops at the first record that is torn, corrupt or out of range.
+// ============================================================================
+BOOL JournalRecover(LPCWSTR journalPath, LPCWSTR documentPath, WCHAR **text, size_t *length,
+                    TextEncoding *encodingOut, ULONGLONG *resumeAtOut) {
+    size_t size = 0;
+    BYTE *data = ReadWholeFile(journalPath, &size);
+    if (!data) return FALSE;
+
+    // Validate the header against the document as it is now
+    JournalHeader header;
+    ULONGLONG baseSize = 0, baseWriteTime = 0;
+    GetBaseIdentity(documentPath, &baseSize, &baseWriteTime);
+    BOOL valid = size >= sizeof(header);
+    if (valid) {
+        CopyMemory(&header, data, sizeof(header));
+        valid = header.magic == JOURNAL_MAGIC && header.version == JOURNAL_VERSION &&
+                header.baseSize == baseSize && header.baseWriteTime == baseWriteTime &&
+                header.baseLength == *length;
+    }
+
+    GapBuffer gap;
+    gap.capacity = *length;
+    gap.gapStart = gap.gapEnd = *length;
+    gap.data = *text;
+    if (!valid || !GapReserve(&gap, *length / 8 + 4096)) {
+        HeapFree(GetProcessHeap(), 0, data);
+        return FALSE;
+    }
+    *text = gap.data;  // The base buffer now belongs to the gap buffer
+
+    // Replay every intact record in order
+    size_t pos = sizeof(header);
+    while (size - pos >= sizeof(JournalRecord)) {
+        JournalRecord record;
+        CopyMemory(&record, data + pos, sizeof(record));
+        size_t textBytes = (size_t)record.insertLength * sizeof(WCHAR);
+        if (textBytes > size - pos - sizeof(record)) break;  // Torn tail
+        const WCHAR *insert = (const WCHAR *)(data + pos + sizeof(record));
+        if (RecordCrc(&record, insert) != record.crc) break;
+        if (!GapReplace(&gap, record.offset, record.removeLength, insert, record.insertLength)) break;
+        pos += sizeof(record) + textBytes;
+    }
+    HeapFree(GetProcessHeap(), 0, data);
+
+    // Close the gap and terminate the text (GapReplace keeps one spare)
+    size_t recovered = GapLength(&gap);
+    GapMove(&gap, recovered);
+    gap.data[recovered] = L'\0';
+    *text = gap.data;
+    *length = recovered;
+    if (encodingOut) *encodingOut = (TextEncoding)header.encoding;
+    if (resumeAtOut) *resumeAtOut = pos;
+    return TRUE;
+}
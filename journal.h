@@ -0,0 +1,106 @@
+// ============================================================================
+// journal.h - Crash Recovery Edit Journal Header
+// ============================================================================
+// Keeps unsaved work safe without saving the document. Every edit is appended
+// to a small journal file ("<document>.rpj", hidden, next to the document; in
+// %LOCALAPPDATA%\retropad\journal for untitled documents) as
+// "at offset X, replace R characters with this text".
+//   - The UI thread only copies the record into a lock-free ring buffer.
+//   - A background thread writes the ring to disk and flushes it in batches.
+//   - A clean exit or a save discards the journal (a hot exit keeps it for
+//     the next session instead). If retropad dies, the next start finds the
+//     journal and replays it on top of the file.
+// Records carry a CRC so a torn write at the end of the file is ignored.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "file_io.h"
+
+#define JOURNAL_EXTENSION     L".rpj"
+#define JOURNAL_RING_SIZE     (1u << 20)   // Ring buffer bytes (power of two)
+#define JOURNAL_BATCH_MS      100          // Delay that groups edits into one write
+
+// ============================================================================
+// Journal State
+// ============================================================================
+// The ring is single-producer (UI thread) / single-consumer (writer thread).
+// 'head' and 'tail' count bytes ever written and consumed; only the producer
+// moves 'head' and only the writer moves 'tail'.
+// ============================================================================
+typedef struct Journal {
+    BYTE *ring;                         // JOURNAL_RING_SIZE bytes
+    volatile LONGLONG head;             // Bytes enqueued
+    volatile LONGLONG tail;             // Bytes written to disk (or dropped)
+    volatile LONG writerIdle;           // Writer is waiting for a wake-up
+    volatile LONG syncRequested;        // Skip the batching delay
+    volatile LONG stopping;             // Writer should exit
+    HANDLE thread;                      // Background writer
+    HANDLE wake;                        // Auto-reset: data or request pending
+    HANDLE drained;                     // Auto-reset: writer caught up
+
+    CRITICAL_SECTION fileLock;          // Guards everything below
+    HANDLE file;                        // Journal file, created on first edit
+    BOOL fileFailed;                    // Could not create it; drop records
+    WCHAR path[MAX_PATH];               // Journal file path ("" = disabled)
+    ULONGLONG baseSize;                 // Document file identity at the base
+    ULONGLONG baseWriteTime;
+    ULONGLONG baseLength;               // Base text length in characters
+    TextEncoding encoding;              // Encoding of the document
+} Journal;
+
+// Starts the background writer. Returns FALSE if journaling is unavailable;
+// all other functions are then harmless no-ops.
+BOOL JournalStart(Journal *journal);
+
+// Writes out pending records and stops the writer. The journal file is
+// deleted unless 'keepFile' is TRUE.
+void JournalStop(Journal *journal, BOOL keepFile);
+
+// Closes the journal file without deleting it so a later session can pick
+// up the unsaved edits (hot exit). Journaling stops until JournalBegin.
+// Parameters:
+//   pathOut - Receives the journal path
+//   pathLen - Size of pathOut in WCHARs
+// Returns: TRUE if every edit so far is in the kept journal, FALSE if there
+//          is no journal file (nothing edited, or journaling failed)
+BOOL JournalDetach(Journal *journal, WCHAR *pathOut, DWORD pathLen);
+
+// Starts journaling a document whose text on disk is the base for all
+// following edits. Any previous journal is deleted.
+// Parameters:
+//   documentPath - Document file, or NULL for an untitled document
+//   baseLength   - Length of the document text in characters
+//   encoding     - Document encoding (restored with untitled documents)
+//   resumeFrom   - Recovered journal to keep appending to, or NULL
+//   resumeAt     - Valid length of 'resumeFrom' reported by JournalRecover
+void JournalBegin(Journal *journal, LPCWSTR documentPath, size_t baseLength, TextEncoding encoding,
+                  LPCWSTR resumeFrom, ULONGLONG resumeAt);
+
+// Queues one edit. Never blocks unless the ring is full.
+void JournalAppend(Journal *journal, ULONGLONG offset, ULONGLONG removeLength,
+                   const WCHAR *insert, size_t insertLength);
+
+// Finds a journal left behind by a session that did not exit cleanly.
+// Parameters:
+//   documentPath - Document to check, or NULL to look for untitled work
+//   pathOut      - Receives the journal path
+//   pathLen      - Size of pathOut in WCHARs
+// Returns: TRUE if a journal with at least one edit exists and is not in use
+BOOL JournalFindOrphan(LPCWSTR documentPath, WCHAR *pathOut, DWORD pathLen);
+
+// Replays a journal on top of the document text.
+// Parameters:
+//   journalPath  - Journal found by JournalFindOrphan
+//   documentPath - Document the text was loaded from (NULL if untitled)
+//   text         - In: HeapAlloc'd base text. Out: recovered text
+//   length       - In: base length. Out: recovered length
+//   encodingOut  - Receives the recorded encoding (can be NULL)
+//   resumeAtOut  - Receives the valid journal length for JournalBegin
+// Returns: TRUE if the journal matched the document and was applied
+BOOL JournalRecover(LPCWSTR journalPath, LPCWSTR documentPath, WCHAR **text, size_t *length,
+                    TextEncoding *encodingOut, ULONGLONG *resumeAtOut);
+
+// Deletes a journal the user chose not to recover.
+void JournalDiscard(LPCWSTR journalPath);
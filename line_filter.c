@@ -0,0 +1,158 @@
+// ============================================================================
+// line_filter.c - Filtered Line View Implementation
+// ============================================================================
+// Following an edit ('removed' characters at 'offset' became 'inserted'):
+//   - The lines searched again run from the line holding the character
+//     'reach' before the edit (a match starting there could run into it) to
+//     the end of the line holding the new edit end.
+//   - Rows before those lines cannot change. Rows after them keep their
+//     text and are shifted by the length change.
+//   - Each search is confined to the searched lines plus 'reach'
+//     characters, so a keystroke in a huge document stays cheap.
+// ============================================================================
+
+#include "line_filter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY  256
+
+// ============================================================================
+// Storage Helpers
+// ============================================================================
+static bool Reserve(uint32_t **rows, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) return true;
+    size_t newCapacity = *capacity ? *capacity : INITIAL_CAPACITY;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2 / sizeof(uint32_t)) return false;
+        newCapacity *= 2;
+    }
+    uint32_t *grown = (uint32_t *)realloc(*rows, newCapacity * sizeof(uint32_t));
+    if (!grown) return false;
+    *rows = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+static bool Append(uint32_t **rows, size_t *count, size_t *capacity, size_t lineStart) {
+    if (*count > 0 && (*rows)[*count - 1] >= lineStart) return true;
+    if (!Reserve(rows, capacity, *count + 1)) return false;
+    (*rows)[(*count)++] = (uint32_t)lineStart;
+    return true;
+}
+
+// ============================================================================
+// LineFilterInit / LineFilterFree / LineFilterReset / LineFilterInvalidate
+// ============================================================================
+void LineFilterInit(LineFilter *filter) {
+    memset(filter, 0, sizeof(*filter));
+}
+
+void LineFilterFree(LineFilter *filter) {
+    free(filter->rows);
+    LineFilterInit(filter);
+}
+
+void LineFilterReset(LineFilter *filter) {
+    filter->count = 0;
+    filter->stale = false;
+}
+
+void LineFilterInvalidate(LineFilter *filter) {
+    filter->count = 0;
+    filter->stale = true;
+}
+
+bool LineFilterAppend(LineFilter *filter, size_t lineStart) {
+    if (lineStart > LINE_FILTER_MAX_TEXT) return false;
+    return Append(&filter->rows, &filter->count, &filter->capacity, lineStart);
+}
+
+size_t LineFilterLowerBound(const LineFilter *filter, size_t position) {
+    size_t lo = 0, hi = filter->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (filter->rows[mid] < position) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// ============================================================================
+// Line Boundaries
+// ============================================================================
+size_t LineFilterLineStart(const uint16_t *text, size_t length, size_t pos) {
+    if (pos > length) pos = length;
+    // The '\n' of "\r\n" ends the same line as its '\r'
+    if (pos > 0 && pos < length && text[pos] == '\n' && text[pos - 1] == '\r') pos--;
+    while (pos > 0 && text[pos - 1] != '\n' && text[pos - 1] != '\r') pos--;
+    return pos;
+}
+
+size_t LineFilterLineEnd(const uint16_t *text, size_t length, size_t pos) {
+    if (pos > 0 && pos < length && text[pos] == '\n' && text[pos - 1] == '\r') return pos - 1;
+    while (pos < length && text[pos] != '\n' && text[pos] != '\r') pos++;
+    return pos;
+}
+
+size_t LineFilterNextLine(const uint16_t *text, size_t length, size_t pos) {
+    pos = LineFilterLineEnd(text, length, pos);
+    if (pos < length && text[pos] == '\r') pos++;
+    if (pos < length && text[pos] == '\n') pos++;
+    return pos;
+}
+
+// ============================================================================
+// LineFilterUpdate - Follow One Edit
+// ============================================================================
+bool LineFilterUpdate(LineFilter *filter, const MatchFinder *finder, const uint16_t *text, size_t length,
+                      size_t offset, size_t removed, size_t inserted) {
+    if (filter->stale) return false;
+    if (finder->reach == 0 || length > LINE_FILTER_MAX_TEXT) {
+        LineFilterInvalidate(filter);
+        return false;
+    }
+
+    // The lines to search again, in the new text; the line before the edit
+    // is included, as the edit may join or split its terminator
+    size_t back = finder->reach + 1;
+    size_t first = LineFilterLineStart(text, length, offset > back ? offset - back : 0);
+    size_t last = LineFilterNextLine(text, length, offset + inserted < length ? offset + inserted : length);
+    size_t oldLast = last - inserted + removed;
+
+    size_t keep = LineFilterLowerBound(filter, first);     // Rows before the lines searched
+    size_t next = LineFilterLowerBound(filter, oldLast);   // First row after them (old offsets)
+
+    uint32_t *fresh = NULL;
+    size_t freshCount = 0, freshCapacity = 0;
+    size_t window = last + finder->reach;
+    if (window > length) window = length;
+    size_t pos = first, start = 0, end = 0;
+    while (pos < last && finder->find(finder->context, text, window, pos, &start, &end) && start < last) {
+        if (!Append(&fresh, &freshCount, &freshCapacity, LineFilterLineStart(text, length, start))) {
+            free(fresh);
+            LineFilterInvalidate(filter);
+            return false;
+        }
+        pos = LineFilterNextLine(text, length, start);
+    }
+
+    // Splice: kept rows, new rows, shifted rows
+    size_t tail = filter->count - next;
+    if (!Reserve(&filter->rows, &filter->capacity, keep + freshCount + tail)) {
+        free(fresh);
+        LineFilterInvalidate(filter);
+        return false;
+    }
+    uint32_t *rows = filter->rows;
+    if (tail) memmove(rows + keep + freshCount, rows + next, tail * sizeof(uint32_t));
+    if (removed != inserted) {
+        for (size_t i = keep + freshCount; i < keep + freshCount + tail; ++i) {
+            rows[i] = (uint32_t)(rows[i] - removed + inserted);
+        }
+    }
+    if (freshCount) memcpy(rows + keep, fresh, freshCount * sizeof(uint32_t));
+    filter->count = keep + freshCount + tail;
+    free(fresh);
+    return true;
+}
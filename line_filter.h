@@ -0,0 +1,70 @@
+// ============================================================================
+// line_filter.h - Filtered Line View Header
+// ============================================================================
+// The lines of a document that hold a match, as a list of rows: row i is
+// the i-th such line. Nothing of the text is copied; a row is the offset
+// where its line starts, one 32-bit integer per matching line (the edit
+// control holds fewer than 2^31 characters). The line's text and number
+// are looked up in the document when a row is shown.
+//   - A line matches if a match starts in it ("\r\n", "\n" and "\r" each
+//     end one line, as in LineIndex).
+//   - The filter follows edits: rows before an edit stay, rows after it
+//     are shifted, and only the lines around the edit are searched again.
+//     Text appended at the end (a growing log) is searched once, as it
+//     arrives. A finder with no length limit cannot be followed that way;
+//     the edit marks the filter stale and it must be rebuilt.
+// Building the filter of a whole document is done on all cores by
+// ParallelFilterLines (parallel_search.h), which appends rows in order.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "match_index.h"
+
+#define LINE_FILTER_MAX_TEXT  UINT32_MAX  // Longest text a filter can describe
+
+typedef struct LineFilter {
+    uint32_t *rows;         // Start offset of each matching line, rising
+    size_t count;
+    size_t capacity;
+    bool stale;             // Edits could not be followed; rebuild before use
+} LineFilter;
+
+void LineFilterInit(LineFilter *filter);
+void LineFilterFree(LineFilter *filter);
+
+// Empties the filter for a rebuild (keeping its memory).
+void LineFilterReset(LineFilter *filter);
+
+// Adds the line starting at 'lineStart' after the last row; a repeat of
+// the last row is ignored. Returns false if out of memory.
+bool LineFilterAppend(LineFilter *filter, size_t lineStart);
+
+// Follows one edit: 'removed' characters at 'offset' were replaced by
+// 'inserted' characters. 'text' is the document after the edit.
+// Returns true if the filter is still current, false if it went stale.
+bool LineFilterUpdate(LineFilter *filter, const MatchFinder *finder, const uint16_t *text, size_t length,
+                      size_t offset, size_t removed, size_t inserted);
+
+// Marks the filter stale, for edits that cannot be described.
+void LineFilterInvalidate(LineFilter *filter);
+
+// Returns the first row whose line starts at or after 'position' (count if none).
+size_t LineFilterLowerBound(const LineFilter *filter, size_t position);
+
+// ============================================================================
+// Line Boundaries
+// ============================================================================
+// Start of the line holding 'pos'. A position on a line's terminator
+// belongs to that line.
+size_t LineFilterLineStart(const uint16_t *text, size_t length, size_t pos);
+
+// End of the text of the line holding 'pos' (where its terminator starts).
+size_t LineFilterLineEnd(const uint16_t *text, size_t length, size_t pos);
+
+// Start of the line after the one holding 'pos', or 'length' if it is the last.
+size_t LineFilterNextLine(const uint16_t *text, size_t length, size_t pos);
@@ -0,0 +1,220 @@
+// ============================================================================
+// line_gutter.c - Line Number Gutter Implementation
+// ============================================================================
+// The gutter is a plain child window of its own class. It draws numbers
+// right-aligned, level with the edit control's rows: the control draws its
+// top row at the top of its formatting rectangle (EM_GETRECT), mapped here
+// into gutter coordinates, and every row below is one row height further.
+// Only the rows inside the paint rectangle are visited.
+// ============================================================================
+
+#include "line_gutter.h"
+#include <strsafe.h>   // For safe string operations
+
+#define GUTTER_CLASS        L"RetropadLineGutter"
+#define GUTTER_MIN_DIGITS   3       // Width never shrinks below "999"
+#define GUTTER_PADDING      6       // Pixels on each side of the numbers
+
+// ============================================================================
+// Metrics
+// ============================================================================
+// Measures the edit control's font, unless it was measured already
+static void Measure(LineGutter *gutter) {
+    HFONT font = (HFONT)SendMessageW(gutter->edit, WM_GETFONT, 0, 0);
+    if (gutter->measured && font == gutter->font) return;
+
+    HDC hdc = GetDC(gutter->edit);
+    if (!hdc) return;
+    HFONT oldFont = (HFONT)SelectObject(hdc, font ? font : (HFONT)GetStockObject(SYSTEM_FONT));
+    TEXTMETRICW tm;
+    GetTextMetricsW(hdc, &tm);
+    INT widths[10];
+    int digitWidth = tm.tmAveCharWidth;
+    if (GetCharWidth32W(hdc, L'0', L'9', widths)) {
+        digitWidth = 0;
+        for (int i = 0; i < 10; ++i) {
+            if (widths[i] > digitWidth) digitWidth = widths[i];
+        }
+    }
+    SelectObject(hdc, oldFont);
+    ReleaseDC(gutter->edit, hdc);
+
+    gutter->font = font;
+    gutter->rowHeight = tm.tmHeight > 0 ? tm.tmHeight : 1;
+    gutter->digitWidth = digitWidth > 0 ? digitWidth : 1;
+    gutter->measured = TRUE;
+}
+
+// Digits needed for the numbers of 'rows' rows (an upper bound on the lines)
+static int DigitsFor(LRESULT rows) {
+    int digits = 1;
+    for (unsigned long long limit = 10; (unsigned long long)rows >= limit && digits < 20; limit *= 10) digits++;
+    return digits < GUTTER_MIN_DIGITS ? GUTTER_MIN_DIGITS : digits;
+}
+
+// ============================================================================
+// Paint - Number the Visible Rows
+// ============================================================================
+static void DrawNumber(HDC hdc, int x, int y, uint64_t number) {
+    WCHAR text[24];
+    StringCchPrintfW(text, ARRAYSIZE(text), L"%llu", (unsigned long long)number);
+    TextOutW(hdc, x, y, text, lstrlenW(text));
+}
+
+static void Paint(LineGutter *gutter) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(gutter->hwnd, &ps);
+    FillRect(hdc, &ps.rcPaint, GetSysColorBrush(COLOR_BTNFACE));
+    if (!gutter->edit) {
+        EndPaint(gutter->hwnd, &ps);
+        return;
+    }
+    Measure(gutter);
+
+    RECT client, format;
+    GetClientRect(gutter->hwnd, &client);
+    SendMessageW(gutter->edit, EM_GETRECT, 0, (LPARAM)&format);
+    POINT origin = { 0, format.top };
+    MapWindowPoints(gutter->edit, gutter->hwnd, &origin, 1);
+
+    int rows = (int)SendMessageW(gutter->edit, EM_GETLINECOUNT, 0, 0);
+    int first = (int)SendMessageW(gutter->edit, EM_GETFIRSTVISIBLELINE, 0, 0);
+    gutter->firstRow = first;
+
+    // Rows overlapping the paint rectangle
+    int skip = ps.rcPaint.top > origin.y ? (ps.rcPaint.top - origin.y) / gutter->rowHeight : 0;
+    int span = ps.rcPaint.bottom > origin.y ?
+               (ps.rcPaint.bottom - origin.y + gutter->rowHeight - 1) / gutter->rowHeight : 0;
+    int from = first + skip;
+    int to = first + span;
+    if (to > rows) to = rows;
+
+    HFONT oldFont = (HFONT)SelectObject(hdc, gutter->font ? gutter->font : (HFONT)GetStockObject(SYSTEM_FONT));
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, GetSysColor(COLOR_GRAYTEXT));
+    UINT oldAlign = SetTextAlign(hdc, TA_RIGHT | TA_TOP);
+    int x = client.right - GUTTER_PADDING;
+
+    if (!gutter->wrapped) {
+        for (int row = from; row < to; ++row) {
+            DrawNumber(hdc, x, origin.y + (row - first) * gutter->rowHeight, (uint64_t)row + 1);
+        }
+    } else {
+        // Rows that start after a terminator start a line; the first row's
+        // line comes from the index
+        HLOCAL handle = (HLOCAL)SendMessageW(gutter->edit, EM_GETHANDLE, 0, 0);
+        const WCHAR *text = handle ? (const WCHAR *)LocalLock(handle) : NULL;
+        if (text) {
+            size_t length = (size_t)GetWindowTextLengthW(gutter->edit);
+            uint64_t line = 0;
+            for (int row = from; row < to; ++row) {
+                LRESULT start = SendMessageW(gutter->edit, EM_LINEINDEX, (WPARAM)row, 0);
+                if (start < 0 || (size_t)start > length) break;
+                BOOL startsLine = start == 0 || text[start - 1] == L'\n' || text[start - 1] == L'\r';
+                if (row == from) {
+                    line = LineIndexLineFromOffset(gutter->index, (const uint16_t *)text, length, (size_t)start);
+                } else if (startsLine) {
+                    line++;
+                }
+                if (startsLine) DrawNumber(hdc, x, origin.y + (row - first) * gutter->rowHeight, line + 1);
+            }
+            LocalUnlock(handle);
+        }
+    }
+
+    SetTextAlign(hdc, oldAlign);
+    SelectObject(hdc, oldFont);
+    EndPaint(gutter->hwnd, &ps);
+}
+
+// ============================================================================
+// GutterWndProc
+// ============================================================================
+static LRESULT CALLBACK GutterWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    LineGutter *gutter = (LineGutter *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    switch (msg) {
+    case WM_NCCREATE:
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)((CREATESTRUCTW *)lParam)->lpCreateParams);
+        break;
+    case WM_ERASEBKGND:
+        return 1;       // Paint fills the background
+    case WM_PAINT:
+        if (gutter) {
+            Paint(gutter);
+            return 0;
+        }
+        break;
+    case WM_MOUSEWHEEL:
+        // Scrolling over the numbers scrolls the text
+        if (gutter && gutter->edit) return SendMessageW(gutter->edit, msg, wParam, lParam);
+        break;
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+// ============================================================================
+// LineGutterCreate / LineGutterShow / LineGutterAttach
+// ============================================================================
+BOOL LineGutterCreate(LineGutter *gutter, HWND parent, HINSTANCE instance) {
+    static ATOM atom = 0;
+    if (!atom) {
+        WNDCLASSEXW wc = { sizeof(wc) };
+        wc.lpfnWndProc = GutterWndProc;
+        wc.hInstance = instance;
+        wc.hCursor = LoadCursorW(NULL, IDC_ARROW);
+        wc.lpszClassName = GUTTER_CLASS;
+        atom = RegisterClassExW(&wc);
+        if (!atom) return FALSE;
+    }
+    gutter->hwnd = CreateWindowExW(0, GUTTER_CLASS, NULL, WS_CHILD, 0, 0, 0, 0, parent, NULL, instance, gutter);
+    gutter->firstRow = -1;
+    return gutter->hwnd != NULL;
+}
+
+void LineGutterShow(LineGutter *gutter, BOOL visible) {
+    gutter->visible = visible;
+    gutter->firstRow = -1;
+    if (gutter->hwnd) ShowWindow(gutter->hwnd, visible ? SW_SHOW : SW_HIDE);
+}
+
+void LineGutterAttach(LineGutter *gutter, HWND edit, LineIndex *index, BOOL wrapped) {
+    gutter->edit = edit;
+    gutter->index = index;
+    gutter->wrapped = wrapped;
+    gutter->measured = FALSE;
+    gutter->firstRow = -1;
+    if (gutter->hwnd) InvalidateRect(gutter->hwnd, NULL, FALSE);
+}
+
+// ============================================================================
+// LineGutterLayout
+// ============================================================================
+int LineGutterLayout(LineGutter *gutter, int height) {
+    if (!gutter->visible || !gutter->hwnd || !gutter->edit) return 0;
+    Measure(gutter);
+    gutter->digits = DigitsFor(SendMessageW(gutter->edit, EM_GETLINECOUNT, 0, 0));
+    int width = gutter->digits * gutter->digitWidth + 2 * GUTTER_PADDING;
+    MoveWindow(gutter->hwnd, 0, 0, width, height, TRUE);
+    InvalidateRect(gutter->hwnd, NULL, FALSE);
+    return width;
+}
+
+void LineGutterFontChanged(LineGutter *gutter) {
+    gutter->measured = FALSE;
+}
+
+// ============================================================================
+// LineGutterTextChanged / LineGutterSync
+// ============================================================================
+BOOL LineGutterTextChanged(LineGutter *gutter) {
+    if (!gutter->visible || !gutter->hwnd || !gutter->edit) return FALSE;
+    if (DigitsFor(SendMessageW(gutter->edit, EM_GETLINECOUNT, 0, 0)) != gutter->digits) return TRUE;
+    InvalidateRect(gutter->hwnd, NULL, FALSE);
+    return FALSE;
+}
+
+void LineGutterSync(LineGutter *gutter) {
+    if (!gutter->visible || !gutter->hwnd || !gutter->edit) return;
+    int first = (int)SendMessageW(gutter->edit, EM_GETFIRSTVISIBLELINE, 0, 0);
+    if (first != gutter->firstRow) InvalidateRect(gutter->hwnd, NULL, FALSE);
+}
@@ -0,0 +1,60 @@
+// ============================================================================
+// line_gutter.h - Line Number Gutter Header
+// ============================================================================
+// A strip left of the edit control with the line number of each row on
+// screen. A paint costs O(visible rows), however long the document:
+//   - The control reports its top row (EM_GETFIRSTVISIBLELINE) and each
+//     row's start (EM_LINEINDEX) directly.
+//   - Without word wrap a row is a line, so row r shows r + 1.
+//   - With word wrap only rows that start a line get a number. The line of
+//     the top row comes from the document's LineIndex (which follows edits,
+//     see line_index.h); each row below adds one if it starts after a line
+//     terminator.
+// Font metrics (row height, widest digit) are measured once per font. The
+// parent calls LineGutterSync after the edit control paints, which marks
+// the gutter for repainting only if the control scrolled. The gutter itself
+// only paints from the message loop, never in the middle of an edit, so
+// the line index it reads has always caught up with the text.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "line_index.h"
+
+typedef struct LineGutter {
+    HWND hwnd;
+    HWND edit;                  // Edit control whose rows are numbered
+    LineIndex *index;           // Lines of the edit control's text
+    BOOL wrapped;               // Word wrap is on: rows are not lines
+    BOOL visible;
+    HFONT font;                 // Font the metrics below were measured for
+    BOOL measured;
+    int rowHeight;
+    int digitWidth;             // Widest of '0'..'9'
+    int digits;                 // Digits the current width has room for
+    int firstRow;               // Top row when last painted
+} LineGutter;
+
+// Creates the (hidden) gutter window. Returns FALSE on failure.
+BOOL LineGutterCreate(LineGutter *gutter, HWND parent, HINSTANCE instance);
+
+void LineGutterShow(LineGutter *gutter, BOOL visible);
+
+// Points the gutter at a new or recreated edit control.
+void LineGutterAttach(LineGutter *gutter, HWND edit, LineIndex *index, BOOL wrapped);
+
+// Places the gutter at the parent's left edge, 'height' pixels tall.
+// Returns the width it takes (0 while hidden).
+int LineGutterLayout(LineGutter *gutter, int height);
+
+// The edit control's font changed: measure again on the next layout.
+void LineGutterFontChanged(LineGutter *gutter);
+
+// The text changed. Returns TRUE if the row count outgrew (or shrank below)
+// the gutter's width, so the parent must lay it out again.
+BOOL LineGutterTextChanged(LineGutter *gutter);
+
+// Marks the gutter for repainting if the edit control scrolled since the
+// last paint. Called after the control paints.
+void LineGutterSync(LineGutter *gutter);
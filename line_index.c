@@ -0,0 +1,349 @@
+// ============================================================================
+// line_index.c - Sparse Line Offset Index Implementation
+// ============================================================================
+// Builds, queries and serializes the checkpoint-based line index declared in
+// line_index.h. The serialized form is used by the metadata cache so that
+// reopening a large file does not require recounting its lines.
+// ============================================================================
+
+#include "line_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// AppendCheckpoint - Add One Checkpoint, Growing the Array as Needed
+// ============================================================================
+static bool AppendCheckpoint(LineIndex *index, uint64_t offset) {
+    if (index->count == index->capacity) {
+        size_t newCapacity = index->capacity ? index->capacity * 2 : 64;
+        uint64_t *grown = (uint64_t *)realloc(index->checkpoints, newCapacity * sizeof(uint64_t));
+        if (!grown) return false;
+        index->checkpoints = grown;
+        index->capacity = newCapacity;
+    }
+    index->checkpoints[index->count++] = offset;
+    return true;
+}
+
+// ============================================================================
+// LineIndexInit - Prepare an Empty Index
+// ============================================================================
+void LineIndexInit(LineIndex *index, uint32_t stride) {
+    memset(index, 0, sizeof(*index));
+    index->stride = stride ? stride : LINE_INDEX_DEFAULT_STRIDE;
+    index->lineCount = 1;
+}
+
+// ============================================================================
+// LineIndexFree - Release Checkpoint Storage
+// ============================================================================
+void LineIndexFree(LineIndex *index) {
+    uint32_t stride = index->stride;
+    free(index->checkpoints);
+    LineIndexInit(index, stride);
+}
+
+// ============================================================================
+// LineIndexBuild - Scan Text and Record Every Nth Line Start
+// ============================================================================
+// Walks the text once, counting line terminators of each style and storing
+// the start offset of every stride-th line. Line 0 is always a checkpoint.
+// ============================================================================
+bool LineIndexBuild(LineIndex *index, const uint16_t *text, size_t length) {
+    index->count = 0;
+    index->lineCount = 1;
+    index->lineEnding = LINE_ENDING_NONE;
+    index->partial = false;
+    if (!AppendCheckpoint(index, 0)) return false;
+
+    uint64_t crlf = 0, lf = 0, cr = 0;
+    uint32_t sinceCheckpoint = 0;
+    size_t i = 0;
+    while (i < length) {
+        uint16_t ch = text[i++];
+        // Fast path: most code units are not line terminators
+        if (ch != '\n' && ch != '\r') continue;
+
+        if (ch == '\r') {
+            if (i < length && text[i] == '\n') {
+                i++;
+                crlf++;
+            } else {
+                cr++;
+            }
+        } else {
+            lf++;
+        }
+
+        // 'i' now points at the first code unit of the next line
+        index->lineCount++;
+        if (++sinceCheckpoint == index->stride) {
+            sinceCheckpoint = 0;
+            if (!AppendCheckpoint(index, (uint64_t)i)) return false;
+        }
+    }
+
+    // Classify the dominant line ending style
+    int styles = (crlf != 0) + (lf != 0) + (cr != 0);
+    if (styles > 1) {
+        index->lineEnding = LINE_ENDING_MIXED;
+    } else if (crlf) {
+        index->lineEnding = LINE_ENDING_CRLF;
+    } else if (lf) {
+        index->lineEnding = LINE_ENDING_LF;
+    } else if (cr) {
+        index->lineEnding = LINE_ENDING_CR;
+    }
+    return true;
+}
+
+// ============================================================================
+// LineIndexSeek - Locate the Nearest Checkpoint at or Before a Line
+// ============================================================================
+uint64_t LineIndexSeek(const LineIndex *index, uint64_t line, uint64_t *lineOut) {
+    if (index->count == 0) {
+        if (lineOut) *lineOut = 0;
+        return 0;
+    }
+    uint64_t slot = line / index->stride;
+    if (slot >= index->count) slot = index->count - 1;
+    if (lineOut) *lineOut = slot * index->stride;
+    return index->checkpoints[slot];
+}
+
+// ============================================================================
+// LineIndexLineOffset - Resolve a Line Number to a Text Offset
+// ============================================================================
+// Jumps to the checkpoint for the line and scans forward over the remaining
+// (at most stride - 1) lines in the text.
+// ============================================================================
+uint64_t LineIndexLineOffset(const LineIndex *index, const uint16_t *text, size_t length, uint64_t line) {
+    if (line >= index->lineCount) line = index->lineCount ? index->lineCount - 1 : 0;
+
+    uint64_t current = 0;
+    size_t pos = (size_t)LineIndexSeek(index, line, &current);
+    if (pos > length) pos = length;
+
+    while (current < line && pos < length) {
+        uint16_t ch = text[pos++];
+        if (ch == '\r') {
+            if (pos < length && text[pos] == '\n') pos++;
+            current++;
+        } else if (ch == '\n') {
+            current++;
+        }
+    }
+    return (uint64_t)pos;
+}
+
+// ============================================================================
+// Edit Helpers
+// ============================================================================
+// First checkpoint whose offset is above 'offset' (count if none)
+static size_t UpperBound(const LineIndex *index, uint64_t offset) {
+    size_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->checkpoints[mid] <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Lines ending in text[from, to), both line starts; stops counting at 'limit'
+static uint64_t CountLines(const uint16_t *text, size_t length, size_t from, size_t to, uint64_t limit) {
+    uint64_t lines = 0;
+    size_t pos = from;
+    while (pos < to && lines < limit) {
+        uint16_t ch = text[pos++];
+        if (ch == '\r') {
+            if (pos < length && text[pos] == '\n') pos++;
+            lines++;
+        } else if (ch == '\n') {
+            lines++;
+        }
+    }
+    return lines;
+}
+
+// ============================================================================
+// LineIndexEdit - Follow One Edit
+// ============================================================================
+// A checkpoint before the edit is untouched; one strictly after the old
+// edit end still starts a line, as the code unit before it is unchanged.
+// If exactly one stride of lines still separates it from the checkpoint
+// before the edit, it and every later checkpoint keep their line numbers.
+// ============================================================================
+void LineIndexEdit(LineIndex *index, const uint16_t *text, size_t length, size_t offset, size_t removed,
+                   size_t inserted) {
+    if (index->count == 0) {
+        index->partial = true;
+        return;
+    }
+    // A checkpoint at the edit offset itself may stop starting a line
+    // ("\r" + "\n" joined), so only those before it are kept; line 0 always is
+    size_t keep = offset > 0 ? UpperBound(index, (uint64_t)offset - 1) : 1;
+    size_t next = UpperBound(index, (uint64_t)offset + removed);
+
+    if (next == keep && next < index->count) {
+        size_t from = (size_t)index->checkpoints[keep - 1];
+        size_t to = (size_t)(index->checkpoints[next] - removed + inserted);
+        if (to <= length && CountLines(text, length, from, to, (uint64_t)index->stride + 1) == index->stride) {
+            if (removed != inserted) {
+                for (size_t i = next; i < index->count; ++i) {
+                    index->checkpoints[i] = index->checkpoints[i] - removed + inserted;
+                }
+            }
+            return;
+        }
+    }
+    index->count = keep;
+    index->partial = true;
+}
+
+// ============================================================================
+// LineIndexDropFrom - Forget the Lines from an Offset On
+// ============================================================================
+void LineIndexDropFrom(LineIndex *index, size_t offset) {
+    if (index->count > 0) {
+        size_t keep = offset > 0 ? UpperBound(index, (uint64_t)offset - 1) : 1;
+        if (keep < index->count) index->count = keep;
+    }
+    index->partial = true;
+}
+
+// ============================================================================
+// LineIndexExtend - Count a Partial Index Forward
+// ============================================================================
+// Resumes at the last checkpoint, so the budget is checked a stride of
+// lines at a time.
+// ============================================================================
+bool LineIndexExtend(LineIndex *index, const uint16_t *text, size_t length, size_t offset, size_t budget) {
+    if (!index->partial) return true;
+    if (index->count == 0 && !AppendCheckpoint(index, 0)) return false;
+
+    uint64_t line = (uint64_t)(index->count - 1) * index->stride;
+    size_t start = (size_t)index->checkpoints[index->count - 1];
+    if (start > offset) return true;
+    size_t pos = start;
+    uint32_t sinceCheckpoint = 0;
+    while (pos < length) {
+        uint16_t ch = text[pos++];
+        if (ch != '\n' && ch != '\r') continue;
+        if (ch == '\r' && pos < length && text[pos] == '\n') pos++;
+
+        line++;
+        if (++sinceCheckpoint == index->stride) {
+            sinceCheckpoint = 0;
+            if (!AppendCheckpoint(index, (uint64_t)pos)) return false;
+            if (pos > offset) return true;
+            if (pos - start >= budget) return false;
+        }
+    }
+    index->lineCount = line + 1;
+    index->partial = false;
+    return true;
+}
+
+// ============================================================================
+// LineIndexLineFromOffset - Resolve a Text Offset to a Line Number
+// ============================================================================
+uint64_t LineIndexLineFromOffset(LineIndex *index, const uint16_t *text, size_t length, size_t offset) {
+    if (offset > length) offset = length;
+    LineIndexExtend(index, text, length, offset, SIZE_MAX);  // Out of memory: scan further below
+
+    size_t slot = UpperBound(index, (uint64_t)offset);
+    uint64_t line = slot > 0 ? (uint64_t)(slot - 1) * index->stride : 0;
+    size_t pos = slot > 0 ? (size_t)index->checkpoints[slot - 1] : 0;
+    while (pos < offset) {
+        uint16_t ch = text[pos++];
+        if (ch == '\r') {
+            if (pos < length && text[pos] == '\n') {
+                if (pos >= offset) break;   // 'offset' is on the "\n" of this line's "\r\n"
+                pos++;
+            }
+            line++;
+        } else if (ch == '\n') {
+            line++;
+        }
+    }
+    return line;
+}
+
+// ============================================================================
+// Varint Helpers - LEB128 Encoding of Unsigned 64-bit Values
+// ============================================================================
+static size_t PutVarint(uint8_t *out, size_t capacity, size_t pos, uint64_t value) {
+    do {
+        uint8_t byte = (uint8_t)(value & 0x7F);
+        value >>= 7;
+        if (value) byte |= 0x80;
+        if (pos < capacity) out[pos] = byte;
+        pos++;
+    } while (value);
+    return pos;
+}
+
+static bool GetVarint(const uint8_t *data, size_t size, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (*pos >= size) return false;
+        uint8_t byte = data[(*pos)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;  // Overlong encoding
+}
+
+// ============================================================================
+// LineIndexEncode - Serialize the Index Compactly
+// ============================================================================
+// Layout: stride, lineCount, lineEnding, count, then each checkpoint as the
+// delta from the previous one. Deltas are roughly "bytes per N lines", so
+// they usually fit in two or three bytes each.
+// ============================================================================
+size_t LineIndexEncode(const LineIndex *index, uint8_t *out, size_t capacity) {
+    size_t pos = 0;
+    pos = PutVarint(out, capacity, pos, index->stride);
+    pos = PutVarint(out, capacity, pos, index->lineCount);
+    pos = PutVarint(out, capacity, pos, (uint64_t)index->lineEnding);
+    pos = PutVarint(out, capacity, pos, (uint64_t)index->count);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < index->count; ++i) {
+        pos = PutVarint(out, capacity, pos, index->checkpoints[i] - previous);
+        previous = index->checkpoints[i];
+    }
+    return pos;
+}
+
+// ============================================================================
+// LineIndexDecode - Restore a Serialized Index
+// ============================================================================
+bool LineIndexDecode(LineIndex *index, const uint8_t *data, size_t size, size_t *consumedOut) {
+    size_t pos = 0;
+    uint64_t stride = 0, lineCount = 0, lineEnding = 0, count = 0;
+    if (!GetVarint(data, size, &pos, &stride) || stride == 0 || stride > UINT32_MAX) return false;
+    if (!GetVarint(data, size, &pos, &lineCount)) return false;
+    if (!GetVarint(data, size, &pos, &lineEnding) || lineEnding > LINE_ENDING_MIXED) return false;
+    if (!GetVarint(data, size, &pos, &count) || count > size - pos) return false;  // >= 1 byte each
+
+    LineIndexFree(index);
+    index->stride = (uint32_t)stride;
+    index->lineCount = lineCount;
+    index->lineEnding = (LineEnding)lineEnding;
+
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t delta = 0;
+        if (!GetVarint(data, size, &pos, &delta) || !AppendCheckpoint(index, offset + delta)) {
+            LineIndexFree(index);
+            return false;
+        }
+        offset += delta;
+    }
+    if (consumedOut) *consumedOut = pos;
+    return true;
+}
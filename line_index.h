@@ -0,0 +1,111 @@
+// ============================================================================
+// line_index.h - Sparse Line Offset Index Header
+// ============================================================================
+// A compact index mapping line numbers to text offsets. Only every Nth line
+// (the "stride") is recorded as a checkpoint, so the index stays small even
+// for files with millions of lines; a lookup jumps to the nearest checkpoint
+// and scans forward at most N-1 lines.
+// Offsets are measured in UTF-16 code units of the decoded document text,
+// which is what the edit control and the rest of retropad use.
+// The index can follow edits without rescanning the document: see
+// LineIndexEdit below.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINE_INDEX_DEFAULT_STRIDE 1024   // Lines between stored checkpoints
+
+// ============================================================================
+// Line Ending Styles
+// ============================================================================
+// The dominant line terminator found while building the index.
+// ============================================================================
+typedef enum LineEnding {
+    LINE_ENDING_NONE = 0,   // Single-line text (no terminators found)
+    LINE_ENDING_CRLF = 1,   // Windows style "\r\n"
+    LINE_ENDING_LF = 2,     // Unix style "\n"
+    LINE_ENDING_CR = 3,     // Classic Mac style "\r"
+    LINE_ENDING_MIXED = 4   // More than one style present
+} LineEnding;
+
+// ============================================================================
+// Line Index Structure
+// ============================================================================
+typedef struct LineIndex {
+    uint32_t stride;          // Lines between checkpoints (N)
+    uint64_t lineCount;       // Total number of lines (an empty text has 1)
+    uint64_t *checkpoints;    // checkpoints[k] = offset of line k * stride
+    size_t count;             // Number of valid checkpoints
+    size_t capacity;          // Allocated checkpoint slots
+    LineEnding lineEnding;    // Dominant line terminator style
+    bool partial;             // Edited: lines past the last checkpoint not counted yet
+} LineIndex;
+
+// Prepares an empty index. A stride of 0 selects LINE_INDEX_DEFAULT_STRIDE.
+void LineIndexInit(LineIndex *index, uint32_t stride);
+
+// Releases memory held by the index and resets it to empty.
+void LineIndexFree(LineIndex *index);
+
+// Rebuilds the index by scanning UTF-16 text. "\r\n", "\n" and "\r" each
+// terminate one line. Returns false only when memory allocation fails.
+bool LineIndexBuild(LineIndex *index, const uint16_t *text, size_t length);
+
+// Finds the checkpoint at or before a zero-based line number.
+// Parameters:
+//   index   - Built index
+//   line    - Zero-based line to locate
+//   lineOut - Receives the line number of the returned checkpoint
+// Returns: Offset of line *lineOut; scan forward to reach the target line
+uint64_t LineIndexSeek(const LineIndex *index, uint64_t line, uint64_t *lineOut);
+
+// Finds the offset of a zero-based line by seeking to the nearest checkpoint
+// and scanning the text forward. Lines past the end clamp to the last line.
+uint64_t LineIndexLineOffset(const LineIndex *index, const uint16_t *text, size_t length, uint64_t line);
+
+// ============================================================================
+// Following Edits
+// ============================================================================
+// An edit keeps the checkpoints before it. If it leaves the number of lines
+// between the checkpoints around it unchanged (most keystrokes), the
+// checkpoints after it are shifted and the index stays complete; otherwise
+// they are dropped and the index is 'partial' until LineIndexExtend has
+// counted the rest of the text again. lineCount is only current for a
+// complete index; lineEnding keeps describing the text as it was built.
+// LineIndexSeek, LineIndexLineOffset and LineIndexEncode expect a complete
+// index.
+// ============================================================================
+
+// Follows one edit: 'removed' code units at 'offset' were replaced by
+// 'inserted' ones. 'text' is the document after the edit.
+void LineIndexEdit(LineIndex *index, const uint16_t *text, size_t length, size_t offset, size_t removed,
+                   size_t inserted);
+
+// Forgets every checkpoint at or after 'offset' (0: the whole text changed);
+// the index becomes partial.
+void LineIndexDropFrom(LineIndex *index, size_t offset);
+
+// Counts a partial index forward until its checkpoints reach past 'offset'
+// or the text ends, or about 'budget' code units were scanned. Returns
+// true if the index now reaches 'offset'; false if the budget ran out or
+// memory allocation failed.
+bool LineIndexExtend(LineIndex *index, const uint16_t *text, size_t length, size_t offset, size_t budget);
+
+// Returns the zero-based line holding 'offset' (a position on a line's
+// terminator belongs to that line), extending a partial index as far as
+// needed. Scans at most one stride of lines once the index reaches 'offset'.
+uint64_t LineIndexLineFromOffset(LineIndex *index, const uint16_t *text, size_t length, size_t offset);
+
+// Serializes the index as LEB128 varints with delta-encoded checkpoints.
+// Returns the number of bytes required; when it exceeds 'capacity' nothing
+// useful was written and the caller should retry with a larger buffer.
+size_t LineIndexEncode(const LineIndex *index, uint8_t *out, size_t capacity);
+
+// Restores an index written by LineIndexEncode.
+// Returns false if the data is truncated or malformed.
+bool LineIndexDecode(LineIndex *index, const uint8_t *data, size_t size, size_t *consumedOut);
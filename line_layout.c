@@ -0,0 +1,146 @@
+// ============================================================================
+// line_layout.c - Chunked Long-Line Measurement Implementation
+// ============================================================================
+// Chunk k covers text[ChunkStart(k), ChunkStart(k + 1)). A chunk start
+// that would fall between the halves of a surrogate pair moves one code
+// unit on, so both halves are always measured together.
+// ============================================================================
+
+#include "line_layout.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_BOUNDS  64
+
+static bool IsHigh(uint16_t ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+static bool IsLow(uint16_t ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+// ============================================================================
+// Chunk Helpers
+// ============================================================================
+static size_t ChunkCount(const LineLayout *layout) {
+    return (layout->length + LINE_LAYOUT_CHUNK - 1) / LINE_LAYOUT_CHUNK;
+}
+
+static size_t ChunkStart(const LineLayout *layout, size_t chunk) {
+    if (chunk >= ChunkCount(layout)) return layout->length;
+    size_t start = chunk * LINE_LAYOUT_CHUNK;
+    if (start > 0 && IsLow(layout->text[start]) && IsHigh(layout->text[start - 1])) start++;
+    return start;
+}
+
+static size_t ChunkOf(const LineLayout *layout, size_t offset) {
+    size_t chunk = offset / LINE_LAYOUT_CHUNK;
+    if (chunk > 0 && offset < ChunkStart(layout, chunk)) chunk--;
+    return chunk;
+}
+
+static int ClampExtent(int64_t extent) {
+    if (extent < 0) return 0;
+    return extent > INT_MAX ? INT_MAX : (int)extent;
+}
+
+static int64_t MeasureChunk(const LineLayout *layout, size_t chunk) {
+    size_t from = ChunkStart(layout, chunk);
+    size_t fit = 0;
+    return layout->measure(layout->context, layout->text + from, ChunkStart(layout, chunk + 1) - from, INT_MAX, &fit);
+}
+
+static int64_t Bound(const LineLayout *layout, size_t chunk) {
+    return layout->bounds ? layout->bounds[chunk] : 0;
+}
+
+// Measures the next chunk into the cache. Returns false once every chunk
+// is measured, or if out of memory.
+static bool MeasureNext(LineLayout *layout) {
+    if (layout->measured >= ChunkCount(layout)) return false;
+    if (layout->measured + 2 > layout->capacity) {
+        size_t newCapacity = layout->capacity ? layout->capacity * 2 : INITIAL_BOUNDS;
+        if (newCapacity > SIZE_MAX / sizeof(int64_t)) return false;
+        int64_t *grown = (int64_t *)realloc(layout->bounds, newCapacity * sizeof(int64_t));
+        if (!grown) return false;
+        if (!layout->bounds) grown[0] = 0;
+        layout->bounds = grown;
+        layout->capacity = newCapacity;
+    }
+    layout->bounds[layout->measured + 1] = layout->bounds[layout->measured] + MeasureChunk(layout, layout->measured);
+    layout->measured++;
+    return true;
+}
+
+// ============================================================================
+// LineLayoutInit / LineLayoutFree
+// ============================================================================
+void LineLayoutInit(LineLayout *layout, const uint16_t *text, size_t length, LineMeasureProc measure, void *context) {
+    memset(layout, 0, sizeof(*layout));
+    layout->text = text;
+    layout->length = length;
+    layout->measure = measure;
+    layout->context = context;
+}
+
+void LineLayoutFree(LineLayout *layout) {
+    free(layout->bounds);
+    layout->bounds = NULL;
+    layout->measured = 0;
+    layout->capacity = 0;
+}
+
+// ============================================================================
+// LineLayoutOffsetAtX
+// ============================================================================
+size_t LineLayoutOffsetAtX(LineLayout *layout, int64_t x) {
+    if (x < 0) return 0;
+    size_t chunks = ChunkCount(layout);
+    while (layout->measured < chunks && Bound(layout, layout->measured) <= x && MeasureNext(layout)) continue;
+
+    // Last cached boundary at or before x
+    size_t lo = 0, hi = layout->measured + 1;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (Bound(layout, mid) <= x) lo = mid;
+        else hi = mid;
+    }
+
+    // The chunk holding x; past the cache (out of memory) the chunks are
+    // measured one by one
+    int64_t base = Bound(layout, lo);
+    for (size_t chunk = lo; chunk < chunks; ++chunk) {
+        size_t from = ChunkStart(layout, chunk);
+        size_t count = ChunkStart(layout, chunk + 1) - from;
+        size_t fit = 0;
+        int width = layout->measure(layout->context, layout->text + from, count, ClampExtent(x - base), &fit);
+        if (fit < count) {
+            size_t offset = from + fit;
+            if (offset > 0 && IsLow(layout->text[offset]) && IsHigh(layout->text[offset - 1])) offset--;
+            return offset;
+        }
+        base += width;
+    }
+    return layout->length;
+}
+
+// ============================================================================
+// LineLayoutXAtOffset / LineLayoutWidth
+// ============================================================================
+int64_t LineLayoutXAtOffset(LineLayout *layout, size_t offset) {
+    if (offset > layout->length) offset = layout->length;
+    size_t chunk = ChunkOf(layout, offset);
+    while (layout->measured < chunk && MeasureNext(layout)) continue;
+
+    size_t known = layout->measured < chunk ? layout->measured : chunk;
+    int64_t x = Bound(layout, known);
+    for (size_t k = known; k < chunk; ++k) x += MeasureChunk(layout, k);   // Out of memory only
+
+    size_t from = ChunkStart(layout, chunk);
+    if (offset > from) {
+        size_t fit = 0;
+        x += layout->measure(layout->context, layout->text + from, offset - from, INT_MAX, &fit);
+    }
+    return x;
+}
+
+int64_t LineLayoutWidth(LineLayout *layout) {
+    return LineLayoutXAtOffset(layout, layout->length);
+}
@@ -0,0 +1,56 @@
+// ============================================================================
+// line_layout.h - Chunked Long-Line Measurement Header
+// ============================================================================
+// Horizontal layout of one logical line of any length. Measuring a whole
+// line at once is what makes multi-megabyte lines (minified JSON, base64)
+// slow: every query pays for the full line. Here the line is cut into
+// fixed-size chunks of LINE_LAYOUT_CHUNK code units (never inside a
+// surrogate pair) and the total advance of the chunks before each chunk
+// boundary is cached as it is measured:
+//   - Chunks are measured lazily, in order, only as far as a query needs;
+//     drawing the start of a 50 MB line measures one chunk.
+//   - Once measured, offset -> x and x -> offset are a binary search over
+//     the cached boundaries plus one measurement inside a single chunk,
+//     O(log n + LINE_LAYOUT_CHUNK) whatever the line length.
+// Measuring is the caller's: a LineMeasureProc (GetTextExtentExPointW on a
+// device context, for example). Chunks are measured separately, so kerning
+// across a chunk boundary is ignored.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINE_LAYOUT_CHUNK  4096     // Code units measured at a time
+
+// Returns the advance width of text[0, count). *fitOut receives how many
+// leading code units fit within 'maxExtent' (count if all do).
+typedef int (*LineMeasureProc)(void *context, const uint16_t *text, size_t count, int maxExtent, size_t *fitOut);
+
+typedef struct LineLayout {
+    const uint16_t *text;       // The line, without its terminator
+    size_t length;
+    LineMeasureProc measure;
+    void *context;
+    int64_t *bounds;            // bounds[k]: advance of chunks [0, k); bounds[0] = 0
+    size_t measured;            // Chunks whose end is in 'bounds'
+    size_t capacity;
+} LineLayout;
+
+void LineLayoutInit(LineLayout *layout, const uint16_t *text, size_t length, LineMeasureProc measure, void *context);
+void LineLayoutFree(LineLayout *layout);
+
+// Number of leading code units whose advance fits within 'x' (0 for x < the
+// first character's width, 'length' if the whole line fits). Out of memory,
+// the chunk cache stops growing and the rest is measured from the last
+// cached boundary.
+size_t LineLayoutOffsetAtX(LineLayout *layout, int64_t x);
+
+// Advance of text[0, offset).
+int64_t LineLayoutXAtOffset(LineLayout *layout, size_t offset);
+
+// Advance of the whole line (measures every chunk once).
+int64_t LineLayoutWidth(LineLayout *layout);
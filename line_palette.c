@@ -0,0 +1,256 @@
+// ============================================================================
+// line_palette.c - Go To Matching Line Dialog Implementation
+// ============================================================================
+// The query box is subclassed so the arrow and page keys move the list's
+// selection while the caret stays in the query; Enter picks the selected
+// line through the dialog's default button.
+// ============================================================================
+
+#include "line_palette.h"
+#include "fuzzy_match.h"
+#include "resource.h"
+#include <strsafe.h>   // For safe string operations
+
+typedef struct LinePalette {
+    const uint16_t *text;
+    size_t length;
+    const uint16_t *fold;
+    FuzzyLines lines;
+    FuzzyHit hits[LINE_PALETTE_SHOWN];  // Lines listed, best first
+    size_t hitCount;
+    size_t matched;                     // Lines matching the query, listed or not
+    HWND query;
+    HWND list;
+    HWND status;
+    WNDPROC queryProc;                  // Original edit control window procedure
+    size_t chosen;                      // Offset of the picked line
+} LinePalette;
+
+// ============================================================================
+// Ranking on All Cores
+// ============================================================================
+typedef struct ScoreJob ScoreJob;
+
+typedef struct ScoreShare {
+    ScoreJob *job;
+    FuzzyTop top;
+    FuzzyHit hits[LINE_PALETTE_SHOWN];
+    size_t matched;
+} ScoreShare;
+
+struct ScoreJob {
+    const LinePalette *palette;
+    const FuzzyQuery *query;
+    volatile LONG next;                 // Next slice to claim
+    size_t sliceCount;
+    ScoreShare shares[LINE_PALETTE_MAX_THREADS];
+};
+
+static void RunSlices(ScoreShare *share) {
+    ScoreJob *job = share->job;
+    const LinePalette *palette = job->palette;
+    for (;;) {
+        size_t k = (size_t)(InterlockedIncrement(&job->next) - 1);
+        if (k >= job->sliceCount) return;
+        size_t first = k * (size_t)LINE_PALETTE_SLICE;
+        size_t last = first + LINE_PALETTE_SLICE;
+        if (last > palette->lines.count) last = palette->lines.count;
+        share->matched += FuzzyScanLines(job->query, &palette->lines, palette->text, first, last, &share->top);
+    }
+}
+
+static DWORD WINAPI ScoreWorker(LPVOID param) {
+    RunSlices((ScoreShare *)param);
+    return 0;
+}
+
+// Fills palette->hits with the best lines for the query, best first
+static void RankLines(LinePalette *palette, const FuzzyQuery *query) {
+    FuzzyTop best;
+    FuzzyTopInit(&best, palette->hits, LINE_PALETTE_SHOWN);
+    palette->matched = 0;
+
+    ScoreJob *job = (ScoreJob *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(ScoreJob));
+    if (!job) {
+        palette->matched = FuzzyScanLines(query, &palette->lines, palette->text, 0, palette->lines.count, &best);
+    } else {
+        static DWORD processors = 0;
+        if (processors == 0) {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            processors = info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+        }
+        job->palette = palette;
+        job->query = query;
+        job->sliceCount = (palette->lines.count + LINE_PALETTE_SLICE - 1) / LINE_PALETTE_SLICE;
+        size_t threads = processors;
+        if (threads > LINE_PALETTE_MAX_THREADS) threads = LINE_PALETTE_MAX_THREADS;
+        if (threads > job->sliceCount) threads = job->sliceCount;
+        for (size_t i = 0; i < threads; ++i) {
+            job->shares[i].job = job;
+            FuzzyTopInit(&job->shares[i].top, job->shares[i].hits, LINE_PALETTE_SHOWN);
+        }
+
+        HANDLE workers[LINE_PALETTE_MAX_THREADS];
+        DWORD started = 0;
+        for (size_t i = 1; i < threads; ++i) {
+            HANDLE thread = CreateThread(NULL, 0, ScoreWorker, &job->shares[i], 0, NULL);
+            if (thread) workers[started++] = thread;
+        }
+        RunSlices(&job->shares[0]);
+        if (started) WaitForMultipleObjects(started, workers, TRUE, INFINITE);
+        for (DWORD i = 0; i < started; ++i) CloseHandle(workers[i]);
+
+        for (size_t i = 0; i < threads; ++i) {
+            const ScoreShare *share = &job->shares[i];
+            for (size_t k = 0; k < share->top.count; ++k) FuzzyTopOffer(&best, &share->top.hits[k]);
+            palette->matched += share->matched;
+        }
+        HeapFree(GetProcessHeap(), 0, job);
+    }
+    FuzzyTopSort(&best);
+    palette->hitCount = best.count;
+}
+
+// ============================================================================
+// Refresh - Rank and List the Lines for the Current Query
+// ============================================================================
+static void Refresh(LinePalette *palette) {
+    WCHAR queryText[LINE_PALETTE_MAX_QUERY + 1];
+    int queryLength = GetWindowTextW(palette->query, queryText, ARRAYSIZE(queryText));
+    FuzzyQuery query;
+    if (FuzzyQueryInit(&query, (const uint16_t *)queryText, (size_t)queryLength, palette->fold)) {
+        RankLines(palette, &query);
+    } else {
+        // No query: the first lines, in order
+        size_t count = palette->lines.count < LINE_PALETTE_SHOWN ? palette->lines.count : LINE_PALETTE_SHOWN;
+        for (size_t i = 0; i < count; ++i) {
+            palette->hits[i].score = 0;
+            palette->hits[i].length = 0;
+            palette->hits[i].line = i;
+        }
+        palette->hitCount = count;
+        palette->matched = palette->lines.count;
+    }
+
+    SendMessageW(palette->list, WM_SETREDRAW, FALSE, 0);
+    SendMessageW(palette->list, LB_RESETCONTENT, 0, 0);
+    for (size_t i = 0; i < palette->hitCount; ++i) {
+        size_t line = palette->hits[i].line;
+        const uint16_t *start = palette->text + palette->lines.starts[line];
+        size_t length = FuzzyLineLength(&palette->lines, palette->text, line);
+        if (length > LINE_PALETTE_PREVIEW) length = LINE_PALETTE_PREVIEW;
+
+        WCHAR row[32 + LINE_PALETTE_PREVIEW];
+        StringCchPrintfW(row, ARRAYSIZE(row), L"%llu\t", (unsigned long long)(line + 1));
+        size_t used = (size_t)lstrlenW(row);
+        for (size_t k = 0; k < length; ++k) {
+            WCHAR ch = (WCHAR)start[k];
+            row[used++] = (ch < L' ') ? L' ' : ch;   // Tabs would jump to the next column
+        }
+        row[used] = L'\0';
+        LRESULT item = SendMessageW(palette->list, LB_ADDSTRING, 0, (LPARAM)row);
+        if (item < 0) break;
+        SendMessageW(palette->list, LB_SETITEMDATA, (WPARAM)item, (LPARAM)line);
+    }
+    SendMessageW(palette->list, LB_SETCURSEL, 0, 0);
+    SendMessageW(palette->list, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(palette->list, NULL, TRUE);
+
+    WCHAR status[96];
+    if (palette->matched == 0) {
+        StringCchCopyW(status, ARRAYSIZE(status), L"No matching lines");
+    } else if (palette->hitCount < palette->matched) {
+        StringCchPrintfW(status, ARRAYSIZE(status), L"Best %llu of %llu lines",
+                         (unsigned long long)palette->hitCount, (unsigned long long)palette->matched);
+    } else {
+        StringCchPrintfW(status, ARRAYSIZE(status), L"%llu lines", (unsigned long long)palette->matched);
+    }
+    SetWindowTextW(palette->status, status);
+}
+
+// ============================================================================
+// QuerySubclassProc - Move Through the List from the Query Box
+// ============================================================================
+static LRESULT CALLBACK QuerySubclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    LinePalette *palette = (LinePalette *)GetWindowLongPtrW(GetParent(hwnd), DWLP_USER);
+    if (msg == WM_KEYDOWN && (wParam == VK_UP || wParam == VK_DOWN || wParam == VK_PRIOR || wParam == VK_NEXT)) {
+        SendMessageW(palette->list, msg, wParam, lParam);
+        return 0;
+    }
+    return CallWindowProcW(palette->queryProc, hwnd, msg, wParam, lParam);
+}
+
+// Ends the dialog on the selected line; does nothing if none is selected
+static void Choose(HWND dlg, LinePalette *palette) {
+    LRESULT item = SendMessageW(palette->list, LB_GETCURSEL, 0, 0);
+    if (item == LB_ERR) {
+        MessageBeep(MB_OK);
+        return;
+    }
+    size_t line = (size_t)SendMessageW(palette->list, LB_GETITEMDATA, (WPARAM)item, 0);
+    palette->chosen = palette->lines.starts[line];
+    EndDialog(dlg, IDOK);
+}
+
+// ============================================================================
+// PaletteDlgProc
+// ============================================================================
+static INT_PTR CALLBACK PaletteDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
+    LinePalette *palette = (LinePalette *)GetWindowLongPtrW(dlg, DWLP_USER);
+    switch (msg) {
+    case WM_INITDIALOG: {
+        palette = (LinePalette *)lParam;
+        SetWindowLongPtrW(dlg, DWLP_USER, lParam);
+        palette->query = GetDlgItem(dlg, IDC_MATCHING_QUERY);
+        palette->list = GetDlgItem(dlg, IDC_MATCHING_LIST);
+        palette->status = GetDlgItem(dlg, IDC_MATCHING_STATUS);
+        SendMessageW(palette->query, EM_SETLIMITTEXT, LINE_PALETTE_MAX_QUERY, 0);
+        int tabStop = 36;   // Dialog units: room for a seven-digit line number
+        SendMessageW(palette->list, LB_SETTABSTOPS, 1, (LPARAM)&tabStop);
+        palette->queryProc = (WNDPROC)SetWindowLongPtrW(palette->query, GWLP_WNDPROC, (LONG_PTR)QuerySubclassProc);
+        Refresh(palette);
+        return TRUE;
+    }
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDC_MATCHING_QUERY:
+            if (HIWORD(wParam) == EN_CHANGE) Refresh(palette);
+            return TRUE;
+        case IDC_MATCHING_LIST:
+            if (HIWORD(wParam) == LBN_DBLCLK) Choose(dlg, palette);
+            return TRUE;
+        case IDOK:
+            Choose(dlg, palette);
+            return TRUE;
+        case IDCANCEL:
+            EndDialog(dlg, IDCANCEL);
+            return TRUE;
+        }
+        break;
+    }
+    return FALSE;
+}
+
+// ============================================================================
+// LinePaletteShow
+// ============================================================================
+INT_PTR LinePaletteShow(HWND owner, HINSTANCE instance, const uint16_t *text, size_t length,
+                        const uint16_t *fold, size_t *offsetOut) {
+    LinePalette *palette = (LinePalette *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(LinePalette));
+    if (!palette) return -1;
+    palette->text = text;
+    palette->length = length;
+    palette->fold = fold;
+    if (!FuzzyLinesBuild(&palette->lines, text, length, fold)) {
+        HeapFree(GetProcessHeap(), 0, palette);
+        return -1;
+    }
+
+    INT_PTR result = DialogBoxParamW(instance, MAKEINTRESOURCE(IDD_GOTO_MATCHING), owner, PaletteDlgProc,
+                                     (LPARAM)palette);
+    if (result == IDOK) *offsetOut = palette->chosen;
+    FuzzyLinesFree(&palette->lines);
+    HeapFree(GetProcessHeap(), 0, palette);
+    return result;
+}
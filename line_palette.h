@@ -0,0 +1,31 @@
+// ============================================================================
+// line_palette.h - Go To Matching Line Dialog Header
+// ============================================================================
+// A palette for jumping to a line by typing part of it. Every line of the
+// document is fuzzy-matched (fuzzy_match.h) against the query on each
+// keystroke and the best LINE_PALETTE_SHOWN are listed, best first.
+//   - The line table (starts and class masks) is built once, when the
+//     palette opens; the document cannot change while it is open.
+//   - Ranking runs on all cores: threads claim slices of
+//     LINE_PALETTE_SLICE lines from a shared counter, each keeps its own
+//     best lines, and the calling thread (one of them) merges the lists.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+
+#define LINE_PALETTE_SHOWN        200          // Best lines listed
+#define LINE_PALETTE_SLICE        (1u << 15)   // Lines a thread claims at a time
+#define LINE_PALETTE_MAX_THREADS  16
+#define LINE_PALETTE_MAX_QUERY    127          // Characters the query box accepts
+#define LINE_PALETTE_PREVIEW      200          // Characters of a line shown in the list
+
+// Shows the IDD_GOTO_MATCHING dialog over 'text', which must stay unchanged
+// (and locked) until it returns. 'fold' is a 65536-entry lowercase table,
+// or NULL to fold ASCII only.
+// Returns IDOK with the offset of the chosen line's start in *offsetOut,
+// IDCANCEL, or -1 if out of memory.
+INT_PTR LinePaletteShow(HWND owner, HINSTANCE instance, const uint16_t *text, size_t length,
+                        const uint16_t *fold, size_t *offsetOut);
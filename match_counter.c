@@ -0,0 +1,122 @@
+// ============================================================================
+// match_counter.c - Background Match Count Implementation
+// ============================================================================
+// The worker owns its matcher: a copy of the needle, and for a regular
+// expression its own compiled pattern (a Regex is not thread-safe, and the
+// editor keeps using its own). Progress is two counters written with
+// interlocked exchanges and read the same way by MatchCounterPoll.
+// ============================================================================
+
+#include "match_counter.h"
+#include "parallel_search.h"
+
+struct MatchCounter {
+    const uint16_t *text;
+    size_t length;
+    HWND notify;
+    UINT message;
+    ChunkMatcher matcher;
+    Regex *regex;                       // Regex mode: the worker's compiled pattern
+
+    HANDLE thread;
+    volatile LONG cancel;
+    volatile LONG done;
+    volatile LONG notifyPending;        // A message is posted and not yet polled
+    volatile LONGLONG count;
+    volatile LONGLONG scanned;
+
+    WCHAR needle[1];                    // Allocated to fit
+};
+
+static void Notify(MatchCounter *counter) {
+    if (InterlockedExchange(&counter->notifyPending, 1) == 0) {
+        PostMessageW(counter->notify, counter->message, 0, 0);
+    }
+}
+
+// ============================================================================
+// CountWorker - Count One Slice at a Time
+// ============================================================================
+static DWORD WINAPI CountWorker(LPVOID param) {
+    MatchCounter *counter = (MatchCounter *)param;
+    const ChunkMatcher *matcher = &counter->matcher;
+    size_t length = counter->length;
+    size_t pos = 0, count = 0;
+
+    // The last slice also owns an empty match at the very end of the text
+    while (pos <= length && !counter->cancel) {
+        size_t limit = (length - pos > MATCH_COUNT_SLICE) ? pos + MATCH_COUNT_SLICE : length + 1;
+        size_t start, end;
+        while (pos < limit && matcher->find(matcher->context, counter->text, length, pos, limit, &start, &end)) {
+            count++;
+            pos = end > start ? end : end + 1;
+        }
+        if (pos < limit) pos = limit;
+        InterlockedExchange64(&counter->count, (LONGLONG)count);
+        InterlockedExchange64(&counter->scanned, (LONGLONG)(pos < length ? pos : length));
+        Notify(counter);
+    }
+    if (!counter->cancel) {
+        InterlockedExchange(&counter->done, 1);
+        Notify(counter);
+    }
+    return 0;
+}
+
+// ============================================================================
+// MatchCounterStart
+// ============================================================================
+MatchCounter *MatchCounterStart(const MatchCountQuery *query, const uint16_t *text, size_t length,
+                                HWND notify, UINT message) {
+    size_t needleLength = wcslen(query->needle);
+    if (needleLength == 0) return NULL;
+    MatchCounter *counter = (MatchCounter *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                      sizeof(MatchCounter) + needleLength * sizeof(WCHAR));
+    if (!counter) return NULL;
+    CopyMemory(counter->needle, query->needle, (needleLength + 1) * sizeof(WCHAR));
+    counter->text = text;
+    counter->length = length;
+    counter->notify = notify;
+    counter->message = message;
+
+    if (query->regex) {
+        unsigned flags = query->matchCase ? 0 : REGEX_ICASE;
+        if (RegexCompile((const uint16_t *)counter->needle, needleLength, flags, &counter->regex, NULL) != REGEX_OK) {
+            HeapFree(GetProcessHeap(), 0, counter);
+            return NULL;
+        }
+        ChunkMatcherRegex(&counter->matcher, counter->regex, (const uint16_t *)counter->needle, needleLength, flags);
+    } else {
+        ChunkMatcherLiteral(&counter->matcher, (const uint16_t *)counter->needle, needleLength,
+                            query->matchCase ? NULL : query->fold, query->words);
+    }
+
+    counter->thread = CreateThread(NULL, 0, CountWorker, counter, 0, NULL);
+    if (!counter->thread) {
+        RegexFree(counter->regex);
+        HeapFree(GetProcessHeap(), 0, counter);
+        return NULL;
+    }
+    return counter;
+}
+
+// ============================================================================
+// MatchCounterFree / MatchCounterPoll
+// ============================================================================
+void MatchCounterFree(MatchCounter *counter) {
+    if (!counter) return;
+    InterlockedExchange(&counter->cancel, 1);
+    WaitForSingleObject(counter->thread, INFINITE);
+    CloseHandle(counter->thread);
+    RegexFree(counter->regex);
+    HeapFree(GetProcessHeap(), 0, counter);
+}
+
+void MatchCounterPoll(MatchCounter *counter, MatchCountStatus *status) {
+    // Re-arm first: progress from here on posts a new message
+    InterlockedExchange(&counter->notifyPending, 0);
+    status->done = InterlockedCompareExchange(&counter->done, 0, 0) != 0;
+    status->count = (size_t)InterlockedCompareExchange64(&counter->count, 0, 0);
+    status->scanned = (size_t)InterlockedCompareExchange64(&counter->scanned, 0, 0);
+    status->length = counter->length;
+}
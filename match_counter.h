@@ -0,0 +1,50 @@
+// ============================================================================
+// match_counter.h - Background Match Count Header
+// ============================================================================
+// Counts the matches of a find string on a worker thread, so that a count
+// never holds up the editor. Matches are counted as Find Next and Replace
+// All see them: leftmost first, not overlapping. The text is searched a
+// slice at a time; after each slice the count so far is published and the
+// owner window gets a posted message (MatchCounterPoll re-arms it), and a
+// cancel request is checked.
+// The counter reads the caller's text in place: it must not change until
+// MatchCounterFree has returned.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+
+#define MATCH_COUNT_SLICE  (1u << 20)     // Characters searched between progress reports
+
+typedef struct MatchCounter MatchCounter;
+
+typedef struct MatchCountQuery {
+    const WCHAR *needle;                // Literal, or pattern if 'regex'
+    BOOL regex;                         // 'needle' is a regular expression
+    BOOL matchCase;
+    const uint16_t *fold;               // Literal: lowercase table for !matchCase (see TextFind)
+    const uint8_t *words;               // Literal: word table for whole words only, or NULL
+} MatchCountQuery;
+
+typedef struct MatchCountStatus {
+    size_t count;                       // Matches found so far
+    size_t scanned;                     // Characters searched so far
+    size_t length;                      // Characters in the text
+    BOOL done;                          // The whole text has been searched
+} MatchCountStatus;
+
+// Starts counting. 'message' is posted to 'notify' as the count grows and
+// when it is complete. The tables must outlive the counter.
+// Returns NULL if the count could not be started (out of memory, invalid
+// pattern).
+MatchCounter *MatchCounterStart(const MatchCountQuery *query, const uint16_t *text, size_t length,
+                                HWND notify, UINT message);
+
+// Cancels the count if it is still running, waits for the worker and frees
+// everything.
+void MatchCounterFree(MatchCounter *counter);
+
+// Reads the progress and re-arms the notification message.
+void MatchCounterPoll(MatchCounter *counter, MatchCountStatus *status);
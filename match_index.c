@@ -0,0 +1,195 @@
+// ============================================================================
+// match_index.c - Sorted Match Index Implementation
+// ============================================================================
+// Following an edit ('removed' characters at 'offset' became 'inserted'):
+//   - Matches that end at or before 'offset' cannot change.
+//   - Matches that start at or after the old edit end survive as candidates,
+//     shifted by the length change; the rest are dropped.
+//   - The search resumes where the last kept match ended (never earlier
+//     than 'reach' - 1 characters before the edit). It can stop at the first
+//     position p past the edit that the old search also reached without
+//     being inside a match: from there on both searches see the same text
+//     and find the same candidates. Until then, only a match starting
+//     before that point matters, so each search is confined to a window of
+//     'reach' characters past it.
+// ============================================================================
+
+#include "match_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY  256
+
+// ============================================================================
+// Storage Helpers
+// ============================================================================
+static bool Reserve(MatchSpan **spans, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) return true;
+    size_t newCapacity = *capacity ? *capacity : INITIAL_CAPACITY;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2 / sizeof(MatchSpan)) return false;
+        newCapacity *= 2;
+    }
+    MatchSpan *grown = (MatchSpan *)realloc(*spans, newCapacity * sizeof(MatchSpan));
+    if (!grown) return false;
+    *spans = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+static bool Append(MatchSpan **spans, size_t *count, size_t *capacity, size_t start, size_t end) {
+    if (!Reserve(spans, capacity, *count + 1)) return false;
+    (*spans)[*count].start = start;
+    (*spans)[*count].end = end;
+    (*count)++;
+    return true;
+}
+
+// Where the search continues after a match (past an empty one)
+static size_t ResumeAfter(size_t start, size_t end) {
+    return end > start ? end : end + 1;
+}
+
+// ============================================================================
+// MatchIndexInit / MatchIndexFree / MatchIndexInvalidate
+// ============================================================================
+void MatchIndexInit(MatchIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void MatchIndexFree(MatchIndex *index) {
+    free(index->spans);
+    MatchIndexInit(index);
+}
+
+void MatchIndexInvalidate(MatchIndex *index) {
+    index->count = 0;
+    index->stale = true;
+}
+
+bool MatchIndexAppend(MatchIndex *index, uint64_t start, uint64_t end) {
+    return Append(&index->spans, &index->count, &index->capacity, (size_t)start, (size_t)end);
+}
+
+// ============================================================================
+// MatchIndexBuild - Find Every Match
+// ============================================================================
+bool MatchIndexBuild(MatchIndex *index, const MatchFinder *finder, const uint16_t *text, size_t length) {
+    index->count = 0;
+    index->stale = true;
+    size_t pos = 0, start = 0, end = 0;
+    while (pos <= length && finder->find(finder->context, text, length, pos, &start, &end)) {
+        if (!Append(&index->spans, &index->count, &index->capacity, start, end)) {
+            index->count = 0;
+            return false;
+        }
+        pos = ResumeAfter(start, end);
+    }
+    index->stale = false;
+    return true;
+}
+
+// ============================================================================
+// Binary Searches
+// ============================================================================
+size_t MatchIndexLowerBound(const MatchIndex *index, uint64_t position) {
+    size_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->spans[mid].start < position) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// First match ending after 'position' (ends are sorted too: spans do not overlap)
+static size_t FirstEndingAfter(const MatchIndex *index, uint64_t position) {
+    size_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->spans[mid].end <= position) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t MatchIndexLocate(const MatchIndex *index, uint64_t start, uint64_t end) {
+    size_t i = MatchIndexLowerBound(index, start);
+    if (i < index->count && index->spans[i].start == start && index->spans[i].end == end) return i;
+    return MATCH_INDEX_NONE;
+}
+
+// ============================================================================
+// MatchIndexUpdate - Follow One Edit
+// ============================================================================
+bool MatchIndexUpdate(MatchIndex *index, const MatchFinder *finder, const uint16_t *text, size_t length,
+                      uint64_t offset, uint64_t removed, uint64_t inserted) {
+    if (index->stale) return false;
+    if (finder->reach == 0) {
+        MatchIndexInvalidate(index);
+        return false;
+    }
+
+    MatchSpan *spans = index->spans;
+    size_t count = index->count;
+    uint64_t oldEditEnd = offset + removed;
+    uint64_t newEditEnd = offset + inserted;
+    size_t keep = FirstEndingAfter(index, offset);                 // Spans before the edit
+    size_t next = keep;                                            // First candidate after it
+    while (next < count && spans[next].start < oldEditEnd) next++;
+
+    // Resume where the last kept match ended, or just before the edit
+    uint64_t pos = keep > 0 ? spans[keep - 1].end : 0;
+    if (offset + 1 > finder->reach && pos < offset + 1 - finder->reach) pos = offset + 1 - finder->reach;
+
+    MatchSpan *fresh = NULL;
+    size_t freshCount = 0, freshCapacity = 0;
+    for (;;) {
+        // Candidates the search has moved past are gone
+        while (next < count && spans[next].start - removed + inserted < pos) next++;
+
+        // The old search was outside any match from 'sync' on
+        uint64_t sync = newEditEnd;
+        if (next > 0 && spans[next - 1].end >= oldEditEnd) {
+            uint64_t previousEnd = spans[next - 1].end - removed + inserted;
+            if (previousEnd > sync) sync = previousEnd;
+        }
+        if (pos >= sync) break;
+
+        // Look for a match starting before 'sync'; none means we are in step
+        uint64_t window = sync - 1 + finder->reach;
+        if (window > length) window = length;
+        size_t start = 0, end = 0;
+        if (pos > window || !finder->find(finder->context, text, (size_t)window, (size_t)pos, &start, &end) ||
+            start >= sync) {
+            pos = sync;
+            continue;
+        }
+        if (!Append(&fresh, &freshCount, &freshCapacity, start, end)) {
+            free(fresh);
+            MatchIndexInvalidate(index);
+            return false;
+        }
+        pos = ResumeAfter(start, end);
+    }
+
+    // Splice: kept spans, new matches, shifted candidates
+    size_t tail = count - next;
+    if (!Reserve(&index->spans, &index->capacity, keep + freshCount + tail)) {
+        free(fresh);
+        MatchIndexInvalidate(index);
+        return false;
+    }
+    spans = index->spans;
+    if (tail) memmove(spans + keep + freshCount, spans + next, tail * sizeof(MatchSpan));
+    if (removed != inserted) {
+        for (size_t i = keep + freshCount; i < keep + freshCount + tail; ++i) {
+            spans[i].start = spans[i].start - removed + inserted;
+            spans[i].end = spans[i].end - removed + inserted;
+        }
+    }
+    if (freshCount) memcpy(spans + keep, fresh, freshCount * sizeof(MatchSpan));
+    index->count = keep + freshCount + tail;
+    free(fresh);
+    return true;
+}
@@ -0,0 +1,70 @@
+// ============================================================================
+// match_index.h - Sorted Match Index Header
+// ============================================================================
+// Every match of one search in document order, so that "next match after
+// the caret" is a binary search instead of a scan. Matches are found the
+// way Find Next and Replace All see them: leftmost first, not overlapping.
+// The index follows edits: matches after an edit are shifted and only the
+// text around the edit is searched again, until the new matches line up
+// with the old ones. That needs a finder whose matches depend on their own
+// text alone and have a known maximum length (literal search); for other
+// finders an edit marks the index stale and it must be rebuilt.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MATCH_INDEX_NONE  ((size_t)-1)    // "No such match"
+
+typedef struct MatchSpan {
+    uint64_t start;
+    uint64_t end;
+} MatchSpan;
+
+// Finds the leftmost match starting at or after 'from' that lies entirely
+// within text[0, length). Returns false if there is none.
+typedef bool (*MatchFindProc)(void *context, const uint16_t *text, size_t length, size_t from,
+                              size_t *startOut, size_t *endOut);
+
+typedef struct MatchFinder {
+    MatchFindProc find;
+    void *context;
+    size_t reach;       // Longest possible match; 0 if unbounded (edits make the index stale)
+} MatchFinder;
+
+typedef struct MatchIndex {
+    MatchSpan *spans;   // Sorted by start; spans do not overlap
+    size_t count;
+    size_t capacity;
+    bool stale;         // Edits could not be followed; rebuild before use
+} MatchIndex;
+
+void MatchIndexInit(MatchIndex *index);
+void MatchIndexFree(MatchIndex *index);
+
+// Finds every match in the text. Returns false if out of memory (the index
+// is then stale).
+bool MatchIndexBuild(MatchIndex *index, const MatchFinder *finder, const uint16_t *text, size_t length);
+
+// Adds a match after the last one; the caller keeps the spans in order.
+// Returns false if out of memory.
+bool MatchIndexAppend(MatchIndex *index, uint64_t start, uint64_t end);
+
+// Follows one edit: 'removed' characters at 'offset' were replaced by
+// 'inserted' characters. 'text' is the document after the edit.
+// Returns true if the index is still current, false if it went stale.
+bool MatchIndexUpdate(MatchIndex *index, const MatchFinder *finder, const uint16_t *text, size_t length,
+                      uint64_t offset, uint64_t removed, uint64_t inserted);
+
+// Marks the index stale, for edits that cannot be described.
+void MatchIndexInvalidate(MatchIndex *index);
+
+// Returns the first match starting at or after 'position' (count if none).
+size_t MatchIndexLowerBound(const MatchIndex *index, uint64_t position);
+
+// Returns the match with exactly these bounds, or MATCH_INDEX_NONE.
+size_t MatchIndexLocate(const MatchIndex *index, uint64_t start, uint64_t end);
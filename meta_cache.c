@@ -0,0 +1,285 @@
+// ============================================================================
+// meta_cache.c - Document Metadata Cache Implementation
+// ============================================================================
+// Each cache entry is a small versioned binary file:
+//   MetaCacheHeader   - fixed 40-byte header (magic, version, file identity)
+//   WCHAR path[]      - document path, used to reject hash collisions
+//   BYTE index[]      - line index serialized by LineIndexEncode
+// Entry files are named after a hash of the document path. Reading an entry
+// refreshes its last write time, which doubles as the LRU timestamp when the
+// directory grows beyond META_CACHE_MAX_BYTES.
+// ============================================================================
+
+#include "meta_cache.h"
+#include <strsafe.h>   // For safe string operations
+#include <stdlib.h>    // For qsort
+
+#define META_CACHE_MAGIC    0x434D5052u   // "RPMC" in little endian
+#define META_CACHE_VERSION  1
+#define META_CACHE_DIR      L"cache"
+#define META_CACHE_EXT      L".rpm"
+#define SAMPLE_BLOCK_SIZE   4096          // Bytes hashed at start, middle and end
+
+// ============================================================================
+// On-Disk Structures
+// ============================================================================
+typedef struct MetaCacheHeader {
+    DWORD magic;              // META_CACHE_MAGIC
+    WORD version;             // META_CACHE_VERSION
+    WORD pathLength;          // Length of the stored path in WCHARs
+    ULONGLONG fileSize;       // Document size in bytes
+    ULONGLONG lastWrite;      // Document last write time (FILETIME ticks)
+    ULONGLONG sampleHash;     // FNV-1a hash of sampled content blocks
+    BYTE encoding;            // TextEncoding value
+    BYTE reserved[3];
+    DWORD indexBytes;         // Size of the serialized line index
+} MetaCacheHeader;
+
+// Identity of a document on disk
+typedef struct FileKey {
+    ULONGLONG fileSize;
+    ULONGLONG lastWrite;
+    ULONGLONG sampleHash;
+} FileKey;
+
+// ============================================================================
+// HashBytes - FNV-1a 64-bit Hash
+// ============================================================================
+static ULONGLONG HashBytes(ULONGLONG hash, const BYTE *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ull
+
+// ============================================================================
+// ComputeFileKey - Identify the Current Contents of a Document
+// ============================================================================
+// Combines size, last write time and a hash of three sampled blocks (start,
+// middle, end). Sampling keeps the cost constant regardless of file size
+// while still catching files rewritten with a preserved timestamp.
+// ============================================================================
+static BOOL ComputeFileKey(LPCWSTR path, FileKey *key) {
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    LARGE_INTEGER size = {0};
+    FILETIME written = {0};
+    if (!GetFileSizeEx(file, &size) || !GetFileTime(file, NULL, NULL, &written)) {
+        CloseHandle(file);
+        return FALSE;
+    }
+    key->fileSize = (ULONGLONG)size.QuadPart;
+    key->lastWrite = ((ULONGLONG)written.dwHighDateTime << 32) | written.dwLowDateTime;
+
+    // Hash the sampled blocks (they may overlap for small files, which is fine)
+    BYTE block[SAMPLE_BLOCK_SIZE];
+    ULONGLONG hash = HashBytes(FNV_OFFSET_BASIS, (const BYTE *)&key->fileSize, sizeof(key->fileSize));
+    LONGLONG offsets[3] = { 0, size.QuadPart / 2, size.QuadPart - SAMPLE_BLOCK_SIZE };
+    for (int i = 0; i < 3; ++i) {
+        LARGE_INTEGER pos;
+        pos.QuadPart = offsets[i] < 0 ? 0 : offsets[i];
+        DWORD read = 0;
+        if (!SetFilePointerEx(file, pos, NULL, FILE_BEGIN) ||
+            !ReadFile(file, block, sizeof(block), &read, NULL)) {
+            CloseHandle(file);
+            return FALSE;
+        }
+        hash = HashBytes(hash, block, read);
+    }
+    key->sampleHash = hash;
+    CloseHandle(file);
+    return TRUE;
+}
+
+// ============================================================================
+// GetEntryPath - Build the Cache File Path for a Document
+// ============================================================================
+// The entry name is a hash of the upper-cased path so that different
+// spellings of the same (case-insensitive) Windows path share one entry.
+// ============================================================================
+static BOOL GetEntryPath(LPCWSTR path, WCHAR *entryOut, DWORD entryLen) {
+    WCHAR dir[MAX_PATH];
+    if (!GetAppDataPath(META_CACHE_DIR, dir, ARRAYSIZE(dir))) return FALSE;
+    if (!CreateDirectoryW(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) return FALSE;
+
+    ULONGLONG hash = FNV_OFFSET_BASIS;
+    for (LPCWSTR p = path; *p; ++p) {
+        WCHAR ch = *p;
+        CharUpperBuffW(&ch, 1);
+        hash = HashBytes(hash, (const BYTE *)&ch, sizeof(ch));
+    }
+    return SUCCEEDED(StringCchPrintfW(entryOut, entryLen, L"%s\\%016llx%s", dir, hash, META_CACHE_EXT));
+}
+
+// ============================================================================
+// MetaCacheLookup - Read a Cache Entry if it Matches the File on Disk
+// ============================================================================
+BOOL MetaCacheLookup(LPCWSTR path, TextEncoding *encodingOut, LineIndex *linesOut) {
+    WCHAR entryPath[MAX_PATH];
+    FileKey key;
+    if (!ComputeFileKey(path, &key) || key.fileSize < META_CACHE_MIN_FILE_SIZE) return FALSE;
+    if (!GetEntryPath(path, entryPath, ARRAYSIZE(entryPath))) return FALSE;
+
+    // FILE_WRITE_ATTRIBUTES lets us refresh the LRU timestamp on a hit
+    HANDLE file = CreateFileW(entryPath, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    BOOL hit = FALSE;
+    BYTE *data = NULL;
+    LARGE_INTEGER size = {0};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(MetaCacheHeader) ||
+        size.QuadPart > META_CACHE_MAX_BYTES) {
+        goto done;
+    }
+    data = (BYTE *)HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size.QuadPart);
+    DWORD read = 0;
+    if (!data || !ReadFile(file, data, (DWORD)size.QuadPart, &read, NULL) || read != (DWORD)size.QuadPart) {
+        goto done;
+    }
+
+    // Validate header, identity and stored path
+    const MetaCacheHeader *header = (const MetaCacheHeader *)data;
+    size_t pathBytes = (size_t)header->pathLength * sizeof(WCHAR);
+    if (header->magic != META_CACHE_MAGIC || header->version != META_CACHE_VERSION ||
+        header->fileSize != key.fileSize || header->lastWrite != key.lastWrite ||
+        header->sampleHash != key.sampleHash ||
+        sizeof(MetaCacheHeader) + pathBytes + header->indexBytes != read ||
+        header->encoding < ENC_UTF8 || header->encoding > ENC_ANSI) {
+        goto done;
+    }
+    const WCHAR *storedPath = (const WCHAR *)(data + sizeof(MetaCacheHeader));
+    if (CompareStringOrdinal(storedPath, header->pathLength, path, -1, TRUE) != CSTR_EQUAL) {
+        goto done;
+    }
+    if (!LineIndexDecode(linesOut, data + sizeof(MetaCacheHeader) + pathBytes, header->indexBytes, NULL)) {
+        goto done;
+    }
+
+    *encodingOut = (TextEncoding)header->encoding;
+    hit = TRUE;
+
+    // Mark the entry as most recently used
+    FILETIME now;
+    SYSTEMTIME st;
+    GetSystemTime(&st);
+    SystemTimeToFileTime(&st, &now);
+    SetFileTime(file, NULL, NULL, &now);
+
+done:
+    if (data) HeapFree(GetProcessHeap(), 0, data);
+    CloseHandle(file);
+    return hit;
+}
+
+// ============================================================================
+// Cache Directory Trimming
+// ============================================================================
+typedef struct CacheEntryInfo {
+    WCHAR name[MAX_PATH];
+    ULONGLONG size;
+    ULONGLONG lastWrite;
+} CacheEntryInfo;
+
+static int CompareByLastWrite(const void *a, const void *b) {
+    ULONGLONG ta = ((const CacheEntryInfo *)a)->lastWrite;
+    ULONGLONG tb = ((const CacheEntryInfo *)b)->lastWrite;
+    return (ta > tb) - (ta < tb);
+}
+
+// ============================================================================
+// TrimCache - Evict Least Recently Used Entries Above the Size Cap
+// ============================================================================
+// Deletes the oldest entries until the directory is back under three
+// quarters of the cap, so trimming does not run again on every store.
+// ============================================================================
+static void TrimCache(void) {
+    WCHAR dir[MAX_PATH], pattern[MAX_PATH];
+    if (!GetAppDataPath(META_CACHE_DIR, dir, ARRAYSIZE(dir))) return;
+    StringCchPrintfW(pattern, ARRAYSIZE(pattern), L"%s\\*%s", dir, META_CACHE_EXT);
+
+    WIN32_FIND_DATAW fd;
+    HANDLE find = FindFirstFileW(pattern, &fd);
+    if (find == INVALID_HANDLE_VALUE) return;
+
+    CacheEntryInfo *entries = NULL;
+    size_t count = 0, capacity = 0;
+    ULONGLONG total = 0;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        if (count == capacity) {
+            size_t newCapacity = capacity ? capacity * 2 : 64;
+            CacheEntryInfo *grown = entries
+                ? (CacheEntryInfo *)HeapReAlloc(GetProcessHeap(), 0, entries, newCapacity * sizeof(CacheEntryInfo))
+                : (CacheEntryInfo *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(CacheEntryInfo));
+            if (!grown) break;
+            entries = grown;
+            capacity = newCapacity;
+        }
+        CacheEntryInfo *e = &entries[count++];
+        StringCchCopyW(e->name, ARRAYSIZE(e->name), fd.cFileName);
+        e->size = ((ULONGLONG)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        e->lastWrite = ((ULONGLONG)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+        total += e->size;
+    } while (FindNextFileW(find, &fd));
+    FindClose(find);
+
+    if (total > META_CACHE_MAX_BYTES && entries) {
+        qsort(entries, count, sizeof(CacheEntryInfo), CompareByLastWrite);
+        for (size_t i = 0; i < count && total > (META_CACHE_MAX_BYTES / 4) * 3; ++i) {
+            WCHAR victim[MAX_PATH];
+            StringCchPrintfW(victim, ARRAYSIZE(victim), L"%s\\%s", dir, entries[i].name);
+            if (DeleteFileW(victim)) total -= entries[i].size;
+        }
+    }
+    if (entries) HeapFree(GetProcessHeap(), 0, entries);
+}
+
+// ============================================================================
+// MetaCacheStore - Write or Replace the Cache Entry for a Document
+// ============================================================================
+void MetaCacheStore(LPCWSTR path, TextEncoding encoding, const LineIndex *lines) {
+    WCHAR entryPath[MAX_PATH];
+    FileKey key;
+    if (encoding < ENC_UTF8 || encoding > ENC_ANSI) return;
+    if (!ComputeFileKey(path, &key) || key.fileSize < META_CACHE_MIN_FILE_SIZE) return;
+    if (!GetEntryPath(path, entryPath, ARRAYSIZE(entryPath))) return;
+
+    // Size everything first so the entry can be written with one WriteFile
+    size_t pathLength = wcslen(path);
+    size_t pathBytes = pathLength * sizeof(WCHAR);
+    size_t indexBytes = LineIndexEncode(lines, NULL, 0);
+    size_t total = sizeof(MetaCacheHeader) + pathBytes + indexBytes;
+    if (pathLength > 0xFFFF || total > META_CACHE_MAX_BYTES / 4) return;
+
+    BYTE *data = (BYTE *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, total);
+    if (!data) return;
+    MetaCacheHeader *header = (MetaCacheHeader *)data;
+    header->magic = META_CACHE_MAGIC;
+    header->version = META_CACHE_VERSION;
+    header->pathLength = (WORD)pathLength;
+    header->fileSize = key.fileSize;
+    header->lastWrite = key.lastWrite;
+    header->sampleHash = key.sampleHash;
+    header->encoding = (BYTE)encoding;
+    header->indexBytes = (DWORD)indexBytes;
+    CopyMemory(data + sizeof(MetaCacheHeader), path, pathBytes);
+    LineIndexEncode(lines, data + sizeof(MetaCacheHeader) + pathBytes, indexBytes);
+
+    HANDLE file = CreateFileW(entryPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD written = 0;
+        BOOL ok = WriteFile(file, data, (DWORD)total, &written, NULL) && written == (DWORD)total;
+        CloseHandle(file);
+        // A partial entry would fail validation anyway, but don't leave it around
+        if (!ok) DeleteFileW(entryPath);
+    }
+    HeapFree(GetProcessHeap(), 0, data);
+
+    TrimCache();
+}
@@ -0,0 +1,31 @@
+// ============================================================================
+// meta_cache.h - Document Metadata Cache Header
+// ============================================================================
+// Remembers what retropad learned about large files the last time they were
+// opened: the detected encoding, the line ending style and a sparse line
+// index. Entries live in %LOCALAPPDATA%\retropad\cache, one small binary
+// file per document, and are only trusted when the file's size, last write
+// time and a sampled content hash all still match.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "file_io.h"
+#include "line_index.h"
+
+#define META_CACHE_MIN_FILE_SIZE  (1024 * 1024)        // Smaller files are not cached
+#define META_CACHE_MAX_BYTES      (16 * 1024 * 1024)   // LRU cap for the cache directory
+
+// Looks up cached metadata for a file.
+// Parameters:
+//   path        - Full path of the document
+//   encodingOut - Receives the cached encoding
+//   linesOut    - Initialized index that receives the cached line index
+// Returns: TRUE on a valid hit, FALSE if there is no usable entry
+BOOL MetaCacheLookup(LPCWSTR path, TextEncoding *encodingOut, LineIndex *linesOut);
+
+// Records metadata for a file as it currently exists on disk. Files below
+// META_CACHE_MIN_FILE_SIZE are ignored. Failures are silent; the cache is
+// purely an optimization.
+void MetaCacheStore(LPCWSTR path, TextEncoding encoding, const LineIndex *lines);
@@ -0,0 +1,287 @@
+// ============================================================================
+// pagination.c - Print Pagination Implementation
+// ============================================================================
+// A line's layout is always anchored at the line's true start, so a row is
+// measured the same way whether it is reached by laying out from page 1 or
+// by rendering from a cached page start in the middle of the line.
+// Rendering a page also records where the next page starts, so the pages
+// of a request are laid out once, while they are drawn.
+// ============================================================================
+
+#include "pagination.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_PAGES  64
+
+static bool IsBreak(uint16_t ch) { return ch == '\r' || ch == '\n'; }
+static bool IsBlank(uint16_t ch) { return ch == ' ' || ch == '\t'; }
+static bool IsHigh(uint16_t ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+static bool IsLow(uint16_t ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+static size_t LineStartOf(const uint16_t *text, size_t offset) {
+    while (offset > 0 && !IsBreak(text[offset - 1])) offset--;
+    return offset;
+}
+
+static void DropLine(Pagination *pagination) {
+    LineLayoutFree(&pagination->line);
+    pagination->lineValid = false;
+}
+
+static void DropPages(Pagination *pagination, size_t keep) {
+    if (keep < pagination->pages) pagination->pages = keep;
+    pagination->complete = false;
+}
+
+static bool PushPage(Pagination *pagination, size_t start) {
+    if (pagination->pages == pagination->capacity) {
+        size_t newCapacity = pagination->capacity ? pagination->capacity * 2 : INITIAL_PAGES;
+        if (newCapacity > SIZE_MAX / sizeof(size_t)) return false;
+        size_t *grown = (size_t *)realloc(pagination->pageStarts, newCapacity * sizeof(size_t));
+        if (!grown) return false;
+        pagination->pageStarts = grown;
+        pagination->capacity = newCapacity;
+    }
+    pagination->pageStarts[pagination->pages++] = start;
+    return true;
+}
+
+// ============================================================================
+// PaginationInit / PaginationFree / PaginationDetach
+// ============================================================================
+void PaginationInit(Pagination *pagination) {
+    memset(pagination, 0, sizeof(*pagination));
+    pagination->editFrom = PAGINATION_NO_EDIT;
+}
+
+void PaginationFree(Pagination *pagination) {
+    DropLine(pagination);
+    free(pagination->pageStarts);
+    PaginationInit(pagination);
+}
+
+void PaginationDetach(Pagination *pagination) {
+    DropLine(pagination);
+    pagination->text = NULL;
+}
+
+// ============================================================================
+// PaginationSetup / PaginationEdit
+// ============================================================================
+void PaginationSetup(Pagination *pagination, const uint16_t *text, size_t length, LineMeasureProc measure,
+                     void *context, int64_t width, size_t rowsPerPage, uint64_t layoutKey) {
+    DropLine(pagination);
+    if (rowsPerPage < 1) rowsPerPage = 1;
+    if (width < 1) width = 1;
+
+    if (width != pagination->width || rowsPerPage != pagination->rowsPerPage ||
+        layoutKey != pagination->layoutKey ||
+        (length != pagination->length && pagination->editFrom == PAGINATION_NO_EDIT)) {
+        DropPages(pagination, 0);
+    } else if (pagination->editFrom != PAGINATION_NO_EDIT) {
+        // Rows of earlier lines end at their terminators and cannot change.
+        // The line before the edited one is dropped too, in case the edit
+        // joined a "\r" to a "\n".
+        size_t edit = pagination->editFrom < length ? pagination->editFrom : length;
+        size_t keep = LineStartOf(text, edit);
+        if (keep > 0) keep = LineStartOf(text, keep - 1);
+        size_t pages = pagination->pages;
+        while (pages > 1 && pagination->pageStarts[pages - 1] > keep) pages--;
+        DropPages(pagination, pages);
+    }
+
+    pagination->text = text;
+    pagination->length = length;
+    pagination->measure = measure;
+    pagination->context = context;
+    pagination->width = width;
+    pagination->rowsPerPage = rowsPerPage;
+    pagination->layoutKey = layoutKey;
+    pagination->editFrom = PAGINATION_NO_EDIT;
+    if (length == 0) DropPages(pagination, 0);
+}
+
+void PaginationEdit(Pagination *pagination, size_t offset) {
+    if (offset < pagination->editFrom) pagination->editFrom = offset;
+}
+
+// ============================================================================
+// Rows
+// ============================================================================
+// Points the line layout at the line holding 'start'
+static void LoadLine(Pagination *pagination, size_t start) {
+    if (pagination->lineValid && start >= pagination->lineStart && start <= pagination->lineEnd) return;
+    DropLine(pagination);
+    const uint16_t *text = pagination->text;
+    size_t from = LineStartOf(text, start);
+    size_t end = start;
+    while (end < pagination->length && !IsBreak(text[end])) end++;
+    LineLayoutInit(&pagination->line, text + from, end - from, pagination->measure, pagination->context);
+    pagination->lineStart = from;
+    pagination->lineEnd = end;
+    pagination->lineValid = true;
+}
+
+// Lays out the row starting at 'start': *endOut receives the end of its
+// text, and the start of the next row is returned
+static size_t NextRow(Pagination *pagination, size_t start, size_t *endOut) {
+    const uint16_t *text = pagination->text;
+    pagination->rowsLaidOut++;
+    LoadLine(pagination, start);
+
+    size_t lineEnd = pagination->lineEnd;
+    if (start < lineEnd) {
+        size_t base = pagination->lineStart;
+        int64_t x = LineLayoutXAtOffset(&pagination->line, start - base);
+        size_t fit = base + LineLayoutOffsetAtX(&pagination->line, x + pagination->width);
+        if (fit < lineEnd) {
+            size_t end = fit;
+            if (fit <= start) {
+                // A character wider than the page still gets a row of its own
+                end = start + 1;
+                if (end < lineEnd && IsHigh(text[start]) && IsLow(text[end])) end++;
+            } else {
+                for (size_t k = fit; k > start + 1; --k) {
+                    if (IsBlank(text[k - 1])) {
+                        end = k;
+                        break;
+                    }
+                }
+            }
+            *endOut = end;
+            return end;
+        }
+    }
+
+    // The rest of the line fits: the next row starts past its terminator
+    *endOut = lineEnd;
+    if (lineEnd == pagination->length) return lineEnd;
+    if (text[lineEnd] == '\r' && lineEnd + 1 < pagination->length && text[lineEnd + 1] == '\n') return lineEnd + 2;
+    return lineEnd + 1;
+}
+
+// ============================================================================
+// PaginationPageStart / PaginationPageCount
+// ============================================================================
+// Lays out the last known page to find where the next one starts. Returns
+// false at the end of the document (or out of memory).
+static bool ExtendPages(Pagination *pagination) {
+    if (pagination->complete || !pagination->text) return false;
+    if (pagination->pages == 0) {
+        if (pagination->length == 0) {
+            pagination->complete = true;
+            return false;
+        }
+        return PushPage(pagination, 0);
+    }
+
+    size_t start = pagination->pageStarts[pagination->pages - 1];
+    for (size_t row = 0; row < pagination->rowsPerPage && start < pagination->length; ++row) {
+        size_t end = 0;
+        start = NextRow(pagination, start, &end);
+    }
+    if (start >= pagination->length) {
+        pagination->complete = true;
+        return false;
+    }
+    return PushPage(pagination, start);
+}
+
+bool PaginationPageStart(Pagination *pagination, size_t page, size_t *startOut) {
+    while (pagination->pages <= page && ExtendPages(pagination)) continue;
+    if (page >= pagination->pages) return false;
+    *startOut = pagination->pageStarts[page];
+    return true;
+}
+
+size_t PaginationPageCount(Pagination *pagination) {
+    while (ExtendPages(pagination)) continue;
+    return pagination->pages;
+}
+
+// ============================================================================
+// PaginationRender
+// ============================================================================
+bool PaginationRender(Pagination *pagination, size_t first, size_t last, const PageSink *sink) {
+    for (size_t page = first; page <= last; ++page) {
+        size_t start = 0;
+        if (!PaginationPageStart(pagination, page, &start)) break;
+        if (!sink->beginPage(sink->context, page)) return false;
+
+        for (size_t row = 0; row < pagination->rowsPerPage && start < pagination->length; ++row) {
+            size_t end = 0;
+            size_t next = NextRow(pagination, start, &end);
+            if (!sink->row(sink->context, row, start, end)) return false;
+            start = next;
+        }
+
+        // Drawing the page found where the next one starts
+        if (page + 1 == pagination->pages && !pagination->complete) {
+            if (start >= pagination->length) pagination->complete = true;
+            else PushPage(pagination, start);
+        }
+        if (!sink->endPage(sink->context, page)) return false;
+        if (page == SIZE_MAX) break;
+    }
+    return true;
+}
+
+// ============================================================================
+// Plain Text Sink
+// ============================================================================
+static bool TextBeginPage(void *context, size_t page) {
+    PageTextSink *state = (PageTextSink *)context;
+    return page == 0 || fputc('\f', state->file) != EOF;
+}
+
+static bool TextRow(void *context, size_t row, size_t start, size_t end) {
+    PageTextSink *state = (PageTextSink *)context;
+    (void)row;
+    for (size_t i = start; i < end; ++i) {
+        uint32_t cp = state->text[i];
+        if (IsHigh((uint16_t)cp) && i + 1 < end && IsLow(state->text[i + 1])) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (state->text[++i] - 0xDC00);
+        } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = 0xFFFD;
+        }
+        unsigned char bytes[4];
+        size_t count;
+        if (cp < 0x80) {
+            bytes[0] = (unsigned char)cp;
+            count = 1;
+        } else if (cp < 0x800) {
+            bytes[0] = (unsigned char)(0xC0 | (cp >> 6));
+            bytes[1] = (unsigned char)(0x80 | (cp & 0x3F));
+            count = 2;
+        } else if (cp < 0x10000) {
+            bytes[0] = (unsigned char)(0xE0 | (cp >> 12));
+            bytes[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | (cp & 0x3F));
+            count = 3;
+        } else {
+            bytes[0] = (unsigned char)(0xF0 | (cp >> 18));
+            bytes[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            bytes[3] = (unsigned char)(0x80 | (cp & 0x3F));
+            count = 4;
+        }
+        if (fwrite(bytes, 1, count, state->file) != count) return false;
+    }
+    return fputc('\n', state->file) != EOF;
+}
+
+static bool TextEndPage(void *context, size_t page) {
+    (void)context;
+    (void)page;
+    return true;
+}
+
+void PageTextSinkInit(PageSink *sink, PageTextSink *state, FILE *file, const uint16_t *text) {
+    state->file = file;
+    state->text = text;
+    sink->context = state;
+    sink->beginPage = TextBeginPage;
+    sink->row = TextRow;
+    sink->endPage = TextEndPage;
+}
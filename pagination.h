@@ -0,0 +1,97 @@
+// ============================================================================
+// pagination.h - Print Pagination Header
+// ============================================================================
+// Splits a document into pages of rows for printing:
+//   - A row is as much of a line as fits across the page. A line too wide
+//     for the page wraps after its last blank (space or tab) that fits, or
+//     mid-word if a word alone is wider than the page. Lines are measured
+//     through LineLayout (line_layout.h), so a multi-megabyte line costs
+//     a chunk of measuring per row, not the whole line.
+//   - A page is 'rowsPerPage' rows. The offset where each page starts is
+//     cached as pages are laid out, and only as far as a request needs:
+//     rendering pages 900-910 lays out pages 1-899 once, and a later
+//     request for any of them starts from its cached offset.
+//   - Edits keep the page starts before the edited line (PaginationEdit);
+//     a different page width, page height or font drops them all.
+// Rendered pages go to a PageSink: a printer device context in retropad,
+// or the plain text writer below for checking page breaks headlessly.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "line_layout.h"
+
+#define PAGINATION_NO_EDIT  SIZE_MAX
+
+// Receives rendered pages. Returning false from any callback stops the
+// rendering.
+typedef struct PageSink {
+    void *context;
+    bool (*beginPage)(void *context, size_t page);                       // 'page' counts from 0
+    bool (*row)(void *context, size_t row, size_t start, size_t end);    // text[start, end), row 0 at the top
+    bool (*endPage)(void *context, size_t page);
+} PageSink;
+
+typedef struct Pagination {
+    const uint16_t *text;       // Set by PaginationSetup, cleared by PaginationDetach
+    size_t length;
+    LineMeasureProc measure;
+    void *context;
+    int64_t width;              // Page width in measuring units
+    size_t rowsPerPage;
+    uint64_t layoutKey;         // Font (and device) the pages were measured with
+    size_t *pageStarts;         // Offset of each page laid out so far
+    size_t pages;
+    size_t capacity;
+    bool complete;              // pageStarts holds every page
+    size_t editFrom;            // Earliest edit since the last setup, or PAGINATION_NO_EDIT
+    LineLayout line;            // The line being wrapped
+    size_t lineStart;
+    size_t lineEnd;
+    bool lineValid;
+    uint64_t rowsLaidOut;       // Rows measured, over the pagination's lifetime
+} Pagination;
+
+void PaginationInit(Pagination *pagination);
+void PaginationFree(Pagination *pagination);
+
+// Points the pagination at the document's current text before laying out
+// or rendering. Page starts survive if width, rowsPerPage and layoutKey
+// are unchanged, up to the first edit reported since the last setup. A
+// length change no edit accounts for drops them all.
+void PaginationSetup(Pagination *pagination, const uint16_t *text, size_t length, LineMeasureProc measure,
+                     void *context, int64_t width, size_t rowsPerPage, uint64_t layoutKey);
+
+// Lets go of the text (page starts are kept).
+void PaginationDetach(Pagination *pagination);
+
+// The text changed at 'offset' (offsets at or after it may have moved).
+void PaginationEdit(Pagination *pagination, size_t offset);
+
+// Offset where 'page' starts, laying out the pages before it if needed.
+// Returns false if the document has fewer pages (or out of memory).
+bool PaginationPageStart(Pagination *pagination, size_t page, size_t *startOut);
+
+// Number of pages (lays out the whole document).
+size_t PaginationPageCount(Pagination *pagination);
+
+// Renders pages first .. last (inclusive, clamped to the document) into
+// 'sink'. Returns false if the sink stopped it.
+bool PaginationRender(Pagination *pagination, size_t first, size_t last, const PageSink *sink);
+
+// ============================================================================
+// Plain Text Sink
+// ============================================================================
+// Writes each row as a UTF-8 line ending in "\n" and each page break as a
+// form feed, so the output shows exactly where rows and pages break.
+typedef struct PageTextSink {
+    FILE *file;
+    const uint16_t *text;
+} PageTextSink;
+
+void PageTextSinkInit(PageSink *sink, PageTextSink *state, FILE *file, const uint16_t *text);
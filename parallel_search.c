@@ -0,0 +1,400 @@
+// ============================================================================
+// parallel_search.c - Parallel Chunked Search Implementation
+// ============================================================================
+
+#include "parallel_search.h"
+
+typedef struct ChunkResult {
+    MatchSpan *spans;           // Matches starting in the chunk (ParallelFindAll)
+    size_t count;
+    size_t capacity;
+    BOOL failed;                // Out of memory
+} ChunkResult;
+
+typedef struct SearchJob {
+    const ChunkMatcher *matcher;
+    const uint16_t *text;
+    size_t length;
+    size_t begin;               // Where the first chunk starts
+    size_t chunkCount;
+    volatile LONG next;         // Next chunk to claim
+    volatile LONG first;        // ParallelFindFirst: lowest chunk with a match so far
+    MatchSpan *firsts;          // ParallelFindFirst: the match found in each chunk
+    ChunkResult *results;       // ParallelFindAll: the matches of each chunk
+    BOOL lines;                 // ParallelFilterLines: 'results' holds matching line starts
+} SearchJob;
+
+// ============================================================================
+// Built-in Matchers
+// ============================================================================
+static BOOL FindLiteral(void *context, const uint16_t *text, size_t length, size_t from,
+                        size_t startLimit, size_t *startOut, size_t *endOut) {
+    const ChunkMatcher *matcher = (const ChunkMatcher *)context;
+    size_t n = matcher->needleLength;
+    if (n == 0) return FALSE;
+    // A match starting before the limit ends at most n - 1 characters past it
+    size_t limit = (startLimit < length && length - startLimit > n - 1) ? startLimit + n - 1 : length;
+    size_t start = from;
+    while ((start = TextNeedleFind(&matcher->literal, text, limit, start)) != TEXT_NOT_FOUND) {
+        // Whole words are judged against the full text, past the limit
+        if (!matcher->words || TextIsWholeWord(text, length, start, start + n, matcher->words)) {
+            *startOut = start;
+            *endOut = start + n;
+            return TRUE;
+        }
+        start++;
+    }
+    return FALSE;
+}
+
+static BOOL FindRegex(void *context, const uint16_t *text, size_t length, size_t from,
+                      size_t startLimit, size_t *startOut, size_t *endOut) {
+    RegexMatch match;
+    if (!RegexSearchWithin((Regex *)context, text, length, from, startLimit, &match)) return FALSE;
+    *startOut = match.start[0];
+    *endOut = match.end[0];
+    return TRUE;
+}
+
+static void *CloneRegex(const ChunkMatcher *matcher) {
+    Regex *regex = NULL;
+    if (RegexCompile(matcher->needle, matcher->needleLength, matcher->regexFlags, &regex, NULL) != REGEX_OK) {
+        return NULL;
+    }
+    return regex;
+}
+
+static void ReleaseRegex(void *context) {
+    RegexFree((Regex *)context);
+}
+
+void ChunkMatcherLiteral(ChunkMatcher *matcher, const uint16_t *needle, size_t needleLength,
+                         const uint16_t *fold, const uint8_t *words) {
+    ZeroMemory(matcher, sizeof(*matcher));
+    matcher->find = FindLiteral;
+    matcher->context = matcher;     // Read-only: shared by every thread
+    matcher->needle = needle;
+    matcher->needleLength = needleLength;
+    matcher->fold = fold;
+    matcher->words = words;
+    TextNeedleInit(&matcher->literal, needle, needleLength, fold);
+}
+
+void ChunkMatcherRegex(ChunkMatcher *matcher, Regex *regex, const uint16_t *pattern, size_t patternLength,
+                       unsigned flags) {
+    ZeroMemory(matcher, sizeof(*matcher));
+    matcher->find = FindRegex;
+    matcher->context = regex;
+    matcher->clone = CloneRegex;
+    matcher->release = ReleaseRegex;
+    matcher->needle = pattern;
+    matcher->needleLength = patternLength;
+    matcher->regexFlags = flags;
+}
+
+// ============================================================================
+// Indexed Matcher
+// ============================================================================
+// Runs the inner matcher over each stretch of candidate blocks in turn. A
+// worker thread gets its own copy of the inner context, as it would without
+// the index.
+// ============================================================================
+static BOOL FindIndexed(void *context, const uint16_t *text, size_t length, size_t from,
+                        size_t startLimit, size_t *startOut, size_t *endOut) {
+    const IndexedContext *indexed = (const IndexedContext *)context;
+    const IndexedMatcher *owner = indexed->owner;
+    size_t pos = from, runStart, runEnd;
+    while (pos < startLimit && TrigramQueryNext(&owner->query, pos, &runStart, &runEnd)) {
+        if (runStart >= startLimit) break;
+        if (runStart < pos) runStart = pos;
+        if (runEnd > startLimit) runEnd = startLimit;
+        if (owner->inner->find(indexed->inner, text, length, runStart, runEnd, startOut, endOut)) return TRUE;
+        pos = runEnd;
+    }
+    return FALSE;
+}
+
+static void *CloneIndexed(const ChunkMatcher *matcher) {
+    const IndexedMatcher *owner = (const IndexedMatcher *)matcher;
+    IndexedContext *context = (IndexedContext *)HeapAlloc(GetProcessHeap(), 0, sizeof(IndexedContext));
+    if (!context) return NULL;
+    context->owner = owner;
+    context->inner = owner->inner->clone ? owner->inner->clone(owner->inner) : owner->inner->context;
+    if (!context->inner) {
+        HeapFree(GetProcessHeap(), 0, context);
+        return NULL;
+    }
+    return context;
+}
+
+static void ReleaseIndexed(void *context) {
+    IndexedContext *indexed = (IndexedContext *)context;
+    const ChunkMatcher *inner = indexed->owner->inner;
+    if (inner->clone) inner->release(indexed->inner);
+    HeapFree(GetProcessHeap(), 0, indexed);
+}
+
+void IndexedMatcherInit(IndexedMatcher *indexed, const ChunkMatcher *inner, const TrigramQuery *query) {
+    ZeroMemory(indexed, sizeof(*indexed));
+    indexed->matcher.find = FindIndexed;
+    indexed->matcher.context = &indexed->context;
+    indexed->matcher.clone = CloneIndexed;
+    indexed->matcher.release = ReleaseIndexed;
+    indexed->inner = inner;
+    indexed->query = *query;
+    indexed->context.owner = indexed;
+    indexed->context.inner = inner->context;
+}
+
+void IndexedMatcherFree(IndexedMatcher *indexed) {
+    TrigramQueryFree(&indexed->query);
+}
+
+// ============================================================================
+// Chunk Helpers
+// ============================================================================
+// Where the search continues after a match (past an empty one)
+static size_t ResumeAfter(size_t start, size_t end) {
+    return end > start ? end : end + 1;
+}
+
+// The last chunk also owns an empty match at the very end of the text
+static void ChunkBounds(const SearchJob *job, size_t k, size_t *startOut, size_t *limitOut) {
+    size_t start = job->begin + k * (size_t)PARALLEL_SEARCH_CHUNK;
+    *startOut = start;
+    *limitOut = (k + 1 < job->chunkCount) ? start + PARALLEL_SEARCH_CHUNK : job->length + 1;
+}
+
+static BOOL AddChunkMatch(ChunkResult *result, size_t start, size_t end) {
+    if (result->count == result->capacity) {
+        size_t newCapacity = result->capacity ? result->capacity * 2 : 64;
+        MatchSpan *grown = result->spans
+            ? (MatchSpan *)HeapReAlloc(GetProcessHeap(), 0, result->spans, newCapacity * sizeof(MatchSpan))
+            : (MatchSpan *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(MatchSpan));
+        if (!grown) return FALSE;
+        result->spans = grown;
+        result->capacity = newCapacity;
+    }
+    result->spans[result->count].start = start;
+    result->spans[result->count].end = end;
+    result->count++;
+    return TRUE;
+}
+
+// ============================================================================
+// RunChunks - Claim and Search Chunks Until None Are Left
+// ============================================================================
+static void RunChunks(SearchJob *job, void *context) {
+    const ChunkMatcher *matcher = job->matcher;
+    for (;;) {
+        size_t k = (size_t)(InterlockedIncrement(&job->next) - 1);
+        if (k >= job->chunkCount) return;
+        size_t chunkStart, chunkLimit;
+        ChunkBounds(job, k, &chunkStart, &chunkLimit);
+
+        if (job->firsts) {
+            // Chunks are claimed in order: past a chunk with a match, nothing is needed
+            if ((LONG)k > job->first) return;
+            size_t start, end;
+            if (!matcher->find(context, job->text, job->length, chunkStart, chunkLimit, &start, &end)) continue;
+            job->firsts[k].start = start;
+            job->firsts[k].end = end;
+            LONG seen = job->first;
+            while ((LONG)k < seen) {
+                LONG previous = InterlockedCompareExchange(&job->first, (LONG)k, seen);
+                if (previous == seen) break;
+                seen = previous;
+            }
+        } else {
+            ChunkResult *result = &job->results[k];
+            size_t pos = chunkStart, start, end;
+            while (pos < chunkLimit && matcher->find(context, job->text, job->length, pos, chunkLimit, &start, &end)) {
+                if (job->lines) {
+                    // One row per line: the rest of the line need not be searched
+                    size_t lineStart = LineFilterLineStart(job->text, job->length, start);
+                    if (!AddChunkMatch(result, lineStart, lineStart)) {
+                        result->failed = TRUE;
+                        break;
+                    }
+                    size_t nextLine = LineFilterNextLine(job->text, job->length, start);
+                    pos = nextLine > start ? nextLine : start + 1;
+                    continue;
+                }
+                if (!AddChunkMatch(result, start, end)) {
+                    result->failed = TRUE;
+                    break;
+                }
+                pos = ResumeAfter(start, end);
+            }
+        }
+    }
+}
+
+static DWORD WINAPI SearchWorker(LPVOID param) {
+    SearchJob *job = (SearchJob *)param;
+    const ChunkMatcher *matcher = job->matcher;
+    void *context = matcher->clone ? matcher->clone(matcher) : matcher->context;
+    if (!context) return 0;     // The other threads take this one's share
+    RunChunks(job, context);
+    if (matcher->clone) matcher->release(context);
+    return 0;
+}
+
+// ============================================================================
+// RunJob - Search the Chunks on the Calling Thread and the Workers
+// ============================================================================
+static void RunJob(SearchJob *job) {
+    static DWORD processors = 0;
+    if (processors == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        processors = info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+    }
+    size_t threads = processors;
+    if (threads > PARALLEL_SEARCH_MAX_THREADS) threads = PARALLEL_SEARCH_MAX_THREADS;
+    if (threads > job->chunkCount) threads = job->chunkCount;
+
+    HANDLE workers[PARALLEL_SEARCH_MAX_THREADS];
+    DWORD started = 0;
+    for (size_t i = 1; i < threads; ++i) {
+        HANDLE thread = CreateThread(NULL, 0, SearchWorker, job, 0, NULL);
+        if (thread) workers[started++] = thread;
+    }
+    RunChunks(job, job->matcher->context);
+    if (started) WaitForMultipleObjects(started, workers, TRUE, INFINITE);
+    for (DWORD i = 0; i < started; ++i) CloseHandle(workers[i]);
+}
+
+// ============================================================================
+// ParallelFindFirst
+// ============================================================================
+BOOL ParallelFindFirst(const ChunkMatcher *matcher, const uint16_t *text, size_t length, size_t from,
+                       size_t *startOut, size_t *endOut) {
+    if (from > length) return FALSE;
+
+    // Most searches end close to where they start: try the first stretch here
+    size_t probeLimit = (length - from > PARALLEL_SEARCH_CHUNK) ? from + PARALLEL_SEARCH_CHUNK : length + 1;
+    if (matcher->find(matcher->context, text, length, from, probeLimit, startOut, endOut)) return TRUE;
+    if (probeLimit > length) return FALSE;
+
+    SearchJob job = {0};
+    job.matcher = matcher;
+    job.text = text;
+    job.length = length;
+    job.begin = probeLimit;
+    job.chunkCount = (length - probeLimit) / PARALLEL_SEARCH_CHUNK + 1;
+    job.first = (LONG)job.chunkCount;
+    job.firsts = (MatchSpan *)HeapAlloc(GetProcessHeap(), 0, job.chunkCount * sizeof(MatchSpan));
+    if (!job.firsts) {
+        return matcher->find(matcher->context, text, length, probeLimit, length + 1, startOut, endOut);
+    }
+    RunJob(&job);
+
+    BOOL found = (size_t)job.first < job.chunkCount;
+    if (found) {
+        *startOut = (size_t)job.firsts[job.first].start;
+        *endOut = (size_t)job.firsts[job.first].end;
+    }
+    HeapFree(GetProcessHeap(), 0, job.firsts);
+    return found;
+}
+
+// ============================================================================
+// ParallelFindAll
+// ============================================================================
+BOOL ParallelFindAll(const ChunkMatcher *matcher, const uint16_t *text, size_t length, MatchIndex *index) {
+    index->count = 0;
+    index->stale = true;
+
+    SearchJob job = {0};
+    job.matcher = matcher;
+    job.text = text;
+    job.length = length;
+    job.chunkCount = length / PARALLEL_SEARCH_CHUNK + 1;
+    job.first = (LONG)job.chunkCount;
+    job.results = (ChunkResult *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, job.chunkCount * sizeof(ChunkResult));
+    if (!job.results) return FALSE;
+    RunJob(&job);
+
+    // Merge in document order, re-searching where a match crosses into a chunk
+    BOOL ok = TRUE;
+    size_t pos = 0;
+    for (size_t k = 0; k < job.chunkCount && ok; ++k) {
+        const ChunkResult *result = &job.results[k];
+        size_t chunkStart, chunkLimit;
+        ChunkBounds(&job, k, &chunkStart, &chunkLimit);
+        if (result->failed) {
+            ok = FALSE;
+            break;
+        }
+        if (pos < chunkStart) pos = chunkStart;
+
+        size_t i = 0;
+        for (;;) {
+            while (i < result->count && result->spans[i].start < pos) i++;
+            // In step once 'pos' falls where the chunk's own search found nothing
+            if (i == 0 || pos >= ResumeAfter((size_t)result->spans[i - 1].start, (size_t)result->spans[i - 1].end)) {
+                break;
+            }
+            size_t start, end;
+            if (!matcher->find(matcher->context, text, length, pos, chunkLimit, &start, &end)) {
+                i = result->count;
+                break;
+            }
+            if (!MatchIndexAppend(index, start, end)) {
+                ok = FALSE;
+                break;
+            }
+            pos = ResumeAfter(start, end);
+        }
+        for (; ok && i < result->count; ++i) {
+            ok = MatchIndexAppend(index, result->spans[i].start, result->spans[i].end);
+            pos = ResumeAfter((size_t)result->spans[i].start, (size_t)result->spans[i].end);
+        }
+    }
+
+    for (size_t k = 0; k < job.chunkCount; ++k) {
+        if (job.results[k].spans) HeapFree(GetProcessHeap(), 0, job.results[k].spans);
+    }
+    HeapFree(GetProcessHeap(), 0, job.results);
+    if (!ok) {
+        index->count = 0;
+        return FALSE;
+    }
+    index->stale = false;
+    return TRUE;
+}
+
+// ============================================================================
+// ParallelFilterLines
+// ============================================================================
+// Each chunk lists the lines its matches start in; a line that crosses
+// into the next chunk may be listed by both, which LineFilterAppend drops.
+// ============================================================================
+BOOL ParallelFilterLines(const ChunkMatcher *matcher, const uint16_t *text, size_t length, LineFilter *filter) {
+    LineFilterInvalidate(filter);
+    if (length > LINE_FILTER_MAX_TEXT) return FALSE;
+
+    SearchJob job = {0};
+    job.matcher = matcher;
+    job.text = text;
+    job.length = length;
+    job.lines = TRUE;
+    job.chunkCount = length / PARALLEL_SEARCH_CHUNK + 1;
+    job.first = (LONG)job.chunkCount;
+    job.results = (ChunkResult *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, job.chunkCount * sizeof(ChunkResult));
+    if (!job.results) return FALSE;
+    RunJob(&job);
+
+    BOOL ok = TRUE;
+    LineFilterReset(filter);
+    for (size_t k = 0; k < job.chunkCount; ++k) {
+        const ChunkResult *result = &job.results[k];
+        if (result->failed) ok = FALSE;
+        for (size_t i = 0; ok && i < result->count; ++i) ok = LineFilterAppend(filter, (size_t)result->spans[i].start);
+        if (result->spans) HeapFree(GetProcessHeap(), 0, result->spans);
+    }
+    HeapFree(GetProcessHeap(), 0, job.results);
+    if (!ok) LineFilterInvalidate(filter);
+    return ok;
+}
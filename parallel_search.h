@@ -0,0 +1,102 @@
+// ============================================================================
+// parallel_search.h - Parallel Chunked Search Header
+// ============================================================================
+// Searches a large text on all cores. The text is cut into chunks of
+// PARALLEL_SEARCH_CHUNK characters; a chunk owns the matches that start
+// inside it, and a match may run on past its end (for a literal that is the
+// needle length - 1 overlap). Threads claim chunks in document order from a
+// shared counter. The calling thread is one of them, so the search
+// completes even if no worker thread can be started.
+//   - ParallelFindFirst: the first match in document order at or after a
+//     position. Chunks after one that holds a match are skipped.
+//   - ParallelFindAll: every match, leftmost first and not overlapping, as
+//     a sequential search finds them. Each chunk is searched from its own
+//     start. Where a match from the previous chunk runs into it, the calling
+//     thread searches from the real resume point until it lines up with the
+//     chunk's own results.
+//   - ParallelFilterLines: the lines holding a match (see line_filter.h).
+//     A chunk moves on to the next line after each match.
+// Matchers plug in through ChunkMatcher; literal (exact or through a fold
+// table) and regular expression matchers are built in. IndexedMatcher
+// narrows any of them to the candidate blocks of a trigram index query, so
+// a repeated search of a large document reads only those.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+#include "line_filter.h"
+#include "match_index.h"
+#include "regex.h"
+#include "text_search.h"
+#include "trigram_index.h"
+
+#define PARALLEL_SEARCH_CHUNK        (1u << 20)   // Characters per chunk
+#define PARALLEL_SEARCH_MAX_THREADS  16
+
+typedef struct ChunkMatcher ChunkMatcher;
+
+// Finds the leftmost match starting in [from, startLimit). The match may
+// extend up to 'length'. Returns FALSE if there is none.
+typedef BOOL (*ChunkFindProc)(void *context, const uint16_t *text, size_t length, size_t from,
+                              size_t startLimit, size_t *startOut, size_t *endOut);
+
+struct ChunkMatcher {
+    ChunkFindProc find;
+    void *context;                              // For 'find' on the calling thread
+    void *(*clone)(const ChunkMatcher *matcher); // Context for a worker thread; NULL to share 'context'
+    void (*release)(void *context);             // Frees a cloned context
+
+    // Parameters of the built-in matchers
+    const uint16_t *needle;                     // Literal text or pattern
+    size_t needleLength;
+    const uint16_t *fold;                       // Literal: 65536-entry fold table, or NULL
+    const uint8_t *words;                       // Literal: word table for whole words only, or NULL
+    TextNeedle literal;                         // Literal: the needle prepared once for every chunk
+    unsigned regexFlags;                        // Regex: REGEX_* compile flags
+};
+
+// Literal matcher; 'fold' as in TextFind, 'words' as in TextFindWord. The
+// needle must outlive the matcher.
+void ChunkMatcherLiteral(ChunkMatcher *matcher, const uint16_t *needle, size_t needleLength,
+                         const uint16_t *fold, const uint8_t *words);
+
+// Regex matcher. 'regex' is used on the calling thread; each worker compiles
+// its own copy of the pattern (a Regex is not thread-safe).
+void ChunkMatcherRegex(ChunkMatcher *matcher, Regex *regex, const uint16_t *pattern, size_t patternLength,
+                       unsigned flags);
+
+// A matcher that only finds the matches starting in the candidate blocks
+// of a trigram query. When every match starts with the query's literal,
+// those are all of them.
+typedef struct IndexedMatcher IndexedMatcher;
+
+typedef struct IndexedContext {
+    const IndexedMatcher *owner;
+    void *inner;                                // Context for the inner matcher's 'find'
+} IndexedContext;
+
+struct IndexedMatcher {
+    ChunkMatcher matcher;                       // Search with this
+    const ChunkMatcher *inner;                  // The matcher being narrowed
+    TrigramQuery query;
+    IndexedContext context;                     // The calling thread's
+};
+
+// Narrows 'inner' (which must outlive it) to the query's candidate blocks.
+// The indexed matcher takes over the query.
+void IndexedMatcherInit(IndexedMatcher *indexed, const ChunkMatcher *inner, const TrigramQuery *query);
+void IndexedMatcherFree(IndexedMatcher *indexed);
+
+// First match starting at or after 'from'. Returns FALSE if there is none.
+BOOL ParallelFindFirst(const ChunkMatcher *matcher, const uint16_t *text, size_t length, size_t from,
+                       size_t *startOut, size_t *endOut);
+
+// Fills 'index' with every match (as MatchIndexBuild does).
+// Returns FALSE if out of memory; the index is then stale.
+BOOL ParallelFindAll(const ChunkMatcher *matcher, const uint16_t *text, size_t length, MatchIndex *index);
+
+// Fills 'filter' with the lines holding a match. Returns FALSE if out of
+// memory or the text is too long; the filter is then stale.
+BOOL ParallelFilterLines(const ChunkMatcher *matcher, const uint16_t *text, size_t length, LineFilter *filter);
@@ -0,0 +1,328 @@
+// ============================================================================
+// print_job.c - Background Printing Implementation
+// ============================================================================
+// One worker thread per job runs the whole GDI print sequence (StartDocW,
+// a StartPage/EndPage pair per page, EndDoc or AbortDoc) on the printer DC
+// it was handed. The UI thread only reads interlocked counters.
+// ============================================================================
+
+#include "print_job.h"
+#include <strsafe.h>   // For safe string operations
+
+#define PRINT_MAX_SPANS  256    // Colored runs drawn per printed row
+
+struct PrintJob {
+    HANDLE thread;
+    HWND notify;
+    UINT message;
+    HDC hdc;
+    WCHAR docName[MAX_PATH];
+    WCHAR *text;
+    size_t length;
+    LOGFONTW font;
+    RECT margins;
+    size_t firstPage;
+    size_t lastPage;
+    const HighlightLanguage *language;
+    Pagination pagination;
+    TextMetricsCache metrics;
+
+    // Worker state
+    PrintPage page;
+    PrintInk ink;
+
+    // Shared with the UI thread
+    volatile LONG cancel;
+    volatile LONG done;
+    volatile LONG failed;
+    volatile LONGLONG pagesPrinted;
+    volatile LONGLONG pagesTotal;
+    volatile LONG notifyPending;        // A message is posted and not yet polled
+};
+
+// Ink for each HighlightKind; plain text keeps the DC's colour
+static const COLORREF g_highlightColors[HL_KIND_COUNT] = {
+    RGB(0, 0, 0),           // HL_PLAIN (unused)
+    RGB(0, 0, 192),         // HL_KEYWORD
+    RGB(0, 112, 128),       // HL_TYPE
+    RGB(160, 24, 24),       // HL_STRING
+    RGB(8, 128, 80),        // HL_NUMBER
+    RGB(0, 128, 0),         // HL_COMMENT
+    RGB(128, 0, 128),       // HL_PREPROCESSOR
+    RGB(0, 64, 160),        // HL_KEY
+    RGB(160, 80, 0),        // HL_SECTION
+    RGB(128, 0, 0),         // HL_TAG
+    RGB(192, 64, 0),        // HL_ATTRIBUTE
+    RGB(128, 0, 128),       // HL_ENTITY
+    RGB(200, 0, 0),         // HL_ERROR
+    RGB(176, 112, 0),       // HL_WARNING
+    RGB(0, 96, 192),        // HL_INFO
+    RGB(112, 112, 112),     // HL_DEBUG
+};
+
+// ============================================================================
+// Text Metrics on a Device Context
+// ============================================================================
+// The TextMetricsProvider for printing: GDI measurements with the font
+// selected into the device context.
+static bool DeviceAdvances(void *context, uint16_t first, size_t count, int32_t *widths) {
+    return GetCharWidth32W((HDC)context, first, (UINT)(first + count - 1), (LPINT)widths) != 0;
+}
+
+static int32_t DeviceMeasureRun(void *context, const uint16_t *text, size_t count, int32_t maxExtent,
+                                size_t *fitOut) {
+    SIZE size = {0};
+    INT fit = 0;
+    GetTextExtentExPointW((HDC)context, (LPCWSTR)text, (int)count, maxExtent, &fit, NULL, &size);
+    *fitOut = (size_t)fit;
+    return size.cx;
+}
+
+static int32_t DeviceLineHeight(void *context) {
+    TEXTMETRICW tm;
+    if (!GetTextMetricsW((HDC)context, &tm)) return 0;
+    return tm.tmHeight + tm.tmExternalLeading;
+}
+
+int PrintMeasureRun(void *context, const uint16_t *text, size_t count, int maxExtent, size_t *fitOut) {
+    return TextMetricsMeasure((TextMetricsCache *)context, text, count, maxExtent, fitOut);
+}
+
+// ============================================================================
+// PrintMeasurePage
+// ============================================================================
+// The metrics key is the font's description plus the device's resolution
+// and kind, so printing again with the same font and printer measures
+// nothing new.
+void PrintMeasurePage(HDC hdc, HFONT font, const RECT *margins, TextMetricsCache *metrics, PrintPage *page) {
+    LOGFONTW lf;
+    ZeroMemory(&lf, sizeof(lf));
+    GetObjectW(font, sizeof(lf), &lf);
+    size_t face = wcsnlen(lf.lfFaceName, LF_FACESIZE);
+    ZeroMemory(lf.lfFaceName + face, (LF_FACESIZE - face) * sizeof(WCHAR));   // Only the name counts
+
+    int logPixelsX = GetDeviceCaps(hdc, LOGPIXELSX);
+    int logPixelsY = GetDeviceCaps(hdc, LOGPIXELSY);
+    uint64_t seed = ((uint64_t)(uint32_t)logPixelsX << 32) | (uint32_t)logPixelsY;
+    seed ^= (uint64_t)(uint32_t)GetDeviceCaps(hdc, TECHNOLOGY) << 16;
+    TextMetricsProvider provider = { hdc, DeviceAdvances, DeviceMeasureRun, DeviceLineHeight };
+    page->fontKey = TextMetricsKey(&lf, sizeof(lf), seed);
+    TextMetricsSelect(metrics, page->fontKey, &provider);
+
+    // Margins are in thousandths of an inch
+    page->left = (margins->left * logPixelsX) / 1000;
+    page->top = (margins->top * logPixelsY) / 1000;
+    page->width = GetDeviceCaps(hdc, HORZRES) - page->left - (margins->right * logPixelsX) / 1000;
+    page->height = GetDeviceCaps(hdc, VERTRES) - page->top - (margins->bottom * logPixelsY) / 1000;
+    page->lineHeight = TextMetricsLineHeight(metrics);
+    page->rows = page->height > page->lineHeight ? (size_t)(page->height / page->lineHeight) : 1;
+}
+
+// ============================================================================
+// PrintInk - Highlighted Rows
+// ============================================================================
+void PrintInkInit(PrintInk *ink, HDC hdc, const WCHAR *text, size_t length, const HighlightLanguage *language) {
+    ink->hdc = hdc;
+    ink->text = text;
+    ink->length = length;
+    ink->language = language;
+    PrintInkSeed(ink, 0, HL_STATE_START);
+}
+
+void PrintInkSeed(PrintInk *ink, size_t offset, uint8_t state) {
+    ink->lexedTo = offset;
+    ink->lexState = state;
+}
+
+// From the top again if 'offset' lies behind
+uint8_t PrintInkStateAt(PrintInk *ink, size_t offset) {
+    if (!ink->language) return HL_STATE_START;
+    if (offset < ink->lexedTo) PrintInkSeed(ink, 0, HL_STATE_START);
+    if (offset > ink->lexedTo) {
+        size_t none = 0;
+        ink->lexState = HighlightLex(ink->language, ink->lexState, (const uint16_t *)ink->text, ink->length,
+                                     ink->lexedTo, offset, NULL, 0, &none);
+        ink->lexedTo = offset;
+    }
+    return ink->lexState;
+}
+
+// A row with more than PRINT_MAX_SPANS tokens is plain past the last.
+void PrintDrawRow(PrintInk *ink, int x, int y, size_t start, size_t end) {
+    HDC hdc = ink->hdc;
+    if (!ink->language) {
+        TextOutW(hdc, x, y, ink->text + start, (int)(end - start));
+        return;
+    }
+
+    HighlightSpan spans[PRINT_MAX_SPANS];
+    size_t count = 0;
+    uint8_t state = PrintInkStateAt(ink, start);
+    ink->lexState = HighlightLex(ink->language, state, (const uint16_t *)ink->text, ink->length, start, end, spans,
+                                 ARRAYSIZE(spans), &count);
+    ink->lexedTo = end;
+
+    // Each TextOutW carries on where the last one stopped
+    COLORREF plain = GetTextColor(hdc);
+    UINT align = SetTextAlign(hdc, TA_UPDATECP);
+    MoveToEx(hdc, x, y, NULL);
+    size_t pos = start;
+    for (size_t i = 0; i <= count; ++i) {
+        size_t spanStart = (i < count) ? spans[i].start : end;
+        if (spanStart > pos) {
+            SetTextColor(hdc, plain);
+            TextOutW(hdc, 0, 0, ink->text + pos, (int)(spanStart - pos));
+        }
+        if (i == count) break;
+        SetTextColor(hdc, g_highlightColors[spans[i].kind]);
+        TextOutW(hdc, 0, 0, ink->text + spans[i].start, (int)(spans[i].end - spans[i].start));
+        pos = spans[i].end;
+    }
+    SetTextAlign(hdc, align);
+    SetTextColor(hdc, plain);
+}
+
+// ============================================================================
+// Worker - Pages onto the Printer
+// ============================================================================
+static void Notify(PrintJob *job) {
+    if (InterlockedExchange(&job->notifyPending, 1) == 0) {
+        PostMessageW(job->notify, job->message, 0, 0);
+    }
+}
+
+// Pages the job will print, once the pagination knows
+static void PublishTotal(PrintJob *job) {
+    size_t total = 0;
+    if (job->pagination.complete) {
+        size_t pages = job->pagination.pages;
+        size_t last = job->lastPage < pages ? job->lastPage + 1 : pages;
+        total = last > job->firstPage ? last - job->firstPage : 0;
+    } else if (job->lastPage != SIZE_MAX) {
+        total = job->lastPage - job->firstPage + 1;
+    }
+    InterlockedExchange64(&job->pagesTotal, (LONGLONG)total);
+}
+
+static bool JobBeginPage(void *context, size_t page) {
+    PrintJob *job = (PrintJob *)context;
+    UNREFERENCED_PARAMETER(page);
+    if (job->cancel) return false;
+    if (StartPage(job->hdc) <= 0) {
+        InterlockedExchange(&job->failed, 1);
+        return false;
+    }
+    return true;
+}
+
+static bool JobRow(void *context, size_t row, size_t start, size_t end) {
+    PrintJob *job = (PrintJob *)context;
+    PrintDrawRow(&job->ink, job->page.left, job->page.top + (int)row * job->page.lineHeight, start, end);
+    return true;
+}
+
+static bool JobEndPage(void *context, size_t page) {
+    PrintJob *job = (PrintJob *)context;
+    UNREFERENCED_PARAMETER(page);
+    if (EndPage(job->hdc) <= 0) {
+        InterlockedExchange(&job->failed, 1);
+        return false;
+    }
+    InterlockedIncrement64(&job->pagesPrinted);
+    PublishTotal(job);
+    Notify(job);
+    return true;
+}
+
+static DWORD WINAPI PrintWorker(LPVOID param) {
+    PrintJob *job = (PrintJob *)param;
+    DOCINFOW di = {0};
+    di.cbSize = sizeof(DOCINFOW);
+    di.lpszDocName = job->docName;
+
+    HFONT font = CreateFontIndirectW(&job->font);
+    if (!font || StartDocW(job->hdc, &di) <= 0) {
+        InterlockedExchange(&job->failed, 1);
+    } else {
+        HFONT oldFont = (HFONT)SelectObject(job->hdc, font);
+        PrintMeasurePage(job->hdc, font, &job->margins, &job->metrics, &job->page);
+        PrintInkInit(&job->ink, job->hdc, job->text, job->length, job->language);
+
+        // Lay out pages as far as the range needs (page starts from the last
+        // job survive if the text, font and page size allow) and print them
+        PaginationSetup(&job->pagination, (const uint16_t *)job->text, job->length, PrintMeasureRun,
+                        &job->metrics, job->page.width, job->page.rows, job->page.fontKey);
+        PublishTotal(job);
+        PageSink sink = { job, JobBeginPage, JobRow, JobEndPage };
+        bool printed = PaginationRender(&job->pagination, job->firstPage, job->lastPage, &sink);
+        PaginationDetach(&job->pagination);
+        PublishTotal(job);
+
+        // Finish the job, or withdraw it if cancelled or refused
+        if (printed && EndDoc(job->hdc) <= 0) InterlockedExchange(&job->failed, 1);
+        if (!printed) AbortDoc(job->hdc);
+        SelectObject(job->hdc, oldFont);
+    }
+    if (font) DeleteObject(font);
+    DeleteDC(job->hdc);
+    job->hdc = NULL;
+
+    InterlockedExchange(&job->done, 1);
+    Notify(job);
+    return 0;
+}
+
+// ============================================================================
+// PrintJobStart / PrintJobCancel / PrintJobPoll / PrintJobFree
+// ============================================================================
+PrintJob *PrintJobStart(const PrintJobSetup *setup, HWND notify, UINT message) {
+    PrintJob *job = (PrintJob *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(PrintJob));
+    if (!job) return NULL;
+    job->notify = notify;
+    job->message = message;
+    job->hdc = setup->hdc;
+    StringCchCopyW(job->docName, ARRAYSIZE(job->docName), setup->docName);
+    job->text = setup->text;
+    job->length = setup->length;
+    job->font = setup->font;
+    job->margins = setup->margins;
+    job->firstPage = setup->firstPage;
+    job->lastPage = setup->lastPage < setup->firstPage ? setup->firstPage : setup->lastPage;
+    job->language = setup->language;
+    job->pagination = *setup->pagination;
+    job->metrics = *setup->metrics;
+
+    job->thread = CreateThread(NULL, 0, PrintWorker, job, 0, NULL);
+    if (!job->thread) {
+        HeapFree(GetProcessHeap(), 0, job);
+        return NULL;
+    }
+
+    // The job owns them now
+    PaginationInit(setup->pagination);
+    TextMetricsInit(setup->metrics);
+    return job;
+}
+
+void PrintJobCancel(PrintJob *job) {
+    if (job) InterlockedExchange(&job->cancel, 1);
+}
+
+void PrintJobPoll(PrintJob *job, PrintJobStatus *status) {
+    InterlockedExchange(&job->notifyPending, 0);
+    status->done = InterlockedCompareExchange(&job->done, 0, 0) != 0;
+    status->failed = InterlockedCompareExchange(&job->failed, 0, 0) != 0;
+    status->cancelled = InterlockedCompareExchange(&job->cancel, 0, 0) != 0;
+    status->pagesPrinted = (size_t)InterlockedCompareExchange64(&job->pagesPrinted, 0, 0);
+    status->pagesTotal = (size_t)InterlockedCompareExchange64(&job->pagesTotal, 0, 0);
+}
+
+void PrintJobFree(PrintJob *job, Pagination *pagination, TextMetricsCache *metrics) {
+    if (!job) return;
+    WaitForSingleObject(job->thread, INFINITE);
+    CloseHandle(job->thread);
+    *pagination = job->pagination;
+    *metrics = job->metrics;
+    HeapFree(GetProcessHeap(), 0, job->text);
+    HeapFree(GetProcessHeap(), 0, job);
+}
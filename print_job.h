@@ -0,0 +1,111 @@
+// ============================================================================
+// print_job.h - Background Printing Header
+// ============================================================================
+// Prints the document on a worker thread, so the editor stays usable while
+// a long job spools:
+//   - The job prints a snapshot: its own copy of the text and of the font
+//     description, taken when printing starts. Edits made while it runs
+//     change nothing on paper.
+//   - Pages are laid out by a Pagination (pagination.h) measured through a
+//     TextMetricsCache (text_metrics.h). The caller's pagination and
+//     metrics cache are moved into the job while it runs and handed back
+//     by PrintJobFree, so page starts and widths carry over to the next
+//     job (edits reported meanwhile still apply).
+//   - The owner window gets a posted message after each page and when the
+//     job ends; PrintJobPoll re-arms it. PrintJobCancel stops the job at
+//     the next page and withdraws it from the spooler.
+// Syntax highlighting is lexed from the snapshot as pages are drawn, since
+// the editor's line state cache follows the live edit control.
+// The measuring and drawing helpers are shared with anything else that
+// lays out printed pages.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "highlight.h"
+#include "pagination.h"
+#include "text_metrics.h"
+
+typedef struct PrintJob PrintJob;
+
+typedef struct PrintJobSetup {
+    HDC hdc;                            // Printer DC from PrintDlgW
+    const WCHAR *docName;               // Name shown in the print queue
+    WCHAR *text;                        // Snapshot (HeapAlloc)
+    size_t length;
+    LOGFONTW font;                      // Font to print with
+    RECT margins;                       // Thousandths of an inch (PAGESETUPDLGW)
+    size_t firstPage;                   // Pages to print, counted from 0;
+    size_t lastPage;                    // SIZE_MAX for all
+    const HighlightLanguage *language;  // NULL for plain text
+    Pagination *pagination;             // Moved into the job until PrintJobFree
+    TextMetricsCache *metrics;          // Likewise
+} PrintJobSetup;
+
+typedef struct PrintJobStatus {
+    size_t pagesPrinted;
+    size_t pagesTotal;                  // Pages the job will print; 0 until known
+    BOOL done;
+    BOOL failed;                        // The printer refused the job or a page
+    BOOL cancelled;
+} PrintJobStatus;
+
+// Starts printing. On success the job owns the DC and the text, and the
+// pagination and metrics cache are moved into it. Returns NULL if the job
+// could not be started; everything then stays the caller's.
+PrintJob *PrintJobStart(const PrintJobSetup *setup, HWND notify, UINT message);
+
+// Asks the job to stop after the current page.
+void PrintJobCancel(PrintJob *job);
+
+// Reads the progress and re-arms the notification message.
+void PrintJobPoll(PrintJob *job, PrintJobStatus *status);
+
+// Waits for the job to end (cancel it first to stop early), frees it, and
+// moves the pagination and metrics cache back to the given places.
+void PrintJobFree(PrintJob *job, Pagination *pagination, TextMetricsCache *metrics);
+
+// ============================================================================
+// Page Layout and Drawing
+// ============================================================================
+typedef struct PrintPage {
+    int left;                           // Printable area, in device units
+    int top;
+    int width;
+    int height;
+    int lineHeight;
+    size_t rows;                        // Rows per page
+    uint64_t fontKey;                   // Metrics cache key of the font
+} PrintPage;
+
+// Measures the page of 'hdc' (margins in thousandths of an inch) and makes
+// 'font', which must be selected into 'hdc', the metrics cache's font.
+void PrintMeasurePage(HDC hdc, HFONT font, const RECT *margins, TextMetricsCache *metrics, PrintPage *page);
+
+// LineMeasureProc over a TextMetricsCache (the context).
+int PrintMeasureRun(void *context, const uint16_t *text, size_t count, int maxExtent, size_t *fitOut);
+
+// Draws rows of text in colour. The lexer state carries from one row to
+// the next; a row before the last one drawn starts lexing over from the
+// top of the text.
+typedef struct PrintInk {
+    HDC hdc;
+    const WCHAR *text;
+    size_t length;
+    const HighlightLanguage *language;
+    size_t lexedTo;                     // Where lexing stopped...
+    uint8_t lexState;                   // ...and its state there
+} PrintInk;
+
+void PrintInkInit(PrintInk *ink, HDC hdc, const WCHAR *text, size_t length, const HighlightLanguage *language);
+
+// Resumes lexing at 'offset' in 'state' (a state PrintInkStateAt returned
+// there earlier), for drawing pages out of order without lexing from the top.
+void PrintInkSeed(PrintInk *ink, size_t offset, uint8_t state);
+
+// Lexer state at 'offset', lexing forward to it.
+uint8_t PrintInkStateAt(PrintInk *ink, size_t offset);
+
+// Draws text[start, end) at (x, y).
+void PrintDrawRow(PrintInk *ink, int x, int y, size_t start, size_t end);
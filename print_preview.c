@@ -0,0 +1,590 @@
+// ============================================================================
+// print_preview.c - Print Preview Implementation
+// ============================================================================
+// The printer DC is kept for measuring only: the font is selected into it
+// for as long as the preview is open, and the Pagination measures through
+// it exactly as a print job does. Thumbnails are drawn into screen bitmaps
+// whose mapping (MM_ANISOTROPIC) shrinks the printer's page onto the
+// thumbnail, so a page is drawn with the printer's coordinates and the
+// same PrintDrawRow a print job uses.
+// ============================================================================
+
+#include "print_preview.h"
+#include "print_job.h"
+#include <strsafe.h>   // For safe string operations
+
+#define PREVIEW_CLASS           L"RetropadPrintPreview"
+#define PREVIEW_TIMER           0x5E7E
+#define PREVIEW_TIMER_MS        10
+#define PREVIEW_SLICE_MS        25                          // Layout per timer tick
+#define PREVIEW_GAP             16                          // Pixels between pages
+#define PREVIEW_LABEL           20                          // Page number below each page
+#define PREVIEW_LINE            48                          // Pixels per scroll line
+#define PREVIEW_THUMBS          256                         // Bitmaps kept at most...
+#define PREVIEW_CACHE_BYTES     (48u * 1024u * 1024u)       // ...and their pixels
+#define PREVIEW_NO_STATE        0xFFFF
+
+// Thumbnail widths for '+' and '-'
+static const int g_zoomWidths[] = { 120, 180, 260, 380, 540, 760 };
+#define PREVIEW_DEFAULT_ZOOM    2
+
+typedef struct PreviewThumb {
+    size_t page;
+    HBITMAP bitmap;
+    uint64_t lastUse;
+} PreviewThumb;
+
+typedef struct Preview {
+    const PrintPreviewSetup *setup;
+    HWND hwnd;
+    HFONT oldFont;                      // Of the printer DC
+    LOGFONTW font;                      // Thumbnails draw with this in printer units
+    PrintPage page;
+    int paperWidth;                     // Printable area, in printer units
+    int paperHeight;
+    PrintInk ink;
+    uint16_t *states;                   // Lexer state at each page start, or PREVIEW_NO_STATE
+    size_t stateCapacity;
+
+    int zoom;                           // Index into g_zoomWidths
+    int thumbWidth;
+    int thumbHeight;
+    int columns;
+    int scrollY;
+    int contentHeight;
+
+    PreviewThumb thumbs[PREVIEW_THUMBS];
+    size_t thumbCount;
+    size_t thumbLimit;                  // Fewer when thumbnails are large
+    uint64_t clock;
+
+    BOOL print;                         // The user asked to print
+    BOOL closed;
+} Preview;
+
+// ============================================================================
+// Page Layout
+// ============================================================================
+// Measures the page and points the pagination at the text; page starts
+// survive if the printable width and rows per page did not change
+static void Measure(Preview *pv) {
+    const PrintPreviewSetup *setup = pv->setup;
+    PrintMeasurePage(setup->printer, setup->font, setup->margins, setup->metrics, &pv->page);
+    PaginationSetup(setup->pagination, (const uint16_t *)setup->text, setup->length, PrintMeasureRun,
+                    setup->metrics, pv->page.width, pv->page.rows, pv->page.fontKey);
+}
+
+// Lays out pages for a slice of time, until the page count is known.
+// Returns FALSE once there is nothing left to lay out.
+static BOOL LayOutSlice(Preview *pv) {
+    Pagination *pagination = pv->setup->pagination;
+    DWORD started = GetTickCount();
+    while (!pagination->complete && GetTickCount() - started < PREVIEW_SLICE_MS) {
+        size_t start = 0;
+        if (!PaginationPageStart(pagination, pagination->pages, &start) && !pagination->complete) {
+            return FALSE;   // Out of memory: show the pages found so far
+        }
+    }
+    return !pagination->complete;
+}
+
+// ============================================================================
+// Lexer States
+// ============================================================================
+static BOOL GrowStates(Preview *pv, size_t count) {
+    if (count <= pv->stateCapacity) return TRUE;
+    size_t capacity = pv->stateCapacity ? pv->stateCapacity * 2 : 64;
+    if (capacity < count) capacity = count;
+    SIZE_T bytes = capacity * sizeof(uint16_t);
+    uint16_t *grown = pv->states
+        ? (uint16_t *)HeapReAlloc(GetProcessHeap(), 0, pv->states, bytes)
+        : (uint16_t *)HeapAlloc(GetProcessHeap(), 0, bytes);
+    if (!grown) return FALSE;
+    memset(grown + pv->stateCapacity, 0xFF, (capacity - pv->stateCapacity) * sizeof(uint16_t));
+    pv->states = grown;
+    pv->stateCapacity = capacity;
+    return TRUE;
+}
+
+static void ForgetStates(Preview *pv) {
+    if (pv->states) memset(pv->states, 0xFF, pv->stateCapacity * sizeof(uint16_t));
+}
+
+// Readies the ink to draw 'page' (which starts at 'start'): lexing resumes
+// from the nearest earlier page whose state is known, and the states of
+// the pages in between are recorded on the way
+static void SeedInk(Preview *pv, size_t page, size_t start) {
+    if (!pv->setup->language || pv->ink.lexedTo == start) return;
+    if (!GrowStates(pv, page + 1)) return;      // PrintDrawRow lexes from the top instead
+
+    Pagination *pagination = pv->setup->pagination;
+    size_t from = page;
+    while (from > 0 && pv->states[from] == PREVIEW_NO_STATE) from--;
+    size_t offset = 0;
+    uint8_t state = HL_STATE_START;
+    if (from > 0 && PaginationPageStart(pagination, from, &offset)) state = (uint8_t)pv->states[from];
+    else from = 0;
+
+    PrintInkSeed(&pv->ink, offset, state);
+    for (size_t k = from + 1; k <= page; ++k) {
+        size_t at = 0;
+        if (!PaginationPageStart(pagination, k, &at)) break;
+        pv->states[k] = PrintInkStateAt(&pv->ink, at);
+    }
+}
+
+// ============================================================================
+// Thumbnails
+// ============================================================================
+static bool ThumbBeginPage(void *context, size_t page) {
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(page);
+    return true;
+}
+
+static bool ThumbRow(void *context, size_t row, size_t start, size_t end) {
+    Preview *pv = (Preview *)context;
+    PrintDrawRow(&pv->ink, pv->page.left, pv->page.top + (int)row * pv->page.lineHeight, start, end);
+    return true;
+}
+
+static bool ThumbEndPage(void *context, size_t page) {
+    UNREFERENCED_PARAMETER(context);
+    UNREFERENCED_PARAMETER(page);
+    return true;
+}
+
+// Draws 'page' into a new bitmap compatible with 'screen'
+static HBITMAP RenderPage(Preview *pv, HDC screen, size_t page) {
+    HBITMAP bitmap = CreateCompatibleBitmap(screen, pv->thumbWidth, pv->thumbHeight);
+    if (!bitmap) return NULL;
+    HDC mem = CreateCompatibleDC(screen);
+    if (!mem) {
+        DeleteObject(bitmap);
+        return NULL;
+    }
+    HBITMAP oldBitmap = (HBITMAP)SelectObject(mem, bitmap);
+    RECT paper = { 0, 0, pv->thumbWidth, pv->thumbHeight };
+    FillRect(mem, &paper, (HBRUSH)GetStockObject(WHITE_BRUSH));
+
+    // Printer units in, thumbnail pixels out
+    SetMapMode(mem, MM_ANISOTROPIC);
+    SetWindowExtEx(mem, pv->paperWidth, pv->paperHeight, NULL);
+    SetViewportExtEx(mem, pv->thumbWidth, pv->thumbHeight, NULL);
+    HFONT font = CreateFontIndirectW(&pv->font);
+    HFONT oldFont = (HFONT)SelectObject(mem, font ? font : (HFONT)GetStockObject(SYSTEM_FONT));
+    SetBkMode(mem, TRANSPARENT);
+    SetTextColor(mem, RGB(0, 0, 0));
+
+    size_t start = 0;
+    if (PaginationPageStart(pv->setup->pagination, page, &start)) {
+        pv->ink.hdc = mem;
+        SeedInk(pv, page, start);
+        PageSink sink = { pv, ThumbBeginPage, ThumbRow, ThumbEndPage };
+        PaginationRender(pv->setup->pagination, page, page, &sink);
+    }
+
+    SelectObject(mem, oldFont);
+    if (font) DeleteObject(font);
+    SelectObject(mem, oldBitmap);
+    DeleteDC(mem);
+    return bitmap;
+}
+
+// The thumbnail of 'page', drawing it (and evicting the least recently
+// used one) if it is not cached
+static HBITMAP Thumb(Preview *pv, HDC screen, size_t page) {
+    for (size_t i = 0; i < pv->thumbCount; ++i) {
+        if (pv->thumbs[i].page == page) {
+            pv->thumbs[i].lastUse = ++pv->clock;
+            return pv->thumbs[i].bitmap;
+        }
+    }
+
+    PreviewThumb *slot = NULL;
+    if (pv->thumbCount < pv->thumbLimit) {
+        slot = &pv->thumbs[pv->thumbCount++];
+    } else {
+        slot = &pv->thumbs[0];
+        for (size_t i = 1; i < pv->thumbCount; ++i) {
+            if (pv->thumbs[i].lastUse < slot->lastUse) slot = &pv->thumbs[i];
+        }
+        DeleteObject(slot->bitmap);
+    }
+    slot->bitmap = RenderPage(pv, screen, page);
+    if (!slot->bitmap) {
+        *slot = pv->thumbs[--pv->thumbCount];
+        return NULL;
+    }
+    slot->page = page;
+    slot->lastUse = ++pv->clock;
+    return slot->bitmap;
+}
+
+static void FlushThumbs(Preview *pv) {
+    for (size_t i = 0; i < pv->thumbCount; ++i) DeleteObject(pv->thumbs[i].bitmap);
+    pv->thumbCount = 0;
+}
+
+// Sizes thumbnails for the zoom level; the cache holds as many as fit
+// in PREVIEW_CACHE_BYTES
+static void SetThumbSize(Preview *pv) {
+    FlushThumbs(pv);
+    pv->thumbWidth = g_zoomWidths[pv->zoom];
+    pv->thumbHeight = MulDiv(pv->thumbWidth, pv->paperHeight, pv->paperWidth);
+    if (pv->thumbHeight < 1) pv->thumbHeight = 1;
+    size_t bytes = (size_t)pv->thumbWidth * (size_t)pv->thumbHeight * 4;
+    pv->thumbLimit = PREVIEW_CACHE_BYTES / bytes;
+    if (pv->thumbLimit < 1) pv->thumbLimit = 1;
+    if (pv->thumbLimit > PREVIEW_THUMBS) pv->thumbLimit = PREVIEW_THUMBS;
+}
+
+// ============================================================================
+// Grid and Scrolling
+// ============================================================================
+static int RowPitch(const Preview *pv) {
+    return pv->thumbHeight + PREVIEW_LABEL + PREVIEW_GAP;
+}
+
+static void PageRect(const Preview *pv, int clientWidth, size_t page, RECT *rect) {
+    int pitch = pv->thumbWidth + PREVIEW_GAP;
+    int left = (clientWidth - pv->columns * pitch + PREVIEW_GAP) / 2;
+    if (left < PREVIEW_GAP) left = PREVIEW_GAP;
+    size_t row = page / (size_t)pv->columns;
+    rect->left = left + (int)(page % (size_t)pv->columns) * pitch;
+    rect->top = PREVIEW_GAP + (int)row * RowPitch(pv) - pv->scrollY;
+    rect->right = rect->left + pv->thumbWidth;
+    rect->bottom = rect->top + pv->thumbHeight;
+}
+
+static size_t TopPage(const Preview *pv) {
+    return (size_t)(pv->scrollY / RowPitch(pv)) * (size_t)pv->columns;
+}
+
+// Fits the grid to the window and the pages known so far
+static void Layout(Preview *pv) {
+    Pagination *pagination = pv->setup->pagination;
+    RECT client;
+    GetClientRect(pv->hwnd, &client);
+    pv->columns = (client.right - PREVIEW_GAP) / (pv->thumbWidth + PREVIEW_GAP);
+    if (pv->columns < 1) pv->columns = 1;
+
+    size_t rows = (pagination->pages + (size_t)pv->columns - 1) / (size_t)pv->columns;
+    size_t height = PREVIEW_GAP + rows * (size_t)RowPitch(pv);
+    pv->contentHeight = height > INT_MAX / 2 ? INT_MAX / 2 : (int)height;
+    int most = pv->contentHeight - client.bottom;
+    if (pv->scrollY > most) pv->scrollY = most;
+    if (pv->scrollY < 0) pv->scrollY = 0;
+
+    SCROLLINFO si = { sizeof(si) };
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    si.nMin = 0;
+    si.nMax = pv->contentHeight - 1;
+    si.nPage = (UINT)client.bottom;
+    si.nPos = pv->scrollY;
+    SetScrollInfo(pv->hwnd, SB_VERT, &si, TRUE);
+
+    WCHAR title[160];
+    StringCchPrintfW(title, ARRAYSIZE(title),
+                     L"Print Preview - %llu pages%s    (+/- zoom, U page setup, Ctrl+P print, Esc close)",
+                     (unsigned long long)pagination->pages, pagination->complete ? L"" : L" so far");
+    SetWindowTextW(pv->hwnd, title);
+}
+
+static void ScrollTo(Preview *pv, int y) {
+    RECT client;
+    GetClientRect(pv->hwnd, &client);
+    int most = pv->contentHeight - client.bottom;
+    if (y > most) y = most;
+    if (y < 0) y = 0;
+    if (y == pv->scrollY) return;
+    int dy = pv->scrollY - y;
+    pv->scrollY = y;
+    SetScrollPos(pv->hwnd, SB_VERT, y, TRUE);
+    ScrollWindowEx(pv->hwnd, 0, dy, NULL, NULL, NULL, NULL, SW_INVALIDATE);
+}
+
+// Lays out and scrolls so 'page' is in the top row
+static void ShowPage(Preview *pv, size_t page) {
+    Layout(pv);
+    pv->scrollY = (int)(page / (size_t)pv->columns) * RowPitch(pv);
+    Layout(pv);
+    InvalidateRect(pv->hwnd, NULL, FALSE);
+}
+
+// ============================================================================
+// Painting
+// ============================================================================
+// Only the pages inside the paint rectangle are drawn (or taken from the
+// cache)
+static void Paint(Preview *pv) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(pv->hwnd, &ps);
+    RECT client;
+    GetClientRect(pv->hwnd, &client);
+    FillRect(hdc, &ps.rcPaint, GetSysColorBrush(COLOR_BTNFACE));
+
+    HDC mem = CreateCompatibleDC(hdc);
+    HFONT oldFont = (HFONT)SelectObject(hdc, GetStockObject(DEFAULT_GUI_FONT));
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, GetSysColor(COLOR_BTNTEXT));
+
+    size_t count = pv->setup->pagination->pages;
+    int pitch = RowPitch(pv);
+    int firstRow = (ps.rcPaint.top + pv->scrollY - PREVIEW_GAP) / pitch;
+    int lastRow = (ps.rcPaint.bottom + pv->scrollY) / pitch;
+    if (firstRow < 0) firstRow = 0;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = 0; column < pv->columns; ++column) {
+            size_t page = (size_t)row * (size_t)pv->columns + (size_t)column;
+            if (page >= count) break;
+            RECT rect;
+            PageRect(pv, client.right, page, &rect);
+
+            HBITMAP bitmap = mem ? Thumb(pv, hdc, page) : NULL;
+            if (bitmap) {
+                HBITMAP old = (HBITMAP)SelectObject(mem, bitmap);
+                BitBlt(hdc, rect.left, rect.top, pv->thumbWidth, pv->thumbHeight, mem, 0, 0, SRCCOPY);
+                SelectObject(mem, old);
+            } else {
+                FillRect(hdc, &rect, (HBRUSH)GetStockObject(WHITE_BRUSH));
+            }
+            RECT frame = rect;
+            InflateRect(&frame, 1, 1);
+            FrameRect(hdc, &frame, (HBRUSH)GetStockObject(BLACK_BRUSH));
+
+            WCHAR label[32];
+            StringCchPrintfW(label, ARRAYSIZE(label), L"Page %llu", (unsigned long long)(page + 1));
+            RECT labelRect = { rect.left, rect.bottom + 2, rect.right, rect.bottom + PREVIEW_LABEL };
+            DrawTextW(hdc, label, -1, &labelRect, DT_CENTER | DT_SINGLELINE | DT_VCENTER);
+        }
+    }
+
+    SelectObject(hdc, oldFont);
+    if (mem) DeleteDC(mem);
+    EndPaint(pv->hwnd, &ps);
+}
+
+// ============================================================================
+// Commands
+// ============================================================================
+static void Zoom(Preview *pv, int step) {
+    int zoom = pv->zoom + step;
+    if (zoom < 0 || zoom >= (int)ARRAYSIZE(g_zoomWidths)) return;
+    size_t top = TopPage(pv);
+    pv->zoom = zoom;
+    SetThumbSize(pv);
+    ShowPage(pv, top);
+}
+
+// The whole document, for End
+static void LayOutAll(Preview *pv) {
+    PaginationPageCount(pv->setup->pagination);
+    KillTimer(pv->hwnd, PREVIEW_TIMER);
+    Layout(pv);
+    ScrollTo(pv, INT_MAX);
+    InvalidateRect(pv->hwnd, NULL, FALSE);
+}
+
+// Shows Page Setup; new margins measure the page again
+static void ChangePageSetup(Preview *pv) {
+    const PrintPreviewSetup *setup = pv->setup;
+    if (!setup->pageSetup) return;
+    RECT before = *setup->margins;
+    setup->pageSetup(pv->hwnd);
+    if (EqualRect(&before, setup->margins)) return;
+
+    size_t top = TopPage(pv);
+    Measure(pv);
+    if (setup->pagination->pages == 0) ForgetStates(pv);   // Page starts moved
+    FlushThumbs(pv);
+    if (!setup->pagination->complete) SetTimer(pv->hwnd, PREVIEW_TIMER, PREVIEW_TIMER_MS, NULL);
+    ShowPage(pv, top);
+}
+
+static void HandleKey(Preview *pv, WPARAM key) {
+    RECT client;
+    GetClientRect(pv->hwnd, &client);
+    switch (key) {
+    case VK_ESCAPE:
+        pv->closed = TRUE;
+        break;
+    case 'P':
+        if (GetKeyState(VK_CONTROL) < 0) {
+            pv->print = TRUE;
+            pv->closed = TRUE;
+        }
+        break;
+    case 'U':
+        ChangePageSetup(pv);
+        break;
+    case VK_UP:
+        ScrollTo(pv, pv->scrollY - PREVIEW_LINE);
+        break;
+    case VK_DOWN:
+        ScrollTo(pv, pv->scrollY + PREVIEW_LINE);
+        break;
+    case VK_PRIOR:
+        ScrollTo(pv, pv->scrollY - client.bottom);
+        break;
+    case VK_NEXT:
+        ScrollTo(pv, pv->scrollY + client.bottom);
+        break;
+    case VK_HOME:
+        ScrollTo(pv, 0);
+        break;
+    case VK_END:
+        LayOutAll(pv);
+        break;
+    }
+}
+
+static void HandleScroll(Preview *pv, WPARAM wParam) {
+    SCROLLINFO si = { sizeof(si) };
+    si.fMask = SIF_ALL;
+    GetScrollInfo(pv->hwnd, SB_VERT, &si);
+    int y = pv->scrollY;
+    switch (LOWORD(wParam)) {
+    case SB_LINEUP:     y -= PREVIEW_LINE; break;
+    case SB_LINEDOWN:   y += PREVIEW_LINE; break;
+    case SB_PAGEUP:     y -= (int)si.nPage; break;
+    case SB_PAGEDOWN:   y += (int)si.nPage; break;
+    case SB_THUMBTRACK: y = si.nTrackPos; break;
+    case SB_TOP:        y = 0; break;
+    case SB_BOTTOM:     y = INT_MAX; break;
+    }
+    ScrollTo(pv, y);
+}
+
+// ============================================================================
+// PreviewWndProc
+// ============================================================================
+static LRESULT CALLBACK PreviewWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    Preview *pv = (Preview *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    switch (msg) {
+    case WM_NCCREATE:
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)((CREATESTRUCTW *)lParam)->lpCreateParams);
+        break;
+    case WM_ERASEBKGND:
+        return 1;       // Paint fills the background
+    case WM_PAINT:
+        if (pv) {
+            Paint(pv);
+            return 0;
+        }
+        break;
+    case WM_SIZE:
+        if (pv) {
+            Layout(pv);
+            InvalidateRect(hwnd, NULL, FALSE);
+        }
+        return 0;
+    case WM_TIMER:
+        if (pv && wParam == PREVIEW_TIMER) {
+            size_t before = pv->setup->pagination->pages;
+            if (!LayOutSlice(pv)) KillTimer(hwnd, PREVIEW_TIMER);
+            Layout(pv);
+
+            // Repaint only if new pages landed on screen
+            RECT client, first;
+            GetClientRect(hwnd, &client);
+            PageRect(pv, client.right, before, &first);
+            if (pv->setup->pagination->pages != before && first.top < client.bottom) {
+                InvalidateRect(hwnd, NULL, FALSE);
+            }
+            return 0;
+        }
+        break;
+    case WM_VSCROLL:
+        if (pv) HandleScroll(pv, wParam);
+        return 0;
+    case WM_MOUSEWHEEL:
+        if (pv) ScrollTo(pv, pv->scrollY - GET_WHEEL_DELTA_WPARAM(wParam) * 3 * PREVIEW_LINE / WHEEL_DELTA);
+        return 0;
+    case WM_KEYDOWN:
+        if (pv) HandleKey(pv, wParam);
+        return 0;
+    case WM_CHAR:
+        if (pv && (wParam == L'+' || wParam == L'=')) Zoom(pv, 1);
+        if (pv && wParam == L'-') Zoom(pv, -1);
+        return 0;
+    case WM_CLOSE:
+        if (pv) pv->closed = TRUE;
+        return 0;
+    case WM_DESTROY:
+        if (pv) pv->closed = TRUE;      // Also when the owner goes first
+        break;
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+// ============================================================================
+// PrintPreviewRun
+// ============================================================================
+// Runs its own message loop until the preview closes. A WM_QUIT that
+// arrives meanwhile is posted again for the owner's loop.
+BOOL PrintPreviewRun(const PrintPreviewSetup *setup) {
+    static ATOM atom = 0;
+    if (!atom) {
+        WNDCLASSEXW wc = { sizeof(wc) };
+        wc.lpfnWndProc = PreviewWndProc;
+        wc.hInstance = setup->instance;
+        wc.hCursor = LoadCursorW(NULL, IDC_ARROW);
+        wc.hIcon = (HICON)GetClassLongPtrW(setup->owner, GCLP_HICON);
+        wc.lpszClassName = PREVIEW_CLASS;
+        atom = RegisterClassExW(&wc);
+        if (!atom) return FALSE;
+    }
+
+    Preview *pv = (Preview *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(Preview));
+    if (!pv) return FALSE;
+    pv->setup = setup;
+    pv->zoom = PREVIEW_DEFAULT_ZOOM;
+    GetObjectW(setup->font, sizeof(pv->font), &pv->font);
+    pv->oldFont = (HFONT)SelectObject(setup->printer, setup->font);
+    pv->paperWidth = GetDeviceCaps(setup->printer, HORZRES);
+    pv->paperHeight = GetDeviceCaps(setup->printer, VERTRES);
+    if (pv->paperWidth < 1) pv->paperWidth = 1;
+    if (pv->paperHeight < 1) pv->paperHeight = 1;
+    PrintInkInit(&pv->ink, NULL, setup->text, setup->length, setup->language);
+    Measure(pv);
+    SetThumbSize(pv);
+
+    RECT frame;
+    GetWindowRect(setup->owner, &frame);
+    pv->hwnd = CreateWindowExW(0, PREVIEW_CLASS, L"Print Preview", WS_OVERLAPPEDWINDOW | WS_VSCROLL,
+                               frame.left, frame.top, frame.right - frame.left, frame.bottom - frame.top,
+                               setup->owner, NULL, setup->instance, pv);
+    BOOL quit = FALSE;
+    MSG msg = {0};
+    if (pv->hwnd) {
+        EnableWindow(setup->owner, FALSE);
+        Layout(pv);
+        ShowWindow(pv->hwnd, SW_SHOW);
+        if (!setup->pagination->complete) SetTimer(pv->hwnd, PREVIEW_TIMER, PREVIEW_TIMER_MS, NULL);
+
+        while (!pv->closed) {
+            BOOL got = GetMessageW(&msg, NULL, 0, 0);
+            if (got == 0) quit = TRUE;
+            if (got <= 0) break;
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+
+        // Enable the owner first, so it is the one activated
+        EnableWindow(setup->owner, TRUE);
+        if (IsWindow(pv->hwnd)) {
+            KillTimer(pv->hwnd, PREVIEW_TIMER);
+            DestroyWindow(pv->hwnd);
+        }
+        if (quit) PostQuitMessage((int)msg.wParam);
+    }
+
+    BOOL print = pv->print;
+    FlushThumbs(pv);
+    PaginationDetach(setup->pagination);
+    SelectObject(setup->printer, pv->oldFont);
+    if (pv->states) HeapFree(GetProcessHeap(), 0, pv->states);
+    HeapFree(GetProcessHeap(), 0, pv);
+    return print;
+}
@@ -0,0 +1,44 @@
+// ============================================================================
+// print_preview.h - Print Preview Header
+// ============================================================================
+// Shows the pages as they will print, as a scrolling grid of thumbnails:
+//   - Pages are laid out by the same Pagination and TextMetricsCache that
+//     printing uses, so page starts found in the preview carry over to the
+//     next print job, and the other way round. Layout runs a slice at a time
+//     on a timer until the page count is known; scrolling never lays out
+//     pages that are already known.
+//   - A thumbnail is drawn only when it scrolls into view, and kept in a
+//     least recently used bitmap cache of bounded size.
+//   - The lexer state at the top of each page is cached as pages are drawn,
+//     so a page is highlighted by lexing from the nearest page before it,
+//     not from the top of the document.
+//   - Changing the margins (Page Setup) measures the page again. If the
+//     printable width and rows per page come out the same, the page starts
+//     survive; otherwise the layout starts over, lazily as before.
+// The preview is modal: the owner is disabled while it is open.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "highlight.h"
+#include "pagination.h"
+#include "text_metrics.h"
+
+typedef struct PrintPreviewSetup {
+    HWND owner;
+    HINSTANCE instance;
+    HDC printer;                        // Device the pages are laid out for (stays the caller's)
+    const WCHAR *text;                  // Snapshot of the document
+    size_t length;
+    HFONT font;                         // Font to print with
+    RECT *margins;                      // Thousandths of an inch; read again after page setup
+    void (*pageSetup)(HWND owner);      // Shows the Page Setup dialog
+    const HighlightLanguage *language;  // NULL for plain text
+    Pagination *pagination;             // Shared with printing
+    TextMetricsCache *metrics;          // Likewise
+} PrintPreviewSetup;
+
+// Shows the preview until the user closes it. Returns TRUE if the user
+// asked to print from it.
+BOOL PrintPreviewRun(const PrintPreviewSetup *setup);
@@ -0,0 +1,1487 @@
+// ============================================================================
+// regex.c - Linear-Time Regular Expression Engine Implementation
+// ============================================================================
+// Pipeline:
+//   pattern --parse--> syntax tree --emit--> NFA program (Pike VM bytecode)
+// Searching:
+//   1. Lazy DFA scan: each DFA state is the set of NFA threads waiting to
+//      consume the next code unit plus the kind of the previous code unit
+//      (for ^ $ \b). Transitions are computed on first use, per equivalence
+//      class of code units, and cached. The scan stops at the earliest
+//      position where some match ends and remembers the last position at
+//      which no thread was alive; the leftmost match cannot start before it.
+//   2. Pike VM from that position: leftmost-first match and capture groups.
+// Both stages are O(text length x program size) at worst; the DFA makes the
+// common case a table lookup per code unit. When the DFA cache fills up it
+// is flushed, and if it keeps thrashing the search falls back to the VM.
+// ============================================================================
+
+#include "regex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REGEX_MAX_PATTERN   4096      // Bounds parser and emitter recursion
+#define REGEX_MAX_REPEAT    1000      // Largest {n,m} count
+#define REGEX_MAX_NESTING   256       // Deepest group nesting
+#define REGEX_PREFIX_MAX    32        // Longest literal prefix used by the prefilter
+#define NO_NODE             (-1)
+#define DFA_UNKNOWN         (-1)      // Transition not computed yet
+#define DFA_FULL            (-2)      // Cache hit its memory cap
+#define END_OF_TEXT         (-1)      // Lookahead past the last code unit
+
+// ============================================================================
+// Program
+// ============================================================================
+typedef enum Opcode {
+    OP_CHAR,        // Consume 'ch'
+    OP_ANY,         // Consume anything except a line break
+    OP_CLASS,       // Consume a unit in class 'x'
+    OP_MATCH,       // Match found
+    OP_JMP,         // Continue at 'x'
+    OP_SPLIT,       // Continue at 'x' (preferred) and 'y'
+    OP_SAVE,        // Record the position in capture slot 'x'
+    OP_BOL,         // ^  start of a line
+    OP_EOL,         // $  end of a line
+    OP_WORDB,       // \b word boundary
+    OP_NWORDB       // \B not a word boundary
+} Opcode;
+
+typedef struct Inst {
+    uint8_t op;
+    uint16_t ch;
+    uint32_t x, y;
+} Inst;
+
+typedef struct Range {
+    uint16_t lo, hi;
+} Range;
+
+typedef struct CharClass {
+    size_t first;           // Index of the first range in Regex.ranges
+    size_t count;           // Sorted, non-overlapping ranges
+} CharClass;
+
+// Kind of the code unit before a position, which is all ^ $ \b \B need
+typedef enum Context {
+    CTX_START = 0,          // Beginning of the text
+    CTX_LF = 1,
+    CTX_CR = 2,
+    CTX_WORD = 3,
+    CTX_OTHER = 4
+} Context;
+
+// ============================================================================
+// Lazy DFA Cache
+// ============================================================================
+typedef struct DfaState {
+    uint32_t setStart;      // NFA pcs in Dfa.pool (sorted)
+    uint32_t setCount;
+    uint8_t context;        // Context of the previous code unit
+    int8_t endMatch;        // -1 unknown, else whether a match ends at end of text
+} DfaState;
+
+typedef struct Dfa {
+    DfaState *states;
+    size_t stateCount, stateCapacity;
+    uint32_t *pool;
+    size_t poolLength, poolCapacity;
+    int32_t *transitions;   // stateCapacity x alphabetSize; (target << 1) | matchBefore
+    int32_t *hash;          // Open addressing, state index or -1
+    size_t hashCapacity;
+} Dfa;
+
+// Pike VM thread list: pcs in priority order, captures alongside
+typedef struct ThreadList {
+    uint32_t *pcs;
+    size_t *caps;           // programLength x slotCount
+    uint32_t *mark;         // Generation per pc, to add each pc once
+    uint32_t generation;
+    size_t count;
+} ThreadList;
+
+typedef struct StackEntry {
+    uint32_t pc;
+    uint32_t slot;          // UINT32_MAX: visit pc; else restore caps[slot] = value
+    size_t value;
+} StackEntry;
+
+struct Regex {
+    unsigned flags;
+    Inst *program;
+    size_t programLength, programCapacity;
+    Range *ranges;
+    size_t rangeCount, rangeCapacity;
+    CharClass *classes;
+    size_t classCount, classCapacity;
+    size_t groupCount;
+
+    // Prefilter: literal every match starts with (case-folded with REGEX_ICASE)
+    uint16_t prefix[REGEX_PREFIX_MAX];
+    size_t prefixLength;
+
+    // Code unit equivalence classes: units in one class behave the same for
+    // every instruction and context, so the DFA transitions per class
+    uint16_t *classMap;     // 65536 entries
+    uint16_t *classRep;     // A representative unit per class
+    size_t alphabetSize;
+    Dfa dfa;
+
+    // Scratch shared by the DFA and the VM
+    StackEntry *stack;
+    uint32_t *closureMark;
+    uint32_t closureGeneration;
+    uint32_t *setBuffer;
+    ThreadList lists[2];
+    size_t *slotBuffer;
+};
+
+// ============================================================================
+// Character Tables
+// ============================================================================
+static const Range kDigitRanges[] = { {'0', '9'} };
+
+static const Range kSpaceRanges[] = {
+    {0x09, 0x0D}, {0x20, 0x20}, {0x85, 0x85}, {0xA0, 0xA0}, {0x1680, 0x1680},
+    {0x2000, 0x200A}, {0x2028, 0x2029}, {0x202F, 0x202F}, {0x205F, 0x205F},
+    {0x3000, 0x3000}, {0xFEFF, 0xFEFF}
+};
+
+// ASCII alphanumerics and '_', plus the letter blocks of the BMP. Surrogates
+// count as word units so that supplementary letters stay inside words.
+static const Range kWordRanges[] = {
+    {'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}, {0xAA, 0xAA}, {0xB5, 0xB5},
+    {0xBA, 0xBA}, {0xC0, 0xD6}, {0xD8, 0xF6}, {0xF8, 0x2BF}, {0x370, 0x3FF},
+    {0x400, 0x52F}, {0x531, 0x1FFF}, {0x2C00, 0x2DFF}, {0x3040, 0xDFFF},
+    {0xF900, 0xFDFF}, {0xFE70, 0xFEFE}, {0xFF10, 0xFF19}, {0xFF21, 0xFF3A},
+    {0xFF3F, 0xFF3F}, {0xFF41, 0xFF5A}, {0xFF66, 0xFFDC}
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+static bool InRanges(const Range *ranges, size_t count, uint16_t ch) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ch < ranges[mid].lo) {
+            hi = mid;
+        } else if (ch > ranges[mid].hi) {
+            lo = mid + 1;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool IsWordUnit(uint16_t ch) {
+    return InRanges(kWordRanges, COUNT_OF(kWordRanges), ch);
+}
+
+// Simple case folding for Latin-1, Greek and Cyrillic
+static uint16_t FoldCase(uint16_t ch) {
+    if (ch >= 'A' && ch <= 'Z') return (uint16_t)(ch + 0x20);
+    if (ch < 0xC0) return ch;
+    if (ch <= 0xDE && ch != 0xD7) return (uint16_t)(ch + 0x20);
+    if (ch >= 0x391 && ch <= 0x3A9 && ch != 0x3A2) return (uint16_t)(ch + 0x20);
+    if (ch >= 0x410 && ch <= 0x42F) return (uint16_t)(ch + 0x20);
+    if (ch >= 0x400 && ch <= 0x40F) return (uint16_t)(ch + 0x50);
+    return ch;
+}
+
+static uint16_t UpperCase(uint16_t ch) {
+    if (ch >= 'a' && ch <= 'z') return (uint16_t)(ch - 0x20);
+    if (ch < 0xE0) return ch;
+    if (ch <= 0xFE && ch != 0xF7) return (uint16_t)(ch - 0x20);
+    if (ch >= 0x3B1 && ch <= 0x3C9 && ch != 0x3C2) return (uint16_t)(ch - 0x20);
+    if (ch >= 0x430 && ch <= 0x44F) return (uint16_t)(ch - 0x20);
+    if (ch >= 0x450 && ch <= 0x45F) return (uint16_t)(ch - 0x50);
+    return ch;
+}
+
+// The other member of a case pair, or 'ch' itself
+static uint16_t OtherCase(uint16_t ch) {
+    uint16_t lower = FoldCase(ch);
+    return lower != ch ? lower : UpperCase(ch);
+}
+
+static Context ContextOf(int32_t ch) {
+    if (ch == '\n') return CTX_LF;
+    if (ch == '\r') return CTX_CR;
+    return IsWordUnit((uint16_t)ch) ? CTX_WORD : CTX_OTHER;
+}
+
+static Context ContextAt(const uint16_t *text, size_t pos) {
+    return pos == 0 ? CTX_START : ContextOf(text[pos - 1]);
+}
+
+// ============================================================================
+// Growth Helpers
+// ============================================================================
+static bool Reserve(void **data, size_t *capacity, size_t needed, size_t elementSize) {
+    if (needed <= *capacity) return true;
+    size_t newCapacity = *capacity ? *capacity : 16;
+    while (newCapacity < needed) newCapacity *= 2;
+    void *grown = realloc(*data, newCapacity * elementSize);
+    if (!grown) return false;
+    *data = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+// ============================================================================
+// Range Lists
+// ============================================================================
+// Classes are collected as unsorted range lists, then case-folded, sorted,
+// merged and (for [^...]) complemented before they are stored.
+// ============================================================================
+typedef struct RangeList {
+    Range *items;
+    size_t count, capacity;
+} RangeList;
+
+static bool RangeListAdd(RangeList *list, uint16_t lo, uint16_t hi) {
+    if (!Reserve((void **)&list->items, &list->capacity, list->count + 1, sizeof(Range))) return false;
+    list->items[list->count].lo = lo;
+    list->items[list->count].hi = hi;
+    list->count++;
+    return true;
+}
+
+static bool RangeListAddTable(RangeList *list, const Range *table, size_t count, bool negate) {
+    uint32_t next = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!negate) {
+            if (!RangeListAdd(list, table[i].lo, table[i].hi)) return false;
+            continue;
+        }
+        if (table[i].lo > next && !RangeListAdd(list, (uint16_t)next, (uint16_t)(table[i].lo - 1))) return false;
+        next = (uint32_t)table[i].hi + 1;
+    }
+    return !negate || next > 0xFFFF || RangeListAdd(list, (uint16_t)next, 0xFFFF);
+}
+
+static int CompareRanges(const void *a, const void *b) {
+    const Range *ra = (const Range *)a, *rb = (const Range *)b;
+    return (int)ra->lo - (int)rb->lo;
+}
+
+static void RangeListNormalize(RangeList *list) {
+    if (list->count == 0) return;
+    qsort(list->items, list->count, sizeof(Range), CompareRanges);
+    size_t out = 0;
+    for (size_t i = 1; i < list->count; ++i) {
+        Range *last = &list->items[out];
+        if ((uint32_t)list->items[i].lo <= (uint32_t)last->hi + 1) {
+            if (list->items[i].hi > last->hi) last->hi = list->items[i].hi;
+        } else {
+            list->items[++out] = list->items[i];
+        }
+    }
+    list->count = out + 1;
+}
+
+// Adds the other case of every unit in the list (only the cased blocks)
+static bool RangeListAddFolds(RangeList *list) {
+    static const Range cased[] = { {'A', 'Z'}, {'a', 'z'}, {0xC0, 0xFE}, {0x391, 0x3C9}, {0x400, 0x45F} };
+    size_t original = list->count;
+    for (size_t i = 0; i < original; ++i) {
+        for (size_t z = 0; z < COUNT_OF(cased); ++z) {
+            uint32_t lo = list->items[i].lo > cased[z].lo ? list->items[i].lo : cased[z].lo;
+            uint32_t hi = list->items[i].hi < cased[z].hi ? list->items[i].hi : cased[z].hi;
+            for (uint32_t ch = lo; ch <= hi; ++ch) {
+                uint16_t other = OtherCase((uint16_t)ch);
+                if (other != ch && !RangeListAdd(list, other, other)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Stores a normalized list as a class and returns its index (or -1)
+static int32_t AddClass(Regex *re, RangeList *list, bool negate) {
+    RangeListNormalize(list);
+    if (negate) {
+        RangeList complement = {0};
+        if (!RangeListAddTable(&complement, list->items, list->count, true)) {
+            free(complement.items);
+            return -1;
+        }
+        free(list->items);
+        *list = complement;
+    }
+    if (!Reserve((void **)&re->ranges, &re->rangeCapacity, re->rangeCount + list->count, sizeof(Range)) ||
+        !Reserve((void **)&re->classes, &re->classCapacity, re->classCount + 1, sizeof(CharClass))) {
+        return -1;
+    }
+    if (list->count) memcpy(re->ranges + re->rangeCount, list->items, list->count * sizeof(Range));
+    re->classes[re->classCount].first = re->rangeCount;
+    re->classes[re->classCount].count = list->count;
+    re->rangeCount += list->count;
+    return (int32_t)re->classCount++;
+}
+
+// ============================================================================
+// Syntax Tree
+// ============================================================================
+typedef enum NodeType {
+    NODE_EMPTY,
+    NODE_CHAR,      // 'ch'
+    NODE_ANY,       // .
+    NODE_CLASS,     // Class 'index'
+    NODE_ASSERT,    // Zero-width OP_* in 'index'
+    NODE_CONCAT,    // left then right
+    NODE_ALT,       // left or right
+    NODE_REPEAT,    // left {min,max}, max < 0 = unbounded
+    NODE_GROUP      // left, captured as group 'index' (-1 = not captured)
+} NodeType;
+
+typedef struct Node {
+    uint8_t type;
+    bool greedy;
+    uint16_t ch;
+    int32_t left, right;
+    int32_t min, max;
+    int32_t index;
+} Node;
+
+typedef struct Parser {
+    Regex *re;
+    const uint16_t *pattern;
+    size_t length;
+    size_t pos;
+    Node *nodes;
+    size_t nodeCount, nodeCapacity;
+    int depth;              // Current group nesting
+    RegexError error;
+} Parser;
+
+static int32_t NewNode(Parser *p, NodeType type, int32_t left, int32_t right) {
+    if (!Reserve((void **)&p->nodes, &p->nodeCapacity, p->nodeCount + 1, sizeof(Node))) {
+        p->error = REGEX_ERROR_MEMORY;
+        return NO_NODE;
+    }
+    Node *node = &p->nodes[p->nodeCount];
+    memset(node, 0, sizeof(*node));
+    node->type = (uint8_t)type;
+    node->left = left;
+    node->right = right;
+    node->index = -1;
+    node->greedy = true;
+    return (int32_t)p->nodeCount++;
+}
+
+static int32_t Fail(Parser *p, RegexError error) {
+    if (p->error == REGEX_OK) p->error = error;
+    return NO_NODE;
+}
+
+static int HexValue(uint16_t ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Result of parsing a backslash escape
+typedef enum EscapeKind {
+    ESCAPE_UNIT,        // A single code unit in 'unit'
+    ESCAPE_SHORTHAND,   // \d \D \w \W \s \S, letter in 'unit'
+    ESCAPE_ASSERT       // \b \B, opcode in 'unit'
+} EscapeKind;
+
+// Parses the escape after a backslash. Inside a class \b means backspace.
+static bool ParseEscape(Parser *p, bool inClass, EscapeKind *kind, uint16_t *unit) {
+    if (p->pos >= p->length) return false;  // Trailing backslash
+    uint16_t ch = p->pattern[p->pos++];
+    *kind = ESCAPE_UNIT;
+    switch (ch) {
+    case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+        *kind = ESCAPE_SHORTHAND;
+        *unit = ch;
+        return true;
+    case 'b':
+        if (inClass) {
+            *unit = 0x08;
+        } else {
+            *kind = ESCAPE_ASSERT;
+            *unit = OP_WORDB;
+        }
+        return true;
+    case 'B':
+        if (inClass) return false;
+        *kind = ESCAPE_ASSERT;
+        *unit = OP_NWORDB;
+        return true;
+    case 't': *unit = '\t'; return true;
+    case 'n': *unit = '\n'; return true;
+    case 'r': *unit = '\r'; return true;
+    case 'f': *unit = 0x0C; return true;
+    case 'v': *unit = 0x0B; return true;
+    case '0': *unit = 0; return true;
+    case 'x':
+    case 'u': {
+        size_t digits = ch == 'x' ? 2 : 4;
+        uint32_t value = 0;
+        if (p->pos + digits > p->length) return false;
+        for (size_t i = 0; i < digits; ++i) {
+            int v = HexValue(p->pattern[p->pos + i]);
+            if (v < 0) return false;
+            value = value * 16 + (uint32_t)v;
+        }
+        p->pos += digits;
+        *unit = (uint16_t)value;
+        return true;
+    }
+    default:
+        // Any other escaped unit stands for itself (\. \\ \( ...)
+        *unit = ch;
+        return true;
+    }
+}
+
+static bool AddShorthand(RangeList *list, uint16_t letter) {
+    bool negate = letter == 'D' || letter == 'W' || letter == 'S';
+    switch (letter) {
+    case 'd': case 'D': return RangeListAddTable(list, kDigitRanges, COUNT_OF(kDigitRanges), negate);
+    case 'w': case 'W': return RangeListAddTable(list, kWordRanges, COUNT_OF(kWordRanges), negate);
+    default:            return RangeListAddTable(list, kSpaceRanges, COUNT_OF(kSpaceRanges), negate);
+    }
+}
+
+// Finishes a class: folds case if needed and stores it as a NODE_CLASS
+static int32_t FinishClass(Parser *p, RangeList *list, bool negate) {
+    int32_t index = -1;
+    if (!(p->re->flags & REGEX_ICASE) || RangeListAddFolds(list)) {
+        index = AddClass(p->re, list, negate);
+    }
+    free(list->items);
+    if (index < 0) return Fail(p, REGEX_ERROR_MEMORY);
+    int32_t node = NewNode(p, NODE_CLASS, NO_NODE, NO_NODE);
+    if (node != NO_NODE) p->nodes[node].index = index;
+    return node;
+}
+
+// Parses "[...]" after the opening bracket
+static int32_t ParseClass(Parser *p) {
+    RangeList list = {0};
+    bool negate = false;
+    if (p->pos < p->length && p->pattern[p->pos] == '^') {
+        negate = true;
+        p->pos++;
+    }
+    bool first = true;
+    for (;;) {
+        if (p->pos >= p->length) {
+            free(list.items);
+            return Fail(p, REGEX_ERROR_SYNTAX);  // Unterminated class
+        }
+        uint16_t ch = p->pattern[p->pos++];
+        if (ch == ']' && !first) break;
+        first = false;
+
+        uint16_t lo = ch;
+        if (ch == '\\') {
+            EscapeKind kind;
+            if (!ParseEscape(p, true, &kind, &lo)) {
+                free(list.items);
+                return Fail(p, REGEX_ERROR_SYNTAX);
+            }
+            if (kind == ESCAPE_SHORTHAND) {
+                if (!AddShorthand(&list, lo)) {
+                    free(list.items);
+                    return Fail(p, REGEX_ERROR_MEMORY);
+                }
+                continue;
+            }
+        }
+
+        uint16_t hi = lo;
+        if (p->pos + 1 < p->length && p->pattern[p->pos] == '-' && p->pattern[p->pos + 1] != ']') {
+            p->pos++;
+            hi = p->pattern[p->pos++];
+            if (hi == '\\') {
+                EscapeKind kind;
+                if (!ParseEscape(p, true, &kind, &hi) || kind != ESCAPE_UNIT) {
+                    free(list.items);
+                    return Fail(p, REGEX_ERROR_SYNTAX);
+                }
+            }
+            if (hi < lo) {
+                free(list.items);
+                return Fail(p, REGEX_ERROR_SYNTAX);  // Reversed range
+            }
+        }
+        if (!RangeListAdd(&list, lo, hi)) {
+            free(list.items);
+            return Fail(p, REGEX_ERROR_MEMORY);
+        }
+    }
+    return FinishClass(p, &list, negate);
+}
+
+static int32_t ParseAlternation(Parser *p);
+
+static int32_t ParseAtom(Parser *p) {
+    uint16_t ch = p->pattern[p->pos++];
+    switch (ch) {
+    case '(': {
+        int32_t capture = -1;
+        if (p->pos + 1 < p->length && p->pattern[p->pos] == '?' && p->pattern[p->pos + 1] == ':') {
+            p->pos += 2;
+        } else if (p->re->groupCount < REGEX_MAX_GROUPS) {
+            capture = (int32_t)p->re->groupCount++;
+        }
+        if (++p->depth > REGEX_MAX_NESTING) return Fail(p, REGEX_ERROR_TOO_BIG);
+        int32_t inner = ParseAlternation(p);
+        p->depth--;
+        if (inner == NO_NODE) return NO_NODE;
+        if (p->pos >= p->length || p->pattern[p->pos] != ')') return Fail(p, REGEX_ERROR_SYNTAX);
+        p->pos++;
+        int32_t node = NewNode(p, NODE_GROUP, inner, NO_NODE);
+        if (node != NO_NODE) p->nodes[node].index = capture;
+        return node;
+    }
+    case '[':
+        return ParseClass(p);
+    case '.':
+        return NewNode(p, NODE_ANY, NO_NODE, NO_NODE);
+    case '^':
+    case '$': {
+        int32_t node = NewNode(p, NODE_ASSERT, NO_NODE, NO_NODE);
+        if (node != NO_NODE) p->nodes[node].index = ch == '^' ? OP_BOL : OP_EOL;
+        return node;
+    }
+    case '*': case '+': case '?':
+        return Fail(p, REGEX_ERROR_SYNTAX);  // Nothing to repeat
+    case '\\': {
+        EscapeKind kind;
+        uint16_t unit;
+        if (!ParseEscape(p, false, &kind, &unit)) return Fail(p, REGEX_ERROR_SYNTAX);
+        if (kind == ESCAPE_SHORTHAND) {
+            RangeList list = {0};
+            if (!AddShorthand(&list, unit)) {
+                free(list.items);
+                return Fail(p, REGEX_ERROR_MEMORY);
+            }
+            return FinishClass(p, &list, false);
+        }
+        int32_t node = NewNode(p, kind == ESCAPE_ASSERT ? NODE_ASSERT : NODE_CHAR, NO_NODE, NO_NODE);
+        if (node == NO_NODE) return NO_NODE;
+        if (kind == ESCAPE_ASSERT) {
+            p->nodes[node].index = unit;
+        } else {
+            p->nodes[node].ch = unit;
+        }
+        return node;
+    }
+    default: {
+        int32_t node = NewNode(p, NODE_CHAR, NO_NODE, NO_NODE);
+        if (node != NO_NODE) p->nodes[node].ch = ch;
+        return node;
+    }
+    }
+}
+
+static bool ParseNumber(Parser *p, int32_t *value) {
+    size_t begin = p->pos;
+    int32_t result = 0;
+    while (p->pos < p->length && p->pattern[p->pos] >= '0' && p->pattern[p->pos] <= '9') {
+        if (result <= REGEX_MAX_REPEAT) result = result * 10 + (p->pattern[p->pos] - '0');
+        p->pos++;
+    }
+    *value = result;
+    return p->pos > begin;
+}
+
+// Parses "{n}", "{n,}" or "{n,m}". Anything else leaves '{' as a literal.
+static bool ParseCount(Parser *p, int32_t *min, int32_t *max) {
+    size_t begin = p->pos;
+    p->pos++;  // '{'
+    if (!ParseNumber(p, min)) goto literal;
+    *max = *min;
+    if (p->pos < p->length && p->pattern[p->pos] == ',') {
+        p->pos++;
+        if (!ParseNumber(p, max)) *max = -1;
+    }
+    if (p->pos >= p->length || p->pattern[p->pos] != '}') goto literal;
+    p->pos++;
+    return true;
+literal:
+    p->pos = begin;
+    return false;
+}
+
+static int32_t ParseRepeat(Parser *p) {
+    int32_t node = ParseAtom(p);
+    while (node != NO_NODE && p->pos < p->length) {
+        uint16_t ch = p->pattern[p->pos];
+        int32_t min, max;
+        if (ch == '*') {
+            min = 0; max = -1; p->pos++;
+        } else if (ch == '+') {
+            min = 1; max = -1; p->pos++;
+        } else if (ch == '?') {
+            min = 0; max = 1; p->pos++;
+        } else if (ch != '{' || !ParseCount(p, &min, &max)) {
+            break;
+        }
+        if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT) return Fail(p, REGEX_ERROR_TOO_BIG);
+        if (max >= 0 && min > max) return Fail(p, REGEX_ERROR_SYNTAX);
+
+        int32_t repeat = NewNode(p, NODE_REPEAT, node, NO_NODE);
+        if (repeat == NO_NODE) return NO_NODE;
+        p->nodes[repeat].min = min;
+        p->nodes[repeat].max = max;
+        if (p->pos < p->length && p->pattern[p->pos] == '?') {
+            p->nodes[repeat].greedy = false;
+            p->pos++;
+        }
+        node = repeat;
+    }
+    return node;
+}
+
+static int32_t ParseConcat(Parser *p) {
+    int32_t result = NO_NODE;
+    while (p->pos < p->length && p->pattern[p->pos] != '|' && p->pattern[p->pos] != ')') {
+        int32_t item = ParseRepeat(p);
+        if (item == NO_NODE) return NO_NODE;
+        result = result == NO_NODE ? item : NewNode(p, NODE_CONCAT, result, item);
+        if (result == NO_NODE) return NO_NODE;
+    }
+    return result == NO_NODE ? NewNode(p, NODE_EMPTY, NO_NODE, NO_NODE) : result;
+}
+
+static int32_t ParseAlternation(Parser *p) {
+    int32_t left = ParseConcat(p);
+    while (left != NO_NODE && p->pos < p->length && p->pattern[p->pos] == '|') {
+        p->pos++;
+        int32_t right = ParseConcat(p);
+        if (right == NO_NODE) return NO_NODE;
+        left = NewNode(p, NODE_ALT, left, right);
+    }
+    return left;
+}
+
+// ============================================================================
+// Literal Prefix
+// ============================================================================
+// Walks the leftmost path of the tree and collects the code units that every
+// match must begin with. Stops at the first node that is not a fixed literal.
+// ============================================================================
+static void CollectPrefix(Regex *re, const Node *nodes, int32_t index, bool *stop) {
+    const Node *node = &nodes[index];
+    switch (node->type) {
+    case NODE_EMPTY:
+    case NODE_ASSERT:
+        break;  // Zero width
+    case NODE_CHAR:
+        if (re->prefixLength == REGEX_PREFIX_MAX) {
+            *stop = true;
+        } else {
+            re->prefix[re->prefixLength++] = (re->flags & REGEX_ICASE) ? FoldCase(node->ch) : node->ch;
+        }
+        break;
+    case NODE_CONCAT:
+        CollectPrefix(re, nodes, node->left, stop);
+        if (!*stop) CollectPrefix(re, nodes, node->right, stop);
+        break;
+    case NODE_GROUP:
+        CollectPrefix(re, nodes, node->left, stop);
+        break;
+    case NODE_REPEAT:
+        // The first repetition is required; what follows it is not fixed
+        if (node->min > 0) CollectPrefix(re, nodes, node->left, stop);
+        *stop = true;
+        break;
+    default:
+        *stop = true;
+        break;
+    }
+}
+
+// ============================================================================
+// Code Emission
+// ============================================================================
+static bool Emit(Regex *re, Opcode op, uint16_t ch, uint32_t x, uint32_t y, RegexError *error) {
+    if (re->programLength >= REGEX_MAX_PROGRAM) {
+        *error = REGEX_ERROR_TOO_BIG;
+        return false;
+    }
+    if (!Reserve((void **)&re->program, &re->programCapacity, re->programLength + 1, sizeof(Inst))) {
+        *error = REGEX_ERROR_MEMORY;
+        return false;
+    }
+    Inst *inst = &re->program[re->programLength++];
+    inst->op = (uint8_t)op;
+    inst->ch = ch;
+    inst->x = x;
+    inst->y = y;
+    return true;
+}
+
+// Emits a SPLIT whose preferred branch is the next instruction when greedy.
+// The other branch is patched later through SetSplitExit.
+static bool EmitSplit(Regex *re, bool greedy, RegexError *error) {
+    uint32_t next = (uint32_t)re->programLength + 1;
+    return Emit(re, OP_SPLIT, 0, greedy ? next : 0, greedy ? 0 : next, error);
+}
+
+static void SetSplitExit(Regex *re, size_t split, bool greedy, uint32_t target) {
+    if (greedy) {
+        re->program[split].y = target;
+    } else {
+        re->program[split].x = target;
+    }
+}
+
+static bool EmitNode(Regex *re, const Node *nodes, int32_t index, RegexError *error) {
+    const Node *node = &nodes[index];
+    switch (node->type) {
+    case NODE_EMPTY:
+        return true;
+    case NODE_CHAR: {
+        uint16_t other = OtherCase(node->ch);
+        if (!(re->flags & REGEX_ICASE) || other == node->ch) {
+            return Emit(re, OP_CHAR, node->ch, 0, 0, error);
+        }
+        RangeList list = {0};
+        int32_t cls = -1;
+        if (RangeListAdd(&list, node->ch, node->ch) && RangeListAdd(&list, other, other)) {
+            cls = AddClass(re, &list, false);
+        }
+        free(list.items);
+        if (cls < 0) {
+            *error = REGEX_ERROR_MEMORY;
+            return false;
+        }
+        return Emit(re, OP_CLASS, 0, (uint32_t)cls, 0, error);
+    }
+    case NODE_ANY:
+        return Emit(re, OP_ANY, 0, 0, 0, error);
+    case NODE_CLASS:
+        return Emit(re, OP_CLASS, 0, (uint32_t)node->index, 0, error);
+    case NODE_ASSERT:
+        return Emit(re, (Opcode)node->index, 0, 0, 0, error);
+    case NODE_CONCAT:
+        return EmitNode(re, nodes, node->left, error) && EmitNode(re, nodes, node->right, error);
+    case NODE_ALT: {
+        //   SPLIT L1, L2
+        //   L1: left; JMP end
+        //   L2: right
+        size_t split = re->programLength;
+        if (!EmitSplit(re, true, error) || !EmitNode(re, nodes, node->left, error)) return false;
+        size_t jump = re->programLength;
+        if (!Emit(re, OP_JMP, 0, 0, 0, error)) return false;
+        SetSplitExit(re, split, true, (uint32_t)re->programLength);
+        if (!EmitNode(re, nodes, node->right, error)) return false;
+        re->program[jump].x = (uint32_t)re->programLength;
+        return true;
+    }
+    case NODE_GROUP:
+        if (node->index < 0) return EmitNode(re, nodes, node->left, error);
+        return Emit(re, OP_SAVE, 0, (uint32_t)node->index * 2, 0, error) &&
+               EmitNode(re, nodes, node->left, error) &&
+               Emit(re, OP_SAVE, 0, (uint32_t)node->index * 2 + 1, 0, error);
+    case NODE_REPEAT: {
+        int32_t required = node->min;
+        if (node->max < 0 && required > 0) required--;  // Last copy doubles as the loop body
+        for (int32_t i = 0; i < required; ++i) {
+            if (!EmitNode(re, nodes, node->left, error)) return false;
+        }
+        if (node->max < 0 && node->min > 0) {
+            // L: body; SPLIT L, next
+            uint32_t loop = (uint32_t)re->programLength;
+            if (!EmitNode(re, nodes, node->left, error)) return false;
+            uint32_t next = (uint32_t)re->programLength + 1;
+            return Emit(re, OP_SPLIT, 0, node->greedy ? loop : next, node->greedy ? next : loop, error);
+        }
+        if (node->max < 0) {
+            // L: SPLIT body, end; body; JMP L
+            size_t split = re->programLength;
+            if (!EmitSplit(re, node->greedy, error) || !EmitNode(re, nodes, node->left, error)) return false;
+            if (!Emit(re, OP_JMP, 0, (uint32_t)split, 0, error)) return false;
+            SetSplitExit(re, split, node->greedy, (uint32_t)re->programLength);
+            return true;
+        }
+        // Optional copies: SPLIT body, end; body; SPLIT body, end; body; ... end:
+        int32_t optional = node->max - node->min;
+        size_t *splits = optional ? (size_t *)malloc((size_t)optional * sizeof(size_t)) : NULL;
+        if (optional && !splits) {
+            *error = REGEX_ERROR_MEMORY;
+            return false;
+        }
+        for (int32_t i = 0; i < optional; ++i) {
+            splits[i] = re->programLength;
+            if (!EmitSplit(re, node->greedy, error) || !EmitNode(re, nodes, node->left, error)) {
+                free(splits);
+                return false;
+            }
+        }
+        for (int32_t i = 0; i < optional; ++i) {
+            SetSplitExit(re, splits[i], node->greedy, (uint32_t)re->programLength);
+        }
+        free(splits);
+        return true;
+    }
+    }
+    return true;
+}
+
+// ============================================================================
+// Matching Helpers
+// ============================================================================
+static bool InClass(const Regex *re, uint32_t cls, uint16_t ch) {
+    const CharClass *c = &re->classes[cls];
+    return InRanges(re->ranges + c->first, c->count, ch);
+}
+
+static bool Consumes(const Regex *re, const Inst *inst, int32_t ch) {
+    if (ch == END_OF_TEXT) return false;
+    switch (inst->op) {
+    case OP_CHAR:  return inst->ch == (uint16_t)ch;
+    case OP_ANY:   return ch != '\n' && ch != '\r';
+    case OP_CLASS: return InClass(re, inst->x, (uint16_t)ch);
+    default:       return false;
+    }
+}
+
+// Evaluates a zero-width assertion between 'before' and the lookahead unit.
+// A CR LF pair is one line break: there is no line start or end inside it.
+static bool AssertionHolds(uint8_t op, Context before, int32_t next) {
+    switch (op) {
+    case OP_BOL:
+        return before == CTX_START || before == CTX_LF || (before == CTX_CR && next != '\n');
+    case OP_EOL:
+        return next == END_OF_TEXT || next == '\r' || (next == '\n' && before != CTX_CR);
+    default: {
+        bool wordBefore = before == CTX_WORD;
+        bool wordAfter = next != END_OF_TEXT && IsWordUnit((uint16_t)next);
+        return (op == OP_WORDB) == (wordBefore != wordAfter);
+    }
+    }
+}
+
+static bool IsAssertion(uint8_t op) {
+    return op == OP_BOL || op == OP_EOL || op == OP_WORDB || op == OP_NWORDB;
+}
+
+static uint32_t NextGeneration(uint32_t *generation, uint32_t *marks, size_t count) {
+    if (++*generation == 0) {
+        memset(marks, 0, count * sizeof(uint32_t));
+        *generation = 1;
+    }
+    return *generation;
+}
+
+// ============================================================================
+// Pike VM
+// ============================================================================
+// Follows the epsilon closure of 'pc' at 'pos' in priority order and appends
+// the consuming and MATCH instructions reached to 'list' with their captures.
+// SAVE updates 'caps' in place and restores it on the way back out.
+// ============================================================================
+static void AddThread(Regex *re, ThreadList *list, uint32_t pc0, size_t *caps,
+                      const uint16_t *text, size_t length, size_t pos) {
+    size_t slotCount = re->groupCount * 2;
+    Context before = ContextAt(text, pos);
+    int32_t next = pos < length ? text[pos] : END_OF_TEXT;
+    size_t top = 0;
+    re->stack[top].pc = pc0;
+    re->stack[top].slot = UINT32_MAX;
+    top++;
+    while (top) {
+        StackEntry entry = re->stack[--top];
+        if (entry.slot != UINT32_MAX) {
+            caps[entry.slot] = entry.value;
+            continue;
+        }
+        uint32_t pc = entry.pc;
+        if (list->mark[pc] == list->generation) continue;
+        list->mark[pc] = list->generation;
+        const Inst *inst = &re->program[pc];
+        switch (inst->op) {
+        case OP_JMP:
+            re->stack[top].pc = inst->x;
+            re->stack[top++].slot = UINT32_MAX;
+            break;
+        case OP_SPLIT:
+            re->stack[top].pc = inst->y;
+            re->stack[top++].slot = UINT32_MAX;
+            re->stack[top].pc = inst->x;
+            re->stack[top++].slot = UINT32_MAX;
+            break;
+        case OP_SAVE:
+            re->stack[top].slot = inst->x;
+            re->stack[top++].value = caps[inst->x];
+            caps[inst->x] = pos;
+            re->stack[top].pc = pc + 1;
+            re->stack[top++].slot = UINT32_MAX;
+            break;
+        case OP_BOL: case OP_EOL: case OP_WORDB: case OP_NWORDB:
+            if (AssertionHolds(inst->op, before, next)) {
+                re->stack[top].pc = pc + 1;
+                re->stack[top++].slot = UINT32_MAX;
+            }
+            break;
+        default:
+            list->pcs[list->count] = pc;
+            memcpy(list->caps + list->count * slotCount, caps, slotCount * sizeof(size_t));
+            list->count++;
+            break;
+        }
+    }
+}
+
+static void ClearList(Regex *re, ThreadList *list) {
+    list->count = 0;
+    NextGeneration(&list->generation, list->mark, re->programLength);
+}
+
+// Leftmost-first search from 'from' to the end of the text
+static bool PikeSearch(Regex *re, const uint16_t *text, size_t length, size_t from, RegexMatch *match) {
+    size_t slotCount = re->groupCount * 2;
+    ThreadList *current = &re->lists[0];
+    ThreadList *next = &re->lists[1];
+    size_t *best = re->slotBuffer + slotCount;
+    bool matched = false;
+    ClearList(re, current);
+
+    for (size_t pos = from;; ++pos) {
+        if (!matched) {
+            // New threads start with the lowest priority
+            for (size_t i = 0; i < slotCount; ++i) re->slotBuffer[i] = REGEX_NO_GROUP;
+            AddThread(re, current, 0, re->slotBuffer, text, length, pos);
+        }
+        if (current->count == 0) break;
+
+        int32_t ch = pos < length ? text[pos] : END_OF_TEXT;
+        ClearList(re, next);
+        for (size_t t = 0; t < current->count; ++t) {
+            const Inst *inst = &re->program[current->pcs[t]];
+            size_t *caps = current->caps + t * slotCount;
+            if (inst->op == OP_MATCH) {
+                // Threads after this one have lower priority: drop them
+                memcpy(best, caps, slotCount * sizeof(size_t));
+                matched = true;
+                break;
+            }
+            if (Consumes(re, inst, ch)) {
+                AddThread(re, next, current->pcs[t] + 1, caps, text, length, pos + 1);
+            }
+        }
+        ThreadList *swap = current;
+        current = next;
+        next = swap;
+        if (pos >= length) break;
+    }
+
+    if (!matched) return false;
+    for (size_t g = 0; g < REGEX_MAX_GROUPS; ++g) {
+        bool set = g < re->groupCount && best[g * 2] != REGEX_NO_GROUP && best[g * 2 + 1] != REGEX_NO_GROUP;
+        match->start[g] = set ? best[g * 2] : REGEX_NO_GROUP;
+        match->end[g] = set ? best[g * 2 + 1] : REGEX_NO_GROUP;
+    }
+    return true;
+}
+
+// ============================================================================
+// Lazy DFA
+// ============================================================================
+static uint32_t HashSet(const uint32_t *set, size_t count, uint8_t context) {
+    uint32_t hash = 2166136261u ^ context;
+    for (size_t i = 0; i < count; ++i) {
+        hash = (hash ^ set[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool DfaRehash(Regex *re, size_t capacity) {
+    Dfa *dfa = &re->dfa;
+    int32_t *hash = (int32_t *)malloc(capacity * sizeof(int32_t));
+    if (!hash) return false;
+    memset(hash, 0xFF, capacity * sizeof(int32_t));
+    for (size_t s = 0; s < dfa->stateCount; ++s) {
+        const DfaState *state = &dfa->states[s];
+        size_t slot = HashSet(dfa->pool + state->setStart, state->setCount, state->context) & (capacity - 1);
+        while (hash[slot] >= 0) slot = (slot + 1) & (capacity - 1);
+        hash[slot] = (int32_t)s;
+    }
+    free(dfa->hash);
+    dfa->hash = hash;
+    dfa->hashCapacity = capacity;
+    return true;
+}
+
+// Drops every cached state (allocations are kept for reuse)
+static void DfaFlush(Regex *re) {
+    Dfa *dfa = &re->dfa;
+    dfa->stateCount = 0;
+    dfa->poolLength = 0;
+    if (dfa->hash) memset(dfa->hash, 0xFF, dfa->hashCapacity * sizeof(int32_t));
+}
+
+// Finds or adds the state for (set, context). Returns DFA_FULL when the
+// cache would exceed REGEX_DFA_MEMORY, or on allocation failure.
+static int32_t DfaIntern(Regex *re, const uint32_t *set, size_t count, uint8_t context) {
+    Dfa *dfa = &re->dfa;
+    uint32_t hash = HashSet(set, count, context);
+    if (dfa->hashCapacity) {
+        size_t slot = hash & (dfa->hashCapacity - 1);
+        while (dfa->hash[slot] >= 0) {
+            const DfaState *state = &dfa->states[dfa->hash[slot]];
+            if (state->context == context && state->setCount == count &&
+                (count == 0 || memcmp(dfa->pool + state->setStart, set, count * sizeof(uint32_t)) == 0)) {
+                return dfa->hash[slot];
+            }
+            slot = (slot + 1) & (dfa->hashCapacity - 1);
+        }
+    }
+
+    // New state: grow the tables, within the memory cap
+    size_t oldStates = dfa->stateCapacity;
+    if (dfa->stateCount + 1 > dfa->stateCapacity || dfa->poolLength + count > dfa->poolCapacity ||
+        (dfa->stateCount + 1) * 2 > dfa->hashCapacity) {
+        size_t states = dfa->stateCapacity, pool = dfa->poolCapacity, hashSlots = dfa->hashCapacity;
+        if (dfa->stateCount + 1 > states) states = states ? states * 2 : 64;
+        while (dfa->poolLength + count > pool) pool = pool ? pool * 2 : 256;
+        while ((dfa->stateCount + 1) * 2 > hashSlots) hashSlots = hashSlots ? hashSlots * 2 : 128;
+        size_t needed = states * (sizeof(DfaState) + re->alphabetSize * sizeof(int32_t)) +
+                        pool * sizeof(uint32_t) + hashSlots * sizeof(int32_t);
+        if (needed > REGEX_DFA_MEMORY && dfa->stateCount > 0) return DFA_FULL;
+
+        if (!Reserve((void **)&dfa->states, &dfa->stateCapacity, states, sizeof(DfaState))) return DFA_FULL;
+        if (dfa->stateCapacity != oldStates) {
+            // The transition table always has a row per state slot
+            int32_t *grown = (int32_t *)realloc(dfa->transitions,
+                                                dfa->stateCapacity * re->alphabetSize * sizeof(int32_t));
+            if (!grown) {
+                dfa->stateCapacity = oldStates;
+                return DFA_FULL;
+            }
+            dfa->transitions = grown;
+        }
+        if (!Reserve((void **)&dfa->pool, &dfa->poolCapacity, pool, sizeof(uint32_t))) return DFA_FULL;
+        if (hashSlots != dfa->hashCapacity && !DfaRehash(re, hashSlots)) return DFA_FULL;
+    }
+
+    size_t index = dfa->stateCount++;
+    DfaState *state = &dfa->states[index];
+    state->setStart = (uint32_t)dfa->poolLength;
+    state->setCount = (uint32_t)count;
+    state->context = context;
+    state->endMatch = -1;
+    if (count) memcpy(dfa->pool + dfa->poolLength, set, count * sizeof(uint32_t));
+    dfa->poolLength += count;
+    int32_t *row = dfa->transitions + index * re->alphabetSize;
+    for (size_t c = 0; c < re->alphabetSize; ++c) row[c] = DFA_UNKNOWN;
+
+    size_t slot = hash & (dfa->hashCapacity - 1);
+    while (dfa->hash[slot] >= 0) slot = (slot + 1) & (dfa->hashCapacity - 1);
+    dfa->hash[slot] = (int32_t)index;
+    return (int32_t)index;
+}
+
+static int CompareUint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Follows the closure of a state's threads plus a new thread at the start of
+// the program, with 'next' as the lookahead. Returns whether MATCH is reached
+// and, if 'out' is set, the sorted set of threads after consuming 'next'.
+static bool DfaClosure(Regex *re, const DfaState *state, int32_t next, uint32_t *out, size_t *outCount) {
+    uint32_t generation = NextGeneration(&re->closureGeneration, re->closureMark, re->programLength);
+    const uint32_t *set = re->dfa.pool + state->setStart;
+    Context before = (Context)state->context;
+    bool matched = false;
+    size_t count = 0;
+    size_t top = 0;
+    re->stack[top++].pc = 0;
+    for (size_t i = state->setCount; i > 0; --i) re->stack[top++].pc = set[i - 1];
+
+    while (top) {
+        uint32_t pc = re->stack[--top].pc;
+        if (re->closureMark[pc] == generation) continue;
+        re->closureMark[pc] = generation;
+        const Inst *inst = &re->program[pc];
+        switch (inst->op) {
+        case OP_JMP:
+            re->stack[top++].pc = inst->x;
+            break;
+        case OP_SPLIT:
+            re->stack[top++].pc = inst->y;
+            re->stack[top++].pc = inst->x;
+            break;
+        case OP_SAVE:
+            re->stack[top++].pc = pc + 1;
+            break;
+        case OP_MATCH:
+            matched = true;
+            break;
+        default:
+            if (IsAssertion(inst->op)) {
+                if (AssertionHolds(inst->op, before, next)) re->stack[top++].pc = pc + 1;
+            } else if (out && Consumes(re, inst, next)) {
+                out[count++] = pc + 1;
+            }
+            break;
+        }
+    }
+    if (out) {
+        if (count > 1) qsort(out, count, sizeof(uint32_t), CompareUint32);
+        *outCount = count;
+    }
+    return matched;
+}
+
+// Computes and caches one transition: (target << 1) | matchBefore, or DFA_FULL
+static int32_t DfaTransition(Regex *re, int32_t stateIndex, size_t cls) {
+    uint16_t ch = re->classRep[cls];
+    size_t count = 0;
+    bool matched = DfaClosure(re, &re->dfa.states[stateIndex], ch, re->setBuffer, &count);
+    int32_t target = DfaIntern(re, re->setBuffer, count, (uint8_t)ContextOf(ch));
+    if (target < 0) return DFA_FULL;
+    int32_t value = (target << 1) | (matched ? 1 : 0);
+    re->dfa.transitions[(size_t)stateIndex * re->alphabetSize + cls] = value;
+    return value;
+}
+
+static bool DfaEndMatch(Regex *re, int32_t stateIndex) {
+    DfaState *state = &re->dfa.states[stateIndex];
+    if (state->endMatch < 0) {
+        state->endMatch = DfaClosure(re, state, END_OF_TEXT, NULL, NULL) ? 1 : 0;
+    }
+    return state->endMatch != 0;
+}
+
+// Next position at or after 'pos' where the literal prefix occurs
+static size_t FindPrefix(const Regex *re, const uint16_t *text, size_t length, size_t pos) {
+    size_t n = re->prefixLength;
+    if (length < n) return REGEX_NO_GROUP;
+    uint16_t first = re->prefix[0];
+    bool icase = (re->flags & REGEX_ICASE) != 0;
+    uint16_t firstOther = icase ? OtherCase(first) : first;
+    size_t last = length - n;
+    for (size_t i = pos; i <= last; ++i) {
+        if (text[i] != first && text[i] != firstOther) continue;
+        size_t k = 1;
+        if (icase) {
+            while (k < n && FoldCase(text[i + k]) == re->prefix[k]) k++;
+        } else {
+            while (k < n && text[i + k] == re->prefix[k]) k++;
+        }
+        if (k == n) return i;
+    }
+    return REGEX_NO_GROUP;
+}
+
+typedef enum ScanResult {
+    SCAN_NO_MATCH,
+    SCAN_MATCH,         // A match ends somewhere; it starts at or after *resetOut
+    SCAN_GAVE_UP        // Cache thrashing: the VM takes over from *resetOut
+} ScanResult;
+
+// Re-adds a state after a flush. Its set is copied out of the pool first.
+static int32_t DfaReintern(Regex *re, int32_t stateIndex) {
+    const DfaState *state = &re->dfa.states[stateIndex];
+    size_t count = state->setCount;
+    uint8_t context = state->context;
+    memcpy(re->setBuffer, re->dfa.pool + state->setStart, count * sizeof(uint32_t));
+    DfaFlush(re);
+    return DfaIntern(re, re->setBuffer, count, context);
+}
+
+// Matches must start before 'startLimit'; once no match is in progress past
+// it, the scan stops.
+static ScanResult DfaScan(Regex *re, const uint16_t *text, size_t length, size_t start, size_t startLimit,
+                          size_t *resetOut) {
+    size_t pos = start;
+    size_t lastReset = start;
+    size_t lastFlush = start;
+    int flushes = 0;
+    int32_t state = DfaIntern(re, NULL, 0, (uint8_t)ContextAt(text, pos));
+    if (state < 0) {
+        DfaFlush(re);
+        state = DfaIntern(re, NULL, 0, (uint8_t)ContextAt(text, pos));
+        if (state < 0) {
+            *resetOut = start;
+            return SCAN_GAVE_UP;
+        }
+    }
+
+    for (;;) {
+        if (re->dfa.states[state].setCount == 0) {
+            // No match in progress: none can start before here
+            lastReset = pos;
+            if (pos >= startLimit) return SCAN_NO_MATCH;
+            if (re->prefixLength) {
+                size_t found = FindPrefix(re, text, length, pos);
+                if (found == REGEX_NO_GROUP || found >= startLimit) return SCAN_NO_MATCH;
+                if (found != pos) {
+                    pos = found;
+                    lastReset = pos;
+                    state = DfaIntern(re, NULL, 0, (uint8_t)ContextAt(text, pos));
+                    if (state < 0) {
+                        DfaFlush(re);
+                        state = DfaIntern(re, NULL, 0, (uint8_t)ContextAt(text, pos));
+                        if (state < 0) break;
+                    }
+                }
+            }
+        }
+        if (pos >= length) {
+            if (!DfaEndMatch(re, state)) return SCAN_NO_MATCH;
+            *resetOut = lastReset;
+            return SCAN_MATCH;
+        }
+
+        size_t cls = re->classMap[text[pos]];
+        int32_t value = re->dfa.transitions[(size_t)state * re->alphabetSize + cls];
+        if (value < 0) {
+            value = DfaTransition(re, state, cls);
+            if (value == DFA_FULL) {
+                // Give up when flushes come faster than the cache pays off
+                size_t statesBefore = re->dfa.stateCount;
+                if (++flushes > 2 && pos - lastFlush < 10 * statesBefore) break;
+                lastFlush = pos;
+                state = DfaReintern(re, state);
+                if (state < 0) break;
+                continue;
+            }
+        }
+        if (value & 1) {
+            *resetOut = lastReset;
+            return SCAN_MATCH;
+        }
+        state = value >> 1;
+        pos++;
+    }
+    *resetOut = lastReset;
+    return SCAN_GAVE_UP;
+}
+
+// ============================================================================
+// BuildAlphabet - Group Code Units into Equivalence Classes
+// ============================================================================
+// Class boundaries fall on every edge used by the program, plus line breaks
+// and word units so that a class also determines the context it leaves.
+// ============================================================================
+static bool BuildAlphabet(Regex *re) {
+    uint8_t *edge = (uint8_t *)calloc(0x10001, 1);
+    re->classMap = (uint16_t *)malloc(0x10000 * sizeof(uint16_t));
+    if (!edge || !re->classMap) {
+        free(edge);
+        return false;
+    }
+    edge[0] = 1;
+    edge['\n'] = edge['\n' + 1] = 1;
+    edge['\r'] = edge['\r' + 1] = 1;
+    for (size_t i = 0; i < COUNT_OF(kWordRanges); ++i) {
+        edge[kWordRanges[i].lo] = edge[(uint32_t)kWordRanges[i].hi + 1] = 1;
+    }
+    for (size_t i = 0; i < re->programLength; ++i) {
+        const Inst *inst = &re->program[i];
+        if (inst->op == OP_CHAR) {
+            edge[inst->ch] = edge[(uint32_t)inst->ch + 1] = 1;
+        } else if (inst->op == OP_CLASS) {
+            const CharClass *cls = &re->classes[inst->x];
+            for (size_t r = 0; r < cls->count; ++r) {
+                edge[re->ranges[cls->first + r].lo] = edge[(uint32_t)re->ranges[cls->first + r].hi + 1] = 1;
+            }
+        }
+    }
+
+    size_t classes = 0;
+    for (uint32_t ch = 0; ch <= 0xFFFF; ++ch) classes += edge[ch];
+    re->classRep = (uint16_t *)malloc(classes * sizeof(uint16_t));
+    if (!re->classRep) {
+        free(edge);
+        return false;
+    }
+    size_t id = 0;
+    for (uint32_t ch = 0; ch <= 0xFFFF; ++ch) {
+        if (edge[ch]) re->classRep[id++] = (uint16_t)ch;
+        re->classMap[ch] = (uint16_t)(id - 1);
+    }
+    re->alphabetSize = classes;
+    free(edge);
+    return true;
+}
+
+static bool AllocateScratch(Regex *re) {
+    size_t n = re->programLength;
+    size_t slots = re->groupCount * 2;
+    re->stack = (StackEntry *)malloc((3 * n + 2) * sizeof(StackEntry));
+    re->closureMark = (uint32_t *)calloc(n, sizeof(uint32_t));
+    re->setBuffer = (uint32_t *)malloc(n * sizeof(uint32_t));
+    re->slotBuffer = (size_t *)malloc(2 * slots * sizeof(size_t));
+    if (!re->stack || !re->closureMark || !re->setBuffer || !re->slotBuffer) return false;
+    for (int i = 0; i < 2; ++i) {
+        re->lists[i].pcs = (uint32_t *)malloc(n * sizeof(uint32_t));
+        re->lists[i].caps = (size_t *)malloc(n * slots * sizeof(size_t));
+        re->lists[i].mark = (uint32_t *)calloc(n, sizeof(uint32_t));
+        if (!re->lists[i].pcs || !re->lists[i].caps || !re->lists[i].mark) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// RegexCompile - Parse, Emit and Prepare a Pattern
+// ============================================================================
+RegexError RegexCompile(const uint16_t *pattern, size_t length, unsigned flags,
+                        Regex **regexOut, size_t *errorOffset) {
+    *regexOut = NULL;
+    if (errorOffset) *errorOffset = 0;
+    if (length > REGEX_MAX_PATTERN) return REGEX_ERROR_TOO_BIG;
+
+    Regex *re = (Regex *)calloc(1, sizeof(Regex));
+    if (!re) return REGEX_ERROR_MEMORY;
+    re->flags = flags;
+    re->groupCount = 1;  // Group 0 is the whole match
+
+    Parser parser = {0};
+    parser.re = re;
+    parser.pattern = pattern;
+    parser.length = length;
+    int32_t root = ParseAlternation(&parser);
+    if (root != NO_NODE && parser.pos < length) {
+        Fail(&parser, REGEX_ERROR_SYNTAX);  // Unbalanced ')'
+        root = NO_NODE;
+    }
+    if (root == NO_NODE) {
+        if (errorOffset) *errorOffset = parser.pos;
+        free(parser.nodes);
+        RegexFree(re);
+        return parser.error != REGEX_OK ? parser.error : REGEX_ERROR_SYNTAX;
+    }
+
+    bool stop = false;
+    CollectPrefix(re, parser.nodes, root, &stop);
+
+    // SAVE 0; body; SAVE 1; MATCH
+    RegexError error = REGEX_OK;
+    bool ok = Emit(re, OP_SAVE, 0, 0, 0, &error) &&
+              EmitNode(re, parser.nodes, root, &error) &&
+              Emit(re, OP_SAVE, 0, 1, 0, &error) &&
+              Emit(re, OP_MATCH, 0, 0, 0, &error);
+    free(parser.nodes);
+    if (ok && (!BuildAlphabet(re) || !AllocateScratch(re))) {
+        ok = false;
+        error = REGEX_ERROR_MEMORY;
+    }
+    if (!ok) {
+        RegexFree(re);
+        return error;
+    }
+    *regexOut = re;
+    return REGEX_OK;
+}
+
+// ============================================================================
+// RegexFree
+// ============================================================================
+void RegexFree(Regex *regex) {
+    if (!regex) return;
+    free(regex->program);
+    free(regex->ranges);
+    free(regex->classes);
+    free(regex->classMap);
+    free(regex->classRep);
+    free(regex->dfa.states);
+    free(regex->dfa.pool);
+    free(regex->dfa.transitions);
+    free(regex->dfa.hash);
+    free(regex->stack);
+    free(regex->closureMark);
+    free(regex->setBuffer);
+    free(regex->slotBuffer);
+    for (int i = 0; i < 2; ++i) {
+        free(regex->lists[i].pcs);
+        free(regex->lists[i].caps);
+        free(regex->lists[i].mark);
+    }
+    free(regex);
+}
+
+size_t RegexGroupCount(const Regex *regex) {
+    return regex->groupCount;
+}
+
+size_t RegexPrefix(const Regex *regex, const uint16_t **prefixOut) {
+    *prefixOut = regex->prefix;
+    return regex->prefixLength;
+}
+
+// ============================================================================
+// RegexSearch - Leftmost-First Match at or After a Position
+// ============================================================================
+bool RegexSearch(Regex *regex, const uint16_t *text, size_t length, size_t start, RegexMatch *match) {
+    return RegexSearchWithin(regex, text, length, start, length + 1, match);
+}
+
+bool RegexSearchWithin(Regex *regex, const uint16_t *text, size_t length, size_t start, size_t startLimit,
+                       RegexMatch *match) {
+    if (start > length || start >= startLimit) return false;
+    size_t from = start;
+    if (DfaScan(regex, text, length, start, startLimit, &from) == SCAN_NO_MATCH) return false;
+    return PikeSearch(regex, text, length, from, match) && match->start[0] < startLimit;
+}
+
+// ============================================================================
+// RegexExpand - Build the Replacement for a Match
+// ============================================================================
+size_t RegexExpand(const RegexMatch *match, const uint16_t *text,
+                   const uint16_t *replacement, size_t replacementLength,
+                   uint16_t *out, size_t capacity) {
+    size_t n = 0;
+#define PUT(u) do { if (n < capacity) out[n] = (u); n++; } while (0)
+    for (size_t i = 0; i < replacementLength; ++i) {
+        uint16_t ch = replacement[i];
+        if (ch == '\\' && i + 1 < replacementLength) {
+            uint16_t next = replacement[i + 1];
+            uint16_t unit = next == 'n' ? '\n' : next == 'r' ? '\r' : next == 't' ? '\t' : next;
+            if (next == 'n' || next == 'r' || next == 't' || next == '\\' || next == '$') {
+                PUT(unit);
+                i++;
+                continue;
+            }
+        } else if (ch == '$' && i + 1 < replacementLength) {
+            uint16_t next = replacement[i + 1];
+            size_t group = REGEX_MAX_GROUPS;
+            size_t used = 0;
+            if (next == '$') {
+                PUT('$');
+                i++;
+                continue;
+            } else if (next == '&') {
+                group = 0;
+                used = 1;
+            } else if (next >= '0' && next <= '9') {
+                group = (size_t)(next - '0');
+                used = 1;
+            } else if (next == '{') {
+                size_t j = i + 2, value = 0;
+                while (j < replacementLength && replacement[j] >= '0' && replacement[j] <= '9' && value < REGEX_MAX_GROUPS) {
+                    value = value * 10 + (size_t)(replacement[j] - '0');
+                    j++;
+                }
+                if (j > i + 2 && j < replacementLength && replacement[j] == '}') {
+                    group = value;
+                    used = j - i;
+                }
+            }
+            if (used) {
+                // Unknown or unmatched groups expand to nothing
+                if (group < REGEX_MAX_GROUPS && match->start[group] != REGEX_NO_GROUP) {
+                    for (size_t k = match->start[group]; k < match->end[group]; ++k) PUT(text[k]);
+                }
+                i += used;
+                continue;
+            }
+        }
+        PUT(ch);
+    }
+#undef PUT
+    return n;
+}
@@ -0,0 +1,84 @@
+// ============================================================================
+// regex.h - Linear-Time Regular Expression Engine Header
+// ============================================================================
+// Regular expressions for Find/Replace over UTF-16 text, built so that no
+// pattern can make a search slower than linear in the text length:
+//   - Patterns compile to a Thompson NFA; there is no backtracking.
+//   - Scanning runs on a lazily built DFA (states are created on demand and
+//     cached, with a memory cap) and skips ahead to a required literal
+//     prefix whenever no partial match is in progress.
+//   - Only the short span that contains a match is re-run on a Pike VM to
+//     find the exact leftmost-first bounds and capture groups.
+// Syntax (Perl-like subset):
+//   .  [abc] [^a-z]  \d \D \w \W \s \S  \t \n \r \f \v \xHH \uHHHH
+//   ^ $ (line anchors)  \b \B  (...) (?:...)  a|b
+//   * + ? {n} {n,} {n,m} and their lazy forms *? +? ?? {n,m}?
+// '.' does not match line breaks. This module is plain C with no Windows
+// dependencies. A compiled Regex caches DFA states and is therefore not
+// safe to use from two threads at once.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define REGEX_MAX_GROUPS      10                   // Group 0 (whole match) and $1..$9
+#define REGEX_NO_GROUP        ((size_t)-1)         // Start/end of a group that did not take part
+#define REGEX_MAX_PROGRAM     100000               // Instruction cap (counted repeats expand)
+#define REGEX_DFA_MEMORY      (16u * 1024u * 1024u) // DFA cache cap in bytes
+
+// Compile flags
+#define REGEX_ICASE           0x0001               // Case-insensitive (simple case folding)
+
+typedef enum RegexError {
+    REGEX_OK = 0,
+    REGEX_ERROR_SYNTAX = 1,     // Malformed pattern
+    REGEX_ERROR_TOO_BIG = 2,    // Program exceeds REGEX_MAX_PROGRAM
+    REGEX_ERROR_MEMORY = 3      // Out of memory
+} RegexError;
+
+typedef struct Regex Regex;
+
+// Match positions in code units. Unused groups are REGEX_NO_GROUP.
+typedef struct RegexMatch {
+    size_t start[REGEX_MAX_GROUPS];
+    size_t end[REGEX_MAX_GROUPS];
+} RegexMatch;
+
+// Compiles a pattern.
+// Parameters:
+//   pattern, length - Pattern text
+//   flags           - REGEX_* flags
+//   regexOut        - Receives the compiled expression
+//   errorOffset     - Receives the pattern position of a syntax error (can be NULL)
+RegexError RegexCompile(const uint16_t *pattern, size_t length, unsigned flags,
+                        Regex **regexOut, size_t *errorOffset);
+
+void RegexFree(Regex *regex);
+
+// Number of capture groups including group 0 (at most REGEX_MAX_GROUPS).
+size_t RegexGroupCount(const Regex *regex);
+
+// The literal every match starts with (case-folded under REGEX_ICASE), as
+// the scan's prefilter uses it. Returns its length; 0 if there is none.
+size_t RegexPrefix(const Regex *regex, const uint16_t **prefixOut);
+
+// Finds the leftmost match starting at or after 'start'. Text before 'start'
+// still counts as context for ^ and \b.
+// Returns: true if a match was found
+bool RegexSearch(Regex *regex, const uint16_t *text, size_t length, size_t start, RegexMatch *match);
+
+// Like RegexSearch, but only a match starting before 'startLimit' counts;
+// the scan stops soon after it. This lets separate parts of a text be
+// searched independently (matches may still extend past 'startLimit').
+bool RegexSearchWithin(Regex *regex, const uint16_t *text, size_t length, size_t start, size_t startLimit,
+                       RegexMatch *match);
+
+// Expands a replacement template for a match: $0-$9 and ${n} insert groups,
+// $& the whole match, $$ a dollar sign; \r \n \t and \\ are escapes.
+// Returns the expanded length; output beyond 'capacity' is not written.
+size_t RegexExpand(const RegexMatch *match, const uint16_t *text,
+                   const uint16_t *replacement, size_t replacementLength,
+                   uint16_t *out, size_t capacity);
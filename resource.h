@@ -30,9 +30,11 @@
 #define IDM_FILE_PAGE_SETUP     40005  // Page setup dialog
 #define IDM_FILE_PRINT          40006  // Print document (Ctrl+P)
 #define IDM_FILE_EXIT           40007  // Exit application
+#define IDM_FILE_CANCEL_PRINT   40008  // Stop the background print job
+#define IDM_FILE_PRINT_PREVIEW  40009  // Preview pages before printing
 
 // ============================================================================
-// Edit Menu Commands (40010-40020)
+// Edit Menu Commands (40010-40029)
 // ============================================================================
 #define IDM_EDIT_UNDO           40010  // Undo last edit (Ctrl+Z)
 #define IDM_EDIT_CUT            40011  // Cut selection to clipboard (Ctrl+X)
@@ -45,6 +47,22 @@
 #define IDM_EDIT_GOTO           40018  // Go to line number (Ctrl+G)
 #define IDM_EDIT_SELECT_ALL     40019  // Select all text (Ctrl+A)
 #define IDM_EDIT_TIME_DATE      40020  // Insert current time/date (F5)
+#define IDM_EDIT_REDO           40021  // Redo last undone edit (Ctrl+Y)
+#define IDM_EDIT_REGEX          40022  // Toggle regular expression Find/Replace
+#define IDM_EDIT_FIND_MULTI     40023  // Find several terms at once (Ctrl+Shift+F)
+#define IDM_EDIT_FIND_PREV      40024  // Find previous occurrence (Shift+F3)
+#define IDM_EDIT_FIND_ALL       40025  // Index and list every occurrence (Alt+F3)
+#define IDM_EDIT_INC_SEARCH     40026  // Open the incremental search bar (Ctrl+I)
+#define IDM_EDIT_FIND_IN_FILES  40027  // Search every file in a folder
+#define IDM_EDIT_USE_FIND       40028  // Use the selection as the find string (Ctrl+E)
+#define IDM_EDIT_USE_REPLACE    40029  // Use the selection as the replace string (Ctrl+Shift+E)
+
+// ============================================================================
+// Edit Menu Commands, continued (40060-40069)
+// ============================================================================
+#define IDM_EDIT_COUNT          40060  // Count occurrences of the find string
+#define IDM_EDIT_GOTO_MATCHING  40061  // Go to a line picked by fuzzy match (Ctrl+Shift+G)
+#define IDM_EDIT_FILTER         40062  // List only the lines holding a match (Ctrl+Shift+L)
 
 // ============================================================================
 // Format Menu Commands (40030-40039)
@@ -56,6 +74,9 @@
 // View Menu Commands (40040-40049)
 // ============================================================================
 #define IDM_VIEW_STATUS_BAR     40040  // Toggle status bar visibility
+#define IDM_VIEW_RESULTS        40041  // Toggle search results list
+#define IDM_VIEW_SEARCH_INDEX   40042  // Toggle indexing of large documents for search
+#define IDM_VIEW_LINE_NUMBERS   40043  // Toggle the line number gutter
 
 // ============================================================================
 // Help Menu Commands (40050-40059)
@@ -69,5 +90,17 @@
 #define IDD_GOTO                50001  // Go To Line dialog
 #define IDD_ABOUT               50002  // About dialog
 #define IDD_HELP                50003  // Help dialog
+#define IDD_FIND_MULTI          50004  // Find Multiple dialog
+#define IDD_FIND_IN_FILES       50005  // Find in Files dialog
+#define IDD_GOTO_MATCHING       50006  // Go To Matching Line dialog
 #define IDC_GOTO_EDIT           50010  // Edit control in Go To dialog
+#define IDC_MULTI_TERMS         50011  // Term list in Find Multiple dialog
+#define IDC_MULTI_MATCH_CASE    50012  // Match case check box in Find Multiple dialog
+#define IDC_FILES_TEXT          50013  // Find what box in Find in Files dialog
+#define IDC_FILES_FOLDER        50014  // Folder box in Find in Files dialog
+#define IDC_FILES_TYPES         50015  // File types box in Find in Files dialog
+#define IDC_FILES_MATCH_CASE    50016  // Match case check box in Find in Files dialog
+#define IDC_MATCHING_QUERY      50017  // Query box in Go To Matching Line dialog
+#define IDC_MATCHING_LIST       50018  // Best matching lines in Go To Matching Line dialog
+#define IDC_MATCHING_STATUS     50019  // Matching line count in Go To Matching Line dialog
 
@@ -0,0 +1,400 @@
+// ============================================================================
+// results_pane.c - Search Results List Implementation
+// ============================================================================
+// Columns: Term | Line | Text (File | Line | Text for Find in Files). Rows
+// are produced on demand in response to LVN_GETDISPINFO; nothing but the
+// ResultItem array is kept per match, and not even that when the rows come
+// from an external source.
+// Offsets are clamped to the current text length, so rows stay harmless
+// when the document has been edited since the search ran.
+// F2 opens an edit box over the Text column of the selected row, a child
+// of the list view so it scrolls away with it; the owner's editor applies
+// the new text, so the pane never writes to the document itself.
+// ============================================================================
+
+#include "results_pane.h"
+#include <strsafe.h>   // For safe string operations
+
+#define INITIAL_CAPACITY  1024
+
+// ============================================================================
+// ResultsPaneCreate
+// ============================================================================
+BOOL ResultsPaneCreate(ResultsPane *pane, HWND parent, HINSTANCE instance) {
+    pane->hwnd = CreateWindowExW(WS_EX_CLIENTEDGE, WC_LISTVIEWW, L"",
+        WS_CHILD | WS_TABSTOP | LVS_REPORT | LVS_OWNERDATA | LVS_SINGLESEL | LVS_SHOWSELALWAYS,
+        0, 0, 0, 0, parent, (HMENU)(INT_PTR)RESULTS_PANE_ID, instance, NULL);
+    if (!pane->hwnd) return FALSE;
+
+    SendMessageW(pane->hwnd, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), FALSE);
+    SendMessageW(pane->hwnd, LVM_SETEXTENDEDLISTVIEWSTYLE, LVS_EX_FULLROWSELECT, LVS_EX_FULLROWSELECT);
+
+    static const struct { const WCHAR *title; int width; int format; } columns[] = {
+        { L"Term", 140, LVCFMT_LEFT },
+        { L"Line", 70, LVCFMT_RIGHT },
+        { L"Text", 640, LVCFMT_LEFT },
+    };
+    for (int i = 0; i < (int)(sizeof(columns) / sizeof(columns[0])); ++i) {
+        LVCOLUMNW column = {0};
+        column.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_FMT;
+        column.pszText = (LPWSTR)columns[i].title;
+        column.cx = columns[i].width;
+        column.fmt = columns[i].format;
+        SendMessageW(pane->hwnd, LVM_INSERTCOLUMNW, i, (LPARAM)&column);
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// ResultsPaneClear / ResultsPaneFree
+// ============================================================================
+static void FreeTags(ResultsPane *pane) {
+    for (size_t i = 0; i < pane->tagCount; ++i) HeapFree(GetProcessHeap(), 0, pane->tags[i]);
+    if (pane->tags) HeapFree(GetProcessHeap(), 0, pane->tags);
+    if (pane->tagHits) HeapFree(GetProcessHeap(), 0, pane->tagHits);
+    pane->tags = NULL;
+    pane->tagHits = NULL;
+    pane->tagCount = 0;
+}
+
+static void SetFirstColumnTitle(ResultsPane *pane, const WCHAR *title) {
+    if (!pane->hwnd) return;
+    LVCOLUMNW column = {0};
+    column.mask = LVCF_TEXT;
+    column.pszText = (LPWSTR)title;
+    SendMessageW(pane->hwnd, LVM_SETCOLUMNW, RESULTS_COLUMN_TERM, (LPARAM)&column);
+}
+
+static void EndRowEdit(ResultsPane *pane, BOOL commit);
+
+void ResultsPaneClear(ResultsPane *pane) {
+    EndRowEdit(pane, FALSE);
+    FreeTags(pane);
+    if (pane->textProc) SetFirstColumnTitle(pane, L"Term");
+    pane->count = 0;
+    pane->truncated = FALSE;
+    pane->rowProc = NULL;
+    pane->textProc = NULL;
+    pane->activateProc = NULL;
+    pane->rowContext = NULL;
+    pane->editProc = NULL;
+    pane->editContext = NULL;
+}
+
+void ResultsPaneFree(ResultsPane *pane) {
+    ResultsPaneClear(pane);
+    if (pane->items) HeapFree(GetProcessHeap(), 0, pane->items);
+    pane->items = NULL;
+    pane->count = 0;
+    pane->capacity = 0;
+}
+
+// ============================================================================
+// ResultsPaneSetTags
+// ============================================================================
+BOOL ResultsPaneSetTags(ResultsPane *pane, const WCHAR *const *tags, const size_t *lengths, size_t count) {
+    FreeTags(pane);
+    if (count == 0) return TRUE;
+    pane->tags = (WCHAR **)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(WCHAR *));
+    pane->tagHits = (DWORD *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(DWORD));
+    if (!pane->tags || !pane->tagHits) {
+        FreeTags(pane);
+        return FALSE;
+    }
+    pane->tagCount = count;
+    for (size_t i = 0; i < count; ++i) {
+        pane->tags[i] = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (lengths[i] + 1) * sizeof(WCHAR));
+        if (!pane->tags[i]) {
+            FreeTags(pane);
+            return FALSE;
+        }
+        CopyMemory(pane->tags[i], tags[i], lengths[i] * sizeof(WCHAR));
+        pane->tags[i][lengths[i]] = L'\0';
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// ResultsPaneAdd
+// ============================================================================
+BOOL ResultsPaneAdd(ResultsPane *pane, ULONGLONG offset, DWORD length, DWORD tag) {
+    if (pane->truncated || pane->rowProc || pane->textProc) return FALSE;
+    if (pane->count == pane->capacity) {
+        // The list view addresses rows with an int
+        size_t newCapacity = pane->capacity ? pane->capacity * 2 : INITIAL_CAPACITY;
+        if (newCapacity > (size_t)INT_MAX) newCapacity = (size_t)INT_MAX;
+        ResultItem *items = newCapacity <= pane->capacity ? NULL
+            : pane->items
+                ? (ResultItem *)HeapReAlloc(GetProcessHeap(), 0, pane->items, newCapacity * sizeof(ResultItem))
+                : (ResultItem *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(ResultItem));
+        if (!items) {
+            pane->truncated = TRUE;
+            return FALSE;
+        }
+        pane->items = items;
+        pane->capacity = newCapacity;
+    }
+    ResultItem *item = &pane->items[pane->count++];
+    item->offset = offset;
+    item->length = length;
+    item->tag = tag;
+    if (tag < pane->tagCount) pane->tagHits[tag]++;
+    return TRUE;
+}
+
+// ============================================================================
+// ResultsPaneSetSource / ResultsPaneSetTextSource / GetRow - External Rows
+// ============================================================================
+void ResultsPaneSetSource(ResultsPane *pane, ResultsRowProc proc, void *context, size_t count) {
+    pane->rowProc = proc;
+    pane->rowContext = context;
+    pane->count = count < (size_t)INT_MAX ? count : (size_t)INT_MAX;   // List view rows are ints
+}
+
+void ResultsPaneSetTextSource(ResultsPane *pane, ResultsTextProc textProc, ResultsActivateProc activateProc,
+                              void *context, size_t count, const WCHAR *firstColumn) {
+    if (!pane->textProc) SetFirstColumnTitle(pane, firstColumn);
+    pane->rowProc = NULL;
+    pane->textProc = textProc;
+    pane->activateProc = activateProc;
+    pane->rowContext = context;
+    pane->count = count < (size_t)INT_MAX ? count : (size_t)INT_MAX;
+}
+
+static BOOL GetRow(const ResultsPane *pane, int row, ResultItem *item) {
+    if (row < 0 || (size_t)row >= pane->count) return FALSE;
+    if (pane->rowProc) return pane->rowProc(pane->rowContext, (size_t)row, item);
+    *item = pane->items[row];
+    return TRUE;
+}
+
+void ResultsPaneSetEditor(ResultsPane *pane, ResultsEditProc proc, void *context) {
+    pane->editProc = proc;
+    pane->editContext = context;
+}
+
+// ============================================================================
+// In-Place Row Editing
+// ============================================================================
+// Closes the edit box, handing its text to the editor if 'commit'. The box
+// is forgotten first, so the focus change this causes cannot end it twice.
+static void EndRowEdit(ResultsPane *pane, BOOL commit) {
+    HWND box = pane->editBox;
+    if (!box) return;
+    pane->editBox = NULL;
+    if (commit && pane->editProc && pane->editRow < pane->count) {
+        int length = GetWindowTextLengthW(box);
+        WCHAR *text = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, ((size_t)length + 1) * sizeof(WCHAR));
+        if (text) {
+            GetWindowTextW(box, text, length + 1);
+            pane->editProc(pane->editContext, pane->editRow, text);
+            HeapFree(GetProcessHeap(), 0, text);
+        }
+    }
+    // Destroyed later: this may run inside the box's own window procedure
+    PostMessageW(box, WM_CLOSE, 0, 0);
+}
+
+static LRESULT CALLBACK EditBoxSubclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    ResultsPane *pane = (ResultsPane *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    WNDPROC original = pane->editBoxProc;
+    BOOL editing = pane->editBox == hwnd;
+    switch (msg) {
+    case WM_GETDLGCODE:
+        return DLGC_WANTALLKEYS;
+    case WM_KEYDOWN:
+        if (editing && (wParam == VK_RETURN || wParam == VK_ESCAPE)) {
+            EndRowEdit(pane, wParam == VK_RETURN);
+            SetFocus(pane->hwnd);
+            return 0;
+        }
+        break;
+    case WM_CHAR:
+        if (wParam == L'\r' || wParam == 0x1B) return 0;   // No beep for Enter or Escape
+        break;
+    case WM_KILLFOCUS:
+        if (editing) EndRowEdit(pane, TRUE);
+        break;
+    }
+    return CallWindowProcW(original, hwnd, msg, wParam, lParam);
+}
+
+static void BeginRowEdit(ResultsPane *pane, HWND hwndEdit) {
+    if (!pane->editProc || pane->editBox) return;
+    int row = (int)SendMessageW(pane->hwnd, LVM_GETNEXTITEM, (WPARAM)-1, LVNI_SELECTED);
+    ResultItem item;
+    if (!GetRow(pane, row, &item)) return;
+
+    // The row's current text, as the box's starting value
+    HLOCAL handle = (HLOCAL)SendMessageW(hwndEdit, EM_GETHANDLE, 0, 0);
+    const WCHAR *text = handle ? (const WCHAR *)LocalLock(handle) : NULL;
+    if (!text) return;
+    size_t length = (size_t)GetWindowTextLengthW(hwndEdit);
+    size_t start = item.offset < length ? (size_t)item.offset : length;
+    size_t count = length - start < item.length ? length - start : item.length;
+    WCHAR *initial = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (count + 1) * sizeof(WCHAR));
+    if (initial) {
+        CopyMemory(initial, text + start, count * sizeof(WCHAR));
+        initial[count] = L'\0';
+    }
+    LocalUnlock(handle);
+    if (!initial) return;
+
+    SendMessageW(pane->hwnd, LVM_ENSUREVISIBLE, (WPARAM)row, FALSE);
+    RECT rc = {0};
+    rc.top = RESULTS_COLUMN_TEXT;
+    rc.left = LVIR_BOUNDS;
+    SendMessageW(pane->hwnd, LVM_GETSUBITEMRECT, (WPARAM)row, (LPARAM)&rc);
+
+    HINSTANCE instance = (HINSTANCE)GetWindowLongPtrW(pane->hwnd, GWLP_HINSTANCE);
+    HWND box = CreateWindowExW(0, L"EDIT", initial, WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL,
+                               rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top,
+                               pane->hwnd, NULL, instance, NULL);
+    HeapFree(GetProcessHeap(), 0, initial);
+    if (!box) return;
+
+    pane->editBox = box;
+    pane->editRow = (size_t)row;
+    SendMessageW(box, EM_SETLIMITTEXT, 0, 0);
+    SendMessageW(box, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), FALSE);
+    SetWindowLongPtrW(box, GWLP_USERDATA, (LONG_PTR)pane);
+    pane->editBoxProc = (WNDPROC)SetWindowLongPtrW(box, GWLP_WNDPROC, (LONG_PTR)EditBoxSubclassProc);
+    SendMessageW(box, EM_SETSEL, 0, -1);
+    SetFocus(box);
+}
+
+// ============================================================================
+// ResultsPaneWantsKey
+// ============================================================================
+BOOL ResultsPaneWantsKey(const ResultsPane *pane, const MSG *msg) {
+    if (!pane->editBox || msg->hwnd != pane->editBox || msg->message != WM_KEYDOWN) return FALSE;
+    if (msg->wParam == VK_DELETE) return TRUE;
+    if (GetKeyState(VK_CONTROL) >= 0 || GetKeyState(VK_SHIFT) < 0 || GetKeyState(VK_MENU) < 0) return FALSE;
+    switch (msg->wParam) {
+    case 'A': case 'C': case 'V': case 'X': case 'Z':
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// ============================================================================
+// ResultsPanePublish
+// ============================================================================
+void ResultsPanePublish(ResultsPane *pane) {
+    if (!pane->hwnd) return;
+    // Keep the scroll position: the list is republished as the document changes
+    SendMessageW(pane->hwnd, LVM_SETITEMCOUNT, (WPARAM)pane->count, LVSICF_NOSCROLL);
+    InvalidateRect(pane->hwnd, NULL, TRUE);
+}
+
+// ============================================================================
+// FormatCount - Integer with Thousands Separators
+// ============================================================================
+void FormatCount(size_t value, WCHAR *out, size_t outLen) {
+    WCHAR digits[32];
+    int n = 0;
+    do {
+        if (n > 0 && n % 4 == 3) digits[n++] = L',';
+        digits[n++] = (WCHAR)(L'0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    if (outLen == 0) return;
+    size_t i = 0;
+    while (n > 0 && i + 1 < outLen) out[i++] = digits[--n];
+    out[i] = L'\0';
+}
+
+// ============================================================================
+// GetMatchContext - Line Text Around a Match
+// ============================================================================
+// Copies the part of the match's line that fits RESULTS_CONTEXT_CHARS,
+// starting at most RESULTS_CONTEXT_BEFORE characters before the match.
+// Tabs become spaces so the list shows one clean line.
+// ============================================================================
+static void GetMatchContext(HWND hwndEdit, ULONGLONG offset, WCHAR *out) {
+    out[0] = L'\0';
+    HLOCAL handle = (HLOCAL)SendMessageW(hwndEdit, EM_GETHANDLE, 0, 0);
+    const WCHAR *text = handle ? (const WCHAR *)LocalLock(handle) : NULL;
+    if (!text) return;
+    size_t length = (size_t)GetWindowTextLengthW(hwndEdit);
+    size_t pos = offset < length ? (size_t)offset : length;
+
+    size_t begin = pos;
+    while (begin > 0 && pos - begin < RESULTS_CONTEXT_BEFORE &&
+           text[begin - 1] != L'\n' && text[begin - 1] != L'\r') {
+        begin--;
+    }
+    size_t n = 0;
+    while (begin + n < length && n < RESULTS_CONTEXT_CHARS) {
+        WCHAR ch = text[begin + n];
+        if (ch == L'\n' || ch == L'\r') break;
+        out[n++] = ch == L'\t' ? L' ' : ch;
+    }
+    out[n] = L'\0';
+    LocalUnlock(handle);
+}
+
+// ============================================================================
+// ResultsPaneNotify
+// ============================================================================
+BOOL ResultsPaneNotify(ResultsPane *pane, HWND hwndEdit, const NMHDR *header) {
+    if (!pane->hwnd || header->hwndFrom != pane->hwnd) return FALSE;
+
+    switch (header->code) {
+        case LVN_GETDISPINFOW: {
+            NMLVDISPINFOW *info = (NMLVDISPINFOW *)header;
+            if (pane->textProc) {
+                if (!(info->item.mask & LVIF_TEXT) || info->item.iItem < 0 || (size_t)info->item.iItem >= pane->count) break;
+                pane->textBuffer[0] = L'\0';
+                pane->textProc(pane->rowContext, (size_t)info->item.iItem, info->item.iSubItem,
+                               pane->textBuffer, ARRAYSIZE(pane->textBuffer));
+                info->item.pszText = pane->textBuffer;
+                break;
+            }
+            ResultItem item;
+            if (!(info->item.mask & LVIF_TEXT) || !GetRow(pane, info->item.iItem, &item)) break;
+            switch (info->item.iSubItem) {
+                case RESULTS_COLUMN_TERM:
+                    StringCchCopyW(info->item.pszText, info->item.cchTextMax,
+                                   item.tag < pane->tagCount ? pane->tags[item.tag] : L"");
+                    break;
+                case RESULTS_COLUMN_LINE: {
+                    LRESULT line = SendMessageW(hwndEdit, EM_LINEFROMCHAR, (WPARAM)item.offset, 0);
+                    FormatCount((size_t)line + 1, info->item.pszText, (size_t)info->item.cchTextMax);
+                    break;
+                }
+                case RESULTS_COLUMN_TEXT:
+                    GetMatchContext(hwndEdit, item.offset, pane->textBuffer);
+                    info->item.pszText = pane->textBuffer;
+                    break;
+            }
+            break;
+        }
+
+        case LVN_KEYDOWN: {
+            const NMLVKEYDOWN *key = (const NMLVKEYDOWN *)header;
+            if (key->wVKey == VK_F2) BeginRowEdit(pane, hwndEdit);
+            break;
+        }
+
+        case LVN_ITEMACTIVATE: {
+            const NMITEMACTIVATE *activate = (const NMITEMACTIVATE *)header;
+            if (pane->textProc) {
+                if (activate->iItem >= 0 && (size_t)activate->iItem < pane->count && pane->activateProc) {
+                    pane->activateProc(pane->rowContext, (size_t)activate->iItem);
+                }
+                break;
+            }
+            ResultItem item;
+            if (!GetRow(pane, activate->iItem, &item)) break;
+            DWORD length = (DWORD)GetWindowTextLengthW(hwndEdit);
+            DWORD start = item.offset < length ? (DWORD)item.offset : length;
+            DWORD end = length - start < item.length ? length : start + item.length;
+            SendMessageW(hwndEdit, EM_SETSEL, start, end);
+            SendMessageW(hwndEdit, EM_SCROLLCARET, 0, 0);
+            SetFocus(hwndEdit);
+            break;
+        }
+    }
+    return TRUE;
+}
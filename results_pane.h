@@ -0,0 +1,110 @@
+// ============================================================================
+// results_pane.h - Search Results List Header
+// ============================================================================
+// A list of search matches docked below the editor. The list view runs in
+// owner-data (virtual) mode: it stores nothing itself and asks for the text
+// of visible rows only, so millions of matches cost one small record each.
+// Line numbers and line text are looked up in the edit control when a row
+// is drawn; activating a row (double-click or Enter) selects the match.
+// Rows of the open document can also be edited in place (F2) when the
+// owner supplies an editor: a one-line edit box opens over the Text column
+// and Enter (or leaving it) hands the new text back; Escape cancels.
+// The owner positions and shows the window and forwards WM_NOTIFY.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <commctrl.h>
+
+#define RESULTS_PANE_ID         3      // Child window ID (edit is 1, status bar 2)
+#define RESULTS_CONTEXT_CHARS   160    // Line text shown for a match
+#define RESULTS_CONTEXT_BEFORE  40     // Of which at most this much precedes it
+
+// ============================================================================
+// Result Records
+// ============================================================================
+typedef struct ResultItem {
+    ULONGLONG offset;                   // Match start in the document
+    DWORD length;                       // Match length in characters
+    DWORD tag;                          // Search term that produced the match
+} ResultItem;
+
+// Supplies one row of a result list the pane does not own (see
+// ResultsPaneSetSource). Returns FALSE if the row is not available.
+typedef BOOL (*ResultsRowProc)(void *context, size_t row, ResultItem *item);
+
+// Rows that are not about the open document (Find in Files) supply their own
+// text and handle their own activation (see ResultsPaneSetTextSource).
+enum { RESULTS_COLUMN_TERM, RESULTS_COLUMN_LINE, RESULTS_COLUMN_TEXT };
+typedef BOOL (*ResultsTextProc)(void *context, size_t row, int column, WCHAR *out, size_t outLen);
+typedef void (*ResultsActivateProc)(void *context, size_t row);
+
+// Writes back the text of a row edited in place (see ResultsPaneSetEditor).
+typedef void (*ResultsEditProc)(void *context, size_t row, const WCHAR *text);
+
+typedef struct ResultsPane {
+    HWND hwnd;                          // Virtual list view (NULL until created)
+    ResultItem *items;                  // Matches in document order
+    size_t count;                       // Rows (in 'items' or from 'rowProc')
+    ResultsRowProc rowProc;             // External row source, or NULL to use 'items'
+    ResultsTextProc textProc;           // External row text, or NULL
+    ResultsActivateProc activateProc;   // Activation of 'textProc' rows
+    void *rowContext;
+    size_t capacity;
+    WCHAR **tags;                       // Search terms, shown in the first column
+    DWORD *tagHits;                     // Matches per term
+    size_t tagCount;
+    BOOL truncated;                     // Ran out of memory while adding
+    ResultsEditProc editProc;           // Writes back edited rows, or NULL if rows are read-only
+    void *editContext;
+    HWND editBox;                       // In-place edit box while a row is being edited
+    WNDPROC editBoxProc;                // Original edit control window procedure
+    size_t editRow;                     // Row being edited
+    WCHAR textBuffer[RESULTS_CONTEXT_CHARS + 1]; // Row text handed to the list view
+} ResultsPane;
+
+// Creates the (hidden) list view as a child of 'parent'.
+BOOL ResultsPaneCreate(ResultsPane *pane, HWND parent, HINSTANCE instance);
+
+// Releases the result storage. The window is destroyed with its parent.
+void ResultsPaneFree(ResultsPane *pane);
+
+// Drops all results and terms (call ResultsPanePublish to update the list).
+void ResultsPaneClear(ResultsPane *pane);
+
+// Sets the search terms that result tags refer to. Terms are copied.
+BOOL ResultsPaneSetTags(ResultsPane *pane, const WCHAR *const *tags, const size_t *lengths, size_t count);
+
+// Appends one match. Returns FALSE (and sets 'truncated') when out of memory.
+BOOL ResultsPaneAdd(ResultsPane *pane, ULONGLONG offset, DWORD length, DWORD tag);
+
+// Shows 'count' rows supplied by 'proc' instead of the pane's own items.
+// Call again whenever the external list changes; ResultsPaneClear detaches.
+void ResultsPaneSetSource(ResultsPane *pane, ResultsRowProc proc, void *context, size_t count);
+
+// Shows 'count' rows whose text comes from 'textProc'; activating a row
+// calls 'activateProc'. 'firstColumn' titles the first column. Call again
+// as the row count grows; ResultsPaneClear detaches.
+void ResultsPaneSetTextSource(ResultsPane *pane, ResultsTextProc textProc, ResultsActivateProc activateProc,
+                              void *context, size_t count, const WCHAR *firstColumn);
+
+// Lets F2 edit a row in place: the box starts with the row's text (its
+// ResultItem span of the document) and 'proc' receives the new text.
+// ResultsPaneClear detaches.
+void ResultsPaneSetEditor(ResultsPane *pane, ResultsEditProc proc, void *context);
+
+// TRUE if the message is an editing key (Delete, Ctrl+A/C/V/X/Z) for the
+// in-place edit box, which must reach it instead of becoming a menu
+// accelerator.
+BOOL ResultsPaneWantsKey(const ResultsPane *pane, const MSG *msg);
+
+// Hands the current result count to the list view.
+void ResultsPanePublish(ResultsPane *pane);
+
+// Handles list view notifications: row text and activation.
+// Returns TRUE if the notification came from the pane.
+BOOL ResultsPaneNotify(ResultsPane *pane, HWND hwndEdit, const NMHDR *header);
+
+// Formats a count with thousands separators ("12,408").
+void FormatCount(size_t value, WCHAR *out, size_t outLen);
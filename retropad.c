@@ -17,13 +17,40 @@
 // Windows API Headers
 #include <windows.h>     // Core Windows API
 #include <commdlg.h>     // Common dialogs (Open, Save, Font, Find/Replace)
+#include <dlgs.h>        // Control IDs inside the common dialogs
 #include <commctrl.h>    // Common controls (Status bar)
 #include <shellapi.h>    // Shell functions (Drag-drop)
+#include <imm.h>         // IME composition flags
 #include <strsafe.h>     // Safe string operations
 
 // Application Headers
 #include "resource.h"    // Resource IDs (menu items, dialogs, etc.)
 #include "file_io.h"     // File I/O with encoding support
+#include "line_index.h"  // Sparse line offset index
+#include "meta_cache.h"  // Cached encoding/line metadata for large files
+#include "undo_log.h"    // Unlimited undo/redo history
+#include "journal.h"     // Crash recovery edit journal
+#include "session.h"     // Hot exit session snapshot
+#include "settings_store.h" // Settings with registry / INI backends
+#include "regex.h"       // Regular expression Find/Replace
+#include "aho_corasick.h" // Multi-term search automaton
+#include "results_pane.h" // Search results list
+#include "match_index.h"  // Find All match index
+#include "line_filter.h"  // Filter view of the lines holding a match
+#include "text_search.h"  // Literal search, incremental search state
+#include "search_bar.h"   // Incremental search bar
+#include "parallel_search.h" // Multi-threaded search of large documents
+#include "find_in_files.h"   // Background search of a folder tree
+#include "trigram_index.h"   // Block index for repeated searches of large documents
+#include "match_counter.h"   // Background count of the find string
+#include "line_palette.h"    // Go To Matching Line palette
+#include "highlight.h"       // Syntax highlighting lexer and line states
+#include "line_gutter.h"     // Line numbers left of the editor
+#include "line_layout.h"     // Chunked measurement of long lines
+#include "text_metrics.h"    // Cached advance widths and shaped runs
+#include "pagination.h"      // Print page breaks and page ranges
+#include "print_job.h"       // Printing on a worker thread
+#include "print_preview.h"   // Page thumbnails before printing
 
 // ============================================================================
 // Application Constants
@@ -34,14 +61,58 @@
 #define DEFAULT_WIDTH  640              // Default window width in pixels
 #define DEFAULT_HEIGHT 480              // Default window height in pixels
 
-// Registry settings
-#define REG_KEY_PATH   L"Software\\retropad"  // Registry path for settings
-#define REG_WORD_WRAP  L"WordWrap"            // Word wrap setting name
-#define REG_STATUS_BAR L"StatusBar"           // Status bar setting name
-#define REG_FONT_NAME  L"FontName"            // Font face name
-#define REG_FONT_SIZE  L"FontSize"            // Font size (height)
-#define REG_FONT_WEIGHT L"FontWeight"         // Font weight (bold)
-#define REG_FONT_ITALIC L"FontItalic"         // Font italic style
+// Find/Replace dialog buffers. The strings themselves have no limit; longer
+// ones (and ones with line breaks) come from the selection
+#define FIND_DIALOG_CHARS 4096
+
+// Undo capture
+#define UNDO_CAPTURE_MARGIN 256               // Text saved around the selection for key edits
+
+// Private window messages
+#define WM_APP_SESSION_LOADED (WM_APP + 1)    // lParam = SessionRestore* from the loader thread
+#define WM_APP_FIND_IN_FILES  (WM_APP + 2)    // Find in Files has new matches or finished
+#define WM_APP_MATCH_COUNT    (WM_APP + 3)    // The match count has grown or finished
+#define WM_APP_PRINT_JOB      (WM_APP + 4)    // The print job finished a page or ended
+
+// Find All
+#define FIND_ALL_TIMER_ID        0x5E78       // WM_TIMER id for rebuilding a stale match index
+#define FIND_ALL_REBUILD_DELAY_MS 300         // Quiet time after an edit before the rebuild
+
+// Filter view: rebuilt after the same quiet time when an edit cannot be followed
+#define FILTER_TIMER_ID          0x5E7C       // WM_TIMER id for rebuilding a stale line filter
+
+// Incremental search: each keystroke searches at most INC_SEARCH_NEAR_CHARS
+// past the caret; the full count is scanned in slices of INC_SEARCH_SLICE_CHARS
+// (a few milliseconds each) from a timer, so typing never waits for it
+#define INC_SEARCH_TIMER_ID      0x5E79       // WM_TIMER id for the next scan slice
+#define INC_SEARCH_NEAR_CHARS    (2u << 20)
+#define INC_SEARCH_SLICE_CHARS   (4u << 20)
+
+// Search index: a document of SEARCH_INDEX_MIN_CHARS or more gets a trigram
+// index on its first search, built in slices of SEARCH_INDEX_SLICE_CHARS
+// from a timer; later searches read only the blocks it points them to
+#define SEARCH_INDEX_TIMER_ID    0x5E7A       // WM_TIMER id for the next build slice
+#define SEARCH_INDEX_MIN_CHARS   (8u << 20)
+#define SEARCH_INDEX_SLICE_CHARS (2u << 20)
+
+// Match count: once shown, the status bar count follows the find string and
+// is counted again (on a worker thread) when editing pauses
+#define COUNT_TIMER_ID           0x5E7B       // WM_TIMER id for counting again after edits
+#define COUNT_RESTART_DELAY_MS   300
+
+// Syntax highlighting: line states are lexed in slices of
+// HIGHLIGHT_SLICE_LINES from a timer once editing has paused
+#define HIGHLIGHT_TIMER_ID       0x5E7D       // WM_TIMER id for the next lexing slice
+#define HIGHLIGHT_IDLE_DELAY_MS  300
+#define HIGHLIGHT_SLICE_LINES    20000
+
+// Editor paint times, shown in the status bar with the PaintTiming setting
+typedef struct PaintTiming {
+    ULONGLONG frames;
+    ULONGLONG totalTicks;               // QueryPerformanceCounter ticks
+    ULONGLONG worstTicks;
+    ULONGLONG frequency;                // Ticks per second, 0 until first used
+} PaintTiming;
 
 // ============================================================================
 // Application State Structure
@@ -61,23 +132,99 @@ typedef struct AppState {
     WCHAR currentPath[MAX_PATH_BUFFER]; // Full path of current file (empty = unsaved)
     BOOL modified;                      // TRUE if document has unsaved changes
     TextEncoding encoding;              // Encoding of current file
+    LineIndex lineIndex;                // Line index and line ending style as loaded
+    
+    // Undo State
+    UndoLog undo;                       // Editor-owned undo/redo history
+    WNDPROC editProc;                   // Original edit control window procedure
+    BOOL editChanged;                   // Set by EN_CHANGE while an edit is captured
+    BOOL undoReplaying;                 // TRUE while undo/redo is changing the text
+    int captureDepth;                   // Nesting depth of captured edit messages
+    size_t editLength;                  // Text length after the last change seen
+    Journal journal;                    // Crash recovery journal of unsaved edits
     
     // UI State
+    SettingsStore settings;             // User preferences, written back lazily
     BOOL wordWrap;                      // TRUE if word wrap is enabled
     BOOL statusVisible;                 // TRUE if status bar is visible
     BOOL statusBeforeWrap;              // Remembers status visibility before word wrap
+    WNDPROC statusProc;                 // Original status bar window procedure
+
+    // Painting
+    HDC backDC;                         // Off-screen buffer shared by the editor and status bar
+    HBITMAP backBitmap;
+    HBITMAP backOldBitmap;
+    int backWidth;
+    int backHeight;
+    PaintTiming paintTiming;            // Editor paint times
     
     // Find/Replace State
     FINDREPLACEW find;                  // Windows find/replace dialog structure
     HWND hFindDlg;                      // Handle to Find dialog (modeless)
     HWND hReplaceDlg;                   // Handle to Replace dialog (modeless)
     UINT findFlags;                     // Find flags (match case, direction, etc.)
-    WCHAR findText[128];                // Current find string
-    WCHAR replaceText[128];             // Current replace string
+    WCHAR *findText;                    // Current find string (heap; any length, may span lines)
+    WCHAR *replaceText;                 // Current replace string (heap; likewise)
+    WCHAR findDlgText[FIND_DIALOG_CHARS];    // Find string as the dialog edits it
+    WCHAR replaceDlgText[FIND_DIALOG_CHARS]; // Replace string as the dialog edits it
+    Regex *findRegex;                   // Compiled find string (regular expression mode)
+    WCHAR *findRegexSource;             // Pattern 'findRegex' was compiled from
+    BOOL findRegexMatchCase;            // Match-case option 'findRegex' was compiled with
+    MatchIndex findAll;                 // Find All: every match of 'findAllText', in order
+    BOOL findAllActive;                 // Find All results are listed and kept current
+    WCHAR *findAllText;                 // Find string 'findAll' was built for
+    BOOL findAllMatchCase;              // Match-case option 'findAll' was built with
+    BOOL findAllWholeWord;              // Whole-word option 'findAll' was built with
+    BOOL findAllRegex;                  // TRUE if 'findAllText' is a regular expression
+    LineFilter lineFilter;              // Filter view: the lines holding a match of 'filterText'
+    BOOL filterActive;                  // Filtered lines are listed and kept current
+    WCHAR *filterText;                  // Find string 'lineFilter' was built for
+    BOOL filterMatchCase;               // Match-case option 'lineFilter' was built with
+    BOOL filterWholeWord;               // Whole-word option 'lineFilter' was built with
+    BOOL filterRegex;                   // TRUE if 'filterText' is a regular expression
+    WCHAR *multiTerms;                  // Find Multiple term list (one per line)
+    BOOL multiMatchCase;                // Find Multiple match-case option
+    uint16_t *lowerFold;                // Code unit -> lowercase, built on first use
+    uint8_t *wordChars;                 // Word character bitmap, built on first whole-word search
+    ResultsPane results;                // Search results list below the editor
+    BOOL resultsVisible;                // TRUE if the results list is shown
+    SearchBar searchBar;                // Incremental search bar above the status bar
+    LineGutter gutter;                  // Line numbers left of the editor
+    TextMetricsCache textMetrics;       // Widths of text in the fonts last printed with
+    Pagination pagination;              // Page starts of the document as last printed (lent to printJob)
+    PrintJob *printJob;                 // Printing in the background, if any
+    PrintJobStatus printStatus;         // Progress of 'printJob' as last polled
+    IncSearch incSearch;                // Occurrences of the search bar query
+    size_t incAnchor;                   // Where the incremental search started
+    size_t incMatch;                    // Selected occurrence, or TEXT_NOT_FOUND
+    BOOL incPending;                    // Select the nearest occurrence once the scan finds it
+    TrigramIndex searchIndex;           // Candidate blocks for searches of a large document
+    MatchCounter *counter;              // Counting the find string (holds the text locked)
+    MatchCountStatus countStatus;       // Progress of the count as last polled
+    BOOL countActive;                   // The status bar shows the find string's count
+    WCHAR *countText;                   // Find string, options and mode counted
+    BOOL countMatchCase;
+    BOOL countWholeWord;
+    BOOL countRegex;
+    FindInFiles *fileSearch;            // Find in Files results listed (searching or done)
+    FindInFilesStatus filesStatus;      // Progress of 'fileSearch' as last polled
+    WCHAR filesText[128];               // Find in Files string, folder, types and option
+    WCHAR filesFolder[MAX_PATH_BUFFER];
+    WCHAR filesTypes[128];
+    BOOL filesMatchCase;
+
+    // Syntax Highlighting
+    HighlightCache highlight;           // Lexer state at the start of each edit control line
     
     // Print State
     PAGESETUPDLGW pageSetup;            // Page setup settings (margins, orientation)
     PRINTDLGW printDlg;                 // Print dialog settings
+    
+    // Session State
+    SessionState session;               // Snapshot read at startup
+    BOOL sessionValid;                  // TRUE if 'session' was read successfully
+    BOOL sessionLoading;                // Restored document is still loading in the background
+    WCHAR pendingOpen[MAX_PATH_BUFFER]; // File named on the command line, opened after the restore
 } AppState;
 
 // ============================================================================
@@ -101,6 +248,9 @@ static void CreateEditControl(HWND hwnd);              // Create/recreate edit c
 static void UpdateLayout(HWND hwnd);                   // Resize controls to fit window
 static void UpdateStatusBar(HWND hwnd);                // Update status bar with cursor info
 static void ToggleStatusBar(HWND hwnd, BOOL visible);  // Show/hide status bar
+static void ToggleResults(HWND hwnd, BOOL visible);    // Show/hide search results list
+static void ToggleLineNumbers(HWND hwnd, BOOL visible); // Show/hide the line number gutter
+static void ClearResults(HWND hwnd);                   // Drop search results (document changed)
 
 // File Operations
 static BOOL PromptSaveChanges(HWND hwnd);              // Ask to save if modified
@@ -108,32 +258,63 @@ static BOOL DoFileOpen(HWND hwnd);                     // Open file dialog and l
 static BOOL DoFileSave(HWND hwnd, BOOL saveAs);        // Save file (with optional dialog)
 static void DoFileNew(HWND hwnd);                      // Start new document
 static BOOL LoadDocumentFromPath(HWND hwnd, LPCWSTR path); // Load file from path
+static void StartJournal(HWND hwnd);                   // Start crash journal, recover untitled work
+static BOOL BeginSessionRestore(HWND hwnd);            // Start loading the previous session's document
+static BOOL SaveSession(HWND hwnd, BOOL withDocument); // Write the hot exit snapshot
 
 // Edit Operations
 static void SetWordWrap(HWND hwnd, BOOL enabled);      // Toggle word wrap mode
 static void DoSelectFont(HWND hwnd);                   // Show font selection dialog
 static void InsertTimeDate(HWND hwnd);                 // Insert current time/date at cursor
+static void DoUndo(HWND hwnd, BOOL redo);              // Undo or redo one step
 
 // Settings Persistence
-static BOOL LoadWordWrapSetting(void);                 // Load word wrap from registry
-static void SaveWordWrapSetting(BOOL enabled);         // Save word wrap to registry
-static BOOL LoadStatusBarSetting(void);                // Load status bar from registry
-static void SaveStatusBarSetting(BOOL enabled);        // Save status bar to registry
-static HFONT LoadFontSetting(void);                    // Load font from registry
-static void SaveFontSetting(const LOGFONTW *lf);       // Save font to registry
+static HFONT LoadFontSetting(void);                    // Create the font saved in the settings
+static void SaveFontSetting(const LOGFONTW *lf);       // Remember the font in the settings
+static void SettingsChanged(HWND hwnd);                // Schedule a deferred settings write
 
 // Print Operations
 static void DoPageSetup(HWND hwnd);                    // Show page setup dialog
-static void DoPrint(HWND hwnd);                        // Show print dialog and print
+static void DoPrint(HWND hwnd);                        // Show print dialog and start printing
+static void DoPrintPreview(HWND hwnd);                 // Show the pages as they will print
+static void PrintJobProgress(HWND hwnd);               // Take the print job's progress
+static void EndPrintJob(BOOL cancel);                  // Wait for or cancel the print job
 
 // Find/Replace Operations
 static void ShowFindDialog(HWND hwnd);                 // Show modeless Find dialog
 static void ShowReplaceDialog(HWND hwnd);              // Show modeless Replace dialog
 static BOOL DoFindNext(BOOL reverse);                  // Find next occurrence
+static void DoFindAll(HWND hwnd);                      // Index and list every match of the find string
+static void EndFindAll(void);                          // Drop the Find All index
+static void DoFilterLines(HWND hwnd);                  // List only the lines holding a match
+static void EndFilter(void);                           // Drop the filter view
+static void UseSelectionForFind(HWND hwnd, BOOL replace); // Take the selection as find/replace string
+static void DoFindMultiple(HWND hwnd);                 // Find every occurrence of a term list
+static void DoFindInFiles(HWND hwnd);                  // Search every file in a folder
+static void EndFindInFiles(void);                      // Stop Find in Files and drop its matches
+static void ShowSearchBar(HWND hwnd);                  // Open the incremental search bar
+static void CloseSearchBar(HWND hwnd);                 // Close it, keeping the selected match
+static void IncSearchTextChanged(void);                // The document text changed under the search
+static void NoteEdit(size_t offset, size_t removed, size_t inserted); // Tell searches about an edit
+static void NoteTextReplaced(void);                    // Tell searches about an edit we cannot describe
+static void SetEditTextRecorded(HWND hwndEdit, const WCHAR *text); // Set text for a change the caller records
+static BOOL SearchIndexQuery(TrigramQuery *query, const uint16_t *literal, size_t literalLength,
+                             size_t textLength);       // Candidate blocks for a literal, if indexed
+static const ChunkMatcher *NarrowBySearchIndex(const ChunkMatcher *matcher, const uint16_t *literal,
+                                               size_t literalLength, size_t textLength,
+                                               IndexedMatcher *indexed); // Search only candidate blocks
+static void ResetSearchIndex(void);                    // Drop the search index
+static void StartCount(void);                          // Count the find string in the background
+static void StopCount(void);                           // Cancel the count and release the text
+static void CountTextChanged(void);                    // Count again once editing pauses
+static void DoGoToMatching(HWND hwnd);                 // Jump to a line picked by fuzzy match
+static void ResetHighlight(void);                      // Lex the document's lines over again
 static void HandleFindReplace(LPFINDREPLACE lpfr);     // Process Find/Replace messages
 
 // Dialog Procedures
 static INT_PTR CALLBACK GoToDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam);
+static INT_PTR CALLBACK FindMultiDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam);
+static INT_PTR CALLBACK FindInFilesDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam);
 static INT_PTR CALLBACK HelpDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam);
 static INT_PTR CALLBACK AboutDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -160,6 +341,273 @@ static BOOL GetEditText(HWND hwndEdit, WCHAR **bufferOut, int *lengthOut) {
     return TRUE;
 }
 
+// ============================================================================
+// LockEditText / UnlockEditText - Access Edit Control Text Without Copying
+// ============================================================================
+// Returns a read-only pointer to the multi-line edit control's own buffer.
+// The pointer stays valid until UnlockEditText; the control must not be
+// modified in between.
+// Parameters:
+//   hwndEdit  - Handle to edit control
+//   lengthOut - Receives text length in characters (can be NULL)
+// Returns: Pointer to the text, or NULL on failure
+// ============================================================================
+static const WCHAR *LockEditText(HWND hwndEdit, size_t *lengthOut) {
+    HLOCAL handle = (HLOCAL)SendMessageW(hwndEdit, EM_GETHANDLE, 0, 0);
+    const WCHAR *text = handle ? (const WCHAR *)LocalLock(handle) : NULL;
+    if (text && lengthOut) *lengthOut = (size_t)GetWindowTextLengthW(hwndEdit);
+    return text;
+}
+
+static void UnlockEditText(HWND hwndEdit) {
+    HLOCAL handle = (HLOCAL)SendMessageW(hwndEdit, EM_GETHANDLE, 0, 0);
+    if (handle) LocalUnlock(handle);
+}
+
+// ============================================================================
+// SetSearchString - Replace a Find or Replace String
+// ============================================================================
+// Find and replace strings have no length limit; each lives in its own heap
+// block. '*target' is left as it was if out of memory.
+// Returns: TRUE on success
+// ============================================================================
+static BOOL SetSearchString(WCHAR **target, const WCHAR *text, size_t length) {
+    WCHAR *copy = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (length + 1) * sizeof(WCHAR));
+    if (!copy) return FALSE;
+    CopyMemory(copy, text, length * sizeof(WCHAR));
+    copy[length] = L'\0';
+    if (*target) HeapFree(GetProcessHeap(), 0, *target);
+    *target = copy;
+    return TRUE;
+}
+
+// ============================================================================
+// GetLowerFoldTable - Case Folding Table for Literal Search
+// ============================================================================
+// Maps every UTF-16 code unit to its lowercase form using the system's
+// casing rules. Built once, on the first case-insensitive search.
+// Returns: The table, or NULL if out of memory
+// ============================================================================
+static const uint16_t *GetLowerFoldTable(void) {
+    if (!g_app.lowerFold) {
+        uint16_t *table = (uint16_t *)HeapAlloc(GetProcessHeap(), 0, 0x10000 * sizeof(uint16_t));
+        if (!table) return NULL;
+        for (DWORD ch = 0; ch <= 0xFFFF; ++ch) table[ch] = (uint16_t)ch;
+        CharLowerBuffW((LPWSTR)table + 1, 0xFFFF);  // Skip the terminator
+        g_app.lowerFold = table;
+    }
+    return g_app.lowerFold;
+}
+
+// ============================================================================
+// GetWordTable - Word Characters for Whole-Word Search
+// ============================================================================
+// Marks letters, digits (any script), combining marks and '_' in a bitmap
+// laid out as TextIsWordChar expects, using the system's character types.
+// Surrogates count as word characters so that supplementary letters stay
+// inside words. Built once, on the first whole-word search.
+// Returns: The table, or NULL if out of memory
+// ============================================================================
+static const uint8_t *GetWordTable(void) {
+    if (!g_app.wordChars) {
+        uint8_t *table = (uint8_t *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, TEXT_WORD_TABLE_BYTES);
+        if (!table) return NULL;
+        WCHAR units[256];
+        WORD type1[256], type3[256];
+        for (DWORD base = 0; base <= 0xFFFF; base += ARRAYSIZE(units)) {
+            for (DWORD i = 0; i < ARRAYSIZE(units); ++i) units[i] = (WCHAR)(base + i);
+            if (!GetStringTypeW(CT_CTYPE1, units, (int)ARRAYSIZE(units), type1)) ZeroMemory(type1, sizeof(type1));
+            if (!GetStringTypeW(CT_CTYPE3, units, (int)ARRAYSIZE(units), type3)) ZeroMemory(type3, sizeof(type3));
+            for (DWORD i = 0; i < ARRAYSIZE(units); ++i) {
+                DWORD ch = base + i;
+                if ((type1[i] & (C1_ALPHA | C1_DIGIT)) || (type3[i] & C3_NONSPACING) ||
+                    ch == L'_' || (ch >= 0xD800 && ch <= 0xDFFF)) {
+                    table[ch >> 3] |= (uint8_t)(1u << (ch & 7));
+                }
+            }
+        }
+        g_app.wordChars = table;
+    }
+    return g_app.wordChars;
+}
+
+// ============================================================================
+// GetFindRegex - Compiled Pattern for the Find String
+// ============================================================================
+// Compiles the find string as a regular expression and keeps the result
+// until the pattern or the match-case option changes. Syntax errors are
+// reported to the user.
+// Parameters:
+//   needle    - Pattern text
+//   matchCase - TRUE for case-sensitive matching
+// Returns: The compiled pattern, or NULL if it is not valid
+// ============================================================================
+static Regex *GetFindRegex(const WCHAR *needle, BOOL matchCase) {
+    if (g_app.findRegex && g_app.findRegexMatchCase == matchCase &&
+        wcscmp(g_app.findRegexSource, needle) == 0) {
+        return g_app.findRegex;
+    }
+    RegexFree(g_app.findRegex);
+    g_app.findRegex = NULL;
+
+    size_t offset = 0;
+    RegexError error = RegexCompile((const uint16_t *)needle, wcslen(needle), matchCase ? 0 : REGEX_ICASE,
+                                    &g_app.findRegex, &offset);
+    if (error != REGEX_OK) {
+        WCHAR msg[128];
+        if (error == REGEX_ERROR_SYNTAX) {
+            StringCchPrintfW(msg, ARRAYSIZE(msg), L"The regular expression is not valid (position %u).",
+                             (unsigned)offset + 1);
+        } else if (error == REGEX_ERROR_TOO_BIG) {
+            StringCchCopyW(msg, ARRAYSIZE(msg), L"The regular expression is too large.");
+        } else {
+            StringCchCopyW(msg, ARRAYSIZE(msg), L"Not enough memory to search.");
+        }
+        MessageBoxW(g_app.hwndMain, msg, APP_TITLE, MB_ICONWARNING);
+        return NULL;
+    }
+    if (!SetSearchString(&g_app.findRegexSource, needle, wcslen(needle))) {
+        RegexFree(g_app.findRegex);
+        g_app.findRegex = NULL;
+        MessageBoxW(g_app.hwndMain, L"Not enough memory to search.", APP_TITLE, MB_ICONWARNING);
+        return NULL;
+    }
+    g_app.findRegexMatchCase = matchCase;
+    return g_app.findRegex;
+}
+
+// Describes the compiled find pattern to the parallel search, whose worker
+// threads compile their own copies of it
+static void GetFindRegexMatcher(Regex *regex, ChunkMatcher *matcher) {
+    ChunkMatcherRegex(matcher, regex, (const uint16_t *)g_app.findRegexSource, wcslen(g_app.findRegexSource),
+                      g_app.findRegexMatchCase ? 0 : REGEX_ICASE);
+}
+
+// Narrows a regular expression search by the literal its matches start
+// with. Not when ignoring case: the pattern's case folding is not the
+// search index's.
+static const ChunkMatcher *NarrowRegexBySearchIndex(const ChunkMatcher *matcher, Regex *regex, size_t textLength,
+                                                    IndexedMatcher *indexed) {
+    const uint16_t *prefix = NULL;
+    size_t prefixLength = (matcher->regexFlags & REGEX_ICASE) ? 0 : RegexPrefix(regex, &prefix);
+    return NarrowBySearchIndex(matcher, prefix, prefixLength, textLength, indexed);
+}
+
+// ============================================================================
+// FindRegexInEdit - Search for a Regular Expression in Edit Control
+// ============================================================================
+// Regular expression counterpart of FindInEdit. Searches the control's
+// buffer in place, so no copy of the document is made; large documents are
+// searched on all cores (see parallel_search.h).
+// Parameters:
+//   hwndEdit   - Handle to edit control
+//   regex      - Compiled pattern (see GetFindRegex)
+//   searchDown - TRUE to search forward, FALSE for backward
+//   startPos   - Character position to start searching from
+//   match      - Receives the match and its capture groups
+// Returns: TRUE if found, FALSE if not found
+// ============================================================================
+static BOOL FindRegexInEdit(HWND hwndEdit, Regex *regex, BOOL searchDown, DWORD startPos, RegexMatch *match) {
+    if (!regex) return FALSE;
+    size_t len = 0;
+    const uint16_t *text = (const uint16_t *)LockEditText(hwndEdit, &len);
+    if (!text) return FALSE;
+    if (startPos > len) startPos = (DWORD)len;
+
+    ChunkMatcher matcher;
+    IndexedMatcher indexed;
+    GetFindRegexMatcher(regex, &matcher);
+    const ChunkMatcher *search = NarrowRegexBySearchIndex(&matcher, regex, len, &indexed);
+    BOOL found = FALSE;
+    size_t start = 0, end = 0;
+    if (searchDown) {
+        found = ParallelFindFirst(search, text, len, startPos, &start, &end);
+        // An empty match at the caret would be found again on every Find Next
+        if (found && end == startPos && startPos < len) {
+            found = ParallelFindFirst(search, text, len, startPos + 1, &start, &end);
+        }
+        // Wrap around to the beginning
+        if (!found && startPos > 0) {
+            found = ParallelFindFirst(search, text, len, 0, &start, &end);
+        }
+    } else {
+        // Find every match: keep the last one before startPos, or (wrapping
+        // around) the last one in the document
+        MatchIndex all;
+        MatchIndexInit(&all);
+        if (ParallelFindAll(search, text, len, &all) && all.count) {
+            size_t i = MatchIndexLowerBound(&all, startPos);
+            const MatchSpan *span = &all.spans[i > 0 ? i - 1 : all.count - 1];
+            start = (size_t)span->start;
+            end = (size_t)span->end;
+            found = TRUE;
+        }
+        MatchIndexFree(&all);
+    }
+    IndexedMatcherFree(&indexed);
+    // Search the match again on its own for the capture groups
+    if (found) found = RegexSearchWithin(regex, text, len, start, start + 1, match);
+
+    UnlockEditText(hwndEdit);
+    return found;
+}
+
+// ============================================================================
+// ExpandRegexReplacement - Build Replacement Text for a Match
+// ============================================================================
+// Expands $0-$9 / ${n} group references in the replacement template against
+// the current edit control text. Caller must free the result using HeapFree().
+// Returns: The expanded null-terminated text, or NULL on failure
+// ============================================================================
+static WCHAR *ExpandRegexReplacement(HWND hwndEdit, const RegexMatch *match, const WCHAR *replacement) {
+    const uint16_t *text = (const uint16_t *)LockEditText(hwndEdit, NULL);
+    if (!text) return NULL;
+    size_t replLen = wcslen(replacement);
+    size_t needed = RegexExpand(match, text, (const uint16_t *)replacement, replLen, NULL, 0);
+    WCHAR *result = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (needed + 1) * sizeof(WCHAR));
+    if (result) {
+        RegexExpand(match, text, (const uint16_t *)replacement, replLen, (uint16_t *)result, needed);
+        result[needed] = L'\0';
+    }
+    UnlockEditText(hwndEdit);
+    return result;
+}
+
+// Grows a HeapAlloc'd character buffer to hold at least 'needed' characters
+static BOOL ReserveChars(WCHAR **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) return TRUE;
+    size_t newCapacity = *capacity ? *capacity : 256;
+    while (newCapacity < needed) newCapacity *= 2;
+    WCHAR *grown = *buffer
+        ? (WCHAR *)HeapReAlloc(GetProcessHeap(), 0, *buffer, newCapacity * sizeof(WCHAR))
+        : (WCHAR *)HeapAlloc(GetProcessHeap(), 0, newCapacity * sizeof(WCHAR));
+    if (!grown) return FALSE;
+    *buffer = grown;
+    *capacity = newCapacity;
+    return TRUE;
+}
+
+// Last occurrence starting before 'before' in the candidate blocks of a
+// search index query: each stretch of blocks is searched backward on its own
+static size_t FindLastInBlocks(const TrigramQuery *query, const uint16_t *text, size_t length, size_t before,
+                               const uint16_t *needle, size_t needleLength, const uint16_t *fold,
+                               const uint8_t *words) {
+    size_t runStart, runEnd;
+    while (TrigramQueryPrev(query, before, &runStart, &runEnd)) {
+        // Occurrences start in [runStart, limit) and end by 'stop'
+        size_t limit = runEnd < before ? runEnd : before;
+        size_t stop = (length - limit > needleLength - 1) ? limit + needleLength - 1 : length;
+        size_t i = limit - runStart;
+        while ((i = TextFindLast(text + runStart, stop - runStart, i, needle, needleLength, fold)) != TEXT_NOT_FOUND) {
+            if (!words || TextIsWholeWord(text, length, runStart + i, runStart + i + needleLength, words)) {
+                return runStart + i;
+            }
+        }
+        before = runStart;
+    }
+    return TEXT_NOT_FOUND;
+}
+
 // ============================================================================
 // FindInEdit - Search for Text in Edit Control
 // ============================================================================
@@ -167,88 +615,170 @@ static BOOL GetEditText(HWND hwndEdit, WCHAR **bufferOut, int *lengthOut) {
 // - Case-sensitive and case-insensitive search
 // - Forward and backward (reverse) search
 // - Wrap-around search from start position
+// - Regular expressions, when enabled in the Edit menu
 // Parameters:
 //   hwndEdit  - Handle to edit control
 //   needle    - Text to search for
 //   matchCase - TRUE for case-sensitive search
+//   wholeWord - TRUE to find whole words only (ignored for regular expressions)
 //   searchDown- TRUE to search forward, FALSE for backward
 //   startPos  - Character position to start searching from
 //   outStart  - Receives start position of found text
 //   outEnd    - Receives end position of found text
 // Returns: TRUE if found, FALSE if not found
 // ============================================================================
-static BOOL FindInEdit(HWND hwndEdit, const WCHAR *needle, BOOL matchCase, BOOL searchDown, DWORD startPos, DWORD *outStart, DWORD *outEnd) {
+static BOOL FindInEdit(HWND hwndEdit, const WCHAR *needle, BOOL matchCase, BOOL wholeWord, BOOL searchDown,
+                       DWORD startPos, DWORD *outStart, DWORD *outEnd) {
     // Validate search string
     if (!needle || needle[0] == L'\0') return FALSE;
 
-    // Get all text from edit control
-    WCHAR *text = NULL;
-    int len = 0;
-    if (!GetEditText(hwndEdit, &text, &len)) return FALSE;
-
-    // Prepare search - need separate buffers for case-insensitive search
-    size_t needleLen = wcslen(needle);
-    WCHAR *haystack = text;  // Text to search in
-    WCHAR *needleBuf = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (needleLen + 1) * sizeof(WCHAR));
-    if (!needleBuf) {
-        HeapFree(GetProcessHeap(), 0, text);
-        return FALSE;
+    if (g_app.settings.values.findRegex) {
+        RegexMatch match;
+        if (!FindRegexInEdit(hwndEdit, GetFindRegex(needle, matchCase), searchDown, startPos, &match)) return FALSE;
+        *outStart = (DWORD)match.start[0];
+        *outEnd = (DWORD)match.end[0];
+        return TRUE;
     }
-    StringCchCopyW(needleBuf, needleLen + 1, needle);
 
-    // Convert both to lowercase for case-insensitive search
-    if (!matchCase) {
-        CharLowerBuffW(haystack, len);
-        CharLowerBuffW(needleBuf, (DWORD)needleLen);
-    }
+    // Case-insensitive search compares through the lowercase table, so the
+    // control's buffer is searched in place
+    const uint16_t *fold = NULL;
+    const uint8_t *words = NULL;
+    if (!matchCase && !(fold = GetLowerFoldTable())) return FALSE;
+    if (wholeWord && !(words = GetWordTable())) return FALSE;
+    size_t len = 0;
+    const uint16_t *text = (const uint16_t *)LockEditText(hwndEdit, &len);
+    if (!text) return FALSE;
 
     // Clamp start position to valid range
-    if (startPos > (DWORD)len) startPos = (DWORD)len;
+    size_t needleLen = wcslen(needle);
+    if (startPos > len) startPos = (DWORD)len;
 
-    WCHAR *found = NULL;
+    BOOL found = FALSE;
+    size_t start = 0, end = 0;
     if (searchDown) {
-        // Forward search: Start from startPos and wrap to beginning if needed
-        // Search from startPos to end
-        found = wcsstr(haystack + startPos, needleBuf);
-        // If not found and we didn't start at beginning, wrap around
+        // Forward search: from startPos to the end, on all cores for large
+        // documents, then wrap around to the beginning
+        ChunkMatcher matcher;
+        IndexedMatcher indexed;
+        ChunkMatcherLiteral(&matcher, (const uint16_t *)needle, needleLen, fold, words);
+        const ChunkMatcher *search = NarrowBySearchIndex(&matcher, (const uint16_t *)needle, needleLen, len, &indexed);
+        found = ParallelFindFirst(search, text, len, startPos, &start, &end);
         if (!found && startPos > 0) {
-            found = wcsstr(haystack, needleBuf);
+            found = ParallelFindFirst(search, text, len, 0, &start, &end);
         }
+        IndexedMatcherFree(&indexed);
     } else {
-        // Backward search: Find last occurrence before startPos
-        WCHAR *p = haystack;
-        while ((p = wcsstr(p, needleBuf)) != NULL) {
-            DWORD idx = (DWORD)(p - haystack);
-            if (idx < startPos) {
-                found = p;  // Keep updating with each match before startPos
-                p++;
-            } else {
-                break;      // Stop when we reach/pass startPos
+        // Backward search: last occurrence before startPos, or (wrapping
+        // around) the last one in the document
+        TrigramQuery query;
+        if (SearchIndexQuery(&query, (const uint16_t *)needle, needleLen, len)) {
+            start = FindLastInBlocks(&query, text, len, startPos, (const uint16_t *)needle, needleLen, fold, words);
+            if (start == TEXT_NOT_FOUND) {
+                start = FindLastInBlocks(&query, text, len, len, (const uint16_t *)needle, needleLen, fold, words);
             }
-        }
-        // If not found before startPos, wrap around and find last occurrence
-        if (!found && startPos < (DWORD)len) {
-            p = haystack + startPos;
-            while ((p = wcsstr(p, needleBuf)) != NULL) {
-                found = p;
-                p++;
+            TrigramQueryFree(&query);
+        } else {
+            start = TextFindLastWord(text, len, startPos, (const uint16_t *)needle, needleLen, fold, words);
+            if (start == TEXT_NOT_FOUND) {
+                start = TextFindLastWord(text, len, len, (const uint16_t *)needle, needleLen, fold, words);
             }
         }
+        found = start != TEXT_NOT_FOUND;
+        end = start + needleLen;
     }
+    UnlockEditText(hwndEdit);
 
-    // If found, calculate positions and return TRUE
-    BOOL result = FALSE;
     if (found) {
-        DWORD pos = (DWORD)(found - haystack);
-        *outStart = pos;
-        *outEnd = pos + (DWORD)needleLen;
-        result = TRUE;
+        *outStart = (DWORD)start;
+        *outEnd = (DWORD)end;
     }
+    return found;
+}
 
-    // Clean up allocated memory
-    HeapFree(GetProcessHeap(), 0, text);
-    HeapFree(GetProcessHeap(), 0, needleBuf);
-    return result;
+// ============================================================================
+// ReplaceAllRegex - Replace All Matches of a Regular Expression
+// ============================================================================
+// Finds every match (on all cores for large documents), then builds the new
+// text in one pass over the control's buffer; each match is replaced by the
+// template expanded with its capture groups. Like
+// ReplaceAllOccurrences, all replacements form a single undo step.
+// Returns: Number of replacements made
+// ============================================================================
+static int ReplaceAllRegex(HWND hwndEdit, Regex *regex, const WCHAR *replacement) {
+    size_t len = 0;
+    const uint16_t *text = (const uint16_t *)LockEditText(hwndEdit, &len);
+    if (!text) return 0;
+
+    size_t replLen = wcslen(replacement);
+    WCHAR *result = NULL;
+    size_t capacity = 0, outLen = 0;
+    size_t copied = 0;      // Text before this offset is already in 'result'
+    int count = 0;
+    BOOL ok = ReserveChars(&result, &capacity, len + 1);
+    RegexMatch match;
+
+    // Find the matches on all cores, then search each again on its own for
+    // its capture groups
+    ChunkMatcher matcher;
+    IndexedMatcher indexed;
+    GetFindRegexMatcher(regex, &matcher);
+    const ChunkMatcher *search = NarrowRegexBySearchIndex(&matcher, regex, len, &indexed);
+    MatchIndex matches;
+    MatchIndexInit(&matches);
+    if (ok) ok = ParallelFindAll(search, text, len, &matches);
+    IndexedMatcherFree(&indexed);
+
+    for (size_t i = 0; ok && i < matches.count; ++i) {
+        size_t start = (size_t)matches.spans[i].start;
+        if (!RegexSearchWithin(regex, text, len, start, start + 1, &match)) continue;
+        size_t end = match.end[0];
+        size_t expanded = RegexExpand(&match, text, (const uint16_t *)replacement, replLen, NULL, 0);
+        ok = ReserveChars(&result, &capacity, outLen + (start - copied) + expanded + 1);
+        if (!ok) break;
+
+        // Copy everything before the match, then the expanded template
+        CopyMemory(result + outLen, text + copied, (start - copied) * sizeof(WCHAR));
+        outLen += start - copied;
+        RegexExpand(&match, text, (const uint16_t *)replacement, replLen, (uint16_t *)result + outLen, expanded);
+
+        // One undo step for everything; offsets are positions in the result
+        if (count == 0) UndoLogBeginGroup(&g_app.undo);
+        UndoLogRecord(&g_app.undo, (uint64_t)outLen, text + start, end - start,
+                      (const uint16_t *)result + outLen, expanded, UNDO_KIND_OTHER);
+        JournalAppend(&g_app.journal, (ULONGLONG)outLen, end - start, result + outLen, expanded);
+        outLen += expanded;
+        copied = end;
+        count++;
+    }
+    if (count) UndoLogEndGroup(&g_app.undo);
+    MatchIndexFree(&matches);
+
+    // Copy any remaining text after the last match
+    if (ok && count) ok = ReserveChars(&result, &capacity, outLen + (len - copied) + 1);
+    if (ok && count) {
+        CopyMemory(result + outLen, text + copied, (len - copied) * sizeof(WCHAR));
+        outLen += len - copied;
+        result[outLen] = L'\0';
+    }
+    if (count && !ok) {
+        // The recorded edits are never applied: drop them from the history
+        // and journal the unchanged text over what was logged so far
+        JournalAppend(&g_app.journal, 0, outLen + (len - copied), (const WCHAR *)text, len);
+        UndoLogClear(&g_app.undo);
+        count = 0;
+    }
+    UnlockEditText(hwndEdit);
+
+    if (count) {
+        SetEditTextRecorded(hwndEdit, result);
+        SendMessageW(hwndEdit, EM_SETMODIFY, TRUE, 0);
+        g_app.modified = TRUE;
+        UpdateTitle(g_app.hwndMain);
+        NoteTextReplaced();
+    }
+    if (result) HeapFree(GetProcessHeap(), 0, result);
+    return count;
 }
 
 // ============================================================================
@@ -256,7 +786,7 @@ static BOOL FindInEdit(HWND hwndEdit, const WCHAR *needle, BOOL matchCase, BOOL
 // ============================================================================
 // Finds all occurrences of search text and replaces them with replacement text.
 // Efficiently handles the replacement by:
-//   1. Counting occurrences first
+//   1. Finding every occurrence first
 //   2. Allocating appropriate buffer for result
 //   3. Building new text with replacements
 //   4. Setting edit control text once
@@ -265,112 +795,101 @@ static BOOL FindInEdit(HWND hwndEdit, const WCHAR *needle, BOOL matchCase, BOOL
 //   needle      - Text to search for
 //   replacement - Text to replace with
 //   matchCase   - TRUE for case-sensitive search
+//   wholeWord   - TRUE to replace whole words only (ignored for regular expressions)
 // Returns: Number of replacements made
 // ============================================================================
-static int ReplaceAllOccurrences(HWND hwndEdit, const WCHAR *needle, const WCHAR *replacement, BOOL matchCase) {
+static int ReplaceAllOccurrences(HWND hwndEdit, const WCHAR *needle, const WCHAR *replacement, BOOL matchCase,
+                                 BOOL wholeWord) {
     // Validate search string
     if (!needle || needle[0] == L'\0') return 0;
 
-    // Get all text from edit control
-    WCHAR *text = NULL;
-    int len = 0;
-    if (!GetEditText(hwndEdit, &text, &len)) return 0;
+    if (g_app.settings.values.findRegex) {
+        Regex *regex = GetFindRegex(needle, matchCase);
+        return regex ? ReplaceAllRegex(hwndEdit, regex, replacement ? replacement : L"") : 0;
+    }
+
+    const uint16_t *fold = NULL;
+    const uint8_t *words = NULL;
+    if (!matchCase && !(fold = GetLowerFoldTable())) return 0;
+    if (wholeWord && !(words = GetWordTable())) return 0;
+    size_t len = 0;
+    const WCHAR *text = LockEditText(hwndEdit, &len);
+    if (!text) return 0;
 
     size_t needleLen = wcslen(needle);
     size_t replLen = replacement ? wcslen(replacement) : 0;
 
-    // Create separate buffers for case-insensitive comparison
-    // searchBuf: lowercase copy for searching (if case-insensitive)
-    // needleBuf: lowercase copy of search string (if case-insensitive)
-    WCHAR *searchBuf = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (len + 1) * sizeof(WCHAR));
-    WCHAR *needleBuf = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (needleLen + 1) * sizeof(WCHAR));
-    if (!searchBuf || !needleBuf) {
-        HeapFree(GetProcessHeap(), 0, text);
-        if (searchBuf) HeapFree(GetProcessHeap(), 0, searchBuf);
-        if (needleBuf) HeapFree(GetProcessHeap(), 0, needleBuf);
-        return 0;
-    }
-    StringCchCopyW(searchBuf, len + 1, text);
-    StringCchCopyW(needleBuf, needleLen + 1, needle);
-
-    // Convert to lowercase for case-insensitive search
-    if (!matchCase) {
-        CharLowerBuffW(searchBuf, len);
-        CharLowerBuffW(needleBuf, (DWORD)needleLen);
-    }
+    // First pass: Find every occurrence (on all cores for large documents)
+    ChunkMatcher matcher;
+    IndexedMatcher indexed;
+    ChunkMatcherLiteral(&matcher, (const uint16_t *)needle, needleLen, fold, words);
+    const ChunkMatcher *search = NarrowBySearchIndex(&matcher, (const uint16_t *)needle, needleLen, len, &indexed);
+    MatchIndex matches;
+    MatchIndexInit(&matches);
+    size_t count = ParallelFindAll(search, (const uint16_t *)text, len, &matches) ? matches.count : 0;
+    IndexedMatcherFree(&indexed);
 
-    // First pass: Count occurrences to calculate result buffer size
-    int count = 0;
-    WCHAR *p = searchBuf;
-    while ((p = wcsstr(p, needleBuf)) != NULL) {
-        count++;
-        p += needleLen;
+    // Calculate new length: original - (count * oldLen) + (count * newLen)
+    WCHAR *result = NULL;
+    if (count) {
+        size_t newLen = len - count * needleLen + count * replLen;
+        result = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (newLen + 1) * sizeof(WCHAR));
     }
-    
     // Nothing to replace
-    if (count == 0) {
-        HeapFree(GetProcessHeap(), 0, text);
-        HeapFree(GetProcessHeap(), 0, searchBuf);
-        HeapFree(GetProcessHeap(), 0, needleBuf);
-        return 0;
-    }
-
-    // Calculate new length: original - (count * oldLen) + (count * newLen)
-    size_t newLen = (size_t)len - (size_t)count * needleLen + (size_t)count * replLen;
-    WCHAR *result = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (newLen + 1) * sizeof(WCHAR));
     if (!result) {
-        HeapFree(GetProcessHeap(), 0, text);
-        HeapFree(GetProcessHeap(), 0, searchBuf);
-        HeapFree(GetProcessHeap(), 0, needleBuf);
+        UnlockEditText(hwndEdit);
+        MatchIndexFree(&matches);
         return 0;
     }
 
-    // Second pass: Build result string with replacements
-    // We iterate through searchBuf to find matches, but copy from origCur (text)
-    // to preserve original case for non-matching parts
+    // Second pass: Build result string with replacements, copying the text
+    // between matches from the original
     WCHAR *dst = result;          // Destination pointer in result buffer
-    WCHAR *searchCur = searchBuf; // Current position in lowercase search buffer
-    WCHAR *origCur = text;        // Current position in original text
-    
-    while ((p = wcsstr(searchCur, needleBuf)) != NULL) {
+    size_t copied = 0;            // Text before this offset is already in 'result'
+
+    // Every replacement goes into one undo step. Offsets are positions in
+    // the result, which is the text as it stands after earlier replacements.
+    UndoLogBeginGroup(&g_app.undo);
+    for (size_t i = 0; i < count; ++i) {
         // Copy everything before the match
-        size_t delta = (size_t)(p - searchCur);
-        CopyMemory(dst, origCur, delta * sizeof(WCHAR));
-        dst += delta;
-        origCur += delta;
-        searchCur += delta;
+        size_t start = (size_t)matches.spans[i].start;
+        CopyMemory(dst, text + copied, (start - copied) * sizeof(WCHAR));
+        dst += start - copied;
+
+        // Record the replacement (a few bytes; repeated strings are shared)
+        UndoLogRecord(&g_app.undo, (uint64_t)(dst - result),
+                      (const uint16_t *)text + start, needleLen,
+                      (const uint16_t *)replacement, replLen, UNDO_KIND_OTHER);
+        JournalAppend(&g_app.journal, (ULONGLONG)(dst - result), needleLen, replacement, replLen);
 
         // Insert replacement text
         if (replLen) {
             CopyMemory(dst, replacement, replLen * sizeof(WCHAR));
             dst += replLen;
         }
-        
+
         // Skip past the matched text in original
-        origCur += needleLen;
-        searchCur += needleLen;
+        copied = start + needleLen;
     }
-    
+    UndoLogEndGroup(&g_app.undo);
+
     // Copy any remaining text after last match
-    size_t tail = wcslen(origCur);
-    CopyMemory(dst, origCur, tail * sizeof(WCHAR));
-    dst += tail;
+    CopyMemory(dst, text + copied, (len - copied) * sizeof(WCHAR));
+    dst += len - copied;
     *dst = L'\0';  // Null-terminate the result
+    UnlockEditText(hwndEdit);
+    MatchIndexFree(&matches);
 
     // Update the edit control with new text
-    SetWindowTextW(hwndEdit, result);
-    
-    // Clean up all allocated memory
-    HeapFree(GetProcessHeap(), 0, text);
-    HeapFree(GetProcessHeap(), 0, searchBuf);
-    HeapFree(GetProcessHeap(), 0, needleBuf);
+    SetEditTextRecorded(hwndEdit, result);
     HeapFree(GetProcessHeap(), 0, result);
-    
+
     // Mark document as modified
     SendMessageW(hwndEdit, EM_SETMODIFY, TRUE, 0);
     g_app.modified = TRUE;
     UpdateTitle(g_app.hwndMain);
-    return count;
+    NoteTextReplaced();
+    return (int)count;
 }
 
 // ============================================================================
@@ -413,117 +932,618 @@ static void ApplyFontToEdit(HWND hwndEdit, HFONT font) {
 }
 
 // ============================================================================
-// CreateEditControl - Create or Recreate the Edit Control
+// Undo Target Callbacks - How the Undo Log Changes the Edit Control
 // ============================================================================
-// Creates the main multi-line edit control that serves as the text editor.
-// This function is called:
-// - On startup to create the initial control
-// - When toggling word wrap (requires recreating with different styles)
-// The function destroys the old control if it exists, creates a new one with
-// appropriate styles, and resizes it to fill the available space.
+// Single records are replayed as a selection replace. Large Replace All
+// groups are rebuilt in one pass from the control's own buffer and set
+// back with a single SetWindowTextW.
 // ============================================================================
-static void CreateEditControl(HWND hwnd) {
-    // Destroy existing edit control if present
-    if (g_app.hwndEdit) {
-        DestroyWindow(g_app.hwndEdit);
-    }
+static void UndoReplaceText(void *context, uint64_t offset, uint64_t removeLength, const uint16_t *insert, size_t insertLength) {
+    HWND hwndEdit = (HWND)context;
+    // EM_REPLACESEL needs a null-terminated string; arena text is not
+    WCHAR *text = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (insertLength + 1) * sizeof(WCHAR));
+    if (!text) return;
+    CopyMemory(text, insert, insertLength * sizeof(WCHAR));
+    text[insertLength] = L'\0';
+    SendMessageW(hwndEdit, EM_SETSEL, (WPARAM)offset, (LPARAM)(offset + removeLength));
+    SendMessageW(hwndEdit, EM_REPLACESEL, FALSE, (LPARAM)text);
+    HeapFree(GetProcessHeap(), 0, text);
+}
 
-    // Build style flags for the edit control
-    // Base styles:
-    //   WS_CHILD - Child window of main window
-    //   WS_VISIBLE - Visible by default
-    //   WS_VSCROLL - Vertical scrollbar
-    //   ES_MULTILINE - Multiple lines (essential for text editor)
-    //   ES_AUTOVSCROLL - Auto-scroll vertically when typing past end
-    //   ES_WANTRETURN - Enter key adds newline (vs. default button)
-    //   ES_NOHIDESEL - Show selection even when control loses focus
-    DWORD style = WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_AUTOVSCROLL | ES_WANTRETURN | ES_NOHIDESEL;
-    
-    // Add horizontal scroll only when word wrap is off
-    if (!g_app.wordWrap) {
-        style |= WS_HSCROLL | ES_AUTOHSCROLL;
-    }
+static const uint16_t *UndoLockText(void *context, size_t *lengthOut) {
+    return (const uint16_t *)LockEditText((HWND)context, lengthOut);
+}
 
-    // Create the edit control
-    // WS_EX_CLIENTEDGE gives it a sunken 3D border
-    // "EDIT" is the Windows built-in edit control class
-    g_app.hwndEdit = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", NULL, style, 0, 0, 0, 0, hwnd, (HMENU)1, g_hInst, NULL);
-    
-    // Apply current font if one is set
-    if (g_app.hwndEdit && g_app.hFont) {
-        ApplyFontToEdit(g_app.hwndEdit, g_app.hFont);
-    }
-    
-    // Remove text length limit (default is ~32KB) to allow large files
-    SendMessageW(g_app.hwndEdit, EM_SETLIMITTEXT, 0, 0);
-    
-    // Position and size the edit control
-    UpdateLayout(hwnd);
+static void UndoUnlockText(void *context) {
+    UnlockEditText((HWND)context);
+}
+
+static void UndoSetText(void *context, const uint16_t *text, size_t length) {
+    UNREFERENCED_PARAMETER(length);
+    SetEditTextRecorded((HWND)context, (LPCWSTR)text);
+}
+
+// Mirrors an undo or redo step into the crash journal
+static void JournalUndoStep(void *context, uint64_t offset, uint64_t removeLength, const uint16_t *insert, size_t insertLength) {
+    UNREFERENCED_PARAMETER(context);
+    JournalAppend(&g_app.journal, offset, removeLength, (const WCHAR *)insert, insertLength);
 }
 
 // ============================================================================
-// ToggleStatusBar - Show or Hide the Status Bar
+// DoUndo - Undo or Redo One Step
 // ============================================================================
-// Controls the visibility of the status bar at the bottom of the window.
-// When shown, the status bar displays line number, column, and total lines.
+// Replays one group from the undo log, places the caret after the restored
+// text and clears the modified flag when the document is back in the state
+// it was last saved in.
 // ============================================================================
-static void ToggleStatusBar(HWND hwnd, BOOL visible) {
-    g_app.statusVisible = visible;
-    if (visible) {
-        // Create status bar if it doesn't exist
-        if (!g_app.hwndStatus) {
-            // SBARS_SIZEGRIP adds the resize grip in bottom-right corner
-            g_app.hwndStatus = CreateStatusWindowW(WS_CHILD | SBARS_SIZEGRIP, L"", hwnd, 2);
-        }
-        ShowWindow(g_app.hwndStatus, SW_SHOW);
-    } else if (g_app.hwndStatus) {
-        ShowWindow(g_app.hwndStatus, SW_HIDE);
-    }
-    // Resize edit control to account for status bar visibility
-    UpdateLayout(hwnd);
+static void DoUndo(HWND hwnd, BOOL redo) {
+    HWND edit = g_app.hwndEdit;
+    UndoTarget target = { edit, UndoReplaceText, UndoLockText, UndoUnlockText, UndoSetText };
+    uint64_t caret = 0;
+
+    // Suppress capture and painting while the log edits the control
+    g_app.undoReplaying = TRUE;
+    SendMessageW(edit, WM_SETREDRAW, FALSE, 0);
+    BOOL done = redo ? UndoLogRedo(&g_app.undo, &target, &caret) : UndoLogUndo(&g_app.undo, &target, &caret);
+    SendMessageW(edit, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(edit, NULL, TRUE);
+    g_app.undoReplaying = FALSE;
+    if (!done) return;
+    UndoLogDescribeLastStep(&g_app.undo, redo != FALSE, JournalUndoStep, NULL);
+    NoteTextReplaced();
+
+    SendMessageW(edit, EM_SETSEL, (WPARAM)caret, (LPARAM)caret);
+    SendMessageW(edit, EM_SCROLLCARET, 0, 0);
+
+    g_app.modified = !UndoLogAtSavePoint(&g_app.undo);
+    SendMessageW(edit, EM_SETMODIFY, g_app.modified, 0);
+    UpdateTitle(hwnd);
     UpdateStatusBar(hwnd);
-    
-    // Save status bar preference to registry
-    SaveStatusBarSetting(visible);
 }
 
 // ============================================================================
-// UpdateLayout - Resize Child Windows to Fit Parent
+// Edit Capture - Record What an Edit Message Changed
 // ============================================================================
-// Calculates and applies proper sizes and positions for the edit control and
-// status bar based on the current window size. Called when:
-// - Window is resized
-// - Status bar visibility changes
-// - Edit control is recreated (e.g., word wrap toggle)
+// Before a message that may change the text, we save the selection, the
+// text length and a copy of the text the edit could remove: the selection
+// plus a margin on each side for Backspace, Delete and their Ctrl variants.
+// Afterwards the caret and the new length describe the change exactly:
+//   start    = min(old selection start, new caret)
+//   inserted = new caret - start
+//   removed  = old length - new length + inserted
 // ============================================================================
-static void UpdateLayout(HWND hwnd) {
-    // Get the client area size of main window
-    RECT rc;
-    GetClientRect(hwnd, &rc);
+typedef struct EditCapture {
+    DWORD selStart;             // Selection start before the edit
+    size_t oldLength;           // Text length before the edit
+    size_t windowStart;         // Document offset of the saved text
+    size_t windowLength;        // Characters saved
+    WCHAR *window;              // Copy of the text the edit may remove
+    UndoKind kind;              // Kind of edit, for undo grouping
+} EditCapture;
 
-    int statusHeight = 0;
-    if (g_app.statusVisible && g_app.hwndStatus) {
-        // Tell status bar to resize itself (calculates its own height)
-        SendMessageW(g_app.hwndStatus, WM_SIZE, 0, 0);
-        // Get the calculated height
-        RECT sbrc;
-        GetWindowRect(g_app.hwndStatus, &sbrc);
-        statusHeight = sbrc.bottom - sbrc.top;
-        // Position status bar at bottom of window
-        MoveWindow(g_app.hwndStatus, 0, rc.bottom - statusHeight, rc.right, statusHeight, TRUE);
-    }
+static BOOL BeginEditCapture(HWND hwndEdit, EditCapture *capture, UndoKind kind, size_t margin) {
+    DWORD start = 0, end = 0;
+    SendMessageW(hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
 
-    // Resize edit control to fill remaining space (excluding status bar)
-    if (g_app.hwndEdit) {
-        MoveWindow(g_app.hwndEdit, 0, 0, rc.right, rc.bottom - statusHeight, TRUE);
+    size_t length = 0;
+    const WCHAR *text = LockEditText(hwndEdit, &length);
+    if (!text) return FALSE;
+
+    size_t windowEnd = ((size_t)end + margin < length) ? (size_t)end + margin : length;
+    capture->selStart = start;
+    capture->oldLength = length;
+    capture->windowStart = (start > margin) ? start - margin : 0;
+    capture->windowLength = windowEnd - capture->windowStart;
+    capture->kind = kind;
+    capture->window = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, (capture->windowLength + 1) * sizeof(WCHAR));
+    if (capture->window) {
+        CopyMemory(capture->window, text + capture->windowStart, capture->windowLength * sizeof(WCHAR));
     }
+    UnlockEditText(hwndEdit);
+
+    g_app.editChanged = FALSE;
+    return capture->window != NULL;
 }
 
-// ============================================================================
-// PromptSaveChanges - Ask User to Save Unsaved Changes
-// ============================================================================
-// If the document has been modified, shows a Yes/No/Cancel dialog asking
-// if the user wants to save changes. Used before:
+static void EndEditCapture(HWND hwndEdit, EditCapture *capture) {
+    if (g_app.editChanged) {
+        DWORD caret = 0;
+        SendMessageW(hwndEdit, EM_GETSEL, 0, (LPARAM)&caret);
+
+        size_t length = 0;
+        const WCHAR *text = LockEditText(hwndEdit, &length);
+        size_t start = (caret < capture->selStart) ? caret : capture->selStart;
+        size_t inserted = caret - start;
+        size_t removed = 0;
+        BOOL described = FALSE;
+        BOOL recorded = FALSE;
+
+        if (text && capture->oldLength + inserted >= length && start + inserted <= length) {
+            removed = capture->oldLength + inserted - length;
+            if (start >= capture->windowStart && start + removed <= capture->windowStart + capture->windowLength) {
+                described = TRUE;
+                recorded = UndoLogRecord(&g_app.undo, start,
+                                         (const uint16_t *)capture->window + (start - capture->windowStart), removed,
+                                         (const uint16_t *)text + start, inserted, capture->kind);
+                JournalAppend(&g_app.journal, start, removed, text + start, inserted);
+            } else {
+                // Journal the whole text instead, so recovery stays exact
+                JournalAppend(&g_app.journal, 0, capture->oldLength, text, length);
+            }
+        }
+        if (text) UnlockEditText(hwndEdit);
+
+        // A change we cannot describe would corrupt later undos; drop history
+        if (!recorded) UndoLogClear(&g_app.undo);
+        if (described) {
+            NoteEdit(start, removed, inserted);
+        } else {
+            NoteTextReplaced();
+        }
+    }
+    HeapFree(GetProcessHeap(), 0, capture->window);
+}
+
+// Sets the control's text for a change the caller records itself (a new
+// document, a load, Replace All, the word wrap swap), so it is not taken
+// for an edit the capture missed
+static void SetEditTextRecorded(HWND hwndEdit, const WCHAR *text) {
+    g_app.captureDepth++;
+    SetWindowTextW(hwndEdit, text);
+    g_app.captureDepth--;
+    g_app.editLength = (size_t)GetWindowTextLengthW(hwndEdit);
+}
+
+// EN_CHANGE outside any capture: the text changed in a way no capture
+// described, so nothing recorded about it can be trusted. The journal
+// takes the whole text over the length last seen, so recovery stays exact.
+static void NoteUncapturedEdit(void) {
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (text) {
+        JournalAppend(&g_app.journal, 0, g_app.editLength, text, length);
+        UnlockEditText(g_app.hwndEdit);
+    }
+    UndoLogClear(&g_app.undo);
+    NoteTextReplaced();
+}
+
+// Messages that may change the control's text, or move its buffer
+static BOOL MayChangeText(UINT msg, WPARAM wParam) {
+    switch (msg) {
+    case WM_CHAR:
+    case WM_IME_CHAR:
+    case WM_IME_COMPOSITION:
+    case WM_CUT:
+    case WM_PASTE:
+    case WM_CLEAR:
+    case WM_UNDO:
+    case EM_UNDO:
+    case EM_REPLACESEL:
+    case EM_SETHANDLE:
+    case EM_FMTLINES:
+    case WM_SETTEXT:
+    case WM_DESTROY:
+        return TRUE;
+    case WM_KEYDOWN:
+        return wParam == VK_DELETE || wParam == VK_INSERT;
+    default:
+        return FALSE;
+    }
+}
+
+// ============================================================================
+// Buffered Painting - Flicker-Free Editor and Status Bar
+// ============================================================================
+// The edit control and the status bar paint into one shared off-screen
+// bitmap, which is then copied to the screen, so a repaint never shows a
+// half-erased window. Only the invalid rectangle is drawn and copied: the
+// control paints through a DC clipped to it. Scrolling still moves the
+// pixels already on screen, and typing is still drawn by the control
+// directly; both leave only a strip or a line to paint. The screen is never
+// erased, since the buffer is. Turning off the BufferedPaint setting paints
+// the old way, and the PaintTiming setting shows the editor's paint times
+// in the status bar, to compare the two.
+// ============================================================================
+static HDC GetBackBuffer(HDC screen, int width, int height) {
+    if (g_app.backDC && width <= g_app.backWidth && height <= g_app.backHeight) return g_app.backDC;
+
+    // Grow to cover the largest control painted so far
+    if (width < g_app.backWidth) width = g_app.backWidth;
+    if (height < g_app.backHeight) height = g_app.backHeight;
+    HDC dc = g_app.backDC ? g_app.backDC : CreateCompatibleDC(screen);
+    if (!dc) return NULL;
+    HBITMAP bitmap = CreateCompatibleBitmap(screen, width, height);
+    if (!bitmap) {
+        if (!g_app.backDC) DeleteDC(dc);
+        return NULL;
+    }
+    HBITMAP previous = (HBITMAP)SelectObject(dc, bitmap);
+    if (g_app.backBitmap) {
+        DeleteObject(g_app.backBitmap);
+    } else {
+        g_app.backOldBitmap = previous;
+    }
+    g_app.backDC = dc;
+    g_app.backBitmap = bitmap;
+    g_app.backWidth = width;
+    g_app.backHeight = height;
+    return dc;
+}
+
+static void FreeBackBuffer(void) {
+    if (g_app.backDC) {
+        SelectObject(g_app.backDC, g_app.backOldBitmap);
+        DeleteDC(g_app.backDC);
+    }
+    if (g_app.backBitmap) DeleteObject(g_app.backBitmap);
+    g_app.backDC = NULL;
+    g_app.backBitmap = NULL;
+    g_app.backOldBitmap = NULL;
+    g_app.backWidth = g_app.backHeight = 0;
+}
+
+// Paints a control whose original window procedure is 'proc' through the
+// back buffer (straight to the screen if no buffer can be had)
+static void PaintBuffered(HWND hwnd, WNDPROC proc) {
+    PAINTSTRUCT ps;
+    HDC screen = BeginPaint(hwnd, &ps);
+    if (!screen) return;
+    RECT client;
+    GetClientRect(hwnd, &client);
+    const RECT *dirty = &ps.rcPaint;
+    HDC dc = IsRectEmpty(dirty) ? NULL : GetBackBuffer(screen, client.right, client.bottom);
+    HDC target = dc ? dc : screen;
+
+    int saved = SaveDC(target);
+    IntersectClipRect(target, dirty->left, dirty->top, dirty->right, dirty->bottom);
+    CallWindowProcW(proc, hwnd, WM_ERASEBKGND, (WPARAM)target, 0);
+    CallWindowProcW(proc, hwnd, WM_PRINTCLIENT, (WPARAM)target, PRF_CLIENT);
+    RestoreDC(target, saved);
+    if (dc) {
+        BitBlt(screen, dirty->left, dirty->top, dirty->right - dirty->left, dirty->bottom - dirty->top,
+               dc, dirty->left, dirty->top, SRCCOPY);
+    }
+    EndPaint(hwnd, &ps);
+}
+
+// WM_PAINT of a subclassed control, timed into 'timing' if not NULL
+static LRESULT PaintControl(HWND hwnd, WNDPROC proc, WPARAM wParam, LPARAM lParam, PaintTiming *timing) {
+    LARGE_INTEGER start, end;
+    if (timing) QueryPerformanceCounter(&start);
+    LRESULT result = 0;
+    if (g_app.settings.values.bufferedPaint && !wParam) {
+        PaintBuffered(hwnd, proc);
+    } else {
+        result = CallWindowProcW(proc, hwnd, WM_PAINT, wParam, lParam);   // Unbuffered, or into a given DC
+    }
+    if (timing) {
+        QueryPerformanceCounter(&end);
+        ULONGLONG ticks = (ULONGLONG)(end.QuadPart - start.QuadPart);
+        timing->frames++;
+        timing->totalTicks += ticks;
+        if (ticks > timing->worstTicks) timing->worstTicks = ticks;
+    }
+    return result;
+}
+
+// ============================================================================
+// StatusSubclassProc - Window Procedure Hook for the Status Bar
+// ============================================================================
+static LRESULT CALLBACK StatusSubclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == WM_ERASEBKGND && g_app.settings.values.bufferedPaint) return 1;   // The buffer is erased instead
+    if (msg == WM_PAINT) return PaintControl(hwnd, g_app.statusProc, wParam, lParam, NULL);
+    return CallWindowProcW(g_app.statusProc, hwnd, msg, wParam, lParam);
+}
+
+// ============================================================================
+// EditSubclassProc - Window Procedure Hook for the Edit Control
+// ============================================================================
+// Takes over the control's built-in single-level undo, captures every
+// message that edits text, and ends typing groups when the caret is moved
+// with the mouse or navigation keys.
+// ============================================================================
+static LRESULT CALLBACK EditSubclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    UndoKind kind = UNDO_KIND_OTHER;
+    size_t margin = 0;
+
+    // The match count reads the buffer on another thread: stop it before
+    // anything can change or move the text, and count again once editing
+    // pauses (the message may turn out to change nothing)
+    if (g_app.counter && MayChangeText(msg, wParam)) CountTextChanged();
+
+    switch (msg) {
+    case WM_UNDO:
+    case EM_UNDO:
+        DoUndo(g_app.hwndMain, FALSE);
+        return TRUE;
+    case EM_CANUNDO:
+        return UndoLogCanUndo(&g_app.undo);
+
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+        UndoLogSeal(&g_app.undo);
+        return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+
+    case WM_KEYDOWN:
+        switch (wParam) {
+        case VK_LEFT: case VK_RIGHT: case VK_UP: case VK_DOWN:
+        case VK_HOME: case VK_END: case VK_PRIOR: case VK_NEXT:
+            UndoLogSeal(&g_app.undo);
+            return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+        case VK_DELETE:     // Shift+Del (cut), Ctrl+Del (delete word)
+            kind = UNDO_KIND_DELETE;
+            margin = UNDO_CAPTURE_MARGIN;
+            break;
+        case VK_INSERT:     // Shift+Ins (paste)
+            break;
+        default:
+            return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+        }
+        break;
+
+    case WM_CHAR:
+        // Backspace and Ctrl+Backspace delete; everything else types
+        kind = (wParam == VK_BACK || wParam == 0x7F) ? UNDO_KIND_DELETE : UNDO_KIND_TYPING;
+        margin = UNDO_CAPTURE_MARGIN;
+        break;
+
+    case WM_IME_COMPOSITION:
+        // Only a committed result string reaches the text
+        if (!(lParam & GCS_RESULTSTR)) return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+        kind = UNDO_KIND_TYPING;
+        margin = UNDO_CAPTURE_MARGIN;
+        break;
+    case WM_IME_CHAR:
+        kind = UNDO_KIND_TYPING;
+        margin = UNDO_CAPTURE_MARGIN;
+        break;
+
+    case WM_CUT:
+    case WM_PASTE:
+    case WM_CLEAR:
+    case EM_REPLACESEL:
+        break;
+
+    case WM_ERASEBKGND:
+        if (g_app.settings.values.bufferedPaint) return 1;   // The buffer is erased instead
+        return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+
+    case WM_PAINT: {
+        // Scrolling repaints the control; the gutter follows it
+        LRESULT result = PaintControl(hwnd, g_app.editProc, wParam, lParam, &g_app.paintTiming);
+        LineGutterSync(&g_app.gutter);
+        return result;
+    }
+
+    default:
+        return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+    }
+
+    // Undo replay and messages nested inside a captured edit are not recorded
+    if (g_app.undoReplaying || g_app.captureDepth > 0) {
+        return CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+    }
+
+    EditCapture capture;
+    if (!BeginEditCapture(hwnd, &capture, kind, margin)) {
+        // Out of memory: lose the history, but keep the journal exact
+        size_t oldLength = (size_t)GetWindowTextLengthW(hwnd);
+        g_app.captureDepth++;
+        LRESULT result = CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+        g_app.captureDepth--;
+        size_t length = 0;
+        const WCHAR *text = LockEditText(hwnd, &length);
+        if (text) {
+            JournalAppend(&g_app.journal, 0, oldLength, text, length);
+            UnlockEditText(hwnd);
+        }
+        UndoLogClear(&g_app.undo);
+        NoteTextReplaced();
+        return result;
+    }
+    g_app.captureDepth++;
+    LRESULT result = CallWindowProcW(g_app.editProc, hwnd, msg, wParam, lParam);
+    g_app.captureDepth--;
+    EndEditCapture(hwnd, &capture);
+    return result;
+}
+
+// ============================================================================
+// CreateEditControl - Create or Recreate the Edit Control
+// ============================================================================
+// Creates the main multi-line edit control that serves as the text editor.
+// This function is called:
+// - On startup to create the initial control
+// - When toggling word wrap (requires recreating with different styles)
+// The function destroys the old control if it exists, creates a new one with
+// appropriate styles, and resizes it to fill the available space.
+// ============================================================================
+static void CreateEditControl(HWND hwnd) {
+    // Destroy existing edit control if present
+    if (g_app.hwndEdit) {
+        DestroyWindow(g_app.hwndEdit);
+    }
+
+    // Build style flags for the edit control
+    // Base styles:
+    //   WS_CHILD - Child window of main window
+    //   WS_VISIBLE - Visible by default
+    //   WS_VSCROLL - Vertical scrollbar
+    //   ES_MULTILINE - Multiple lines (essential for text editor)
+    //   ES_AUTOVSCROLL - Auto-scroll vertically when typing past end
+    //   ES_WANTRETURN - Enter key adds newline (vs. default button)
+    //   ES_NOHIDESEL - Show selection even when control loses focus
+    DWORD style = WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_AUTOVSCROLL | ES_WANTRETURN | ES_NOHIDESEL;
+    
+    // Add horizontal scroll only when word wrap is off
+    if (!g_app.wordWrap) {
+        style |= WS_HSCROLL | ES_AUTOHSCROLL;
+    }
+
+    // Create the edit control
+    // WS_EX_CLIENTEDGE gives it a sunken 3D border
+    // "EDIT" is the Windows built-in edit control class
+    g_app.hwndEdit = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", NULL, style, 0, 0, 0, 0, hwnd, (HMENU)1, g_hInst, NULL);
+    
+    // Apply current font if one is set
+    if (g_app.hwndEdit && g_app.hFont) {
+        ApplyFontToEdit(g_app.hwndEdit, g_app.hFont);
+    }
+    
+    // Remove text length limit (default is ~32KB) to allow large files
+    SendMessageW(g_app.hwndEdit, EM_SETLIMITTEXT, 0, 0);
+    
+    // Route edits through our hook so the undo log sees every change
+    g_app.editProc = (WNDPROC)SetWindowLongPtrW(g_app.hwndEdit, GWLP_WNDPROC, (LONG_PTR)EditSubclassProc);
+    LineGutterAttach(&g_app.gutter, g_app.hwndEdit, &g_app.lineIndex, g_app.wordWrap);
+    
+    // Position and size the edit control
+    UpdateLayout(hwnd);
+}
+
+// ============================================================================
+// ToggleStatusBar - Show or Hide the Status Bar
+// ============================================================================
+// Controls the visibility of the status bar at the bottom of the window.
+// When shown, the status bar displays line number, column, and total lines.
+// ============================================================================
+static void ToggleStatusBar(HWND hwnd, BOOL visible) {
+    g_app.statusVisible = visible;
+    if (visible) {
+        // Create status bar if it doesn't exist
+        if (!g_app.hwndStatus) {
+            // SBARS_SIZEGRIP adds the resize grip in bottom-right corner
+            g_app.hwndStatus = CreateStatusWindowW(WS_CHILD | SBARS_SIZEGRIP, L"", hwnd, 2);
+            if (g_app.hwndStatus) {
+                g_app.statusProc = (WNDPROC)SetWindowLongPtrW(g_app.hwndStatus, GWLP_WNDPROC,
+                                                              (LONG_PTR)StatusSubclassProc);
+            }
+        }
+        ShowWindow(g_app.hwndStatus, SW_SHOW);
+    } else if (g_app.hwndStatus) {
+        ShowWindow(g_app.hwndStatus, SW_HIDE);
+    }
+    // Resize edit control to account for status bar visibility
+    UpdateLayout(hwnd);
+    UpdateStatusBar(hwnd);
+    
+    // Remember status bar preference
+    g_app.settings.values.statusBar = (visible != FALSE);
+    SettingsChanged(hwnd);
+}
+
+// ============================================================================
+// ToggleLineNumbers - Show or Hide the Line Number Gutter
+// ============================================================================
+// The gutter sits left of the edit control. It is created the first time
+// it is shown.
+// ============================================================================
+static void ToggleLineNumbers(HWND hwnd, BOOL visible) {
+    if (visible && !g_app.gutter.hwnd && !LineGutterCreate(&g_app.gutter, hwnd, g_hInst)) {
+        return;
+    }
+    LineGutterShow(&g_app.gutter, visible);
+    UpdateLayout(hwnd);
+
+    // Remember line number preference
+    g_app.settings.values.lineNumbers = (visible != FALSE);
+    SettingsChanged(hwnd);
+}
+
+// ============================================================================
+// ToggleResults - Show or Hide the Search Results List
+// ============================================================================
+// The list sits between the edit control and the status bar. It is created
+// the first time it is shown.
+// ============================================================================
+static void ToggleResults(HWND hwnd, BOOL visible) {
+    if (visible && !g_app.results.hwnd && !ResultsPaneCreate(&g_app.results, hwnd, g_hInst)) {
+        return;
+    }
+    g_app.resultsVisible = visible;
+    if (g_app.results.hwnd) {
+        ShowWindow(g_app.results.hwnd, visible ? SW_SHOW : SW_HIDE);
+    }
+    UpdateLayout(hwnd);
+    UpdateStatusBar(hwnd);
+}
+
+// ============================================================================
+// ClearResults - Forget Search Results
+// ============================================================================
+// Called when a different document is loaded; the offsets refer to the old
+// text. Find in Files results are about other files and stay, so that one
+// result after another can be opened from the list.
+// ============================================================================
+static void ClearResults(HWND hwnd) {
+    EndFindAll();
+    EndFilter();
+    ResetSearchIndex();
+    CountTextChanged();
+    g_app.incAnchor = 0;
+    IncSearchTextChanged();
+    if (g_app.fileSearch) return;
+    if (g_app.results.count == 0 && g_app.results.tagCount == 0) return;
+    ResultsPaneClear(&g_app.results);
+    ResultsPanePublish(&g_app.results);
+    ToggleResults(hwnd, FALSE);
+}
+
+// ============================================================================
+// UpdateLayout - Resize Child Windows to Fit Parent
+// ============================================================================
+// Calculates and applies proper sizes and positions for the edit control and
+// status bar based on the current window size. Called when:
+// - Window is resized
+// - Status bar visibility changes
+// - Edit control is recreated (e.g., word wrap toggle)
+// ============================================================================
+static void UpdateLayout(HWND hwnd) {
+    // Get the client area size of main window
+    RECT rc;
+    GetClientRect(hwnd, &rc);
+
+    int statusHeight = 0;
+    if (g_app.statusVisible && g_app.hwndStatus) {
+        // Tell status bar to resize itself (calculates its own height)
+        SendMessageW(g_app.hwndStatus, WM_SIZE, 0, 0);
+        // Get the calculated height
+        RECT sbrc;
+        GetWindowRect(g_app.hwndStatus, &sbrc);
+        statusHeight = sbrc.bottom - sbrc.top;
+        // Position status bar at bottom of window
+        MoveWindow(g_app.hwndStatus, 0, rc.bottom - statusHeight, rc.right, statusHeight, TRUE);
+    }
+
+    // The incremental search bar sits right above the status bar
+    int barHeight = SearchBarLayout(&g_app.searchBar, rc.bottom - statusHeight, rc.right);
+
+    // Search results take the bottom quarter above those
+    int resultsHeight = 0;
+    if (g_app.resultsVisible && g_app.results.hwnd) {
+        int available = rc.bottom - statusHeight - barHeight;
+        resultsHeight = available / 4;
+        if (resultsHeight < 80) resultsHeight = available < 80 ? available : 80;
+        if (resultsHeight < 0) resultsHeight = 0;
+        MoveWindow(g_app.results.hwnd, 0, rc.bottom - statusHeight - barHeight - resultsHeight,
+                   rc.right, resultsHeight, TRUE);
+    }
+
+    // Resize edit control to fill remaining space (excluding status bar, search bar,
+    // results and the line number gutter to its left)
+    if (g_app.hwndEdit) {
+        int editHeight = rc.bottom - statusHeight - barHeight - resultsHeight;
+        int gutterWidth = LineGutterLayout(&g_app.gutter, editHeight);
+        MoveWindow(g_app.hwndEdit, gutterWidth, 0, rc.right - gutterWidth, editHeight, TRUE);
+    }
+}
+
+// ============================================================================
+// PromptSaveChanges - Ask User to Save Unsaved Changes
+// ============================================================================
+// If the document has been modified, shows a Yes/No/Cancel dialog asking
+// if the user wants to save changes. Used before:
 // - Opening a new file
 // - Creating a new document
 // - Closing the application
@@ -550,6 +1570,37 @@ static BOOL PromptSaveChanges(HWND hwnd) {
     return res == IDNO;
 }
 
+// ============================================================================
+// OfferRecovery - Ask to Restore Edits Left in a Crash Journal
+// ============================================================================
+// Replays the journal on top of 'text' if the user agrees. A journal that is
+// declined, or that no longer matches the file, is deleted.
+// Parameters:
+//   hwnd         - Main window handle
+//   journalPath  - Journal found by JournalFindOrphan
+//   documentPath - Document the text came from (NULL if untitled)
+//   text, length - Base text; replaced by the recovered text
+//   encodingOut  - Receives the recorded encoding (can be NULL)
+//   resumeAtOut  - Receives where journaling should continue
+// Returns: TRUE if edits were recovered
+// ============================================================================
+static BOOL OfferRecovery(HWND hwnd, LPCWSTR journalPath, LPCWSTR documentPath, WCHAR **text, size_t *length,
+                          TextEncoding *encodingOut, ULONGLONG *resumeAtOut) {
+    WCHAR message[MAX_PATH_BUFFER + 160];
+    StringCchPrintfW(message, ARRAYSIZE(message),
+                     L"retropad did not close normally last time. Unsaved changes to %s were kept.\n\n"
+                     L"Do you want to recover them?", documentPath ? documentPath : UNTITLED_NAME);
+    if (MessageBoxW(hwnd, message, APP_TITLE, MB_YESNO | MB_ICONQUESTION) == IDYES) {
+        if (JournalRecover(journalPath, documentPath, text, length, encodingOut, resumeAtOut)) {
+            return TRUE;
+        }
+        MessageBoxW(hwnd, L"The unsaved changes could not be recovered because the file has changed since.",
+                    APP_TITLE, MB_ICONWARNING);
+    }
+    JournalDiscard(journalPath);
+    return FALSE;
+}
+
 // ============================================================================
 // LoadDocumentFromPath - Load File into Editor
 // ============================================================================
@@ -562,24 +1613,59 @@ static BOOL PromptSaveChanges(HWND hwnd) {
 // Returns: TRUE on success, FALSE on failure
 // ============================================================================
 static BOOL LoadDocumentFromPath(HWND hwnd, LPCWSTR path) {
+    // Reuse what we learned last time this exact file was opened, if anything
+    LineIndex cached;
+    LineIndexInit(&cached, 0);
+    TextEncoding hint = ENC_AUTO;
+    BOOL cacheHit = MetaCacheLookup(path, &hint, &cached);
+
     // Load file using file_io module (handles encoding detection)
     WCHAR *text = NULL;
+    size_t length = 0;
     TextEncoding enc = ENC_UTF8;
-    if (!LoadTextFile(hwnd, path, &text, NULL, &enc)) {
+    if (!LoadTextFileWithHint(hwnd, path, cacheHit ? hint : ENC_AUTO, &text, &length, &enc)) {
+        LineIndexFree(&cached);
         return FALSE;  // Error message already shown by LoadTextFile
     }
 
+    // Take the cached line index, or build one and remember it for next time
+    LineIndexFree(&g_app.lineIndex);
+    if (cacheHit && enc == hint) {
+        g_app.lineIndex = cached;
+    } else {
+        LineIndexFree(&cached);
+        LineIndexBuild(&g_app.lineIndex, text, length);
+        MetaCacheStore(path, enc, &g_app.lineIndex);
+    }
+
+    // Replay edits a crashed session left behind, if the user wants them
+    size_t baseLength = length;
+    WCHAR journalPath[MAX_PATH];
+    ULONGLONG resumeAt = 0;
+    BOOL recovered = JournalFindOrphan(path, journalPath, ARRAYSIZE(journalPath)) &&
+                     OfferRecovery(hwnd, journalPath, path, &text, &length, NULL, &resumeAt);
+    if (recovered) {
+        LineIndexBuild(&g_app.lineIndex, text, length);
+    }
+
     // Set the loaded text into edit control
-    SetWindowTextW(g_app.hwndEdit, text);
+    SetEditTextRecorded(g_app.hwndEdit, text);
     HeapFree(GetProcessHeap(), 0, text);  // Free the loaded text buffer
     
     // Update application state with new file info
     StringCchCopyW(g_app.currentPath, ARRAYSIZE(g_app.currentPath), path);
     g_app.encoding = enc;
     
-    // Mark document as unmodified (just loaded)
-    SendMessageW(g_app.hwndEdit, EM_SETMODIFY, FALSE, 0);
-    g_app.modified = FALSE;
+    // Mark document as unmodified (just loaded) unless edits were recovered;
+    // history starts fresh and the journal starts from the file on disk
+    SendMessageW(g_app.hwndEdit, EM_SETMODIFY, recovered, 0);
+    g_app.modified = recovered;
+    UndoLogClear(&g_app.undo);
+    if (recovered) UndoLogForgetSavePoint(&g_app.undo);
+    JournalBegin(&g_app.journal, path, baseLength, enc, recovered ? journalPath : NULL, resumeAt);
+    ClearResults(hwnd);
+    ResetHighlight();
+    PaginationEdit(&g_app.pagination, 0);
     
     // Update UI to reflect new document
     UpdateTitle(hwnd);
@@ -646,12 +1732,22 @@ static BOOL DoFileSave(HWND hwnd, BOOL saveAs) {
 
     // Save using file_io module (preserves encoding)
     BOOL ok = SaveTextFile(hwnd, path, buffer, len, g_app.encoding);
+    if (ok) {
+        // Refresh cached metadata so reopening the saved file is instant
+        // (SaveTextFile writes UTF-16 BE files back out as UTF-8)
+        LineIndexBuild(&g_app.lineIndex, buffer, (size_t)len);
+        MetaCacheStore(path, g_app.encoding == ENC_UTF16BE ? ENC_UTF8 : g_app.encoding, &g_app.lineIndex);
+    }
     HeapFree(GetProcessHeap(), 0, buffer);
     
     if (ok) {
-        // Mark document as unmodified
+        // Mark document as unmodified; undoing back here clears it again
         SendMessageW(g_app.hwndEdit, EM_SETMODIFY, FALSE, 0);
         g_app.modified = FALSE;
+        UndoLogMarkSavePoint(&g_app.undo);
+        JournalBegin(&g_app.journal, path, (size_t)len, g_app.encoding, NULL, 0);
+        // A new name may mean a new language
+        if (HighlightLanguageForPath((const uint16_t *)path) != g_app.highlight.language) ResetHighlight();
         UpdateTitle(hwnd);
     }
     return ok;
@@ -668,15 +1764,21 @@ static void DoFileNew(HWND hwnd) {
     if (!PromptSaveChanges(hwnd)) return;
     
     // Clear the editor
-    SetWindowTextW(g_app.hwndEdit, L"");
+    SetEditTextRecorded(g_app.hwndEdit, L"");
     
     // Reset file state to defaults
     g_app.currentPath[0] = L'\0';  // Empty = "Untitled"
     g_app.encoding = ENC_UTF8;     // Default encoding
+    LineIndexFree(&g_app.lineIndex);
     
-    // Mark as unmodified
+    // Mark as unmodified and forget the previous document's history
     SendMessageW(g_app.hwndEdit, EM_SETMODIFY, FALSE, 0);
     g_app.modified = FALSE;
+    UndoLogClear(&g_app.undo);
+    JournalBegin(&g_app.journal, NULL, 0, ENC_UTF8, NULL, 0);
+    ClearResults(hwnd);
+    ResetHighlight();
+    PaginationEdit(&g_app.pagination, 0);
     
     // Update UI
     UpdateTitle(hwnd);
@@ -684,195 +1786,294 @@ static void DoFileNew(HWND hwnd) {
 }
 
 // ============================================================================
-// LoadWordWrapSetting - Load Word Wrap Setting from Registry
+// StartJournal - Start Crash Journaling and Recover Untitled Work
 // ============================================================================
-// Reads the saved word wrap preference from the Windows registry.
-// Returns TRUE if word wrap was previously enabled, FALSE otherwise.
-// Default is FALSE if no setting exists.
+// Called once at startup. If an earlier session died with unsaved changes
+// in an untitled document, offers to bring them back before journaling the
+// new empty document.
 // ============================================================================
-static BOOL LoadWordWrapSetting(void) {
-    HKEY hKey = NULL;
-    BOOL wordWrap = FALSE;  // Default to OFF
-    
-    // Try to open registry key
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
-        return wordWrap;  // Key doesn't exist or can't be opened
-    }
-    
-    // Read the word wrap setting
-    DWORD value = 0;
-    DWORD size = sizeof(DWORD);
-    DWORD type = REG_DWORD;
-    
-    if (RegQueryValueExW(hKey, REG_WORD_WRAP, NULL, &type, (BYTE*)&value, &size) == ERROR_SUCCESS) {
-        wordWrap = (value != 0);
+static void StartJournal(HWND hwnd) {
+    if (!JournalStart(&g_app.journal)) return;
+
+    WCHAR journalPath[MAX_PATH];
+    if (JournalFindOrphan(NULL, journalPath, ARRAYSIZE(journalPath))) {
+        size_t length = 0;
+        TextEncoding enc = ENC_UTF8;
+        ULONGLONG resumeAt = 0;
+        WCHAR *text = (WCHAR *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(WCHAR));
+        if (text && OfferRecovery(hwnd, journalPath, NULL, &text, &length, &enc, &resumeAt)) {
+            SetEditTextRecorded(g_app.hwndEdit, text);
+            g_app.encoding = enc;
+            LineIndexBuild(&g_app.lineIndex, text, length);
+            SendMessageW(g_app.hwndEdit, EM_SETMODIFY, TRUE, 0);
+            g_app.modified = TRUE;
+            UndoLogClear(&g_app.undo);
+            UndoLogForgetSavePoint(&g_app.undo);
+            JournalBegin(&g_app.journal, NULL, 0, enc, journalPath, resumeAt);
+            HeapFree(GetProcessHeap(), 0, text);
+            return;
+        }
+        if (text) HeapFree(GetProcessHeap(), 0, text);
     }
-    
-    // Always close the key before returning
-    RegCloseKey(hKey);
-    return wordWrap;
+    JournalBegin(&g_app.journal, NULL, 0, ENC_UTF8, NULL, 0);
 }
 
 // ============================================================================
-// SaveWordWrapSetting - Save Word Wrap Setting to Registry
+// Session Restore
 // ============================================================================
-// Saves the current word wrap preference to the Windows registry so it
-// persists across application sessions.
+// The snapshot itself is tiny and read before the window is created, so the
+// window comes up with its previous size, layout and title in the first
+// frame. The document body (a file that may be huge, plus any unsaved edits
+// kept in its journal) is loaded on a worker thread and handed back with
+// WM_APP_SESSION_LOADED. The editor stays read-only until then.
 // ============================================================================
-static void SaveWordWrapSetting(BOOL enabled) {
-    HKEY hKey;
-    
-    // Create or open registry key
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL, 0, 
-                        KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
-        DWORD value = enabled ? 1 : 0;
-        
-        // Write the word wrap setting
-        RegSetValueExW(hKey, REG_WORD_WRAP, 0, REG_DWORD, (BYTE*)&value, sizeof(DWORD));
-        
-        RegCloseKey(hKey);
-    }
+typedef struct SessionRestore {
+    HWND hwnd;                          // Window to notify
+    SessionState state;                 // Snapshot being restored
+    WCHAR *text;                        // Loaded (and recovered) text
+    size_t length;
+    size_t baseLength;                  // Length of the file text before recovery
+    TextEncoding encoding;
+    LineIndex lineIndex;                // Index of 'text'
+    BOOL loaded;                        // FALSE if the document is gone
+    BOOL recovered;                     // Unsaved edits were replayed
+    ULONGLONG resumeAt;                 // Where journaling continues
+} SessionRestore;
+
+static void FreeSessionRestore(SessionRestore *load) {
+    if (load->text) HeapFree(GetProcessHeap(), 0, load->text);
+    LineIndexFree(&load->lineIndex);
+    SessionFree(&load->state);
+    HeapFree(GetProcessHeap(), 0, load);
 }
 
 // ============================================================================
-// LoadStatusBarSetting - Load Status Bar Setting from Registry
+// SessionLoadThread - Load the Restored Document in the Background
 // ============================================================================
-// Reads the saved status bar visibility preference from the Windows registry.
-// Returns TRUE if status bar was previously visible, FALSE otherwise.
-// Default is TRUE if no setting exists.
-// ============================================================================
-static BOOL LoadStatusBarSetting(void) {
-    HKEY hKey = NULL;
-    BOOL statusBar = TRUE;  // Default to ON
-    
-    // Try to open registry key
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
-        return statusBar;  // Key doesn't exist or can't be opened
+static DWORD WINAPI SessionLoadThread(LPVOID param) {
+    SessionRestore *load = (SessionRestore *)param;
+    const SessionState *state = &load->state;
+    LPCWSTR documentPath = state->documentPath[0] ? state->documentPath : NULL;
+
+    // The stored encoding and line index only hold if the file is untouched
+    BOOL unchanged = documentPath && SessionDocumentUnchanged(state);
+    load->encoding = state->encoding;
+    if (documentPath) {
+        // A file deleted since last time is silently dropped, not reported
+        load->loaded = GetFileAttributesW(documentPath) != INVALID_FILE_ATTRIBUTES &&
+                       LoadTextFileWithHint(NULL, documentPath, unchanged ? state->encoding : ENC_AUTO,
+                                            &load->text, &load->length, &load->encoding);
+    } else {
+        load->text = (WCHAR *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(WCHAR));
+        load->loaded = load->text != NULL;
     }
-    
-    // Read the status bar setting
-    DWORD value = 0;
-    DWORD size = sizeof(DWORD);
-    DWORD type = REG_DWORD;
-    
-    if (RegQueryValueExW(hKey, REG_STATUS_BAR, NULL, &type, (BYTE*)&value, &size) == ERROR_SUCCESS) {
-        statusBar = (value != 0);
+
+    if (load->loaded) {
+        load->baseLength = load->length;
+        if (state->journalPath[0]) {
+            load->recovered = JournalRecover(state->journalPath, documentPath, &load->text, &load->length,
+                                             documentPath ? NULL : &load->encoding, &load->resumeAt);
+        }
+        if (!load->recovered && unchanged && load->encoding == state->encoding && state->lineIndex.count > 0) {
+            load->lineIndex = state->lineIndex;
+            LineIndexInit(&load->state.lineIndex, 0);
+        } else {
+            LineIndexBuild(&load->lineIndex, load->text, load->length);
+        }
     }
-    
-    // Always close the key before returning
-    RegCloseKey(hKey);
-    return statusBar;
+
+    // If the window is already gone there is nobody left to restore into
+    if (!PostMessageW(load->hwnd, WM_APP_SESSION_LOADED, 0, (LPARAM)load)) {
+        FreeSessionRestore(load);
+    }
+    return 0;
 }
 
 // ============================================================================
-// SaveStatusBarSetting - Save Status Bar Setting to Registry
+// BeginSessionRestore - Start Loading the Previous Session's Document
 // ============================================================================
-// Saves the current status bar visibility preference to the Windows registry
-// so it persists across application sessions.
+// Called from WM_CREATE when a snapshot was found. Restores the find state
+// and, if the snapshot names a document or unsaved work, starts the loader.
+// A file named on the command line takes the place of a clean document, but
+// never of unsaved work (that is restored first, then the file is opened).
+// Returns: TRUE if the document is being loaded
 // ============================================================================
-static void SaveStatusBarSetting(BOOL enabled) {
-    HKEY hKey;
-    
-    // Create or open registry key
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL, 0, 
-                        KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
-        DWORD value = enabled ? 1 : 0;
-        
-        // Write the status bar setting
-        RegSetValueExW(hKey, REG_STATUS_BAR, 0, REG_DWORD, (BYTE*)&value, sizeof(DWORD));
-        
-        RegCloseKey(hKey);
+static BOOL BeginSessionRestore(HWND hwnd) {
+    SessionState *state = &g_app.session;
+    SetSearchString(&g_app.findText, state->findText, wcslen(state->findText));
+    SetSearchString(&g_app.replaceText, state->replaceText, wcslen(state->replaceText));
+    g_app.findFlags = state->findFlags;
+
+    BOOL unsavedWork = state->journalPath[0] != L'\0';
+    if (!unsavedWork && (!state->documentPath[0] || g_app.pendingOpen[0])) return FALSE;
+
+    SessionRestore *load = (SessionRestore *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(SessionRestore));
+    if (!load) return FALSE;
+    load->hwnd = hwnd;
+    load->state = *state;
+    LineIndexInit(&load->lineIndex, 0);
+    LineIndexInit(&state->lineIndex, 0);  // Ownership moved to the loader
+
+    HANDLE thread = CreateThread(NULL, 0, SessionLoadThread, load, 0, NULL);
+    if (!thread) {
+        FreeSessionRestore(load);
+        return FALSE;
     }
+    CloseHandle(thread);
+
+    // Show the document's name right away; the text follows when it is loaded
+    StringCchCopyW(g_app.currentPath, ARRAYSIZE(g_app.currentPath), state->documentPath);
+    g_app.encoding = state->encoding;
+    g_app.sessionLoading = TRUE;
+    SendMessageW(g_app.hwndEdit, EM_SETREADONLY, TRUE, 0);
+    return TRUE;
 }
 
 // ============================================================================
-// LoadFontSetting - Load Font Setting from Registry
+// FinishSessionRestore - Show the Document Loaded by SessionLoadThread
 // ============================================================================
-// Reads the saved font preference from the Windows registry and creates
-// a font handle. Returns NULL if no saved font or if font creation fails.
-// ============================================================================
-static HFONT LoadFontSetting(void) {
-    HKEY hKey = NULL;
-    HFONT hFont = NULL;
-    
-    // Try to open registry key
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
-        return NULL;  // Key doesn't exist or can't be opened
+static void FinishSessionRestore(HWND hwnd, SessionRestore *load) {
+    const SessionState *state = &load->state;
+    g_app.sessionLoading = FALSE;
+    SendMessageW(g_app.hwndEdit, EM_SETREADONLY, FALSE, 0);
+    JournalStart(&g_app.journal);
+
+    // Kept edits that could not be replayed (the file changed or vanished)
+    if (state->journalPath[0] && !load->recovered) {
+        JournalDiscard(state->journalPath);
     }
-    
-    LOGFONTW lf = {0};
-    DWORD size, type;
-    BOOL hasFont = FALSE;
-    
-    // Read font name
-    size = sizeof(lf.lfFaceName);
-    if (RegQueryValueExW(hKey, REG_FONT_NAME, NULL, &type, (BYTE*)lf.lfFaceName, &size) == ERROR_SUCCESS) {
-        hasFont = TRUE;
+
+    if (load->loaded) {
+        SetEditTextRecorded(g_app.hwndEdit, load->text);
+        g_app.encoding = load->encoding;
+        LineIndexFree(&g_app.lineIndex);
+        g_app.lineIndex = load->lineIndex;
+        LineIndexInit(&load->lineIndex, 0);
+
+        // Unsaved edits come back as unsaved; history starts fresh
+        SendMessageW(g_app.hwndEdit, EM_SETMODIFY, load->recovered, 0);
+        g_app.modified = load->recovered;
+        UndoLogClear(&g_app.undo);
+        if (load->recovered) UndoLogForgetSavePoint(&g_app.undo);
+        JournalBegin(&g_app.journal, state->documentPath[0] ? state->documentPath : NULL, load->baseLength,
+                     load->encoding, load->recovered ? state->journalPath : NULL, load->resumeAt);
+
+        // Put the caret and scroll position back (the control clamps both)
+        SendMessageW(g_app.hwndEdit, EM_SETSEL, state->selStart, state->selEnd);
+        SendMessageW(g_app.hwndEdit, EM_LINESCROLL, 0, state->firstLine);
+    } else {
+        g_app.currentPath[0] = L'\0';
+        g_app.encoding = ENC_UTF8;
+        JournalBegin(&g_app.journal, NULL, 0, ENC_UTF8, NULL, 0);
     }
-    
-    // Read font size (height)
-    size = sizeof(DWORD);
-    DWORD height = 0;
-    if (RegQueryValueExW(hKey, REG_FONT_SIZE, NULL, &type, (BYTE*)&height, &size) == ERROR_SUCCESS) {
-        lf.lfHeight = (LONG)height;
+    FreeSessionRestore(load);
+    ResetHighlight();
+    PaginationEdit(&g_app.pagination, 0);
+
+    UpdateTitle(hwnd);
+    UpdateStatusBar(hwnd);
+
+    // A file named on the command line opens on top of the restored work
+    if (g_app.pendingOpen[0]) {
+        if (PromptSaveChanges(hwnd)) {
+            LoadDocumentFromPath(hwnd, g_app.pendingOpen);
+        }
+        g_app.pendingOpen[0] = L'\0';
     }
-    
-    // Read font weight
-    size = sizeof(DWORD);
-    DWORD weight = 0;
-    if (RegQueryValueExW(hKey, REG_FONT_WEIGHT, NULL, &type, (BYTE*)&weight, &size) == ERROR_SUCCESS) {
-        lf.lfWeight = (LONG)weight;
+}
+
+// ============================================================================
+// SaveSession - Write the Hot Exit Snapshot
+// ============================================================================
+// Records the layout and find state and, if 'withDocument' is TRUE, the open
+// document. Unsaved changes are handed over by keeping the crash journal
+// instead of deleting it on exit.
+// Returns: TRUE if the document (including unsaved changes) will come back,
+//          FALSE if only the layout was kept (no journal for the changes)
+// ============================================================================
+static BOOL SaveSession(HWND hwnd, BOOL withDocument) {
+    SessionState state;
+    ZeroMemory(&state, sizeof(state));
+    LineIndexInit(&state.lineIndex, 0);
+
+    WINDOWPLACEMENT placement = { sizeof(placement) };
+    if (GetWindowPlacement(hwnd, &placement)) {
+        state.windowRect = placement.rcNormalPosition;
+        state.maximized = placement.showCmd == SW_SHOWMAXIMIZED ||
+                          (placement.showCmd == SW_SHOWMINIMIZED && (placement.flags & WPF_RESTORETOMAXIMIZED));
     }
-    
-    // Read font italic
-    size = sizeof(DWORD);
-    DWORD italic = 0;
-    if (RegQueryValueExW(hKey, REG_FONT_ITALIC, NULL, &type, (BYTE*)&italic, &size) == ERROR_SUCCESS) {
-        lf.lfItalic = (BYTE)italic;
+    state.wordWrap = g_app.wordWrap;
+    state.statusVisible = g_app.statusVisible;
+    state.findFlags = g_app.findFlags;
+    // Strings too long for the snapshot are not kept; a cut-off one would be wrong
+    if (wcslen(g_app.findText) < ARRAYSIZE(state.findText)) {
+        StringCchCopyW(state.findText, ARRAYSIZE(state.findText), g_app.findText);
     }
-    
-    RegCloseKey(hKey);
-    
-    // Create font if we have valid font data
-    if (hasFont && lf.lfFaceName[0] != L'\0') {
-        hFont = CreateFontIndirectW(&lf);
+    if (wcslen(g_app.replaceText) < ARRAYSIZE(state.replaceText)) {
+        StringCchCopyW(state.replaceText, ARRAYSIZE(state.replaceText), g_app.replaceText);
     }
-    
-    return hFont;
+    state.encoding = ENC_UTF8;
+
+    BOOL keepDocument = withDocument &&
+        (!g_app.modified || JournalDetach(&g_app.journal, state.journalPath, ARRAYSIZE(state.journalPath)));
+    if (keepDocument) {
+        StringCchCopyW(state.documentPath, ARRAYSIZE(state.documentPath), g_app.currentPath);
+        state.encoding = g_app.encoding;
+        SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&state.selStart, (LPARAM)&state.selEnd);
+        state.firstLine = (DWORD)SendMessageW(g_app.hwndEdit, EM_GETFIRSTVISIBLELINE, 0, 0);
+        if (!g_app.modified && g_app.currentPath[0]) {
+            // Edits undone since the last save may have left the index partial
+            if (!g_app.lineIndex.partial) state.lineIndex = g_app.lineIndex;  // Borrowed; SessionSave only reads it
+        }
+    }
+
+    // A failed write is not fatal: a kept journal is still offered as crash
+    // recovery the next time the document is opened
+    SessionSave(&state);
+    return keepDocument;
+}
+
+// ============================================================================
+// SettingsChanged - Schedule a Deferred Settings Write
+// ============================================================================
+// Settings are changed in memory (g_app.settings.values) and written back
+// once they settle, so toggling the status bar or word wrap repeatedly costs
+// one write instead of one registry round trip per toggle.
+// ============================================================================
+static void SettingsChanged(HWND hwnd) {
+    SettingsStoreChanged(&g_app.settings, hwnd);
 }
 
 // ============================================================================
-// SaveFontSetting - Save Font Setting to Registry
+// LoadFontSetting - Create the Saved Font
+// ============================================================================
+// Creates a font handle from the saved font preference. Returns NULL if no
+// font was saved or if font creation fails.
+// ============================================================================
+static HFONT LoadFontSetting(void) {
+    const Settings *settings = &g_app.settings.values;
+    if (settings->fontName[0] == 0) return NULL;
+
+    LOGFONTW lf = {0};
+    StringCchCopyW(lf.lfFaceName, ARRAYSIZE(lf.lfFaceName), (const WCHAR *)settings->fontName);
+    lf.lfHeight = (LONG)settings->fontSize;
+    lf.lfWeight = (LONG)settings->fontWeight;
+    lf.lfItalic = (BYTE)settings->fontItalic;
+    return CreateFontIndirectW(&lf);
+}
+
 // ============================================================================
-// Saves the current font to the Windows registry so it persists across
-// application sessions.
+// SaveFontSetting - Remember the Font in the Settings
 // ============================================================================
 static void SaveFontSetting(const LOGFONTW *lf) {
-    HKEY hKey;
-    
+    Settings *settings = &g_app.settings.values;
     if (!lf) return;
-    
-    // Create or open registry key
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, REG_KEY_PATH, 0, NULL, 0, 
-                        KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
-        // Write font name
-        size_t nameLen = (wcslen(lf->lfFaceName) + 1) * sizeof(WCHAR);
-        RegSetValueExW(hKey, REG_FONT_NAME, 0, REG_SZ, (BYTE*)lf->lfFaceName, (DWORD)nameLen);
-        
-        // Write font size (height)
-        DWORD height = (DWORD)lf->lfHeight;
-        RegSetValueExW(hKey, REG_FONT_SIZE, 0, REG_DWORD, (BYTE*)&height, sizeof(DWORD));
-        
-        // Write font weight
-        DWORD weight = (DWORD)lf->lfWeight;
-        RegSetValueExW(hKey, REG_FONT_WEIGHT, 0, REG_DWORD, (BYTE*)&weight, sizeof(DWORD));
-        
-        // Write font italic
-        DWORD italic = (DWORD)lf->lfItalic;
-        RegSetValueExW(hKey, REG_FONT_ITALIC, 0, REG_DWORD, (BYTE*)&italic, sizeof(DWORD));
-        
-        RegCloseKey(hKey);
-    }
+
+    StringCchCopyW((WCHAR *)settings->fontName, ARRAYSIZE(settings->fontName), lf->lfFaceName);
+    settings->fontSize = (int32_t)lf->lfHeight;
+    settings->fontWeight = (int32_t)lf->lfWeight;
+    settings->fontItalic = lf->lfItalic != 0;
+    SettingsChanged(g_app.hwndMain);
 }
 
 // ============================================================================
@@ -880,7 +2081,7 @@ static void SaveFontSetting(const LOGFONTW *lf) {
 // ============================================================================
 // Enables or disables word wrap in the editor. When word wrap changes:
 // - Edit control must be recreated (different styles required)
-// - Text and cursor position are preserved
+// - Text, cursor position, modified flag and undo history are preserved
 // - "Go To" is disabled when word wrap is ON (line numbers change with wrapping)
 // - Status bar remains visible and shows current position
 // ============================================================================
@@ -899,14 +2100,18 @@ static void SetWordWrap(HWND hwnd, BOOL enabled) {
     }
     DWORD start = 0, end = 0;
     SendMessageW(edit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
+    BOOL modified = (SendMessageW(edit, EM_GETMODIFY, 0, 0) != 0);
 
     // Recreate edit control with new word wrap setting
     CreateEditControl(hwnd);
     
-    // Restore text and cursor position
-    SetWindowTextW(g_app.hwndEdit, text);
+    // Restore text, cursor position and modified flag (the undo log lives
+    // outside the control, so history survives the swap)
+    SetEditTextRecorded(g_app.hwndEdit, text);
     SendMessageW(g_app.hwndEdit, EM_SETSEL, start, end);
+    SendMessageW(g_app.hwndEdit, EM_SETMODIFY, modified, 0);
     HeapFree(GetProcessHeap(), 0, text);
+    ResetHighlight();
 
     if (enabled) {
         // Word wrap ON: Disable "Go To" (line numbers change with wrapping)
@@ -916,8 +2121,9 @@ static void SetWordWrap(HWND hwnd, BOOL enabled) {
         EnableMenuItem(GetMenu(hwnd), IDM_EDIT_GOTO, MF_BYCOMMAND | MF_ENABLED);
     }
     
-    // Save word wrap preference to registry
-    SaveWordWrapSetting(enabled);
+    // Remember word wrap preference
+    g_app.settings.values.wordWrap = (enabled != FALSE);
+    SettingsChanged(hwnd);
     
     UpdateTitle(hwnd);
     UpdateStatusBar(hwnd);
@@ -938,6 +2144,21 @@ static const WCHAR* GetEncodingName(TextEncoding encoding) {
     }
 }
 
+// ============================================================================
+// GetLineEndingName - Get Display Name for Line Ending Style
+// ============================================================================
+// Returns a human-readable string for the document's line terminators.
+// ============================================================================
+static const WCHAR* GetLineEndingName(LineEnding lineEnding) {
+    switch (lineEnding) {
+        case LINE_ENDING_LF:    return L"Unix (LF)";
+        case LINE_ENDING_CR:    return L"Macintosh (CR)";
+        case LINE_ENDING_MIXED: return L"Mixed";
+        case LINE_ENDING_CRLF:
+        default:                return L"Windows (CRLF)";
+    }
+}
+
 // ============================================================================
 // UpdateStatusBar - Refresh Status Bar with Current Position Info
 // ============================================================================
@@ -945,7 +2166,7 @@ static const WCHAR* GetEncodingName(TextEncoding encoding) {
 // - Current line number (Ln)
 // - Current column number (Col)
 // - Total number of lines in document
-// - Text encoding (right side)
+// - Line ending style and text encoding (right side)
 // Called whenever cursor moves or text changes.
 // ============================================================================
 static void UpdateStatusBar(HWND hwnd) {
@@ -968,23 +2189,165 @@ static void UpdateStatusBar(HWND hwnd) {
     // Get total line count
     int lines = (int)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
 
-    // Set up status bar with two parts: main text (left) and encoding (right)
-    // -1 means the part extends to the right edge
-    int parts[2] = { -1, -1 };
+    // Set up status bar with three parts: main text (left), line ending and
+    // encoding (right). -1 means the part extends to the right edge
+    int parts[3] = { -1, -1, -1 };
     RECT rc;
     GetClientRect(g_app.hwndStatus, &rc);
-    parts[0] = rc.right - 100;  // Encoding part is 100 pixels wide
-    parts[1] = -1;               // Extends to right edge
-    SendMessageW(g_app.hwndStatus, SB_SETPARTS, 2, (LPARAM)parts);
+    parts[0] = rc.right - 220;  // Line ending part is 120 pixels wide
+    parts[1] = rc.right - 100;  // Encoding part is 100 pixels wide
+    parts[2] = -1;               // Extends to right edge
+    SendMessageW(g_app.hwndStatus, SB_SETPARTS, 3, (LPARAM)parts);
 
     // Format and display status text in first part (part 0)
-    WCHAR status[128];
+    WCHAR status[192];
     StringCchPrintfW(status, ARRAYSIZE(status), L"Ln %d, Col %d    Lines: %d", line, col, lines);
+    if (g_app.highlight.language) {
+        StringCchPrintfW(status + lstrlenW(status), ARRAYSIZE(status) - lstrlenW(status), L"    %hs",
+                         g_app.highlight.language->name);
+    }
+    if (g_app.settings.values.paintTiming && g_app.paintTiming.frames > 0) {
+        // Average and worst editor paint, in hundredths of a millisecond
+        PaintTiming *timing = &g_app.paintTiming;
+        if (timing->frequency == 0) {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            timing->frequency = frequency.QuadPart > 0 ? (ULONGLONG)frequency.QuadPart : 1;
+        }
+        ULONGLONG average = timing->totalTicks * 100000 / timing->frequency / timing->frames;
+        ULONGLONG worst = timing->worstTicks * 100000 / timing->frequency;
+        StringCchPrintfW(status + lstrlenW(status), ARRAYSIZE(status) - lstrlenW(status),
+                         L"    Paint: %llu.%02llu ms avg, %llu.%02llu ms worst (%llu)",
+                         (unsigned long long)(average / 100), (unsigned long long)(average % 100),
+                         (unsigned long long)(worst / 100), (unsigned long long)(worst % 100),
+                         (unsigned long long)timing->frames);
+    }
+    if (g_app.printJob) {
+        // Pages spooled so far, out of how many once that is known
+        WCHAR printed[32], total[32];
+        FormatCount(g_app.printStatus.pagesPrinted, printed, ARRAYSIZE(printed));
+        FormatCount(g_app.printStatus.pagesTotal, total, ARRAYSIZE(total));
+        size_t used = (size_t)lstrlenW(status);
+        if (g_app.printStatus.cancelled) {
+            StringCchCopyW(status + used, ARRAYSIZE(status) - used, L"    Printing: cancelling...");
+        } else if (g_app.printStatus.pagesTotal) {
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Printing: %s of %s pages", printed, total);
+        } else {
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Printing: %s pages", printed);
+        }
+    }
+    if (g_app.fileSearch) {
+        // Matches so far, in how many files, and whether the search goes on
+        const FindInFilesStatus *progress = &g_app.filesStatus;
+        WCHAR total[32], files[32];
+        FormatCount((size_t)progress->totalMatches, total, ARRAYSIZE(total));
+        FormatCount((size_t)progress->filesMatched, files, ARRAYSIZE(files));
+        StringCchPrintfW(status + lstrlenW(status), ARRAYSIZE(status) - lstrlenW(status),
+                         L"    Matches: %s in %s files%s", total, files,
+                         progress->done ? L"" : L" (searching...)");
+    } else if (g_app.findAllActive) {
+        // Which match is selected, if any, out of how many
+        WCHAR total[32], current[32];
+        FormatCount(g_app.findAll.count, total, ARRAYSIZE(total));
+        size_t index = MatchIndexLocate(&g_app.findAll, selStart, selEnd);
+        size_t used = (size_t)lstrlenW(status);
+        if (g_app.findAll.stale) {
+            StringCchCopyW(status + used, ARRAYSIZE(status) - used, L"    Matches: updating...");
+        } else if (index != MATCH_INDEX_NONE) {
+            FormatCount(index + 1, current, ARRAYSIZE(current));
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Match %s of %s", current, total);
+        } else {
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Matches: %s", total);
+        }
+    } else if (g_app.filterActive) {
+        // How many lines the filter shows
+        size_t used = (size_t)lstrlenW(status);
+        if (g_app.lineFilter.stale) {
+            StringCchCopyW(status + used, ARRAYSIZE(status) - used, L"    Matching lines: updating...");
+        } else {
+            WCHAR total[32];
+            FormatCount(g_app.lineFilter.count, total, ARRAYSIZE(total));
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Matching lines: %s", total);
+        }
+    } else if (g_app.resultsVisible && g_app.results.tagCount > 0) {
+        // Match total and how many of the terms turned up at all
+        size_t termsFound = 0;
+        for (size_t i = 0; i < g_app.results.tagCount; ++i) {
+            if (g_app.results.tagHits[i]) termsFound++;
+        }
+        WCHAR total[32];
+        FormatCount(g_app.results.count, total, ARRAYSIZE(total));
+        StringCchPrintfW(status + lstrlenW(status), ARRAYSIZE(status) - lstrlenW(status),
+                         L"    Matches: %s%s (%u of %u terms)", total,
+                         g_app.results.truncated ? L"+" : L"", (UINT)termsFound, (UINT)g_app.results.tagCount);
+    } else if (g_app.countActive) {
+        // The find string's count, while it grows, or until it is redone
+        const MatchCountStatus *count = &g_app.countStatus;
+        WCHAR total[32];
+        FormatCount(count->count, total, ARRAYSIZE(total));
+        size_t used = (size_t)lstrlenW(status);
+        if (count->done) {
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Matches: %s", total);
+        } else if (g_app.counter) {
+            UINT percent = count->length ? (UINT)((ULONGLONG)count->scanned * 100 / count->length) : 0;
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Matches: %s (counting %u%%)",
+                             total, percent);
+        } else {
+            StringCchCopyW(status + used, ARRAYSIZE(status) - used, L"    Matches: updating...");
+        }
+    } else if (g_app.searchIndex.state != TRIGRAM_EMPTY) {
+        // Memory the search index takes, or how far its two passes have got
+        const TrigramIndex *index = &g_app.searchIndex;
+        size_t used = (size_t)lstrlenW(status);
+        if (index->state == TRIGRAM_READY) {
+            WCHAR size[32];
+            FormatCount((TrigramIndexMemory(index) + 1023) / 1024, size, ARRAYSIZE(size));
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Index: %s KB", size);
+        } else {
+            size_t done = index->built + (index->state == TRIGRAM_FILLING ? index->blockCount : 0);
+            StringCchPrintfW(status + used, ARRAYSIZE(status) - used, L"    Indexing: %u%%",
+                             (UINT)(done * 50 / (index->blockCount ? index->blockCount : 1)));
+        }
+    }
     SendMessageW(g_app.hwndStatus, SB_SETTEXT, 0, (LPARAM)status);
     
-    // Display encoding in second part (part 1)
+    // Display line ending style in second part (part 1)
+    SendMessageW(g_app.hwndStatus, SB_SETTEXT, 1, (LPARAM)GetLineEndingName(g_app.lineIndex.lineEnding));
+
+    // Display encoding in third part (part 2)
     const WCHAR *encodingName = GetEncodingName(g_app.encoding);
-    SendMessageW(g_app.hwndStatus, SB_SETTEXT, 1, (LPARAM)encodingName);
+    SendMessageW(g_app.hwndStatus, SB_SETTEXT, 2, (LPARAM)encodingName);
+}
+
+// ============================================================================
+// Find/Replace Dialog Buffers
+// ============================================================================
+// The common dialogs edit one line in a fixed buffer. A string is shown up
+// to its first line break (and at most FIND_DIALOG_CHARS - 1 characters);
+// while the dialog still shows exactly that, the whole string stays in use.
+// ============================================================================
+static size_t DialogPrefixLength(const WCHAR *text) {
+    size_t length = 0;
+    while (text[length] && text[length] != L'\r' && text[length] != L'\n' && length < FIND_DIALOG_CHARS - 1) {
+        length++;
+    }
+    return length;
+}
+
+static void ShowInDialog(WCHAR *buffer, const WCHAR *text) {
+    size_t length = DialogPrefixLength(text);
+    CopyMemory(buffer, text, length * sizeof(WCHAR));
+    buffer[length] = L'\0';
+}
+
+// Takes the string the dialog returned, unless it is the untouched first
+// line of a longer one. Returns FALSE if out of memory.
+static BOOL TakeFromDialog(WCHAR **target, const WCHAR *shown) {
+    size_t length = DialogPrefixLength(*target);
+    if ((*target)[length] != L'\0' && wcslen(shown) == length && wcsncmp(shown, *target, length) == 0) {
+        return TRUE;
+    }
+    return SetSearchString(target, shown, wcslen(shown));
 }
 
 // ============================================================================
@@ -1005,8 +2368,9 @@ static void ShowFindDialog(HWND hwnd) {
     ZeroMemory(&g_app.find, sizeof(g_app.find));
     g_app.find.lStructSize = sizeof(FINDREPLACEW);
     g_app.find.hwndOwner = hwnd;                     // Parent window
-    g_app.find.lpstrFindWhat = g_app.findText;       // Buffer for search text
-    g_app.find.wFindWhatLen = ARRAYSIZE(g_app.findText);
+    ShowInDialog(g_app.findDlgText, g_app.findText);
+    g_app.find.lpstrFindWhat = g_app.findDlgText;    // Buffer for search text
+    g_app.find.wFindWhatLen = ARRAYSIZE(g_app.findDlgText);
     g_app.find.Flags = g_app.findFlags;              // Restore previous flags
 
     // Create modeless Find dialog
@@ -1027,112 +2391,1424 @@ static void ShowReplaceDialog(HWND hwnd) {
         return;
     }
 
-    // Initialize FINDREPLACE structure with both find and replace buffers
-    ZeroMemory(&g_app.find, sizeof(g_app.find));
-    g_app.find.lStructSize = sizeof(FINDREPLACEW);
-    g_app.find.hwndOwner = hwnd;
-    g_app.find.lpstrFindWhat = g_app.findText;         // Search text buffer
-    g_app.find.lpstrReplaceWith = g_app.replaceText;   // Replacement text buffer
-    g_app.find.wFindWhatLen = ARRAYSIZE(g_app.findText);
-    g_app.find.wReplaceWithLen = ARRAYSIZE(g_app.replaceText);
-    g_app.find.Flags = g_app.findFlags;                // Restore previous flags
+    // Initialize FINDREPLACE structure with both find and replace buffers
+    ZeroMemory(&g_app.find, sizeof(g_app.find));
+    g_app.find.lStructSize = sizeof(FINDREPLACEW);
+    g_app.find.hwndOwner = hwnd;
+    ShowInDialog(g_app.findDlgText, g_app.findText);
+    ShowInDialog(g_app.replaceDlgText, g_app.replaceText);
+    g_app.find.lpstrFindWhat = g_app.findDlgText;         // Search text buffer
+    g_app.find.lpstrReplaceWith = g_app.replaceDlgText;   // Replacement text buffer
+    g_app.find.wFindWhatLen = ARRAYSIZE(g_app.findDlgText);
+    g_app.find.wReplaceWithLen = ARRAYSIZE(g_app.replaceDlgText);
+    g_app.find.Flags = g_app.findFlags;                // Restore previous flags
+
+    // Create modeless Replace dialog
+    g_app.hReplaceDlg = ReplaceTextW(&g_app.find);
+}
+
+// ============================================================================
+// Find All - Index of Every Match of the Find String
+// ============================================================================
+// Find All scans the document once and keeps the match offsets, sorted, in
+// g_app.findAll. While the index belongs to the current find string, Find
+// Next and F3 / Shift+F3 are a binary search in it, the results list shows
+// every match and the status bar shows "Match 3 of 12,408". Edits are
+// followed by searching again only around the edit. Edits that cannot be
+// followed that way (regular expressions, whole words, undo, Replace All)
+// mark the index stale; it is rebuilt once editing pauses, or by the next
+// search.
+// ============================================================================
+static bool FindAllLiteral(void *context, const uint16_t *text, size_t length, size_t from,
+                           size_t *startOut, size_t *endOut) {
+    UNREFERENCED_PARAMETER(context);
+    size_t needleLen = wcslen(g_app.findAllText);
+    const uint16_t *fold = g_app.findAllMatchCase ? NULL : g_app.lowerFold;
+    const uint8_t *words = g_app.findAllWholeWord ? g_app.wordChars : NULL;
+    size_t start = TextFindWord(text, length, from, (const uint16_t *)g_app.findAllText, needleLen, fold, words);
+    if (start == TEXT_NOT_FOUND) return false;
+    *startOut = start;
+    *endOut = start + needleLen;
+    return true;
+}
+
+static bool FindAllRegex(void *context, const uint16_t *text, size_t length, size_t from,
+                         size_t *startOut, size_t *endOut) {
+    RegexMatch match;
+    if (!RegexSearch((Regex *)context, text, length, from, &match)) return false;
+    *startOut = match.start[0];
+    *endOut = match.end[0];
+    return true;
+}
+
+// Describes how to search for the Find All string. Reports an invalid pattern.
+static BOOL GetFindAllFinder(MatchFinder *finder) {
+    if (g_app.findAllRegex) {
+        Regex *regex = GetFindRegex(g_app.findAllText, g_app.findAllMatchCase);
+        if (!regex) return FALSE;
+        finder->find = FindAllRegex;
+        finder->context = regex;
+        finder->reach = 0;      // Matches have no length limit
+    } else {
+        if (!g_app.findAllMatchCase && !GetLowerFoldTable()) return FALSE;
+        if (g_app.findAllWholeWord && !GetWordTable()) return FALSE;
+        finder->find = FindAllLiteral;
+        finder->context = NULL;
+        // A whole word depends on the characters next to it, which an edit
+        // beside a kept match can change; such edits rebuild the index
+        finder->reach = g_app.findAllWholeWord ? 0 : wcslen(g_app.findAllText);
+    }
+    return TRUE;
+}
+
+// Rows of the results list while it shows Find All matches
+static BOOL FindAllRow(void *context, size_t row, ResultItem *item) {
+    const MatchIndex *index = (const MatchIndex *)context;
+    if (index->stale || row >= index->count) return FALSE;
+    item->offset = index->spans[row].start;
+    item->length = (DWORD)(index->spans[row].end - index->spans[row].start);
+    item->tag = 0;
+    return TRUE;
+}
+
+static void PublishFindAll(void) {
+    ResultsPaneSetSource(&g_app.results, FindAllRow, &g_app.findAll, g_app.findAll.count);
+    ResultsPanePublish(&g_app.results);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Searches the whole document again, on all cores. Returns FALSE if that failed.
+static BOOL RebuildFindAll(void) {
+    KillTimer(g_app.hwndMain, FIND_ALL_TIMER_ID);
+    MatchFinder finder;
+    size_t length = 0;
+    const WCHAR *text = NULL;
+    BOOL ok = GetFindAllFinder(&finder) && (text = LockEditText(g_app.hwndEdit, &length)) != NULL;
+    if (ok) {
+        ChunkMatcher matcher;
+        IndexedMatcher indexed;
+        const ChunkMatcher *search;
+        if (g_app.findAllRegex) {
+            GetFindRegexMatcher((Regex *)finder.context, &matcher);
+            search = NarrowRegexBySearchIndex(&matcher, (Regex *)finder.context, length, &indexed);
+        } else {
+            size_t needleLen = wcslen(g_app.findAllText);
+            ChunkMatcherLiteral(&matcher, (const uint16_t *)g_app.findAllText, needleLen,
+                                g_app.findAllMatchCase ? NULL : g_app.lowerFold,
+                                g_app.findAllWholeWord ? g_app.wordChars : NULL);
+            search = NarrowBySearchIndex(&matcher, (const uint16_t *)g_app.findAllText, needleLen, length, &indexed);
+        }
+        HCURSOR oldCursor = SetCursor(LoadCursorW(NULL, IDC_WAIT));
+        ok = ParallelFindAll(search, (const uint16_t *)text, length, &g_app.findAll);
+        SetCursor(oldCursor);
+        IndexedMatcherFree(&indexed);
+        UnlockEditText(g_app.hwndEdit);
+    }
+    PublishFindAll();
+    return ok;
+}
+
+static void EndFindAll(void) {
+    if (!g_app.findAllActive) return;
+    KillTimer(g_app.hwndMain, FIND_ALL_TIMER_ID);
+    MatchIndexFree(&g_app.findAll);
+    g_app.findAllActive = FALSE;
+}
+
+static void FindAllInvalidate(void) {
+    if (!g_app.findAllActive) return;
+    MatchIndexInvalidate(&g_app.findAll);
+    PublishFindAll();
+    SetTimer(g_app.hwndMain, FIND_ALL_TIMER_ID, FIND_ALL_REBUILD_DELAY_MS, NULL);
+}
+
+// Called after every edit the undo capture could describe
+static void FindAllNoteEdit(size_t offset, size_t removed, size_t inserted) {
+    if (!g_app.findAllActive || g_app.findAll.stale) return;
+    MatchFinder finder;
+    size_t length = 0;
+    const WCHAR *text = NULL;
+    if (g_app.findAllRegex || !GetFindAllFinder(&finder) ||
+        (text = LockEditText(g_app.hwndEdit, &length)) == NULL) {
+        FindAllInvalidate();
+        return;
+    }
+    BOOL current = MatchIndexUpdate(&g_app.findAll, &finder, (const uint16_t *)text, length,
+                                    offset, removed, inserted);
+    UnlockEditText(g_app.hwndEdit);
+    if (current) {
+        PublishFindAll();
+    } else {
+        FindAllInvalidate();
+    }
+}
+
+// TRUE if the index answers searches for this find string and options
+// (rebuilding it first if it is stale)
+static BOOL FindAllUsable(const WCHAR *needle, BOOL matchCase, BOOL wholeWord) {
+    if (!g_app.findAllActive || wcscmp(g_app.findAllText, needle) != 0 ||
+        g_app.findAllMatchCase != matchCase || g_app.findAllRegex != g_app.settings.values.findRegex ||
+        (!g_app.findAllRegex && g_app.findAllWholeWord != wholeWord)) {
+        return FALSE;
+    }
+    return !g_app.findAll.stale || RebuildFindAll();
+}
+
+// ============================================================================
+// FindAllNext - Next or Previous Match from the Index
+// ============================================================================
+// Binary search counterpart of FindInEdit, with the same wrap-around.
+// Parameters:
+//   searchDown       - TRUE for the first match at or after selEnd,
+//                      FALSE for the last match before selStart
+//   selStart, selEnd - Current selection
+//   outStart, outEnd - Receive the match
+// Returns: TRUE if found, FALSE if there are no matches
+// ============================================================================
+static BOOL FindAllNext(BOOL searchDown, DWORD selStart, DWORD selEnd, DWORD *outStart, DWORD *outEnd) {
+    const MatchIndex *index = &g_app.findAll;
+    if (index->count == 0) return FALSE;
+    size_t i;
+    if (searchDown) {
+        i = MatchIndexLowerBound(index, selEnd);
+        // Do not find an empty match at the caret again
+        if (i < index->count && index->spans[i].end == selStart) i++;
+        if (i == index->count) i = 0;
+    } else {
+        i = MatchIndexLowerBound(index, selStart);
+        i = (i == 0) ? index->count - 1 : i - 1;
+    }
+    *outStart = (DWORD)index->spans[i].start;
+    *outEnd = (DWORD)index->spans[i].end;
+    return TRUE;
+}
+
+// ============================================================================
+// DoFindAll - Index and List Every Match of the Find String
+// ============================================================================
+static void DoFindAll(HWND hwnd) {
+    if (g_app.findText[0] == L'\0') {
+        ShowFindDialog(hwnd);
+        return;
+    }
+    EndFindAll();
+    EndFilter();
+    EndFindInFiles();
+    if (!SetSearchString(&g_app.findAllText, g_app.findText, wcslen(g_app.findText))) {
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    g_app.findAllMatchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    g_app.findAllWholeWord = (g_app.findFlags & FR_WHOLEWORD) != 0;
+    g_app.findAllRegex = g_app.settings.values.findRegex;
+    MatchFinder finder;
+    if (!GetFindAllFinder(&finder)) {
+        // An invalid pattern has already been reported
+        if (!g_app.findAllRegex) MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+
+    // The results list reads its rows straight from the index
+    const WCHAR *tag = g_app.findAllText;
+    size_t tagLength = wcslen(tag);
+    ResultsPaneClear(&g_app.results);
+    ResultsPaneSetTags(&g_app.results, &tag, &tagLength, 1);
+    MatchIndexInit(&g_app.findAll);
+    g_app.findAllActive = TRUE;
+    if (!RebuildFindAll()) {
+        EndFindAll();
+        ResultsPaneClear(&g_app.results);
+        ResultsPanePublish(&g_app.results);
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    ToggleResults(hwnd, TRUE);
+    if (g_app.findAll.count == 0) {
+        MessageBoxW(hwnd, L"Cannot find the text.", APP_TITLE, MB_ICONINFORMATION);
+    }
+}
+
+// ============================================================================
+// Filter View - Only the Lines Holding a Match
+// ============================================================================
+// Edit > Show Matching Lines lists, in the results pane, every line that
+// holds a match of the find string (see line_filter.h): one row per line,
+// its text read from the document as it is drawn. The filter is built on
+// all cores and follows edits by searching only the lines around them, so
+// text appended to a log shows up as it arrives. F2 on a row edits that
+// line of the document in place; activating a row selects the line.
+// Edits a literal filter cannot follow (regular expressions, undo)
+// rebuild it once editing pauses, as for Find All.
+// ============================================================================
+static bool FilterLiteral(void *context, const uint16_t *text, size_t length, size_t from,
+                          size_t *startOut, size_t *endOut) {
+    UNREFERENCED_PARAMETER(context);
+    size_t needleLen = wcslen(g_app.filterText);
+    const uint16_t *fold = g_app.filterMatchCase ? NULL : g_app.lowerFold;
+    const uint8_t *words = g_app.filterWholeWord ? g_app.wordChars : NULL;
+    size_t start = TextFindWord(text, length, from, (const uint16_t *)g_app.filterText, needleLen, fold, words);
+    if (start == TEXT_NOT_FOUND) return false;
+    *startOut = start;
+    *endOut = start + needleLen;
+    return true;
+}
+
+// Describes how to search for the filter string. Reports an invalid pattern.
+static BOOL GetFilterFinder(MatchFinder *finder) {
+    if (g_app.filterRegex) {
+        Regex *regex = GetFindRegex(g_app.filterText, g_app.filterMatchCase);
+        if (!regex) return FALSE;
+        finder->find = FindAllRegex;
+        finder->context = regex;
+        finder->reach = 0;      // Matches have no length limit
+    } else {
+        if (!g_app.filterMatchCase && !GetLowerFoldTable()) return FALSE;
+        if (g_app.filterWholeWord && !GetWordTable()) return FALSE;
+        finder->find = FilterLiteral;
+        finder->context = NULL;
+        // Whole lines are searched again, so a whole word sees the same
+        // neighbours as before unless the match runs into the edit
+        finder->reach = wcslen(g_app.filterText);
+    }
+    return TRUE;
+}
+
+// Rows of the results list while it shows the filter: the whole line
+static BOOL FilterRow(void *context, size_t row, ResultItem *item) {
+    const LineFilter *filter = (const LineFilter *)context;
+    if (filter->stale || row >= filter->count) return FALSE;
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text) return FALSE;
+    size_t start = filter->rows[row] < length ? filter->rows[row] : length;
+    size_t end = LineFilterLineEnd((const uint16_t *)text, length, start);
+    UnlockEditText(g_app.hwndEdit);
+    item->offset = start;
+    item->length = (DWORD)(end - start);
+    item->tag = 0;
+    return TRUE;
+}
+
+// Writes a row edited in the results list (F2) back to its line. The edit
+// goes through the edit control, so it is undoable and the filter follows it.
+static void FilterEditRow(void *context, size_t row, const WCHAR *line) {
+    const LineFilter *filter = (const LineFilter *)context;
+    if (filter->stale || row >= filter->count) return;
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text) return;
+    size_t start = filter->rows[row] < length ? filter->rows[row] : length;
+    size_t end = LineFilterLineEnd((const uint16_t *)text, length, start);
+    BOOL same = wcslen(line) == end - start && wcsncmp(line, text + start, end - start) == 0;
+    UnlockEditText(g_app.hwndEdit);
+    if (same) return;
+
+    SendMessageW(g_app.hwndEdit, EM_SETSEL, (WPARAM)start, (LPARAM)end);
+    SendMessageW(g_app.hwndEdit, EM_REPLACESEL, TRUE, (LPARAM)line);
+    g_app.modified = TRUE;
+    UpdateTitle(g_app.hwndMain);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+static void PublishFilter(void) {
+    ResultsPaneSetSource(&g_app.results, FilterRow, &g_app.lineFilter, g_app.lineFilter.count);
+    ResultsPaneSetEditor(&g_app.results, FilterEditRow, &g_app.lineFilter);
+    ResultsPanePublish(&g_app.results);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Searches the whole document again, on all cores. Returns FALSE if that failed.
+static BOOL RebuildFilter(void) {
+    KillTimer(g_app.hwndMain, FILTER_TIMER_ID);
+    MatchFinder finder;
+    size_t length = 0;
+    const WCHAR *text = NULL;
+    BOOL ok = GetFilterFinder(&finder) && (text = LockEditText(g_app.hwndEdit, &length)) != NULL;
+    if (ok) {
+        ChunkMatcher matcher;
+        IndexedMatcher indexed;
+        const ChunkMatcher *search;
+        if (g_app.filterRegex) {
+            GetFindRegexMatcher((Regex *)finder.context, &matcher);
+            search = NarrowRegexBySearchIndex(&matcher, (Regex *)finder.context, length, &indexed);
+        } else {
+            size_t needleLen = wcslen(g_app.filterText);
+            ChunkMatcherLiteral(&matcher, (const uint16_t *)g_app.filterText, needleLen,
+                                g_app.filterMatchCase ? NULL : g_app.lowerFold,
+                                g_app.filterWholeWord ? g_app.wordChars : NULL);
+            search = NarrowBySearchIndex(&matcher, (const uint16_t *)g_app.filterText, needleLen, length, &indexed);
+        }
+        HCURSOR oldCursor = SetCursor(LoadCursorW(NULL, IDC_WAIT));
+        ok = ParallelFilterLines(search, (const uint16_t *)text, length, &g_app.lineFilter);
+        SetCursor(oldCursor);
+        IndexedMatcherFree(&indexed);
+        UnlockEditText(g_app.hwndEdit);
+    }
+    PublishFilter();
+    return ok;
+}
+
+static void EndFilter(void) {
+    if (!g_app.filterActive) return;
+    KillTimer(g_app.hwndMain, FILTER_TIMER_ID);
+    LineFilterFree(&g_app.lineFilter);
+    g_app.filterActive = FALSE;
+}
+
+static void FilterInvalidate(void) {
+    if (!g_app.filterActive) return;
+    LineFilterInvalidate(&g_app.lineFilter);
+    PublishFilter();
+    SetTimer(g_app.hwndMain, FILTER_TIMER_ID, FIND_ALL_REBUILD_DELAY_MS, NULL);
+}
+
+// Called after every edit the undo capture could describe
+static void FilterNoteEdit(size_t offset, size_t removed, size_t inserted) {
+    if (!g_app.filterActive || g_app.lineFilter.stale) return;
+    MatchFinder finder;
+    size_t length = 0;
+    const WCHAR *text = NULL;
+    if (g_app.filterRegex || !GetFilterFinder(&finder) ||
+        (text = LockEditText(g_app.hwndEdit, &length)) == NULL) {
+        FilterInvalidate();
+        return;
+    }
+    BOOL current = LineFilterUpdate(&g_app.lineFilter, &finder, (const uint16_t *)text, length,
+                                    offset, removed, inserted);
+    UnlockEditText(g_app.hwndEdit);
+    if (current) {
+        PublishFilter();
+    } else {
+        FilterInvalidate();
+    }
+}
+
+// Edit > Show Matching Lines
+static void DoFilterLines(HWND hwnd) {
+    if (g_app.findText[0] == L'\0') {
+        ShowFindDialog(hwnd);
+        return;
+    }
+    EndFindAll();
+    EndFilter();
+    EndFindInFiles();
+    if (!SetSearchString(&g_app.filterText, g_app.findText, wcslen(g_app.findText))) {
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    g_app.filterMatchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    g_app.filterWholeWord = (g_app.findFlags & FR_WHOLEWORD) != 0;
+    g_app.filterRegex = g_app.settings.values.findRegex;
+    MatchFinder finder;
+    if (!GetFilterFinder(&finder)) {
+        // An invalid pattern has already been reported
+        if (!g_app.filterRegex) MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+
+    const WCHAR *tag = g_app.filterText;
+    size_t tagLength = wcslen(tag);
+    ResultsPaneClear(&g_app.results);
+    ResultsPaneSetTags(&g_app.results, &tag, &tagLength, 1);
+    LineFilterInit(&g_app.lineFilter);
+    g_app.filterActive = TRUE;
+    if (!RebuildFilter()) {
+        EndFilter();
+        ResultsPaneClear(&g_app.results);
+        ResultsPanePublish(&g_app.results);
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    ToggleResults(hwnd, TRUE);
+    if (g_app.lineFilter.count == 0) {
+        MessageBoxW(hwnd, L"Cannot find the text.", APP_TITLE, MB_ICONINFORMATION);
+    }
+}
+
+// ============================================================================
+// Match Count - How Often the Find String Occurs
+// ============================================================================
+// Edit > Count Matches, and every search with a new find string or new
+// options, counts the find string on a worker thread (see match_counter.h).
+// The status bar shows the count as it grows. The worker reads the
+// control's buffer in place, which stays locked until the count ends;
+// EditSubclassProc stops it before any message that could change the
+// text, and the count starts over once editing pauses.
+// ============================================================================
+static void StopCount(void) {
+    if (!g_app.counter) return;
+    MatchCounterFree(g_app.counter);
+    g_app.counter = NULL;
+    UnlockEditText(g_app.hwndEdit);
+}
+
+static void EndCount(void) {
+    StopCount();
+    if (g_app.hwndMain) KillTimer(g_app.hwndMain, COUNT_TIMER_ID);
+    g_app.countActive = FALSE;
+}
+
+static void StartCount(void) {
+    StopCount();
+    KillTimer(g_app.hwndMain, COUNT_TIMER_ID);
+    ZeroMemory(&g_app.countStatus, sizeof(g_app.countStatus));
+    MatchCountQuery query = {0};
+    query.needle = g_app.findText;
+    query.regex = g_app.settings.values.findRegex;
+    query.matchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    BOOL wholeWord = (g_app.findFlags & FR_WHOLEWORD) != 0;
+    BOOL ok = SetSearchString(&g_app.countText, g_app.findText, wcslen(g_app.findText));
+    if (ok && !query.regex && !query.matchCase) ok = (query.fold = GetLowerFoldTable()) != NULL;
+    if (ok && !query.regex && wholeWord) ok = (query.words = GetWordTable()) != NULL;
+
+    size_t length = 0;
+    const WCHAR *text = ok ? LockEditText(g_app.hwndEdit, &length) : NULL;
+    if (text) {
+        g_app.counter = MatchCounterStart(&query, (const uint16_t *)text, length, g_app.hwndMain, WM_APP_MATCH_COUNT);
+        if (!g_app.counter) UnlockEditText(g_app.hwndEdit);
+    }
+    g_app.countActive = g_app.counter != NULL;
+    g_app.countMatchCase = query.matchCase;
+    g_app.countWholeWord = wholeWord;
+    g_app.countRegex = query.regex;
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Counts the find string, unless the count shown is already for it
+static void FollowFindString(void) {
+    BOOL matchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    BOOL wholeWord = (g_app.findFlags & FR_WHOLEWORD) != 0;
+    if (g_app.countActive && wcscmp(g_app.countText, g_app.findText) == 0 && g_app.countMatchCase == matchCase &&
+        (g_app.countWholeWord == wholeWord || g_app.countRegex) &&
+        g_app.countRegex == (BOOL)g_app.settings.values.findRegex) {
+        return;
+    }
+    StartCount();
+}
+
+// Takes the count so far (WM_APP_MATCH_COUNT); a finished worker is freed
+static void MatchCountProgress(void) {
+    if (!g_app.counter) return;
+    MatchCounterPoll(g_app.counter, &g_app.countStatus);
+    if (g_app.countStatus.done) StopCount();
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// The text changed: the count is out of date until it is counted again
+static void CountTextChanged(void) {
+    if (!g_app.countActive) return;
+    StopCount();
+    g_app.countStatus.done = FALSE;
+    SetTimer(g_app.hwndMain, COUNT_TIMER_ID, COUNT_RESTART_DELAY_MS, NULL);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Edit > Count Matches
+static void DoCount(HWND hwnd) {
+    if (g_app.findText[0] == L'\0') {
+        ShowFindDialog(hwnd);
+        return;
+    }
+    if (g_app.settings.values.findRegex &&
+        !GetFindRegex(g_app.findText, (g_app.findFlags & FR_MATCHCASE) != 0)) {
+        return;
+    }
+    StartCount();
+    if (!g_app.countActive) MessageBoxW(hwnd, L"Not enough memory to count.", APP_TITLE, MB_ICONERROR);
+}
+
+// ============================================================================
+// DoFindNext - Find Next Occurrence (F3 Key)
+// ============================================================================
+// Finds the next occurrence of the last search string. If no search has been
+// performed yet, opens the Find dialog. Supports reverse searching.
+// Parameters:
+//   reverse - TRUE to search backward, FALSE to search forward
+// Returns: TRUE if found, FALSE if not found or no search string
+// ============================================================================
+static BOOL DoFindNext(BOOL reverse) {
+    // If no previous search, open Find dialog
+    if (g_app.findText[0] == L'\0') {
+        ShowFindDialog(g_app.hwndMain);
+        return FALSE;
+    }
+
+    // Get current selection (cursor position)
+    DWORD start = 0, end = 0;
+    SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
+    
+    // Extract flags
+    BOOL matchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    BOOL wholeWord = (g_app.findFlags & FR_WHOLEWORD) != 0;
+    BOOL down = (g_app.findFlags & FR_DOWN) != 0;
+    
+    // Reverse search direction if requested (Shift+F3)
+    if (reverse) down = !down;
+
+    // An invalid pattern has already been reported
+    if (g_app.settings.values.findRegex && !GetFindRegex(g_app.findText, matchCase)) return FALSE;
+    FollowFindString();
+    
+    // Start searching from end of selection (forward) or start (backward)
+    DWORD searchStart = down ? end : start;
+    DWORD outStart = 0, outEnd = 0;
+    
+    // Perform the search (a binary search if Find All has indexed this string)
+    BOOL found = FindAllUsable(g_app.findText, matchCase, wholeWord)
+        ? FindAllNext(down, start, end, &outStart, &outEnd)
+        : FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, wholeWord, down, searchStart, &outStart, &outEnd);
+    if (found) {
+        // Found: Select the found text
+        SendMessageW(g_app.hwndEdit, EM_SETSEL, outStart, outEnd);
+        // Scroll to make selection visible
+        SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+        UpdateStatusBar(g_app.hwndMain);
+        return TRUE;
+    }
+    
+    // Not found: Show message
+    MessageBoxW(g_app.hwndMain, L"Cannot find the text.", APP_TITLE, MB_ICONINFORMATION);
+    return FALSE;
+}
+
+// ============================================================================
+// UseSelectionForFind - Take the Selection as the Find or Replace String
+// ============================================================================
+// The selection may be any length and span lines (a stack trace, a block of
+// SQL); F3, Replace and Replace All then use all of it. An open Find or
+// Replace dialog shows its first line.
+// Parameters:
+//   replace - TRUE to set the replace string, FALSE for the find string
+// ============================================================================
+static void UseSelectionForFind(HWND hwnd, BOOL replace) {
+    DWORD start = 0, end = 0;
+    SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
+    size_t length = 0;
+    const WCHAR *text = (start != end) ? LockEditText(g_app.hwndEdit, &length) : NULL;
+    if (!text) {
+        MessageBeep(MB_OK);
+        return;
+    }
+    if (end > length) end = (DWORD)length;
+    if (start > end) start = end;
+    WCHAR **target = replace ? &g_app.replaceText : &g_app.findText;
+    BOOL ok = SetSearchString(target, text + start, end - start);
+    UnlockEditText(g_app.hwndEdit);
+    if (!ok) {
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+
+    HWND dlg = g_app.hReplaceDlg ? g_app.hReplaceDlg : g_app.hFindDlg;
+    if (dlg) {
+        WCHAR *shown = replace ? g_app.replaceDlgText : g_app.findDlgText;
+        ShowInDialog(shown, *target);
+        SetDlgItemTextW(dlg, replace ? edt2 : edt1, shown);
+    }
+}
+
+// ============================================================================
+// Incremental Search - Search as You Type
+// ============================================================================
+// Ctrl+I opens a search bar above the status bar. Each keystroke selects
+// the nearest occurrence of the query at or after where the search started
+// (wrapping around), and the bar counts them: "Match 3 of 12,408". The
+// keystroke itself only searches a bounded stretch past the anchor; the
+// count comes from a scan that continues in timer slices and starts over
+// whenever the query changes, so a superseded scan simply never finishes.
+// When the query grows, the occurrences found so far are checked again
+// instead of the text. The search is literal and follows the Find dialog's
+// Match case option; the EDIT control can only highlight the selection.
+// ============================================================================
+static void SelectIncMatch(size_t position) {
+    g_app.incMatch = position;
+    g_app.incPending = FALSE;
+    SendMessageW(g_app.hwndEdit, EM_SETSEL, (WPARAM)position, (LPARAM)(position + g_app.incSearch.needleLength));
+    SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+}
+
+static void UpdateIncSearchStatus(void) {
+    const IncSearch *search = &g_app.incSearch;
+    WCHAR status[96] = L"", total[32], current[32];
+    if (search->needleLength > 0) {
+        const WCHAR *more = search->complete ? L"" : L"+";
+        size_t ordinal = (g_app.incMatch != TEXT_NOT_FOUND)
+            ? IncSearchOrdinal(search, g_app.incMatch) : TEXT_NOT_FOUND;
+        FormatCount(search->count, total, ARRAYSIZE(total));
+        if (search->complete && search->count == 0) {
+            StringCchCopyW(status, ARRAYSIZE(status), L"No matches");
+        } else if (ordinal != TEXT_NOT_FOUND) {
+            FormatCount(ordinal + 1, current, ARRAYSIZE(current));
+            StringCchPrintfW(status, ARRAYSIZE(status), L"Match %s of %s%s", current, total, more);
+        } else {
+            StringCchPrintfW(status, ARRAYSIZE(status), L"Matches: %s%s", total, more);
+        }
+    }
+    SearchBarSetStatus(&g_app.searchBar, status);
+}
+
+// Selects the nearest occurrence at or after the anchor once the scan has
+// found it, or the first one once the scan is complete
+static void ResolveIncMatch(const uint16_t *text, size_t length) {
+    const IncSearch *search = &g_app.incSearch;
+    size_t found = IncSearchNextKnown(search, g_app.incAnchor);
+    if (found == TEXT_NOT_FOUND && search->complete) {
+        if (search->overflow) {
+            // Not every occurrence was recorded; there are plenty, search directly
+            found = TextFind(text, length, g_app.incAnchor, search->needle, search->needleLength, search->fold);
+            if (found == TEXT_NOT_FOUND) {
+                found = TextFind(text, length, 0, search->needle, search->needleLength, search->fold);
+            }
+        } else {
+            found = IncSearchNextKnown(search, 0);
+        }
+        if (found == TEXT_NOT_FOUND) g_app.incPending = FALSE;   // No matches at all
+    }
+    if (found != TEXT_NOT_FOUND) SelectIncMatch(found);
+}
+
+// Runs one scan slice (WM_TIMER)
+static void ContinueIncSearch(void) {
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text) {
+        KillTimer(g_app.hwndMain, INC_SEARCH_TIMER_ID);
+        return;
+    }
+    BOOL complete = IncSearchStep(&g_app.incSearch, (const uint16_t *)text, length, INC_SEARCH_SLICE_CHARS);
+    if (g_app.incPending) ResolveIncMatch((const uint16_t *)text, length);
+    UnlockEditText(g_app.hwndEdit);
+    if (complete) KillTimer(g_app.hwndMain, INC_SEARCH_TIMER_ID);
+    UpdateIncSearchStatus();
+}
+
+// The query changed (EN_CHANGE from the search bar)
+static void IncSearchQueryChanged(void) {
+    WCHAR query[SEARCH_BAR_MAX_QUERY + 1];
+    GetWindowTextW(g_app.searchBar.query, query, ARRAYSIZE(query));
+    size_t queryLength = wcslen(query);
+    BOOL matchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
+    const uint16_t *fold = matchCase ? NULL : GetLowerFoldTable();
+    size_t length = 0;
+    const WCHAR *text = (matchCase || fold) ? LockEditText(g_app.hwndEdit, &length) : NULL;
+
+    KillTimer(g_app.hwndMain, INC_SEARCH_TIMER_ID);
+    g_app.incMatch = TEXT_NOT_FOUND;
+    g_app.incPending = FALSE;
+    if (!text || !IncSearchSetQuery(&g_app.incSearch, (const uint16_t *)query, queryLength, fold,
+                                    (const uint16_t *)text, length)) {
+        if (text) UnlockEditText(g_app.hwndEdit);
+        IncSearchFree(&g_app.incSearch);
+        SearchBarSetStatus(&g_app.searchBar, L"Not enough memory to search.");
+        return;
+    }
+
+    const IncSearch *search = &g_app.incSearch;
+    if (queryLength > 0) {
+        g_app.incPending = TRUE;
+        ResolveIncMatch((const uint16_t *)text, length);
+        if (g_app.incPending) {
+            // Not found yet: look a short way past the anchor (occurrences
+            // before 'scanned' are all known), and leave the rest to the scan
+            size_t from = (!search->overflow && search->scanned > g_app.incAnchor) ? search->scanned : g_app.incAnchor;
+            size_t limit = (length - from > INC_SEARCH_NEAR_CHARS + queryLength) ? from + INC_SEARCH_NEAR_CHARS + queryLength : length;
+            size_t found = (from < length)
+                ? TextFind((const uint16_t *)text, limit, from, search->needle, queryLength, search->fold) : TEXT_NOT_FOUND;
+            if (found != TEXT_NOT_FOUND) SelectIncMatch(found);
+        }
+    }
+    UnlockEditText(g_app.hwndEdit);
+
+    // Nothing selected: back to where the search started
+    if (g_app.incMatch == TEXT_NOT_FOUND) {
+        SendMessageW(g_app.hwndEdit, EM_SETSEL, (WPARAM)g_app.incAnchor, (LPARAM)g_app.incAnchor);
+        SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+    }
+    if (!search->complete) SetTimer(g_app.hwndMain, INC_SEARCH_TIMER_ID, USER_TIMER_MINIMUM, NULL);
+    UpdateIncSearchStatus();
+}
+
+// Next or previous occurrence (Enter / Shift+Enter in the search bar)
+static void IncSearchMove(BOOL forward) {
+    const IncSearch *search = &g_app.incSearch;
+    if (search->needleLength == 0) return;
+    DWORD selStart = 0, selEnd = 0;
+    SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&selStart, (LPARAM)&selEnd);
+    size_t length = 0;
+    const uint16_t *text = (const uint16_t *)LockEditText(g_app.hwndEdit, &length);
+    if (!text) return;
+
+    // Recorded occurrences answer at once; otherwise search directly
+    BOOL known = search->complete && !search->overflow;
+    size_t found;
+    if (forward) {
+        found = IncSearchNextKnown(search, (size_t)selStart + 1);
+        if (found == TEXT_NOT_FOUND && !known) {
+            found = TextFind(text, length, (size_t)selStart + 1, search->needle, search->needleLength, search->fold);
+        }
+        if (found == TEXT_NOT_FOUND) {
+            found = known ? IncSearchNextKnown(search, 0)
+                          : TextFind(text, length, 0, search->needle, search->needleLength, search->fold);
+        }
+    } else {
+        found = IncSearchPrevKnown(search, selStart);
+        if (found == TEXT_NOT_FOUND && !known) {
+            found = TextFindLast(text, length, selStart, search->needle, search->needleLength, search->fold);
+        }
+        if (found == TEXT_NOT_FOUND) {
+            found = known ? IncSearchPrevKnown(search, length)
+                          : TextFindLast(text, length, length, search->needle, search->needleLength, search->fold);
+        }
+    }
+    UnlockEditText(g_app.hwndEdit);
+
+    if (found == TEXT_NOT_FOUND) {
+        MessageBeep(MB_OK);
+        return;
+    }
+    g_app.incAnchor = found;    // Typing on continues from here
+    SelectIncMatch(found);
+    UpdateIncSearchStatus();
+}
+
+static void IncSearchTextChanged(void) {
+    if (!g_app.searchBar.visible || g_app.incSearch.needleLength == 0) return;
+    IncSearchRestart(&g_app.incSearch);
+    g_app.incMatch = TEXT_NOT_FOUND;
+    g_app.incPending = FALSE;
+    SetTimer(g_app.hwndMain, INC_SEARCH_TIMER_ID, USER_TIMER_MINIMUM, NULL);
+    UpdateIncSearchStatus();
+}
+
+// ============================================================================
+// ShowSearchBar / CloseSearchBar
+// ============================================================================
+static void ShowSearchBar(HWND hwnd) {
+    if (!g_app.searchBar.query && !SearchBarCreate(&g_app.searchBar, hwnd, g_hInst)) return;
+    DWORD selStart = 0, selEnd = 0;
+    SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&selStart, (LPARAM)&selEnd);
+    g_app.incAnchor = selStart;
+    if (!g_app.searchBar.visible) {
+        SearchBarShow(&g_app.searchBar, TRUE);
+        UpdateLayout(hwnd);
+    }
+    SetFocus(g_app.searchBar.query);
+    SendMessageW(g_app.searchBar.query, EM_SETSEL, 0, -1);
+    IncSearchRestart(&g_app.incSearch);     // The document may have changed since
+    IncSearchQueryChanged();
+}
+
+static void CloseSearchBar(HWND hwnd) {
+    if (!g_app.searchBar.visible) return;
+    KillTimer(hwnd, INC_SEARCH_TIMER_ID);
+    IncSearchFree(&g_app.incSearch);
+    g_app.incMatch = TEXT_NOT_FOUND;
+    g_app.incPending = FALSE;
+    SearchBarShow(&g_app.searchBar, FALSE);
+    UpdateLayout(hwnd);
+    SetFocus(g_app.hwndEdit);
+}
+
+// ============================================================================
+// Syntax Highlighting - Line States for Printing
+// ============================================================================
+// The edit control only draws plain text, so highlighting shows where
+// retropad draws the text itself: on paper. The lexer state at the start
+// of every line (see highlight.h) follows each edit as it happens, which
+// costs no lexing at all; the states are lexed a slice at a time from a
+// timer once editing pauses, and on demand for the lines being printed.
+// The cache counts the edit control's lines, which word wrap turns into
+// screen lines, so anything that rewraps the text starts it over.
+// ============================================================================
+static size_t HighlightLineStart(void *context, size_t line) {
+    return (size_t)SendMessageW((HWND)context, EM_LINEINDEX, (WPARAM)line, 0);
+}
+
+static void ScheduleHighlight(void) {
+    if (g_app.highlight.language && !HighlightCacheComplete(&g_app.highlight)) {
+        SetTimer(g_app.hwndMain, HIGHLIGHT_TIMER_ID, HIGHLIGHT_IDLE_DELAY_MS, NULL);
+    }
+}
+
+// Starts over: the text was replaced, renamed or rewrapped
+static void ResetHighlight(void) {
+    if (!g_app.hwndMain || !g_app.hwndEdit) return;
+    KillTimer(g_app.hwndMain, HIGHLIGHT_TIMER_ID);
+    const HighlightLanguage *language = HighlightLanguageForPath((const uint16_t *)g_app.currentPath);
+    size_t lines = (size_t)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
+    HighlightCacheReset(&g_app.highlight, language, lines);
+    ScheduleHighlight();
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Moves the line states past an edit. The lines from the real start of the
+// line before the edit to the real end of the line after it are the ones
+// that changed; word wrap cannot rewrap anything outside them.
+static void HighlightNoteEdit(size_t offset, size_t inserted) {
+    HighlightCache *cache = &g_app.highlight;
+    if (!cache->language) return;
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text) {
+        ResetHighlight();
+        return;
+    }
+    size_t end = offset + inserted < length ? offset + inserted : length;
+    size_t from = LineFilterLineStart((const uint16_t *)text, length, offset > 0 ? offset - 1 : 0);
+    size_t to = LineFilterLineEnd((const uint16_t *)text, length, end);
+    UnlockEditText(g_app.hwndEdit);
+
+    size_t first = (size_t)SendMessageW(g_app.hwndEdit, EM_LINEFROMCHAR, (WPARAM)from, 0);
+    size_t last = (size_t)SendMessageW(g_app.hwndEdit, EM_LINEFROMCHAR, (WPARAM)to, 0);
+    size_t lines = (size_t)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
+    size_t insertedLines = last - first;
+    if (last < first || lines > cache->lineCount + insertedLines ||
+        !HighlightCacheEdit(cache, first, cache->lineCount + insertedLines - lines, insertedLines)) {
+        ResetHighlight();
+        return;
+    }
+    ScheduleHighlight();
+}
+
+// Lexes one slice (WM_TIMER)
+static void ContinueHighlight(void) {
+    HighlightCache *cache = &g_app.highlight;
+    size_t lines = (size_t)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
+    if (cache->language && cache->lineCount != lines) {
+        ResetHighlight();       // The text changed without NoteEdit
+        return;
+    }
+    size_t length = 0;
+    const WCHAR *text = cache->language ? LockEditText(g_app.hwndEdit, &length) : NULL;
+    if (text) {
+        HighlightCacheAdvance(cache, (const uint16_t *)text, length, HighlightLineStart, g_app.hwndEdit,
+                              cache->lineCount, HIGHLIGHT_SLICE_LINES);
+        UnlockEditText(g_app.hwndEdit);
+    }
+    if (!text || HighlightCacheComplete(cache)) {
+        KillTimer(g_app.hwndMain, HIGHLIGHT_TIMER_ID);
+    } else {
+        SetTimer(g_app.hwndMain, HIGHLIGHT_TIMER_ID, USER_TIMER_MINIMUM, NULL);
+    }
+}
+
+// ============================================================================
+// NoteEdit / NoteTextReplaced - Keep Searches in Step with the Document
+// ============================================================================
+// Called after every change to the text: NoteEdit when the undo capture
+// could describe it ('removed' characters at 'offset' became 'inserted'),
+// NoteTextReplaced when it could not (undo, Replace All, out of memory).
+// ============================================================================
+static void NoteEdit(size_t offset, size_t removed, size_t inserted) {
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (text) {
+        LineIndexEdit(&g_app.lineIndex, (const uint16_t *)text, length, offset, removed, inserted);
+        UnlockEditText(g_app.hwndEdit);
+    } else {
+        LineIndexDropFrom(&g_app.lineIndex, offset);
+    }
+    FindAllNoteEdit(offset, removed, inserted);
+    FilterNoteEdit(offset, removed, inserted);
+    IncSearchTextChanged();
+    CountTextChanged();
+    if (!TrigramIndexUpdate(&g_app.searchIndex, offset, removed, inserted)) ResetSearchIndex();
+    HighlightNoteEdit(offset, inserted);
+    PaginationEdit(&g_app.pagination, offset);
+}
+
+static void NoteTextReplaced(void) {
+    LineIndexDropFrom(&g_app.lineIndex, 0);
+    FindAllInvalidate();
+    FilterInvalidate();
+    IncSearchTextChanged();
+    CountTextChanged();
+    ResetSearchIndex();
+    ResetHighlight();
+    PaginationEdit(&g_app.pagination, 0);
+}
+
+// ============================================================================
+// Search Index - Candidate Blocks for Repeated Searches
+// ============================================================================
+// The first search of a large document starts a trigram index (see
+// trigram_index.h), built a slice at a time from a timer so the editor
+// stays responsive. Once it is ready, literal searches, and regular
+// expressions that start with a literal, read only the blocks that can hold
+// a match. Edits mark the blocks they touch; an index that has changed too
+// much, or any change made while it is being built, drops it until the
+// next search.
+// ============================================================================
+static void ResetSearchIndex(void) {
+    if (g_app.hwndMain) KillTimer(g_app.hwndMain, SEARCH_INDEX_TIMER_ID);
+    if (g_app.searchIndex.state == TRIGRAM_EMPTY) return;
+    TrigramIndexFree(&g_app.searchIndex);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+static void StartSearchIndex(size_t textLength) {
+    if (!g_app.settings.values.searchIndex || textLength < SEARCH_INDEX_MIN_CHARS) return;
+    const uint16_t *fold = GetLowerFoldTable();
+    if (!fold || !TrigramIndexBegin(&g_app.searchIndex, fold, textLength)) return;
+    SetTimer(g_app.hwndMain, SEARCH_INDEX_TIMER_ID, USER_TIMER_MINIMUM, NULL);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Builds one slice (WM_TIMER)
+static void ContinueSearchIndex(void) {
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text || length != g_app.searchIndex.length) {
+        if (text) UnlockEditText(g_app.hwndEdit);
+        ResetSearchIndex();
+        return;
+    }
+    BOOL done = TrigramIndexStep(&g_app.searchIndex, (const uint16_t *)text, length, SEARCH_INDEX_SLICE_CHARS);
+    UnlockEditText(g_app.hwndEdit);
+    if (done) KillTimer(g_app.hwndMain, SEARCH_INDEX_TIMER_ID);
+    UpdateStatusBar(g_app.hwndMain);
+}
+
+// Candidate blocks for a literal that every match starts with. Returns
+// FALSE if the whole text must be searched; the index is then started if
+// the document is large enough for one.
+static BOOL SearchIndexQuery(TrigramQuery *query, const uint16_t *literal, size_t literalLength,
+                             size_t textLength) {
+    if (g_app.searchIndex.state != TRIGRAM_EMPTY && g_app.searchIndex.length != textLength) {
+        ResetSearchIndex();     // The text changed without NoteEdit
+    }
+    if (g_app.searchIndex.state == TRIGRAM_EMPTY) StartSearchIndex(textLength);
+    return TrigramQueryInit(query, &g_app.searchIndex, literal, literalLength);
+}
+
+// Returns the matcher to search with: 'matcher' narrowed to the candidate
+// blocks for 'literal', or 'matcher' itself. Free 'indexed' afterwards
+// either way.
+static const ChunkMatcher *NarrowBySearchIndex(const ChunkMatcher *matcher, const uint16_t *literal,
+                                               size_t literalLength, size_t textLength,
+                                               IndexedMatcher *indexed) {
+    TrigramQuery query;
+    ZeroMemory(indexed, sizeof(*indexed));
+    if (!SearchIndexQuery(&query, literal, literalLength, textLength)) return matcher;
+    IndexedMatcherInit(indexed, matcher, &query);
+    return &indexed->matcher;
+}
+
+// ============================================================================
+// DoGoToMatching - Jump to a Line Picked by Fuzzy Match (Ctrl+Shift+G)
+// ============================================================================
+// Opens the line palette over the edit control's own buffer; the text is
+// locked while it is open, which is safe because the dialog is modal.
+// Lines are picked by offset, so this works with word wrap on as well.
+// ============================================================================
+static void DoGoToMatching(HWND hwnd) {
+    HWND edit = g_app.hwndEdit;
+    size_t length = 0;
+    const WCHAR *text = LockEditText(edit, &length);
+    if (!text) {
+        MessageBoxW(hwnd, L"Not enough memory to list the lines.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    size_t offset = 0;
+    INT_PTR result = LinePaletteShow(hwnd, g_hInst, (const uint16_t *)text, length, GetLowerFoldTable(), &offset);
+    UnlockEditText(edit);
+    if (result == -1) {
+        MessageBoxW(hwnd, L"Not enough memory to list the lines.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    if (result != IDOK) return;
+    SendMessageW(edit, EM_SETSEL, (WPARAM)offset, (LPARAM)offset);
+    SendMessageW(edit, EM_SCROLLCARET, 0, 0);
+    UpdateStatusBar(hwnd);
+}
+
+// ============================================================================
+// GoToDlgProc - Dialog Procedure for "Go To Line" Dialog
+// ============================================================================
+// Handles messages for the Go To Line dialog box. Allows user to enter a
+// line number and jump to that line in the editor.
+// ============================================================================
+static INT_PTR CALLBACK GoToDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
+    UNREFERENCED_PARAMETER(lParam);
+    
+    switch (msg) {
+    // Initialize dialog when first shown
+    case WM_INITDIALOG: {
+        // Set default line number to 1
+        SetDlgItemInt(dlg, IDC_GOTO_EDIT, 1, FALSE);
+        // Limit input to 10 digits (max line number)
+        HWND edit = GetDlgItem(dlg, IDC_GOTO_EDIT);
+        SendMessageW(edit, EM_SETLIMITTEXT, 10, 0);
+        return TRUE;
+    }
+    
+    // Handle button clicks
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDOK: {
+            // Get line number from edit control
+            BOOL ok = FALSE;
+            UINT line = GetDlgItemInt(dlg, IDC_GOTO_EDIT, &ok, FALSE);
+            
+            // Validate input
+            if (!ok || line == 0) {
+                MessageBoxW(dlg, L"Enter a valid line number.", APP_TITLE, MB_ICONWARNING);
+                return TRUE;
+            }
+            
+            // Clamp to valid range (1 to maxLine)
+            int maxLine = (int)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
+            if ((int)line > maxLine) line = (UINT)maxLine;
+            
+            // Get character index for start of requested line
+            // EM_LINEINDEX: line number -> character position
+            int charIndex = (int)SendMessageW(g_app.hwndEdit, EM_LINEINDEX, line - 1, 0);
+            if (charIndex >= 0) {
+                // Move cursor to start of line
+                SendMessageW(g_app.hwndEdit, EM_SETSEL, charIndex, charIndex);
+                // Scroll to make cursor visible
+                SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+            }
+            EndDialog(dlg, IDOK);
+            return TRUE;
+        }
+        case IDCANCEL:
+            EndDialog(dlg, IDCANCEL);
+            return TRUE;
+        }
+        break;
+    }
+    return FALSE;
+}
+
+// ============================================================================
+// CollectMultiMatch - AhoScan Callback Adding a Result
+// ============================================================================
+static bool CollectMultiMatch(void *context, const AhoMatch *match) {
+    return ResultsPaneAdd((ResultsPane *)context, match->start, (DWORD)match->length, match->pattern) != FALSE;
+}
+
+// ============================================================================
+// DoFindMultiple - Find Every Occurrence of a Term List
+// ============================================================================
+// Asks for terms (one per line), builds one automaton for all of them and
+// scans the document once. Every match goes to the results list with the
+// term that produced it; the status bar shows the totals.
+// ============================================================================
+static void DoFindMultiple(HWND hwnd) {
+    if (DialogBoxW(g_hInst, MAKEINTRESOURCE(IDD_FIND_MULTI), hwnd, FindMultiDlgProc) != IDOK) return;
+    if (!g_app.multiTerms) return;
+
+    const uint16_t *fold = NULL;
+    if (!g_app.multiMatchCase && !(fold = GetLowerFoldTable())) {
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+
+    // Split into lines; blank lines and repeated terms are dropped
+    size_t lineCount = 1;
+    for (const WCHAR *p = g_app.multiTerms; *p; ++p) {
+        if (*p == L'\n') lineCount++;
+    }
+    const WCHAR **terms = (const WCHAR **)HeapAlloc(GetProcessHeap(), 0, lineCount * sizeof(WCHAR *));
+    size_t *lengths = (size_t *)HeapAlloc(GetProcessHeap(), 0, lineCount * sizeof(size_t));
+    if (!terms || !lengths) {
+        if (terms) HeapFree(GetProcessHeap(), 0, (void *)terms);
+        if (lengths) HeapFree(GetProcessHeap(), 0, lengths);
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    size_t count = 0;
+    for (const WCHAR *line = g_app.multiTerms; line; ) {
+        const WCHAR *next = wcschr(line, L'\n');
+        size_t length = next ? (size_t)(next - line) : (size_t)lstrlenW(line);
+        if (length > 0 && line[length - 1] == L'\r') length--;
+        BOOL repeated = (length == 0);
+        for (size_t i = 0; i < count && !repeated; ++i) {
+            if (lengths[i] != length) continue;
+            repeated = TRUE;
+            for (size_t k = 0; k < length && repeated; ++k) {
+                uint16_t a = (uint16_t)terms[i][k], b = (uint16_t)line[k];
+                repeated = fold ? fold[a] == fold[b] : a == b;
+            }
+        }
+        if (!repeated) {
+            terms[count] = line;
+            lengths[count] = length;
+            count++;
+        }
+        line = next ? next + 1 : NULL;
+    }
+
+    AhoCorasick *automaton = NULL;
+    AhoError error = AhoBuild((const uint16_t *const *)terms, lengths, count, fold, &automaton);
+    if (error == AHO_OK) {
+        EndFindAll();
+        EndFilter();
+        EndFindInFiles();
+        ResultsPaneClear(&g_app.results);
+        if (!ResultsPaneSetTags(&g_app.results, terms, lengths, count)) error = AHO_ERROR_MEMORY;
+    }
+    HeapFree(GetProcessHeap(), 0, (void *)terms);
+    HeapFree(GetProcessHeap(), 0, lengths);
+    if (error != AHO_OK) {
+        AhoFree(automaton);
+        ResultsPanePublish(&g_app.results);
+        MessageBoxW(hwnd,
+                    error == AHO_ERROR_EMPTY ? L"Enter at least one term to find." :
+                    error == AHO_ERROR_TOO_BIG ? L"The term list is too large to search." :
+                                                 L"Not enough memory to search.",
+                    APP_TITLE, error == AHO_ERROR_EMPTY ? MB_ICONINFORMATION : MB_ICONERROR);
+        return;
+    }
+
+    // One pass over the whole document
+    HCURSOR oldCursor = SetCursor(LoadCursorW(NULL, IDC_WAIT));
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (text) {
+        AhoScan(automaton, (const uint16_t *)text, length, CollectMultiMatch, &g_app.results);
+        UnlockEditText(g_app.hwndEdit);
+    }
+    AhoFree(automaton);
+    SetCursor(oldCursor);
+
+    ResultsPanePublish(&g_app.results);
+    ToggleResults(hwnd, TRUE);
+    if (g_app.results.truncated) {
+        MessageBoxW(hwnd, L"Not enough memory to list every match; the list is incomplete.",
+                    APP_TITLE, MB_ICONWARNING);
+    } else if (g_app.results.count == 0) {
+        MessageBoxW(hwnd, L"Cannot find any of the terms.", APP_TITLE, MB_ICONINFORMATION);
+    }
+}
+
+// ============================================================================
+// FindMultiDlgProc - Dialog Procedure for the "Find Multiple" Dialog
+// ============================================================================
+// Edits the term list and match-case option kept in g_app between uses.
+// ============================================================================
+static INT_PTR CALLBACK FindMultiDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
+    UNREFERENCED_PARAMETER(lParam);
+
+    switch (msg) {
+    case WM_INITDIALOG:
+        if (g_app.multiTerms) SetDlgItemTextW(dlg, IDC_MULTI_TERMS, g_app.multiTerms);
+        CheckDlgButton(dlg, IDC_MULTI_MATCH_CASE, g_app.multiMatchCase ? BST_CHECKED : BST_UNCHECKED);
+        return TRUE;
+
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDOK: {
+            HWND edit = GetDlgItem(dlg, IDC_MULTI_TERMS);
+            int length = GetWindowTextLengthW(edit);
+            WCHAR *terms = (WCHAR *)HeapAlloc(GetProcessHeap(), 0, ((size_t)length + 1) * sizeof(WCHAR));
+            if (!terms) {
+                MessageBoxW(dlg, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+                return TRUE;
+            }
+            GetWindowTextW(edit, terms, length + 1);
+            if (g_app.multiTerms) HeapFree(GetProcessHeap(), 0, g_app.multiTerms);
+            g_app.multiTerms = terms;
+            g_app.multiMatchCase = IsDlgButtonChecked(dlg, IDC_MULTI_MATCH_CASE) == BST_CHECKED;
+            EndDialog(dlg, IDOK);
+            return TRUE;
+        }
+        case IDCANCEL:
+            EndDialog(dlg, IDCANCEL);
+            return TRUE;
+        }
+        break;
+    }
+    return FALSE;
+}
+
+// ============================================================================
+// Find in Files
+// ============================================================================
+// The search runs on its own threads (find_in_files.c) and posts
+// WM_APP_FIND_IN_FILES as matches come in; the results list shows them as
+// they arrive, one row per match, and opens the file when a row is chosen.
+// ============================================================================
+
+// Text of the results list rows: file (relative to the searched folder),
+// line number and the line around the match
+static BOOL FileMatchText(void *context, size_t row, int column, WCHAR *out, size_t outLen) {
+    FindInFiles *search = (FindInFiles *)context;
+    FileMatch match;
+    if (!FindInFilesGetMatch(search, row, &match)) return FALSE;
+    if (column == RESULTS_COLUMN_TERM) {
+        const WCHAR *folder = FindInFilesFolder(search);
+        size_t folderLength = wcslen(folder);
+        const WCHAR *name = match.path;
+        if (CompareStringOrdinal(name, (int)folderLength, folder, (int)folderLength, TRUE) == CSTR_EQUAL &&
+            name[folderLength] == L'\\') {
+            name += folderLength + 1;
+        }
+        StringCchCopyW(out, outLen, name);
+    } else if (column == RESULTS_COLUMN_LINE) {
+        FormatCount((size_t)match.line + 1, out, outLen);
+    } else {
+        StringCchCopyW(out, outLen, match.text);
+    }
+    return TRUE;
+}
+
+// Opens the file of a results list row (unless it is the open document)
+// and selects the match
+static void OpenFileMatch(void *context, size_t row) {
+    FileMatch match;
+    if (!FindInFilesGetMatch((FindInFiles *)context, row, &match)) return;
+    HWND hwnd = g_app.hwndMain;
+    if (lstrcmpiW(match.path, g_app.currentPath) != 0) {
+        if (!PromptSaveChanges(hwnd) || !LoadDocumentFromPath(hwnd, match.path)) return;
+    }
+
+    // Lines are counted as the search counted them, by '\n'; the column is
+    // clamped to the line in case the file has changed since
+    size_t length = 0;
+    const WCHAR *text = LockEditText(g_app.hwndEdit, &length);
+    if (!text) return;
+    size_t pos = 0;
+    for (ULONGLONG line = 0; line < match.line && pos < length; ++pos) {
+        if (text[pos] == L'\n') line++;
+    }
+    size_t lineEnd = pos;
+    while (lineEnd < length && text[lineEnd] != L'\r' && text[lineEnd] != L'\n') lineEnd++;
+    UnlockEditText(g_app.hwndEdit);
+    size_t start = (match.column < lineEnd - pos) ? pos + (size_t)match.column : lineEnd;
+    size_t end = (match.length < lineEnd - start) ? start + match.length : lineEnd;
 
-    // Create modeless Replace dialog
-    g_app.hReplaceDlg = ReplaceTextW(&g_app.find);
+    SendMessageW(g_app.hwndEdit, EM_SETSEL, (WPARAM)start, (LPARAM)end);
+    SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+    SetFocus(g_app.hwndEdit);
+    UpdateStatusBar(hwnd);
+}
+
+// Takes the matches found since the last WM_APP_FIND_IN_FILES
+static void FindInFilesProgress(HWND hwnd) {
+    if (!g_app.fileSearch) return;  // Posted by a search that has since been dropped
+    BOOL wasDone = g_app.filesStatus.done;
+    FindInFilesPoll(g_app.fileSearch, &g_app.filesStatus);
+    ResultsPaneSetTextSource(&g_app.results, FileMatchText, OpenFileMatch, g_app.fileSearch,
+                             g_app.filesStatus.matches, L"File");
+    ResultsPanePublish(&g_app.results);
+    UpdateStatusBar(hwnd);
+    if (!g_app.filesStatus.done || wasDone) return;
+    if (g_app.filesStatus.totalMatches == 0) {
+        MessageBoxW(hwnd, L"Cannot find the text in any file.", APP_TITLE, MB_ICONINFORMATION);
+    } else if (g_app.filesStatus.totalMatches > g_app.filesStatus.matches) {
+        WCHAR shown[32], message[128];
+        FormatCount(g_app.filesStatus.matches, shown, ARRAYSIZE(shown));
+        StringCchPrintfW(message, ARRAYSIZE(message), L"Only the first %s matches are listed.", shown);
+        MessageBoxW(hwnd, message, APP_TITLE, MB_ICONWARNING);
+    }
+}
+
+static void EndFindInFiles(void) {
+    if (!g_app.fileSearch) return;
+    FindInFilesFree(g_app.fileSearch);
+    g_app.fileSearch = NULL;
+    ZeroMemory(&g_app.filesStatus, sizeof(g_app.filesStatus));
 }
 
 // ============================================================================
-// DoFindNext - Find Next Occurrence (F3 Key)
+// DoFindInFiles - Search Every File in a Folder
 // ============================================================================
-// Finds the next occurrence of the last search string. If no search has been
-// performed yet, opens the Find dialog. Supports reverse searching.
-// Parameters:
-//   reverse - TRUE to search backward, FALSE to search forward
-// Returns: TRUE if found, FALSE if not found or no search string
+// Asks for the text, folder and file types, then starts the background
+// search. The results list takes over from any document search results.
 // ============================================================================
-static BOOL DoFindNext(BOOL reverse) {
-    // If no previous search, open Find dialog
-    if (g_app.findText[0] == L'\0') {
-        ShowFindDialog(g_app.hwndMain);
-        return FALSE;
+static void DoFindInFiles(HWND hwnd) {
+    if (DialogBoxW(g_hInst, MAKEINTRESOURCE(IDD_FIND_IN_FILES), hwnd, FindInFilesDlgProc) != IDOK) return;
+
+    const uint16_t *fold = NULL;
+    if (!g_app.filesMatchCase && !(fold = GetLowerFoldTable())) {
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
     }
 
-    // Get current selection (cursor position)
-    DWORD start = 0, end = 0;
-    SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
-    
-    // Extract flags
-    BOOL matchCase = (g_app.findFlags & FR_MATCHCASE) != 0;
-    BOOL down = (g_app.findFlags & FR_DOWN) != 0;
-    
-    // Reverse search direction if requested (Shift+F3)
-    if (reverse) down = !down;
-    
-    // Start searching from end of selection (forward) or start (backward)
-    DWORD searchStart = down ? end : start;
-    DWORD outStart = 0, outEnd = 0;
-    
-    // Perform the search
-    if (FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, down, searchStart, &outStart, &outEnd)) {
-        // Found: Select the found text
-        SendMessageW(g_app.hwndEdit, EM_SETSEL, outStart, outEnd);
-        // Scroll to make selection visible
-        SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
-        return TRUE;
+    EndFindAll();
+    EndFilter();
+    EndFindInFiles();
+    ResultsPaneClear(&g_app.results);
+    FindInFilesQuery query;
+    query.folder = g_app.filesFolder;
+    query.fileTypes = g_app.filesTypes;
+    query.needle = g_app.filesText;
+    query.matchCase = g_app.filesMatchCase;
+    query.fold = fold;
+    g_app.fileSearch = FindInFilesStart(&query, hwnd, WM_APP_FIND_IN_FILES);
+    if (!g_app.fileSearch) {
+        ResultsPanePublish(&g_app.results);
+        MessageBoxW(hwnd, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
     }
-    
-    // Not found: Show message
-    MessageBoxW(g_app.hwndMain, L"Cannot find the text.", APP_TITLE, MB_ICONINFORMATION);
-    return FALSE;
+
+    // Rows appear as WM_APP_FIND_IN_FILES reports them
+    ToggleResults(hwnd, TRUE);
+    ResultsPaneSetTextSource(&g_app.results, FileMatchText, OpenFileMatch, g_app.fileSearch, 0, L"File");
+    ResultsPanePublish(&g_app.results);
+    UpdateStatusBar(hwnd);
 }
 
 // ============================================================================
-// GoToDlgProc - Dialog Procedure for "Go To Line" Dialog
+// FindInFilesDlgProc - Dialog Procedure for the "Find in Files" Dialog
 // ============================================================================
-// Handles messages for the Go To Line dialog box. Allows user to enter a
-// line number and jump to that line in the editor.
+// Edits the options kept in g_app between uses. The first time, the text
+// comes from the Find dialog and the folder is the open document's.
 // ============================================================================
-static INT_PTR CALLBACK GoToDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
+static INT_PTR CALLBACK FindInFilesDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
     UNREFERENCED_PARAMETER(lParam);
-    
+
     switch (msg) {
-    // Initialize dialog when first shown
-    case WM_INITDIALOG: {
-        // Set default line number to 1
-        SetDlgItemInt(dlg, IDC_GOTO_EDIT, 1, FALSE);
-        // Limit input to 10 digits (max line number)
-        HWND edit = GetDlgItem(dlg, IDC_GOTO_EDIT);
-        SendMessageW(edit, EM_SETLIMITTEXT, 10, 0);
+    case WM_INITDIALOG:
+        if (g_app.filesText[0] == L'\0') {
+            StringCchCopyNW(g_app.filesText, ARRAYSIZE(g_app.filesText), g_app.findText,
+                            DialogPrefixLength(g_app.findText));
+        }
+        if (g_app.filesFolder[0] == L'\0') {
+            WCHAR *slash = NULL;
+            if (g_app.currentPath[0]) {
+                StringCchCopyW(g_app.filesFolder, ARRAYSIZE(g_app.filesFolder), g_app.currentPath);
+                slash = wcsrchr(g_app.filesFolder, L'\\');
+            }
+            if (slash) {
+                *slash = L'\0';
+            } else {
+                GetCurrentDirectoryW(ARRAYSIZE(g_app.filesFolder), g_app.filesFolder);
+            }
+        }
+        SendDlgItemMessageW(dlg, IDC_FILES_TEXT, EM_LIMITTEXT, ARRAYSIZE(g_app.filesText) - 1, 0);
+        SendDlgItemMessageW(dlg, IDC_FILES_FOLDER, EM_LIMITTEXT, ARRAYSIZE(g_app.filesFolder) - 1, 0);
+        SendDlgItemMessageW(dlg, IDC_FILES_TYPES, EM_LIMITTEXT, ARRAYSIZE(g_app.filesTypes) - 1, 0);
+        SetDlgItemTextW(dlg, IDC_FILES_TEXT, g_app.filesText);
+        SetDlgItemTextW(dlg, IDC_FILES_FOLDER, g_app.filesFolder);
+        SetDlgItemTextW(dlg, IDC_FILES_TYPES, g_app.filesTypes);
+        CheckDlgButton(dlg, IDC_FILES_MATCH_CASE, g_app.filesMatchCase ? BST_CHECKED : BST_UNCHECKED);
         return TRUE;
-    }
-    
-    // Handle button clicks
+
     case WM_COMMAND:
         switch (LOWORD(wParam)) {
         case IDOK: {
-            // Get line number from edit control
-            BOOL ok = FALSE;
-            UINT line = GetDlgItemInt(dlg, IDC_GOTO_EDIT, &ok, FALSE);
-            
-            // Validate input
-            if (!ok || line == 0) {
-                MessageBoxW(dlg, L"Enter a valid line number.", APP_TITLE, MB_ICONWARNING);
+            WCHAR text[ARRAYSIZE(g_app.filesText)];
+            WCHAR folder[ARRAYSIZE(g_app.filesFolder)];
+            GetDlgItemTextW(dlg, IDC_FILES_TEXT, text, ARRAYSIZE(text));
+            GetDlgItemTextW(dlg, IDC_FILES_FOLDER, folder, ARRAYSIZE(folder));
+            if (text[0] == L'\0') {
+                MessageBoxW(dlg, L"Enter the text to find.", APP_TITLE, MB_ICONINFORMATION);
+                SetFocus(GetDlgItem(dlg, IDC_FILES_TEXT));
                 return TRUE;
             }
-            
-            // Clamp to valid range (1 to maxLine)
-            int maxLine = (int)SendMessageW(g_app.hwndEdit, EM_GETLINECOUNT, 0, 0);
-            if ((int)line > maxLine) line = (UINT)maxLine;
-            
-            // Get character index for start of requested line
-            // EM_LINEINDEX: line number -> character position
-            int charIndex = (int)SendMessageW(g_app.hwndEdit, EM_LINEINDEX, line - 1, 0);
-            if (charIndex >= 0) {
-                // Move cursor to start of line
-                SendMessageW(g_app.hwndEdit, EM_SETSEL, charIndex, charIndex);
-                // Scroll to make cursor visible
-                SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+            DWORD attributes = GetFileAttributesW(folder);
+            if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                MessageBoxW(dlg, L"The folder does not exist.", APP_TITLE, MB_ICONWARNING);
+                SetFocus(GetDlgItem(dlg, IDC_FILES_FOLDER));
+                return TRUE;
             }
+            StringCchCopyW(g_app.filesText, ARRAYSIZE(g_app.filesText), text);
+            StringCchCopyW(g_app.filesFolder, ARRAYSIZE(g_app.filesFolder), folder);
+            GetDlgItemTextW(dlg, IDC_FILES_TYPES, g_app.filesTypes, ARRAYSIZE(g_app.filesTypes));
+            g_app.filesMatchCase = IsDlgButtonChecked(dlg, IDC_FILES_MATCH_CASE) == BST_CHECKED;
             EndDialog(dlg, IDOK);
             return TRUE;
         }
@@ -1183,10 +3859,12 @@ static void DoSelectFont(HWND hwnd) {
             // Apply new font
             g_app.hFont = newFont;
             ApplyFontToEdit(g_app.hwndEdit, g_app.hFont);
+            LineGutterFontChanged(&g_app.gutter);
             // Redraw to show new font
             UpdateLayout(hwnd);
+            if (g_app.wordWrap) ResetHighlight();
             
-            // Save font preference to registry
+            // Remember font preference
             SaveFontSetting(&lf);
         }
     }
@@ -1243,27 +3921,37 @@ static void HandleFindReplace(LPFINDREPLACE lpfr) {
 
     // Save flags and strings for future searches
     g_app.findFlags = lpfr->Flags;
-    if (lpfr->lpstrFindWhat && lpfr->lpstrFindWhat[0]) {
-        StringCchCopyW(g_app.findText, ARRAYSIZE(g_app.findText), lpfr->lpstrFindWhat);
-    }
-    if (lpfr->lpstrReplaceWith) {
-        StringCchCopyW(g_app.replaceText, ARRAYSIZE(g_app.replaceText), lpfr->lpstrReplaceWith);
+    if ((lpfr->lpstrFindWhat && lpfr->lpstrFindWhat[0] && !TakeFromDialog(&g_app.findText, lpfr->lpstrFindWhat)) ||
+        (lpfr->lpstrReplaceWith && !TakeFromDialog(&g_app.replaceText, lpfr->lpstrReplaceWith))) {
+        MessageBoxW(g_app.hwndMain, L"Not enough memory to search.", APP_TITLE, MB_ICONERROR);
+        return;
     }
 
     // Extract search options
     BOOL matchCase = (lpfr->Flags & FR_MATCHCASE) != 0;
+    BOOL wholeWord = (lpfr->Flags & FR_WHOLEWORD) != 0;
     BOOL down = (lpfr->Flags & FR_DOWN) != 0;
 
+    // An invalid pattern is reported once, not as "cannot find"
+    BOOL useRegex = g_app.settings.values.findRegex;
+    if (useRegex && !GetFindRegex(g_app.findText, matchCase)) return;
+    FollowFindString();
+
     // Handle "Find Next" button
     if (lpfr->Flags & FR_FINDNEXT) {
         DWORD start = 0, end = 0;
         SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
         DWORD searchStart = down ? end : start;  // Search from after selection
         DWORD outStart = 0, outEnd = 0;
-        if (FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, down, searchStart, &outStart, &outEnd)) {
+        BOOL found = FindAllUsable(g_app.findText, matchCase, wholeWord)
+            ? FindAllNext(down, start, end, &outStart, &outEnd)
+            : FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, wholeWord, down, searchStart,
+                         &outStart, &outEnd);
+        if (found) {
             // Found: Select the match
             SendMessageW(g_app.hwndEdit, EM_SETSEL, outStart, outEnd);
             SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+            UpdateStatusBar(g_app.hwndMain);
         } else {
             // Not found
             MessageBoxW(g_app.hwndMain, L"Cannot find the text.", APP_TITLE, MB_ICONINFORMATION);
@@ -1274,13 +3962,27 @@ static void HandleFindReplace(LPFINDREPLACE lpfr) {
         DWORD start = 0, end = 0;
         SendMessageW(g_app.hwndEdit, EM_GETSEL, (WPARAM)&start, (LPARAM)&end);
         DWORD outStart = 0, outEnd = 0;
+        RegexMatch match;
+        BOOL found;
         // Find the match at current position
-        if (FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, down, start, &outStart, &outEnd)) {
+        if (useRegex) {
+            found = FindRegexInEdit(g_app.hwndEdit, GetFindRegex(g_app.findText, matchCase), down, start, &match);
+            if (found) {
+                outStart = (DWORD)match.start[0];
+                outEnd = (DWORD)match.end[0];
+            }
+        } else {
+            found = FindInEdit(g_app.hwndEdit, g_app.findText, matchCase, wholeWord, down, start, &outStart, &outEnd);
+        }
+        // Regular expression replacements expand $n group references
+        WCHAR *expanded = (found && useRegex) ? ExpandRegexReplacement(g_app.hwndEdit, &match, g_app.replaceText) : NULL;
+        if (found && (!useRegex || expanded)) {
             // Select the match
             SendMessageW(g_app.hwndEdit, EM_SETSEL, outStart, outEnd);
             // Replace with new text (TRUE makes it undoable)
-            SendMessageW(g_app.hwndEdit, EM_REPLACESEL, TRUE, (LPARAM)g_app.replaceText);
+            SendMessageW(g_app.hwndEdit, EM_REPLACESEL, TRUE, (LPARAM)(expanded ? expanded : g_app.replaceText));
             SendMessageW(g_app.hwndEdit, EM_SCROLLCARET, 0, 0);
+            if (expanded) HeapFree(GetProcessHeap(), 0, expanded);
             g_app.modified = TRUE;
             UpdateTitle(g_app.hwndMain);
         } else {
@@ -1290,7 +3992,7 @@ static void HandleFindReplace(LPFINDREPLACE lpfr) {
     // Handle "Replace All" button
     else if (lpfr->Flags & FR_REPLACEALL) {
         // Replace all occurrences in entire document
-        int replaced = ReplaceAllOccurrences(g_app.hwndEdit, g_app.findText, g_app.replaceText, matchCase);
+        int replaced = ReplaceAllOccurrences(g_app.hwndEdit, g_app.findText, g_app.replaceText, matchCase, wholeWord);
         // Show result count
         WCHAR msg[64];
         StringCchPrintfW(msg, ARRAYSIZE(msg), L"Replaced %d occurrence%s.", replaced, replaced == 1 ? L"" : L"s");
@@ -1305,8 +4007,11 @@ static void HandleFindReplace(LPFINDREPLACE lpfr) {
 // based on current application state. Updates:
 // - Word Wrap checkmark
 // - Status Bar checkmark  
+// - Regular Expressions checkmark
+// - Search Results checkmark
 // - Go To enabled/disabled (based on word wrap)
 // - Save enabled/disabled (based on modified flag)
+// - Undo/Redo enabled/disabled (based on undo history)
 // ============================================================================
 static void UpdateMenuStates(HWND hwnd) {
     HMENU menu = GetMenu(hwnd);
@@ -1317,6 +4022,11 @@ static void UpdateMenuStates(HWND hwnd) {
     UINT statusState = g_app.statusVisible ? MF_CHECKED : MF_UNCHECKED;
     CheckMenuItem(menu, IDM_FORMAT_WORD_WRAP, MF_BYCOMMAND | wrapState);
     CheckMenuItem(menu, IDM_VIEW_STATUS_BAR, MF_BYCOMMAND | statusState);
+    CheckMenuItem(menu, IDM_EDIT_REGEX, MF_BYCOMMAND | (g_app.settings.values.findRegex ? MF_CHECKED : MF_UNCHECKED));
+    CheckMenuItem(menu, IDM_VIEW_RESULTS, MF_BYCOMMAND | (g_app.resultsVisible ? MF_CHECKED : MF_UNCHECKED));
+    CheckMenuItem(menu, IDM_VIEW_LINE_NUMBERS, MF_BYCOMMAND | (g_app.gutter.visible ? MF_CHECKED : MF_UNCHECKED));
+    CheckMenuItem(menu, IDM_VIEW_SEARCH_INDEX,
+                  MF_BYCOMMAND | (g_app.settings.values.searchIndex ? MF_CHECKED : MF_UNCHECKED));
 
     // "Go To" is only available when word wrap is OFF
     // (line numbers change with word wrap)
@@ -1326,6 +4036,13 @@ static void UpdateMenuStates(HWND hwnd) {
     // "Save" enabled only if document has been modified
     BOOL modified = (SendMessageW(g_app.hwndEdit, EM_GETMODIFY, 0, 0) != 0);
     EnableMenuItem(menu, IDM_FILE_SAVE, MF_BYCOMMAND | (modified ? MF_ENABLED : MF_GRAYED));
+
+    // "Undo"/"Redo" enabled only if there is history in that direction
+    EnableMenuItem(menu, IDM_EDIT_UNDO, MF_BYCOMMAND | (UndoLogCanUndo(&g_app.undo) ? MF_ENABLED : MF_GRAYED));
+    EnableMenuItem(menu, IDM_EDIT_REDO, MF_BYCOMMAND | (UndoLogCanRedo(&g_app.undo) ? MF_ENABLED : MF_GRAYED));
+
+    // "Cancel Printing" only while a job spools
+    EnableMenuItem(menu, IDM_FILE_CANCEL_PRINT, MF_BYCOMMAND | (g_app.printJob ? MF_ENABLED : MF_GRAYED));
 }
 
 // ============================================================================
@@ -1336,8 +4053,6 @@ static void UpdateMenuStates(HWND hwnd) {
 // Settings are stored in g_app.pageSetup and persist across sessions.
 // ============================================================================
 static void DoPageSetup(HWND hwnd) {
-    UNREFERENCED_PARAMETER(hwnd);
-    
     // Initialize page setup structure if first time
     if (g_app.pageSetup.lStructSize == 0) {
         ZeroMemory(&g_app.pageSetup, sizeof(PAGESETUPDLGW));
@@ -1351,18 +4066,23 @@ static void DoPageSetup(HWND hwnd) {
         g_app.pageSetup.rtMargin.bottom = 1000;
     }
     
-    // Show page setup dialog
+    // Show page setup dialog (over the print preview, when opened from it)
+    g_app.pageSetup.hwndOwner = hwnd;
     PageSetupDlgW(&g_app.pageSetup);
 }
 
 // ============================================================================
 // DoPrint - Print the Current Document
 // ============================================================================
-// Displays the Windows Print dialog and prints the document contents.
-// Handles text pagination, header/footer, and print job management.
+// Displays the Windows Print dialog and starts printing a snapshot of the
+// document in the background (see print_job.h). One job runs at a time.
 // ============================================================================
 static void DoPrint(HWND hwnd) {
-    UNREFERENCED_PARAMETER(hwnd);
+    if (g_app.printJob) {
+        MessageBoxW(hwnd, L"A document is still printing. Wait for it to finish, or use File > Cancel Printing.",
+                    APP_TITLE, MB_ICONINFORMATION);
+        return;
+    }
     
     // Get text from edit control
     WCHAR *text = NULL;
@@ -1387,14 +4107,14 @@ static void DoPrint(HWND hwnd) {
     
     // Show print dialog
     if (!PrintDlgW(&g_app.printDlg)) {
-        free(text);
+        HeapFree(GetProcessHeap(), 0, text);
         return; // User cancelled
     }
     
     HDC hdc = g_app.printDlg.hDC;
     if (!hdc) {
         MessageBoxW(hwnd, L"Unable to get printer device context.", APP_TITLE, MB_ICONERROR);
-        free(text);
+        HeapFree(GetProcessHeap(), 0, text);
         return;
     }
     
@@ -1408,89 +4128,136 @@ static void DoPrint(HWND hwnd) {
         StringCchCopyW(docName, MAX_PATH, UNTITLED_NAME);
     }
     
-    // Start print job
-    DOCINFOW di = {0};
-    di.cbSize = sizeof(DOCINFOW);
-    di.lpszDocName = docName;
-    
-    if (StartDocW(hdc, &di) <= 0) {
+    // Hand the snapshot to a worker thread; the editor stays usable while
+    // the job spools
+    PrintJobSetup setup;
+    ZeroMemory(&setup, sizeof(setup));
+    setup.hdc = hdc;
+    setup.docName = docName;
+    setup.text = text;
+    setup.length = (size_t)len;
+    GetObjectW(g_app.hFont ? g_app.hFont : (HFONT)GetStockObject(SYSTEM_FONT), sizeof(setup.font), &setup.font);
+    setup.margins = g_app.pageSetup.rtMargin;
+    setup.firstPage = 0;
+    setup.lastPage = SIZE_MAX;
+    if (g_app.printDlg.Flags & PD_PAGENUMS) {
+        // Numbered from 1 in the dialog, from 0 here
+        if (g_app.printDlg.nFromPage > 1) setup.firstPage = g_app.printDlg.nFromPage - 1;
+        if (g_app.printDlg.nToPage >= g_app.printDlg.nFromPage && g_app.printDlg.nToPage > 0) {
+            setup.lastPage = g_app.printDlg.nToPage - 1;
+        }
+    }
+    setup.language = g_app.highlight.language;
+    setup.pagination = &g_app.pagination;
+    setup.metrics = &g_app.textMetrics;
+    g_app.printJob = PrintJobStart(&setup, hwnd, WM_APP_PRINT_JOB);
+    if (!g_app.printJob) {
         MessageBoxW(hwnd, L"Unable to start print job.", APP_TITLE, MB_ICONERROR);
         DeleteDC(hdc);
-        free(text);
+        HeapFree(GetProcessHeap(), 0, text);
         return;
     }
-    
-    // Get printer capabilities
-    int pageHeight = GetDeviceCaps(hdc, VERTRES);
-    int logPixelsY = GetDeviceCaps(hdc, LOGPIXELSY);
-    
-    // Calculate margins (convert from 1/1000 inch to pixels)
-    int leftMargin = (g_app.pageSetup.rtMargin.left * logPixelsY) / 1000;
-    int topMargin = (g_app.pageSetup.rtMargin.top * logPixelsY) / 1000;
-    int bottomMargin = (g_app.pageSetup.rtMargin.bottom * logPixelsY) / 1000;
-    
-    // Calculate printable area
-    int printHeight = pageHeight - topMargin - bottomMargin;
-    
-    // Select font for printing  
-    HFONT hPrintFont = g_app.hFont ? g_app.hFont : (HFONT)GetStockObject(SYSTEM_FONT);
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hPrintFont);
-    
-    // Get font metrics
-    TEXTMETRICW tm;
-    GetTextMetricsW(hdc, &tm);
-    int lineHeight = tm.tmHeight + tm.tmExternalLeading;
-    int linesPerPage = printHeight / lineHeight;
-    
-    if (linesPerPage < 1) linesPerPage = 1;
-    
-    // Print the text page by page
-    WCHAR *line = text;
-    int lineCount = 0;
-    BOOL inPage = FALSE;
-    
-    while (*line) {
-        // Start new page if needed
-        if (!inPage) {
-            if (StartPage(hdc) <= 0) break;
-            inPage = TRUE;
-            lineCount = 0;
-        }
-        
-        // Find end of line
-        WCHAR *lineEnd = line;
-        while (*lineEnd && *lineEnd != L'\r' && *lineEnd != L'\n') lineEnd++;
-        
-        // Print this line
-        int lineLen = (int)(lineEnd - line);
-        TextOutW(hdc, leftMargin, topMargin + (lineCount * lineHeight), line, lineLen);
-        
-        lineCount++;
-        
-        // Move to next line
-        line = lineEnd;
-        if (*line == L'\r') line++;
-        if (*line == L'\n') line++;
-        
-        // End page if full
-        if (lineCount >= linesPerPage && *line) {
-            EndPage(hdc);
-            inPage = FALSE;
+    ZeroMemory(&g_app.printStatus, sizeof(g_app.printStatus));
+    UpdateStatusBar(hwnd);
+}
+
+// ============================================================================
+// DoPrintPreview - Preview the Printed Pages
+// ============================================================================
+// Shows a snapshot of the document as it will print on the printer last
+// chosen in the Print dialog (or the default printer). Page starts found
+// here are kept in g_app.pagination for the next print job. Printing from
+// the preview goes through the Print dialog as usual.
+// ============================================================================
+static HDC CreatePrinterDC(HWND hwnd) {
+    if (g_app.printDlg.hDevNames) {
+        DEVNAMES *names = (DEVNAMES *)GlobalLock(g_app.printDlg.hDevNames);
+        if (names) {
+            const WCHAR *base = (const WCHAR *)names;
+            DEVMODEW *mode = g_app.printDlg.hDevMode ? (DEVMODEW *)GlobalLock(g_app.printDlg.hDevMode) : NULL;
+            HDC hdc = CreateDCW(base + names->wDriverOffset, base + names->wDeviceOffset, NULL, mode);
+            if (mode) GlobalUnlock(g_app.printDlg.hDevMode);
+            GlobalUnlock(g_app.printDlg.hDevNames);
+            if (hdc) return hdc;
         }
     }
-    
-    // End last page if needed
-    if (inPage) {
-        EndPage(hdc);
+
+    // No printer chosen yet: the default one
+    PRINTDLGW pd;
+    ZeroMemory(&pd, sizeof(pd));
+    pd.lStructSize = sizeof(pd);
+    pd.hwndOwner = hwnd;
+    pd.Flags = PD_RETURNDEFAULT | PD_RETURNDC;
+    if (!PrintDlgW(&pd)) return NULL;
+    if (pd.hDevMode) GlobalFree(pd.hDevMode);
+    if (pd.hDevNames) GlobalFree(pd.hDevNames);
+    return pd.hDC;
+}
+
+static void DoPrintPreview(HWND hwnd) {
+    if (g_app.printJob) {
+        MessageBoxW(hwnd, L"A document is still printing. Wait for it to finish, or use File > Cancel Printing.",
+                    APP_TITLE, MB_ICONINFORMATION);
+        return;
     }
-    
-    // Finish print job
-    EndDoc(hdc);
-    
-    // Cleanup
-    SelectObject(hdc, hOldFont);
-    DeleteDC(hdc);
-    free(text);
+
+    WCHAR *text = NULL;
+    int len = 0;
+    if (!GetEditText(g_app.hwndEdit, &text, &len)) {
+        MessageBoxW(hwnd, L"Unable to get text for printing.", APP_TITLE, MB_ICONERROR);
+        return;
+    }
+    HDC printer = CreatePrinterDC(hwnd);
+    if (!printer) {
+        MessageBoxW(hwnd, L"Unable to get printer device context.", APP_TITLE, MB_ICONERROR);
+        HeapFree(GetProcessHeap(), 0, text);
+        return;
+    }
+
+    PrintPreviewSetup setup;
+    ZeroMemory(&setup, sizeof(setup));
+    setup.owner = hwnd;
+    setup.instance = g_hInst;
+    setup.printer = printer;
+    setup.text = text;
+    setup.length = (size_t)len;
+    setup.font = g_app.hFont ? g_app.hFont : (HFONT)GetStockObject(SYSTEM_FONT);
+    setup.margins = &g_app.pageSetup.rtMargin;
+    setup.pageSetup = DoPageSetup;
+    setup.language = g_app.highlight.language;
+    setup.pagination = &g_app.pagination;
+    setup.metrics = &g_app.textMetrics;
+    BOOL print = PrintPreviewRun(&setup);
+
+    DeleteDC(printer);
+    HeapFree(GetProcessHeap(), 0, text);
+    if (print) DoPrint(hwnd);
+}
+
+// Takes the job's progress (WM_APP_PRINT_JOB); a finished job is freed
+static void PrintJobProgress(HWND hwnd) {
+    if (!g_app.printJob) return;    // Posted by a job that has since been freed
+    PrintJobPoll(g_app.printJob, &g_app.printStatus);
+    if (g_app.printStatus.done) {
+        BOOL failed = g_app.printStatus.failed && !g_app.printStatus.cancelled;
+        EndPrintJob(FALSE);
+        if (failed) MessageBoxW(hwnd, L"The document could not be printed.", APP_TITLE, MB_ICONERROR);
+    }
+    UpdateStatusBar(hwnd);
+}
+
+// Stops (if 'cancel') or waits for the print job, and takes back the page
+// layout and metrics it borrowed
+static void EndPrintJob(BOOL cancel) {
+    if (!g_app.printJob) return;
+    if (cancel) PrintJobCancel(g_app.printJob);
+    size_t edited = g_app.pagination.editFrom;     // Edits made while the job ran
+    PaginationFree(&g_app.pagination);
+    TextMetricsFree(&g_app.textMetrics);
+    PrintJobFree(g_app.printJob, &g_app.pagination, &g_app.textMetrics);
+    if (edited != PAGINATION_NO_EDIT) PaginationEdit(&g_app.pagination, edited);
+    g_app.printJob = NULL;
+    ZeroMemory(&g_app.printStatus, sizeof(g_app.printStatus));
 }
 
 // ============================================================================
@@ -1506,6 +4273,9 @@ static void DoPrint(HWND hwnd) {
 static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
     UNREFERENCED_PARAMETER(lParam);
     
+    // Until a restored document arrives nothing may read or replace the text
+    if (g_app.sessionLoading && LOWORD(wParam) != IDM_FILE_EXIT) return;
+    
     // Extract command ID from wParam
     switch (LOWORD(wParam)) {
     // ------------------------------------------------------------------------
@@ -1526,9 +4296,18 @@ static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
     case IDM_FILE_PAGE_SETUP:  // Page Setup...
         DoPageSetup(hwnd);
         break;
+    case IDM_FILE_PRINT_PREVIEW:  // Print Preview...
+        DoPrintPreview(hwnd);
+        break;
     case IDM_FILE_PRINT:    // Ctrl+P
         DoPrint(hwnd);
         break;
+    case IDM_FILE_CANCEL_PRINT:
+        if (g_app.printJob) {
+            PrintJobCancel(g_app.printJob);
+            UpdateStatusBar(hwnd);
+        }
+        break;
     case IDM_FILE_EXIT:     // Alt+F4 or File->Exit
         // Post WM_CLOSE to trigger save prompt
         PostMessageW(hwnd, WM_CLOSE, 0, 0);
@@ -1538,8 +4317,10 @@ static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
     // Edit Menu Commands
     // ------------------------------------------------------------------------
     case IDM_EDIT_UNDO:     // Ctrl+Z
-        // Edit control has built-in undo
-        SendMessageW(g_app.hwndEdit, EM_UNDO, 0, 0);
+        DoUndo(hwnd, FALSE);
+        break;
+    case IDM_EDIT_REDO:     // Ctrl+Y
+        DoUndo(hwnd, TRUE);
         break;
     case IDM_EDIT_CUT:      // Ctrl+X
         SendMessageW(g_app.hwndEdit, WM_CUT, 0, 0);
@@ -1559,9 +4340,44 @@ static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
     case IDM_EDIT_FIND_NEXT:  // F3
         DoFindNext(FALSE);
         break;
+    case IDM_EDIT_FIND_PREV:  // Shift+F3
+        DoFindNext(TRUE);
+        break;
+    case IDM_EDIT_FIND_ALL:   // Alt+F3
+        DoFindAll(hwnd);
+        break;
+    case IDM_EDIT_COUNT:
+        DoCount(hwnd);
+        break;
+    case IDM_EDIT_FILTER:       // Ctrl+Shift+L
+        DoFilterLines(hwnd);
+        break;
     case IDM_EDIT_REPLACE:  // Ctrl+H
         ShowReplaceDialog(hwnd);
         break;
+    case IDM_EDIT_FIND_MULTI:   // Ctrl+Shift+F
+        DoFindMultiple(hwnd);
+        break;
+    case IDM_EDIT_FIND_IN_FILES:
+        DoFindInFiles(hwnd);
+        break;
+    case IDM_EDIT_USE_FIND:     // Ctrl+E
+        UseSelectionForFind(hwnd, FALSE);
+        break;
+    case IDM_EDIT_USE_REPLACE:  // Ctrl+Shift+E
+        UseSelectionForFind(hwnd, TRUE);
+        break;
+    case IDM_EDIT_INC_SEARCH:   // Ctrl+I
+        ShowSearchBar(hwnd);
+        break;
+    case SEARCH_BAR_ID:         // Typing, Enter, Shift+Enter or Esc in the search bar
+        switch (HIWORD(wParam)) {
+        case EN_CHANGE:        IncSearchQueryChanged(); break;
+        case SEARCH_BAR_NEXT:  IncSearchMove(TRUE); break;
+        case SEARCH_BAR_PREV:  IncSearchMove(FALSE); break;
+        case SEARCH_BAR_CLOSE: CloseSearchBar(hwnd); break;
+        }
+        break;
     case IDM_EDIT_GOTO:     // Ctrl+G
         // Only available when word wrap is OFF
         if (g_app.wordWrap) {
@@ -1571,6 +4387,14 @@ static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
             DialogBoxW(g_hInst, MAKEINTRESOURCE(IDD_GOTO), hwnd, GoToDlgProc);
         }
         break;
+    case IDM_EDIT_GOTO_MATCHING:    // Ctrl+Shift+G
+        DoGoToMatching(hwnd);
+        break;
+    case IDM_EDIT_REGEX:
+        // Toggle regular expression Find/Replace
+        g_app.settings.values.findRegex = !g_app.settings.values.findRegex;
+        SettingsChanged(hwnd);
+        break;
     case IDM_EDIT_SELECT_ALL:  // Ctrl+A
         // Select from start (0) to end (-1)
         SendMessageW(g_app.hwndEdit, EM_SETSEL, 0, -1);
@@ -1597,6 +4421,18 @@ static void HandleCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
         // Toggle status bar visibility
         ToggleStatusBar(hwnd, !g_app.statusVisible);
         break;
+    case IDM_VIEW_RESULTS:
+        ToggleResults(hwnd, !g_app.resultsVisible);
+        break;
+    case IDM_VIEW_LINE_NUMBERS:
+        ToggleLineNumbers(hwnd, !g_app.gutter.visible);
+        break;
+    case IDM_VIEW_SEARCH_INDEX:
+        // Toggle indexing of large documents; an index is built on the next search
+        g_app.settings.values.searchIndex = !g_app.settings.values.searchIndex;
+        if (!g_app.settings.values.searchIndex) ResetSearchIndex();
+        SettingsChanged(hwnd);
+        break;
 
     // ------------------------------------------------------------------------
     // Help Menu Commands
@@ -1695,8 +4531,8 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
     // Sent once when window is first created. Initialize all child controls.
     // ------------------------------------------------------------------------
     case WM_CREATE: {
-        // Initialize common controls library (needed for status bar)
-        INITCOMMONCONTROLSEX icc = { sizeof(icc), ICC_BAR_CLASSES };
+        // Initialize common controls library (status bar, results list)
+        INITCOMMONCONTROLSEX icc = { sizeof(icc), ICC_BAR_CLASSES | ICC_LISTVIEW_CLASSES };
         InitCommonControlsEx(&icc);
         
         // Load and apply saved font setting
@@ -1705,16 +4541,24 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
         // Create the main edit control
         CreateEditControl(hwnd);
         
-        // Load and apply saved status bar setting
-        BOOL savedStatusBar = LoadStatusBarSetting();
+        // Apply saved status bar and word wrap settings (as they were when
+        // the session snapshot was taken, if there is one)
+        BOOL savedStatusBar = g_app.sessionValid ? g_app.session.statusVisible : g_app.settings.values.statusBar;
         ToggleStatusBar(hwnd, savedStatusBar);
-        
-        // Load and apply saved word wrap setting
-        BOOL savedWordWrap = LoadWordWrapSetting();
+        if (g_app.settings.values.lineNumbers) {
+            ToggleLineNumbers(hwnd, TRUE);
+        }
+        BOOL savedWordWrap = g_app.sessionValid ? g_app.session.wordWrap : g_app.settings.values.wordWrap;
         if (savedWordWrap) {
             SetWordWrap(hwnd, TRUE);
         }
         
+        // Bring back the previous session's document in the background, or
+        // start the crash journal for a fresh one (may restore untitled work)
+        if (!g_app.sessionValid || !BeginSessionRestore(hwnd)) {
+            StartJournal(hwnd);
+        }
+        
         // Set initial title and status
         UpdateTitle(hwnd);
         UpdateStatusBar(hwnd);
@@ -1738,9 +4582,23 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
     // ------------------------------------------------------------------------
     case WM_SIZE:
         UpdateLayout(hwnd);
+        if (g_app.wordWrap) ResetHighlight();   // The text rewraps
         UpdateStatusBar(hwnd);
         return 0;
     
+    // ------------------------------------------------------------------------
+    // WM_NOTIFY: Common Control Notifications
+    // The search results list asks for row text and reports activation
+    // ------------------------------------------------------------------------
+    case WM_NOTIFY: {
+        const NMHDR *header = (const NMHDR *)lParam;
+        if (ResultsPaneNotify(&g_app.results, g_app.hwndEdit, header)) {
+            if (header->code == LVN_ITEMACTIVATE) UpdateStatusBar(hwnd);
+            return 0;
+        }
+        break;
+    }
+    
     // ------------------------------------------------------------------------
     // WM_DROPFILES: File Drag-and-Drop
     // User dragged a file onto the window. Load the first file dropped.
@@ -1748,8 +4606,8 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
     case WM_DROPFILES: {
         HDROP hDrop = (HDROP)wParam;  // Drop handle
         WCHAR path[MAX_PATH_BUFFER];
-        // Get first dropped file path (index 0)
-        if (DragQueryFileW(hDrop, 0, path, ARRAYSIZE(path))) {
+        // Get first dropped file path (index 0), unless a restore is in flight
+        if (!g_app.sessionLoading && DragQueryFileW(hDrop, 0, path, ARRAYSIZE(path))) {
             // Prompt to save current file, then load dropped file
             if (PromptSaveChanges(hwnd)) {
                 LoadDocumentFromPath(hwnd, path);
@@ -1769,10 +4627,14 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
     case WM_COMMAND:
         // Handle notifications from edit control
         if (HIWORD(wParam) == EN_CHANGE && (HWND)lParam == g_app.hwndEdit) {
-            // Text changed - update modified flag
+            // Text changed - update modified flag and tell the undo capture
+            g_app.editChanged = TRUE;
+            if (g_app.captureDepth == 0 && !g_app.undoReplaying) NoteUncapturedEdit();
+            g_app.editLength = (size_t)GetWindowTextLengthW(g_app.hwndEdit);
             g_app.modified = (SendMessageW(g_app.hwndEdit, EM_GETMODIFY, 0, 0) != 0);
             UpdateTitle(hwnd);
             UpdateStatusBar(hwnd);
+            if (LineGutterTextChanged(&g_app.gutter)) UpdateLayout(hwnd);
             return 0;
         } else if (HIWORD(wParam) == EN_UPDATE && (HWND)lParam == g_app.hwndEdit) {
             // Edit control about to be redrawn - update status bar
@@ -1792,22 +4654,152 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
         UpdateMenuStates(hwnd);
         return 0;
     
+    // ------------------------------------------------------------------------
+    // WM_APP_SESSION_LOADED: Restored Document Ready
+    // The session loader thread finished reading the previous document
+    // ------------------------------------------------------------------------
+    case WM_APP_SESSION_LOADED:
+        FinishSessionRestore(hwnd, (SessionRestore *)lParam);
+        return 0;
+    
+    // ------------------------------------------------------------------------
+    // WM_APP_FIND_IN_FILES: Find in Files Progress
+    // The search threads found more matches, or finished
+    // ------------------------------------------------------------------------
+    case WM_APP_FIND_IN_FILES:
+        FindInFilesProgress(hwnd);
+        return 0;
+
+    // ------------------------------------------------------------------------
+    // WM_APP_MATCH_COUNT: Match Count Progress
+    // The count worker searched another slice, or finished
+    // ------------------------------------------------------------------------
+    case WM_APP_MATCH_COUNT:
+        MatchCountProgress();
+        return 0;
+
+    // ------------------------------------------------------------------------
+    // WM_APP_PRINT_JOB: Print Job Progress
+    // The print worker sent another page to the spooler, or finished
+    // ------------------------------------------------------------------------
+    case WM_APP_PRINT_JOB:
+        PrintJobProgress(hwnd);
+        return 0;
+    
     // ------------------------------------------------------------------------
     // WM_CLOSE: User Requested Window Close
-    // Prompt to save unsaved changes before allowing window to close
+    // With hot exit the session (unsaved changes included) is kept for the
+    // next start. Otherwise prompt to save unsaved changes before closing
     // ------------------------------------------------------------------------
     case WM_CLOSE:
-        if (PromptSaveChanges(hwnd)) {
+        if (g_app.printJob &&
+            MessageBoxW(hwnd, L"A document is still printing. Cancel printing and exit?", APP_TITLE,
+                        MB_YESNO | MB_ICONQUESTION) != IDYES) {
+            return 0;
+        }
+        if (g_app.sessionLoading) {
+            DestroyWindow(hwnd);  // Nothing restored yet; the old snapshot stays valid
+        } else if (g_app.settings.values.hotExit && SaveSession(hwnd, TRUE)) {
+            DestroyWindow(hwnd);  // Everything comes back next time
+        } else if (PromptSaveChanges(hwnd)) {
+            SaveSession(hwnd, g_app.settings.values.hotExit && !g_app.modified);
             DestroyWindow(hwnd);  // Okay to close
         }
         // Otherwise user cancelled - stay open
         return 0;
     
+    // ------------------------------------------------------------------------
+    // WM_ENDSESSION: Windows Is Logging Off or Shutting Down
+    // No WM_CLOSE arrives, so take the hot exit snapshot and write settings here
+    // ------------------------------------------------------------------------
+    case WM_ENDSESSION:
+        if (wParam) {
+            if (g_app.settings.values.hotExit && !g_app.sessionLoading) {
+                SaveSession(hwnd, TRUE);
+            }
+            SettingsStoreFlush(&g_app.settings);
+        }
+        return 0;
+    
+    // ------------------------------------------------------------------------
+    // WM_TIMER: Deferred Work
+    // Settings changes have settled; write them out, edits have paused
+    // and a stale Find All index or line filter can be rebuilt, or the
+    // incremental search scans (or the search index builds) its next
+    // slice, or the match count starts over, or highlighting lexes on
+    // ------------------------------------------------------------------------
+    case WM_TIMER:
+        if (wParam == SETTINGS_FLUSH_TIMER_ID) {
+            SettingsStoreFlush(&g_app.settings);
+            return 0;
+        }
+        if (wParam == FIND_ALL_TIMER_ID) {
+            if (g_app.findAllActive && g_app.findAll.stale) RebuildFindAll();
+            KillTimer(hwnd, FIND_ALL_TIMER_ID);
+            return 0;
+        }
+        if (wParam == FILTER_TIMER_ID) {
+            if (g_app.filterActive && g_app.lineFilter.stale) RebuildFilter();
+            KillTimer(hwnd, FILTER_TIMER_ID);
+            return 0;
+        }
+        if (wParam == INC_SEARCH_TIMER_ID) {
+            ContinueIncSearch();
+            return 0;
+        }
+        if (wParam == SEARCH_INDEX_TIMER_ID) {
+            ContinueSearchIndex();
+            return 0;
+        }
+        if (wParam == COUNT_TIMER_ID) {
+            KillTimer(hwnd, COUNT_TIMER_ID);
+            if (g_app.countActive) StartCount();
+            return 0;
+        }
+        if (wParam == HIGHLIGHT_TIMER_ID) {
+            ContinueHighlight();
+            return 0;
+        }
+        break;
+    
     // ------------------------------------------------------------------------
     // WM_DESTROY: Window Being Destroyed
-    // Post quit message to exit application message loop
+    // Write pending settings. Changes were saved, deliberately discarded or
+    // kept by hot exit, so the live crash journal goes. Post quit message
+    // to exit application message loop
     // ------------------------------------------------------------------------
     case WM_DESTROY:
+        SettingsStoreFlush(&g_app.settings);
+        FreeBackBuffer();
+        EndPrintJob(TRUE);
+        JournalStop(&g_app.journal, FALSE);
+        RegexFree(g_app.findRegex);
+        g_app.findRegex = NULL;
+        EndFindAll();
+        EndFilter();
+        EndCount();
+        if (g_app.countText) HeapFree(GetProcessHeap(), 0, g_app.countText);
+        g_app.countText = NULL;
+        if (g_app.findText) HeapFree(GetProcessHeap(), 0, g_app.findText);
+        if (g_app.replaceText) HeapFree(GetProcessHeap(), 0, g_app.replaceText);
+        if (g_app.findRegexSource) HeapFree(GetProcessHeap(), 0, g_app.findRegexSource);
+        if (g_app.findAllText) HeapFree(GetProcessHeap(), 0, g_app.findAllText);
+        if (g_app.filterText) HeapFree(GetProcessHeap(), 0, g_app.filterText);
+        g_app.findText = g_app.replaceText = g_app.findRegexSource = g_app.findAllText = NULL;
+        g_app.filterText = NULL;
+        EndFindInFiles();
+        IncSearchFree(&g_app.incSearch);
+        TrigramIndexFree(&g_app.searchIndex);
+        HighlightCacheFree(&g_app.highlight);
+        TextMetricsFree(&g_app.textMetrics);
+        PaginationFree(&g_app.pagination);
+        ResultsPaneFree(&g_app.results);
+        if (g_app.multiTerms) HeapFree(GetProcessHeap(), 0, g_app.multiTerms);
+        if (g_app.lowerFold) HeapFree(GetProcessHeap(), 0, g_app.lowerFold);
+        if (g_app.wordChars) HeapFree(GetProcessHeap(), 0, g_app.wordChars);
+        g_app.multiTerms = NULL;
+        g_app.lowerFold = NULL;
+        g_app.wordChars = NULL;
         PostQuitMessage(0);
         return 0;
     }
@@ -1835,7 +4827,7 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow) {
     // Suppress unused parameter warnings
     (void)hPrevInstance;  // Always NULL in Win32
-    (void)lpCmdLine;      // Not using command line args in this app
+    (void)lpCmdLine;      // Parsed from GetCommandLineW for proper quoting
 
     // Initialize global state
     g_hInst = hInstance;
@@ -1847,12 +4839,39 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     g_app.statusVisible = TRUE;          // Status bar visible by default
     g_app.statusBeforeWrap = TRUE;       // Remember status bar preference
     g_app.encoding = ENC_UTF8;           // Default to UTF-8 for new files
+    LineIndexInit(&g_app.lineIndex, 0);  // Empty document has one line
     g_app.findFlags = FR_DOWN;           // Search down by default
+    if (!SetSearchString(&g_app.findText, L"", 0) || !SetSearchString(&g_app.replaceText, L"", 0)) {
+        MessageBoxW(NULL, L"Not enough memory to start.", APP_TITLE, MB_ICONERROR);
+        return 0;
+    }
+    IncSearchInit(&g_app.incSearch);     // No incremental search yet
+    TrigramIndexInit(&g_app.searchIndex); // Nor a search index
+    TextMetricsInit(&g_app.textMetrics); // No fonts measured yet
+    PaginationInit(&g_app.pagination);   // Nor pages laid out
+    g_app.incMatch = TEXT_NOT_FOUND;
+    
+    // Read all saved settings in one pass
+    SettingsStoreLoad(&g_app.settings);
+    UndoLogInit(&g_app.undo, (size_t)g_app.settings.values.undoLimitMB * 1024 * 1024);  // Empty undo history
+    
+    // Read the previous session's snapshot (layout, find state, document)
+    g_app.sessionValid = SessionLoad(&g_app.session);
+    
+    // A file named on the command line ("retropad file.txt")
+    int argc = 0;
+    LPWSTR *argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (argv) {
+        if (argc > 1 && !GetFullPathNameW(argv[1], ARRAYSIZE(g_app.pendingOpen), g_app.pendingOpen, NULL)) {
+            g_app.pendingOpen[0] = L'\0';
+        }
+        LocalFree(argv);
+    }
 
     // Define and register window class
     WNDCLASSEXW wc = {0};
     wc.cbSize = sizeof(wc);
-    wc.style = CS_HREDRAW | CS_VREDRAW;  // Redraw on resize
+    wc.style = 0;                        // Children repaint themselves on resize; no full redraw
     wc.lpfnWndProc = MainWndProc;        // Window procedure
     wc.hInstance = hInstance;
     wc.hIcon = LoadIconW(hInstance, MAKEINTRESOURCE(IDI_RETROPAD));  // App icon
@@ -1869,8 +4888,9 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
 
     // Create main application window
     // WS_OVERLAPPEDWINDOW = standard window with title bar, borders, and system menu
+    // WS_CLIPCHILDREN = never paint the background under the child windows
     // CW_USEDEFAULT = let Windows choose initial position
-    HWND hwnd = CreateWindowExW(0, wc.lpszClassName, APP_TITLE, WS_OVERLAPPEDWINDOW,
+    HWND hwnd = CreateWindowExW(0, wc.lpszClassName, APP_TITLE, WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN,
                                 CW_USEDEFAULT, CW_USEDEFAULT, DEFAULT_WIDTH, DEFAULT_HEIGHT,
                                 NULL, NULL, hInstance, NULL);
     if (!hwnd) {
@@ -1881,10 +4901,30 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     // Save window handle in global state
     g_app.hwndMain = hwnd;
     
-    // Show window with specified show state (normal, maximized, minimized)
-    ShowWindow(hwnd, nCmdShow);
+    // Show window with specified show state (normal, maximized, minimized),
+    // at the size and position it had last time if a session was restored
+    const RECT *last = &g_app.session.windowRect;
+    if (g_app.sessionValid && last->right > last->left && last->bottom > last->top) {
+        WINDOWPLACEMENT placement = { sizeof(placement) };
+        placement.rcNormalPosition = *last;
+        placement.showCmd = nCmdShow;
+        if (g_app.session.maximized && (nCmdShow == SW_SHOWNORMAL || nCmdShow == SW_SHOWDEFAULT)) {
+            placement.showCmd = SW_SHOWMAXIMIZED;
+        }
+        SetWindowPlacement(hwnd, &placement);
+    } else {
+        ShowWindow(hwnd, nCmdShow);
+    }
+    SessionFree(&g_app.session);
     // Force immediate paint
     UpdateWindow(hwnd);
+    
+    // Open a file named on the command line. While a session is being
+    // restored, FinishSessionRestore opens it once the restore has landed
+    if (g_app.pendingOpen[0] && !g_app.sessionLoading) {
+        LoadDocumentFromPath(hwnd, g_app.pendingOpen);
+        g_app.pendingOpen[0] = L'\0';
+    }
 
     // Load keyboard accelerators (Ctrl+S, Ctrl+O, F3, etc.)
     HACCEL accel = LoadAcceleratorsW(hInstance, MAKEINTRESOURCE(IDC_RETROPAD));
@@ -1895,7 +4935,9 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     while (GetMessageW(&msg, NULL, 0, 0)) {
         // Check for accelerator key (e.g., Ctrl+S)
         // If not accelerator, translate and dispatch normally
-        if (!accel || !TranslateAcceleratorW(hwnd, accel, &msg)) {
+        // Editing keys typed into the search bar stay there
+        if (!accel || SearchBarWantsKey(&g_app.searchBar, &msg) ||
+            ResultsPaneWantsKey(&g_app.results, &msg) || !TranslateAcceleratorW(hwnd, accel, &msg)) {
             TranslateMessage(&msg);  // Translate virtual-key messages to character messages
             DispatchMessageW(&msg);  // Dispatch message to window procedure
         }
@@ -0,0 +1,130 @@
+// ============================================================================
+// search_bar.c - Incremental Search Bar Implementation
+// ============================================================================
+// The three controls are children of the main window, so no extra window
+// class is needed; the query box is subclassed to turn Enter, Shift+Enter
+// and Escape into notifications (and to keep them from beeping).
+// ============================================================================
+
+#include "search_bar.h"
+
+#define LABEL_WIDTH    40
+#define QUERY_WIDTH    240
+#define STATUS_WIDTH   260
+#define BAR_PADDING    4
+
+// ============================================================================
+// QuerySubclassProc - Keys of the Query Box
+// ============================================================================
+static LRESULT CALLBACK QuerySubclassProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    SearchBar *bar = (SearchBar *)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+    HWND parent = GetParent(hwnd);
+
+    switch (msg) {
+    case WM_GETDLGCODE:
+        return DLGC_WANTALLKEYS | CallWindowProcW(bar->queryProc, hwnd, msg, wParam, lParam);
+    case WM_KEYDOWN:
+        if (wParam == VK_RETURN) {
+            WORD code = (GetKeyState(VK_SHIFT) < 0) ? SEARCH_BAR_PREV : SEARCH_BAR_NEXT;
+            SendMessageW(parent, WM_COMMAND, MAKEWPARAM(SEARCH_BAR_ID, code), (LPARAM)hwnd);
+            return 0;
+        }
+        if (wParam == VK_ESCAPE) {
+            SendMessageW(parent, WM_COMMAND, MAKEWPARAM(SEARCH_BAR_ID, SEARCH_BAR_CLOSE), (LPARAM)hwnd);
+            return 0;
+        }
+        break;
+    case WM_CHAR:
+        if (wParam == L'\r' || wParam == 0x1B) return 0;   // Handled on key down
+        break;
+    }
+    return CallWindowProcW(bar->queryProc, hwnd, msg, wParam, lParam);
+}
+
+// ============================================================================
+// SearchBarCreate
+// ============================================================================
+BOOL SearchBarCreate(SearchBar *bar, HWND parent, HINSTANCE instance) {
+    ZeroMemory(bar, sizeof(*bar));
+    bar->label = CreateWindowExW(0, L"STATIC", L"Find:", WS_CHILD | SS_CENTERIMAGE,
+                                 0, 0, 0, 0, parent, NULL, instance, NULL);
+    bar->query = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"", WS_CHILD | WS_TABSTOP | ES_AUTOHSCROLL,
+                                 0, 0, 0, 0, parent, (HMENU)(INT_PTR)SEARCH_BAR_ID, instance, NULL);
+    bar->status = CreateWindowExW(0, L"STATIC", L"", WS_CHILD | SS_CENTERIMAGE | SS_ENDELLIPSIS,
+                                  0, 0, 0, 0, parent, NULL, instance, NULL);
+    if (!bar->label || !bar->query || !bar->status) {
+        if (bar->label) DestroyWindow(bar->label);
+        if (bar->query) DestroyWindow(bar->query);
+        if (bar->status) DestroyWindow(bar->status);
+        ZeroMemory(bar, sizeof(*bar));
+        return FALSE;
+    }
+
+    HFONT font = (HFONT)GetStockObject(DEFAULT_GUI_FONT);
+    SendMessageW(bar->label, WM_SETFONT, (WPARAM)font, FALSE);
+    SendMessageW(bar->query, WM_SETFONT, (WPARAM)font, FALSE);
+    SendMessageW(bar->status, WM_SETFONT, (WPARAM)font, FALSE);
+    SendMessageW(bar->query, EM_SETLIMITTEXT, SEARCH_BAR_MAX_QUERY, 0);
+
+    // One line of text plus the query box's border and some air
+    TEXTMETRICW tm;
+    HDC dc = GetDC(bar->query);
+    HFONT oldFont = (HFONT)SelectObject(dc, font);
+    GetTextMetricsW(dc, &tm);
+    SelectObject(dc, oldFont);
+    ReleaseDC(bar->query, dc);
+    bar->height = tm.tmHeight + 2 * GetSystemMetrics(SM_CYEDGE) + 2 * BAR_PADDING + 2;
+
+    SetWindowLongPtrW(bar->query, GWLP_USERDATA, (LONG_PTR)bar);
+    bar->queryProc = (WNDPROC)SetWindowLongPtrW(bar->query, GWLP_WNDPROC, (LONG_PTR)QuerySubclassProc);
+    return TRUE;
+}
+
+// ============================================================================
+// SearchBarShow / SearchBarSetStatus
+// ============================================================================
+void SearchBarShow(SearchBar *bar, BOOL visible) {
+    if (!bar->query) return;
+    bar->visible = visible;
+    int show = visible ? SW_SHOW : SW_HIDE;
+    ShowWindow(bar->label, show);
+    ShowWindow(bar->query, show);
+    ShowWindow(bar->status, show);
+}
+
+void SearchBarSetStatus(SearchBar *bar, const WCHAR *text) {
+    if (bar->status) SetWindowTextW(bar->status, text);
+}
+
+// ============================================================================
+// SearchBarLayout
+// ============================================================================
+int SearchBarLayout(SearchBar *bar, int bottom, int width) {
+    if (!bar->visible || !bar->query) return 0;
+    int top = bottom - bar->height;
+    int inner = bar->height - 2 * BAR_PADDING;
+    int x = BAR_PADDING;
+    MoveWindow(bar->label, x, top + BAR_PADDING, LABEL_WIDTH, inner, TRUE);
+    x += LABEL_WIDTH;
+    MoveWindow(bar->query, x, top + BAR_PADDING, QUERY_WIDTH, inner, TRUE);
+    x += QUERY_WIDTH + 2 * BAR_PADDING;
+    int statusWidth = width - x - BAR_PADDING;
+    if (statusWidth > STATUS_WIDTH) statusWidth = STATUS_WIDTH;
+    if (statusWidth < 0) statusWidth = 0;
+    MoveWindow(bar->status, x, top + BAR_PADDING, statusWidth, inner, TRUE);
+    return bar->height;
+}
+
+// ============================================================================
+// SearchBarWantsKey
+// ============================================================================
+BOOL SearchBarWantsKey(const SearchBar *bar, const MSG *msg) {
+    if (!bar->visible || msg->hwnd != bar->query || msg->message != WM_KEYDOWN) return FALSE;
+    if (msg->wParam == VK_DELETE) return TRUE;
+    if (GetKeyState(VK_CONTROL) >= 0 || GetKeyState(VK_SHIFT) < 0 || GetKeyState(VK_MENU) < 0) return FALSE;
+    switch (msg->wParam) {
+    case 'A': case 'C': case 'V': case 'X': case 'Z':
+        return TRUE;
+    }
+    return FALSE;
+}
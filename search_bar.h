@@ -0,0 +1,46 @@
+// ============================================================================
+// search_bar.h - Incremental Search Bar Header
+// ============================================================================
+// A one-line strip above the status bar: "Find:" label, query box and a
+// match count. The query box reports to the parent window through
+// WM_COMMAND with SEARCH_BAR_ID: EN_CHANGE as the user types, and the
+// SEARCH_BAR_* codes below for Enter, Shift+Enter and Escape. The parent
+// does the searching; the bar only collects the query and shows the result.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+
+#define SEARCH_BAR_ID          4        // Child window ID of the query box
+
+// WM_COMMAND notification codes (HIWORD(wParam)) sent by the query box
+#define SEARCH_BAR_NEXT        0x0A01   // Enter: go to the next match
+#define SEARCH_BAR_PREV        0x0A02   // Shift+Enter: go to the previous match
+#define SEARCH_BAR_CLOSE       0x0A03   // Escape: close the bar
+
+#define SEARCH_BAR_MAX_QUERY   127      // Characters the query box accepts
+
+typedef struct SearchBar {
+    HWND label;                 // "Find:"
+    HWND query;                 // Query box (single-line edit)
+    HWND status;                // "3 of 12,408"
+    WNDPROC queryProc;          // Original edit control window procedure
+    int height;                 // Height of the strip in pixels
+    BOOL visible;
+} SearchBar;
+
+// Creates the (hidden) bar's windows. Returns FALSE on failure.
+BOOL SearchBarCreate(SearchBar *bar, HWND parent, HINSTANCE instance);
+
+void SearchBarShow(SearchBar *bar, BOOL visible);
+
+// Places the bar across the parent with its bottom edge at 'bottom'.
+// Returns the height it takes (0 while hidden).
+int SearchBarLayout(SearchBar *bar, int bottom, int width);
+
+void SearchBarSetStatus(SearchBar *bar, const WCHAR *text);
+
+// TRUE if the message is an editing key (Delete, Ctrl+A/C/V/X/Z) for the
+// query box, which must reach it instead of becoming a menu accelerator.
+BOOL SearchBarWantsKey(const SearchBar *bar, const MSG *msg);
@@ -0,0 +1,223 @@
+// ============================================================================
+// session.c - Hot Exit Session Snapshot Implementation
+// ============================================================================
+// The snapshot is a small versioned binary file:
+//   SessionHeader   - fixed header (magic, version, flags, layout, caret...)
+//   WCHAR strings[] - document path, journal path, find and replace text
+//   BYTE index[]    - line index serialized by LineIndexEncode
+// It is written to a temporary file and moved over the previous snapshot, so
+// a crash while saving leaves the old snapshot intact rather than a torn one.
+// ============================================================================
+
+#include "session.h"
+#include <strsafe.h>   // For safe string operations
+
+#define SESSION_MAGIC      0x53535052u   // "RPSS" in little endian
+#define SESSION_VERSION    1
+#define SESSION_MAX_BYTES  (16 * 1024 * 1024)
+
+// Header flags
+#define SESSION_FLAG_MAXIMIZED  0x0001
+#define SESSION_FLAG_WORD_WRAP  0x0002
+#define SESSION_FLAG_STATUS_BAR 0x0004
+
+// ============================================================================
+// On-Disk Structures
+// ============================================================================
+typedef struct SessionHeader {
+    DWORD magic;                  // SESSION_MAGIC
+    WORD version;                 // SESSION_VERSION
+    WORD flags;                   // SESSION_FLAG_*
+    LONG windowRect[4];           // left, top, right, bottom
+    DWORD encoding;               // TextEncoding value
+    DWORD findFlags;
+    DWORD selStart, selEnd;
+    DWORD firstLine;
+    WORD documentPathLength;      // String lengths in WCHARs
+    WORD journalPathLength;
+    WORD findLength;
+    WORD replaceLength;
+    ULONGLONG documentSize;       // Document identity (0 if untitled)
+    ULONGLONG documentWriteTime;
+    DWORD indexBytes;             // Size of the serialized line index
+    DWORD reserved;
+} SessionHeader;
+
+// ============================================================================
+// GetDocumentIdentity - Size and Last Write Time of a Document
+// ============================================================================
+static BOOL GetDocumentIdentity(LPCWSTR path, ULONGLONG *sizeOut, ULONGLONG *writeTimeOut) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    *sizeOut = 0;
+    *writeTimeOut = 0;
+    if (!path[0] || !GetFileAttributesExW(path, GetFileExInfoStandard, &data)) return FALSE;
+    *sizeOut = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *writeTimeOut = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return TRUE;
+}
+
+// ============================================================================
+// Field Helpers
+// ============================================================================
+// Append a string without its terminator, and read one back (terminated)
+static BYTE *PutString(BYTE *out, const WCHAR *text, size_t length) {
+    CopyMemory(out, text, length * sizeof(WCHAR));
+    return out + length * sizeof(WCHAR);
+}
+
+static const BYTE *GetString(const BYTE *in, size_t length, WCHAR *out, size_t outLen) {
+    size_t copy = length < outLen ? length : outLen - 1;
+    CopyMemory(out, in, copy * sizeof(WCHAR));
+    out[copy] = L'\0';
+    return in + length * sizeof(WCHAR);
+}
+
+// ============================================================================
+// SessionSave - Write the Snapshot
+// ============================================================================
+BOOL SessionSave(const SessionState *state) {
+    WCHAR path[MAX_PATH], tempPath[MAX_PATH];
+    if (!GetAppDataPath(SESSION_FILE_NAME, path, ARRAYSIZE(path))) return FALSE;
+    if (FAILED(StringCchPrintfW(tempPath, ARRAYSIZE(tempPath), L"%s.tmp", path))) return FALSE;
+
+    // Size everything first so the snapshot can be written with one WriteFile
+    size_t documentLength = wcslen(state->documentPath);
+    size_t journalLength = wcslen(state->journalPath);
+    size_t findLength = wcslen(state->findText);
+    size_t replaceLength = wcslen(state->replaceText);
+    size_t indexBytes = LineIndexEncode(&state->lineIndex, NULL, 0);
+    size_t stringBytes = (documentLength + journalLength + findLength + replaceLength) * sizeof(WCHAR);
+    size_t total = sizeof(SessionHeader) + stringBytes + indexBytes;
+    if (total > SESSION_MAX_BYTES) {
+        // An absurdly large index is not worth keeping; the document still is
+        indexBytes = 0;
+        total = sizeof(SessionHeader) + stringBytes;
+    }
+
+    BYTE *data = (BYTE *)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, total);
+    if (!data) return FALSE;
+    SessionHeader *header = (SessionHeader *)data;
+    header->magic = SESSION_MAGIC;
+    header->version = SESSION_VERSION;
+    header->flags = (WORD)((state->maximized ? SESSION_FLAG_MAXIMIZED : 0) |
+                           (state->wordWrap ? SESSION_FLAG_WORD_WRAP : 0) |
+                           (state->statusVisible ? SESSION_FLAG_STATUS_BAR : 0));
+    header->windowRect[0] = state->windowRect.left;
+    header->windowRect[1] = state->windowRect.top;
+    header->windowRect[2] = state->windowRect.right;
+    header->windowRect[3] = state->windowRect.bottom;
+    header->encoding = (DWORD)state->encoding;
+    header->findFlags = state->findFlags;
+    header->selStart = state->selStart;
+    header->selEnd = state->selEnd;
+    header->firstLine = state->firstLine;
+    header->documentPathLength = (WORD)documentLength;
+    header->journalPathLength = (WORD)journalLength;
+    header->findLength = (WORD)findLength;
+    header->replaceLength = (WORD)replaceLength;
+    GetDocumentIdentity(state->documentPath, &header->documentSize, &header->documentWriteTime);
+    header->indexBytes = (DWORD)indexBytes;
+
+    BYTE *out = data + sizeof(SessionHeader);
+    out = PutString(out, state->documentPath, documentLength);
+    out = PutString(out, state->journalPath, journalLength);
+    out = PutString(out, state->findText, findLength);
+    out = PutString(out, state->replaceText, replaceLength);
+    if (indexBytes) LineIndexEncode(&state->lineIndex, out, indexBytes);
+
+    BOOL ok = FALSE;
+    HANDLE file = CreateFileW(tempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD written = 0;
+        ok = WriteFile(file, data, (DWORD)total, &written, NULL) && written == (DWORD)total &&
+             FlushFileBuffers(file);
+        CloseHandle(file);
+        ok = ok && MoveFileExW(tempPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+        if (!ok) DeleteFileW(tempPath);
+    }
+    HeapFree(GetProcessHeap(), 0, data);
+    return ok;
+}
+
+// ============================================================================
+// SessionLoad - Read the Snapshot
+// ============================================================================
+BOOL SessionLoad(SessionState *state) {
+    ZeroMemory(state, sizeof(*state));
+    LineIndexInit(&state->lineIndex, 0);
+
+    WCHAR path[MAX_PATH];
+    if (!GetAppDataPath(SESSION_FILE_NAME, path, ARRAYSIZE(path))) return FALSE;
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    BOOL loaded = FALSE;
+    BYTE *data = NULL;
+    LARGE_INTEGER size = {0};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(SessionHeader) ||
+        size.QuadPart > SESSION_MAX_BYTES) {
+        goto done;
+    }
+    data = (BYTE *)HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size.QuadPart);
+    DWORD read = 0;
+    if (!data || !ReadFile(file, data, (DWORD)size.QuadPart, &read, NULL) || read != (DWORD)size.QuadPart) {
+        goto done;
+    }
+
+    // Validate header and layout of the variable part
+    const SessionHeader *header = (const SessionHeader *)data;
+    size_t stringBytes = ((size_t)header->documentPathLength + header->journalPathLength +
+                          header->findLength + header->replaceLength) * sizeof(WCHAR);
+    if (header->magic != SESSION_MAGIC || header->version != SESSION_VERSION ||
+        sizeof(SessionHeader) + stringBytes + header->indexBytes != read ||
+        header->encoding < ENC_UTF8 || header->encoding > ENC_ANSI ||
+        header->documentPathLength >= SESSION_MAX_PATH || header->journalPathLength >= MAX_PATH) {
+        goto done;
+    }
+
+    state->windowRect.left = header->windowRect[0];
+    state->windowRect.top = header->windowRect[1];
+    state->windowRect.right = header->windowRect[2];
+    state->windowRect.bottom = header->windowRect[3];
+    state->maximized = (header->flags & SESSION_FLAG_MAXIMIZED) != 0;
+    state->wordWrap = (header->flags & SESSION_FLAG_WORD_WRAP) != 0;
+    state->statusVisible = (header->flags & SESSION_FLAG_STATUS_BAR) != 0;
+    state->encoding = (TextEncoding)header->encoding;
+    state->findFlags = header->findFlags;
+    state->selStart = header->selStart;
+    state->selEnd = header->selEnd;
+    state->firstLine = header->firstLine;
+    state->documentSize = header->documentSize;
+    state->documentWriteTime = header->documentWriteTime;
+
+    const BYTE *in = data + sizeof(SessionHeader);
+    in = GetString(in, header->documentPathLength, state->documentPath, ARRAYSIZE(state->documentPath));
+    in = GetString(in, header->journalPathLength, state->journalPath, ARRAYSIZE(state->journalPath));
+    in = GetString(in, header->findLength, state->findText, ARRAYSIZE(state->findText));
+    in = GetString(in, header->replaceLength, state->replaceText, ARRAYSIZE(state->replaceText));
+
+    // A damaged index is not fatal; the document is simply indexed again
+    if (header->indexBytes && !LineIndexDecode(&state->lineIndex, in, header->indexBytes, NULL)) {
+        LineIndexFree(&state->lineIndex);
+    }
+    loaded = TRUE;
+
+done:
+    if (data) HeapFree(GetProcessHeap(), 0, data);
+    CloseHandle(file);
+    return loaded;
+}
+
+// ============================================================================
+// SessionFree / SessionDocumentUnchanged
+// ============================================================================
+void SessionFree(SessionState *state) {
+    LineIndexFree(&state->lineIndex);
+}
+
+BOOL SessionDocumentUnchanged(const SessionState *state) {
+    ULONGLONG size, writeTime;
+    return GetDocumentIdentity(state->documentPath, &size, &writeTime) &&
+           size == state->documentSize && writeTime == state->documentWriteTime;
+}
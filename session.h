@@ -0,0 +1,65 @@
+// ============================================================================
+// session.h - Hot Exit Session Snapshot Header
+// ============================================================================
+// Remembers where the user left off so the next start picks up from there.
+// On exit retropad writes one small binary snapshot
+// (%LOCALAPPDATA%\retropad\session.rps) holding the window layout, the find
+// state, the open document, the caret and scroll position and the document's
+// line index. Unsaved changes are not copied into the snapshot: the crash
+// journal already has them, so it is kept and referenced instead.
+// Reading a snapshot never touches the document itself; the caller loads
+// the body afterwards (see SessionDocumentUnchanged).
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "file_io.h"
+#include "line_index.h"
+
+#define SESSION_FILE_NAME   L"session.rps"
+#define SESSION_MAX_PATH    1024   // Matches the editor's path buffers
+#define SESSION_MAX_FIND    128    // Longer find/replace strings are not kept
+
+// ============================================================================
+// Session State
+// ============================================================================
+typedef struct SessionState {
+    // Layout
+    RECT windowRect;                        // Restored (non-maximized) window position
+    BOOL maximized;
+    BOOL wordWrap;
+    BOOL statusVisible;
+
+    // Find state
+    UINT findFlags;
+    WCHAR findText[SESSION_MAX_FIND];
+    WCHAR replaceText[SESSION_MAX_FIND];
+
+    // Document
+    WCHAR documentPath[SESSION_MAX_PATH];   // "" = untitled or no document
+    WCHAR journalPath[MAX_PATH];            // Journal holding unsaved edits ("" = none)
+    TextEncoding encoding;
+    DWORD selStart, selEnd;                 // Selection (caret at selEnd)
+    DWORD firstLine;                        // First visible line
+    ULONGLONG documentSize;                 // File identity when the snapshot was taken
+    ULONGLONG documentWriteTime;
+    LineIndex lineIndex;                    // Index of the file text (empty if unknown)
+} SessionState;
+
+// Writes the snapshot, replacing the previous one atomically. The document
+// identity is read from 'documentPath' at the time of the call.
+// Returns: TRUE if the snapshot is on disk
+BOOL SessionSave(const SessionState *state);
+
+// Reads the snapshot. 'state' receives an initialized line index that the
+// caller releases with SessionFree.
+// Returns: TRUE if a valid snapshot was found
+BOOL SessionLoad(SessionState *state);
+
+// Releases memory held by a loaded state.
+void SessionFree(SessionState *state);
+
+// Returns TRUE if the document file still has the size and last write time
+// recorded in the snapshot, i.e. the stored line index still describes it.
+BOOL SessionDocumentUnchanged(const SessionState *state);
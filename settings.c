@@ -0,0 +1,292 @@
+// ============================================================================
+// settings.c - Application Settings Implementation
+// ============================================================================
+// Defaults, the field table and the INI text format. INI files are UTF-8
+// (an optional BOM is skipped); strings are converted to and from the
+// UTF-16 used everywhere else, with malformed bytes becoming U+FFFD.
+// ============================================================================
+
+#include "settings.h"
+#include <string.h>
+
+#define FIELD(name, type, member) \
+    { name, type, offsetof(Settings, member), sizeof(((Settings *)0)->member) / sizeof(uint16_t) }
+
+const SettingField g_settingFields[] = {
+    FIELD("WordWrap",      SETTING_BOOL,   wordWrap),
+    FIELD("StatusBar",     SETTING_BOOL,   statusBar),
+    FIELD("FontName",      SETTING_STRING, fontName),
+    FIELD("FontSize",      SETTING_INT,    fontSize),
+    FIELD("FontWeight",    SETTING_INT,    fontWeight),
+    FIELD("FontItalic",    SETTING_BOOL,   fontItalic),
+    FIELD("UndoLimitMB",   SETTING_UINT,   undoLimitMB),
+    FIELD("HotExit",       SETTING_BOOL,   hotExit),
+    FIELD("FindRegex",     SETTING_BOOL,   findRegex),
+    FIELD("SearchIndex",   SETTING_BOOL,   searchIndex),
+    FIELD("LineNumbers",   SETTING_BOOL,   lineNumbers),
+    FIELD("BufferedPaint", SETTING_BOOL,   bufferedPaint),
+    FIELD("PaintTiming",   SETTING_BOOL,   paintTiming),
+};
+const size_t g_settingFieldCount = sizeof(g_settingFields) / sizeof(g_settingFields[0]);
+
+// ============================================================================
+// SettingsDefaults - Built-in Values
+// ============================================================================
+void SettingsDefaults(Settings *settings) {
+    memset(settings, 0, sizeof(*settings));
+    settings->statusBar = true;
+    settings->hotExit = true;
+    settings->searchIndex = true;
+    settings->bufferedPaint = true;
+}
+
+// ============================================================================
+// Field Access
+// ============================================================================
+uint32_t SettingsGetNumber(const Settings *settings, const SettingField *field) {
+    const uint8_t *p = (const uint8_t *)settings + field->offset;
+    switch (field->type) {
+    case SETTING_BOOL:   return *(const bool *)p ? 1u : 0u;
+    case SETTING_INT:    return (uint32_t)*(const int32_t *)p;
+    case SETTING_UINT:   return *(const uint32_t *)p;
+    default:             return 0;
+    }
+}
+
+void SettingsSetNumber(Settings *settings, const SettingField *field, uint32_t value) {
+    uint8_t *p = (uint8_t *)settings + field->offset;
+    switch (field->type) {
+    case SETTING_BOOL:   *(bool *)p = value != 0; break;
+    case SETTING_INT:    *(int32_t *)p = (int32_t)value; break;
+    case SETTING_UINT:   *(uint32_t *)p = value; break;
+    default:             break;
+    }
+}
+
+const uint16_t *SettingsGetString(const Settings *settings, const SettingField *field) {
+    return (const uint16_t *)((const uint8_t *)settings + field->offset);
+}
+
+void SettingsSetString(Settings *settings, const SettingField *field, const uint16_t *value, size_t length) {
+    uint16_t *dst = (uint16_t *)((uint8_t *)settings + field->offset);
+    if (length > field->capacity - 1) length = field->capacity - 1;
+    memcpy(dst, value, length * sizeof(uint16_t));
+    dst[length] = 0;
+}
+
+static size_t StringLength(const uint16_t *s, size_t capacity) {
+    size_t n = 0;
+    while (n < capacity && s[n]) n++;
+    return n;
+}
+
+bool SettingsFieldEqual(const Settings *a, const Settings *b, const SettingField *field) {
+    if (field->type != SETTING_STRING) {
+        return SettingsGetNumber(a, field) == SettingsGetNumber(b, field);
+    }
+    const uint16_t *sa = SettingsGetString(a, field);
+    const uint16_t *sb = SettingsGetString(b, field);
+    size_t la = StringLength(sa, field->capacity);
+    return la == StringLength(sb, field->capacity) && memcmp(sa, sb, la * sizeof(uint16_t)) == 0;
+}
+
+bool SettingsDiffer(const Settings *a, const Settings *b) {
+    for (size_t i = 0; i < g_settingFieldCount; ++i) {
+        if (!SettingsFieldEqual(a, b, &g_settingFields[i])) return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// UTF-8 Conversion
+// ============================================================================
+// Appends UTF-8 for a UTF-16 string; returns the number of bytes it takes.
+// Output beyond 'capacity' is counted but not written.
+static size_t PutUtf8(const uint16_t *s, size_t length, char *out, size_t pos, size_t capacity) {
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t cp = s[i];
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < length && s[i + 1] >= 0xDC00 && s[i + 1] < 0xE000) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (s[++i] - 0xDC00);
+        } else if (cp >= 0xD800 && cp < 0xE000) {
+            cp = 0xFFFD;  // Unpaired surrogate
+        }
+        uint8_t bytes[4];
+        size_t n;
+        if (cp < 0x80) {
+            bytes[0] = (uint8_t)cp; n = 1;
+        } else if (cp < 0x800) {
+            bytes[0] = (uint8_t)(0xC0 | (cp >> 6)); bytes[1] = (uint8_t)(0x80 | (cp & 0x3F)); n = 2;
+        } else if (cp < 0x10000) {
+            bytes[0] = (uint8_t)(0xE0 | (cp >> 12)); bytes[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+            bytes[2] = (uint8_t)(0x80 | (cp & 0x3F)); n = 3;
+        } else {
+            bytes[0] = (uint8_t)(0xF0 | (cp >> 18)); bytes[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+            bytes[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F)); bytes[3] = (uint8_t)(0x80 | (cp & 0x3F)); n = 4;
+        }
+        for (size_t k = 0; k < n; ++k, ++pos) {
+            if (pos < capacity) out[pos] = (char)bytes[k];
+        }
+    }
+    return pos;
+}
+
+// Decodes UTF-8 into at most 'capacity' code units; returns the count
+static size_t GetUtf8(const char *text, size_t length, uint16_t *out, size_t capacity) {
+    const uint8_t *s = (const uint8_t *)text;
+    size_t n = 0;
+    for (size_t i = 0; i < length && n < capacity;) {
+        uint32_t cp = s[i];
+        size_t extra = cp < 0x80 ? 0 : (cp & 0xE0) == 0xC0 ? 1 : (cp & 0xF0) == 0xE0 ? 2 : (cp & 0xF8) == 0xF0 ? 3 : 4;
+        if (extra == 4 || i + extra >= length) {
+            cp = 0xFFFD;
+            extra = 0;
+        } else if (extra) {
+            cp &= 0x3F >> extra;
+            for (size_t k = 1; k <= extra; ++k) {
+                if ((s[i + k] & 0xC0) != 0x80) { cp = 0xFFFD; extra = k - 1; break; }
+                cp = (cp << 6) | (s[i + k] & 0x3F);
+            }
+        }
+        i += extra + 1;
+        if (cp >= 0x10000 && cp <= 0x10FFFF) {
+            if (n + 2 > capacity) break;
+            out[n++] = (uint16_t)(0xD800 + ((cp - 0x10000) >> 10));
+            out[n++] = (uint16_t)(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        } else {
+            out[n++] = (uint16_t)(cp > 0x10FFFF ? 0xFFFD : cp);
+        }
+    }
+    return n;
+}
+
+// ============================================================================
+// SettingsFormatIni - Write Settings as INI Text
+// ============================================================================
+static size_t PutText(const char *s, char *out, size_t pos, size_t capacity) {
+    for (; *s; ++s, ++pos) {
+        if (pos < capacity) out[pos] = *s;
+    }
+    return pos;
+}
+
+size_t SettingsFormatIni(const Settings *settings, char *out, size_t capacity) {
+    size_t pos = PutText("; retropad settings\r\n[" SETTINGS_INI_SECTION "]\r\n", out, 0, capacity);
+    for (size_t i = 0; i < g_settingFieldCount; ++i) {
+        const SettingField *field = &g_settingFields[i];
+        pos = PutText(field->name, out, pos, capacity);
+        pos = PutText("=", out, pos, capacity);
+        if (field->type == SETTING_STRING) {
+            const uint16_t *value = SettingsGetString(settings, field);
+            pos = PutUtf8(value, StringLength(value, field->capacity), out, pos, capacity);
+        } else {
+            // Format the number by hand (signed for SETTING_INT)
+            char digits[16];
+            uint32_t value = SettingsGetNumber(settings, field);
+            bool negative = field->type == SETTING_INT && (int32_t)value < 0;
+            uint64_t magnitude = negative ? (uint64_t)(-(int64_t)(int32_t)value) : value;
+            size_t n = 0;
+            do {
+                digits[n++] = (char)('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude);
+            if (negative) digits[n++] = '-';
+            while (n) {
+                if (pos < capacity) out[pos] = digits[n - 1];
+                ++pos;
+                --n;
+            }
+        }
+        pos = PutText("\r\n", out, pos, capacity);
+    }
+    return pos;
+}
+
+// ============================================================================
+// SettingsParseIni - Read Settings from INI Text
+// ============================================================================
+static bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static bool KeyEquals(const char *key, size_t length, const char *name) {
+    for (size_t i = 0; i < length; ++i, ++name) {
+        char a = key[i], b = *name;
+        if (a >= 'A' && a <= 'Z') a = (char)(a - 'A' + 'a');
+        if (b >= 'A' && b <= 'Z') b = (char)(b - 'A' + 'a');
+        if (!b || a != b) return false;
+    }
+    return *name == '\0';
+}
+
+// Parses a decimal integer (optionally signed) or true/false/yes/no/on/off
+static bool ParseNumber(const char *s, size_t length, uint32_t *valueOut) {
+    if (KeyEquals(s, length, "true") || KeyEquals(s, length, "yes") || KeyEquals(s, length, "on")) {
+        *valueOut = 1;
+        return true;
+    }
+    if (KeyEquals(s, length, "false") || KeyEquals(s, length, "no") || KeyEquals(s, length, "off")) {
+        *valueOut = 0;
+        return true;
+    }
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+    if (i == length) return false;
+    uint64_t value = 0;
+    for (; i < length; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        value = value * 10 + (uint64_t)(s[i] - '0');
+        if (value > 0xFFFFFFFFull) return false;
+    }
+    *valueOut = negative ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return true;
+}
+
+void SettingsParseIni(Settings *settings, const char *text, size_t length) {
+    size_t pos = 0;
+    if (length >= 3 && (uint8_t)text[0] == 0xEF && (uint8_t)text[1] == 0xBB && (uint8_t)text[2] == 0xBF) {
+        pos = 3;
+    }
+    bool inSection = true;  // Keys before any section header count too
+    while (pos < length) {
+        // Isolate one line without its terminator and surrounding blanks
+        size_t start = pos;
+        while (pos < length && text[pos] != '\n' && text[pos] != '\r') pos++;
+        size_t end = pos;
+        while (pos < length && (text[pos] == '\n' || text[pos] == '\r')) pos++;
+        while (start < end && IsBlank(text[start])) start++;
+        while (end > start && IsBlank(text[end - 1])) end--;
+        if (start == end || text[start] == ';' || text[start] == '#') continue;
+
+        if (text[start] == '[') {
+            inSection = end - start >= 2 && text[end - 1] == ']' &&
+                        KeyEquals(text + start + 1, end - start - 2, SETTINGS_INI_SECTION);
+            continue;
+        }
+        if (!inSection) continue;
+
+        size_t eq = start;
+        while (eq < end && text[eq] != '=') eq++;
+        if (eq == end) continue;
+        size_t keyEnd = eq, valueStart = eq + 1;
+        while (keyEnd > start && IsBlank(text[keyEnd - 1])) keyEnd--;
+        while (valueStart < end && IsBlank(text[valueStart])) valueStart++;
+
+        for (size_t i = 0; i < g_settingFieldCount; ++i) {
+            const SettingField *field = &g_settingFields[i];
+            if (!KeyEquals(text + start, keyEnd - start, field->name)) continue;
+            if (field->type == SETTING_STRING) {
+                uint16_t value[SETTINGS_FONT_NAME_MAX];
+                size_t capacity = field->capacity < SETTINGS_FONT_NAME_MAX ? field->capacity : SETTINGS_FONT_NAME_MAX;
+                size_t n = GetUtf8(text + valueStart, end - valueStart, value, capacity - 1);
+                SettingsSetString(settings, field, value, n);
+            } else {
+                uint32_t value;
+                if (ParseNumber(text + valueStart, end - valueStart, &value)) {
+                    SettingsSetNumber(settings, field, value);
+                }
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+// ============================================================================
+// settings.h - Application Settings Header
+// ============================================================================
+// All user preferences in one in-memory structure, plus a table describing
+// each field so that storage backends can load and save every value in a
+// single pass without knowing the individual settings.
+// The INI text format used by the portable file backend is implemented here
+// as well. This module is plain C with no Windows dependencies; the registry
+// and file backends live in settings_store.c.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SETTINGS_FONT_NAME_MAX  32     // Matches LF_FACESIZE
+#define SETTINGS_INI_SECTION    "retropad"
+
+// ============================================================================
+// Settings Structure
+// ============================================================================
+typedef struct Settings {
+    bool wordWrap;                              // Word wrap (default off)
+    bool statusBar;                             // Status bar visible (default on)
+    uint16_t fontName[SETTINGS_FONT_NAME_MAX];  // Font face, "" = default font
+    int32_t fontSize;                           // Font height (LOGFONT lfHeight)
+    int32_t fontWeight;                         // Font weight (LOGFONT lfWeight)
+    bool fontItalic;                            // Italic font
+    uint32_t undoLimitMB;                       // Undo history cap, 0 = default
+    bool hotExit;                               // Keep the session on exit (default on)
+    bool findRegex;                             // Find/Replace uses regular expressions
+    bool searchIndex;                           // Index large documents for searching (default on)
+    bool lineNumbers;                           // Line number gutter (default off)
+    bool bufferedPaint;                         // Paint the editor off-screen first (default on)
+    bool paintTiming;                           // Show editor paint times in the status bar
+} Settings;
+
+// ============================================================================
+// Field Descriptions
+// ============================================================================
+// One entry per setting. 'name' is both the registry value name and the INI
+// key. Strings are null-terminated UTF-16 arrays of 'capacity' code units.
+// ============================================================================
+typedef enum SettingType {
+    SETTING_BOOL = 0,       // bool, stored as 0/1
+    SETTING_INT = 1,        // int32_t
+    SETTING_UINT = 2,       // uint32_t
+    SETTING_STRING = 3      // uint16_t[capacity]
+} SettingType;
+
+typedef struct SettingField {
+    const char *name;
+    SettingType type;
+    size_t offset;          // Offset of the value in Settings
+    size_t capacity;        // Code units, for SETTING_STRING
+} SettingField;
+
+extern const SettingField g_settingFields[];
+extern const size_t g_settingFieldCount;
+
+// Fills 'settings' with the built-in defaults.
+void SettingsDefaults(Settings *settings);
+
+// Returns true if field 'field' has the same value in 'a' and 'b'.
+bool SettingsFieldEqual(const Settings *a, const Settings *b, const SettingField *field);
+
+// Returns true if any field differs between 'a' and 'b'.
+bool SettingsDiffer(const Settings *a, const Settings *b);
+
+// Value accessors for backends. Integers are passed as their 32-bit pattern
+// (booleans as 0/1); strings are copied with truncation.
+uint32_t SettingsGetNumber(const Settings *settings, const SettingField *field);
+void SettingsSetNumber(Settings *settings, const SettingField *field, uint32_t value);
+const uint16_t *SettingsGetString(const Settings *settings, const SettingField *field);
+void SettingsSetString(Settings *settings, const SettingField *field, const uint16_t *value, size_t length);
+
+// Writes all settings as UTF-8 INI text (one [retropad] section).
+// Returns the number of bytes required; when it exceeds 'capacity' nothing
+// useful was written and the caller should retry with a larger buffer.
+size_t SettingsFormatIni(const Settings *settings, char *out, size_t capacity);
+
+// Reads UTF-8 INI text. Known keys are case-insensitive; unknown keys,
+// other sections and malformed lines are ignored, and settings that are
+// not mentioned keep their current values.
+void SettingsParseIni(Settings *settings, const char *text, size_t length);
@@ -0,0 +1,175 @@
+// ============================================================================
+// settings_store.c - Settings Persistence Implementation
+// ============================================================================
+// Registry backend: the key is opened once per load or flush and every field
+// in the table is read or written through it (DWORD values, REG_SZ strings).
+// File backend: the whole INI file is read once and rewritten through a
+// temporary file, so a crash mid-write never leaves half a settings file.
+// ============================================================================
+
+#include "settings_store.h"
+#include <strsafe.h>   // For safe string operations
+
+#define MAX_INI_BYTES  (64 * 1024)   // Larger files are not settings files
+
+// Registry value names are the ASCII field names widened
+static void GetValueName(const SettingField *field, WCHAR *nameOut, size_t nameLen) {
+    size_t i = 0;
+    for (; field->name[i] && i + 1 < nameLen; ++i) nameOut[i] = (WCHAR)field->name[i];
+    nameOut[i] = L'\0';
+}
+
+// ============================================================================
+// Registry Backend
+// ============================================================================
+static void LoadFromRegistry(Settings *settings) {
+    HKEY hKey = NULL;
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, SETTINGS_REG_KEY, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+        return;  // Nothing saved yet
+    }
+    for (size_t i = 0; i < g_settingFieldCount; ++i) {
+        const SettingField *field = &g_settingFields[i];
+        WCHAR name[64];
+        GetValueName(field, name, ARRAYSIZE(name));
+        DWORD type = 0;
+        if (field->type == SETTING_STRING) {
+            WCHAR value[SETTINGS_FONT_NAME_MAX + 1] = {0};
+            DWORD size = sizeof(value) - sizeof(WCHAR);
+            if (RegQueryValueExW(hKey, name, NULL, &type, (BYTE *)value, &size) == ERROR_SUCCESS && type == REG_SZ) {
+                value[size / sizeof(WCHAR)] = L'\0';
+                SettingsSetString(settings, field, (const uint16_t *)value, wcslen(value));
+            }
+        } else {
+            DWORD value = 0;
+            DWORD size = sizeof(value);
+            if (RegQueryValueExW(hKey, name, NULL, &type, (BYTE *)&value, &size) == ERROR_SUCCESS && type == REG_DWORD) {
+                SettingsSetNumber(settings, field, value);
+            }
+        }
+    }
+    RegCloseKey(hKey);
+}
+
+static BOOL SaveToRegistry(const Settings *settings, const Settings *stored) {
+    HKEY hKey = NULL;
+    if (RegCreateKeyExW(HKEY_CURRENT_USER, SETTINGS_REG_KEY, 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL) != ERROR_SUCCESS) {
+        return FALSE;
+    }
+    BOOL ok = TRUE;
+    for (size_t i = 0; i < g_settingFieldCount; ++i) {
+        const SettingField *field = &g_settingFields[i];
+        if (SettingsFieldEqual(settings, stored, field)) continue;
+        WCHAR name[64];
+        GetValueName(field, name, ARRAYSIZE(name));
+        LSTATUS status;
+        if (field->type == SETTING_STRING) {
+            const WCHAR *value = (const WCHAR *)SettingsGetString(settings, field);
+            status = RegSetValueExW(hKey, name, 0, REG_SZ, (const BYTE *)value,
+                                    (DWORD)((wcslen(value) + 1) * sizeof(WCHAR)));
+        } else {
+            DWORD value = SettingsGetNumber(settings, field);
+            status = RegSetValueExW(hKey, name, 0, REG_DWORD, (const BYTE *)&value, sizeof(value));
+        }
+        if (status != ERROR_SUCCESS) ok = FALSE;
+    }
+    RegCloseKey(hKey);
+    return ok;
+}
+
+// ============================================================================
+// File Backend
+// ============================================================================
+static void LoadFromFile(Settings *settings, LPCWSTR path) {
+    HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER size = {0};
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= MAX_INI_BYTES) {
+        char *text = (char *)HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size.QuadPart);
+        DWORD read = 0;
+        if (text && ReadFile(file, text, (DWORD)size.QuadPart, &read, NULL)) {
+            SettingsParseIni(settings, text, read);
+        }
+        if (text) HeapFree(GetProcessHeap(), 0, text);
+    }
+    CloseHandle(file);
+}
+
+static BOOL SaveToFile(const Settings *settings, LPCWSTR path) {
+    WCHAR tempPath[MAX_PATH];
+    if (FAILED(StringCchPrintfW(tempPath, ARRAYSIZE(tempPath), L"%s.tmp", path))) return FALSE;
+
+    size_t needed = SettingsFormatIni(settings, NULL, 0);
+    char *text = (char *)HeapAlloc(GetProcessHeap(), 0, needed);
+    if (!text) return FALSE;
+    SettingsFormatIni(settings, text, needed);
+
+    BOOL ok = FALSE;
+    HANDLE file = CreateFileW(tempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD written = 0;
+        ok = WriteFile(file, text, (DWORD)needed, &written, NULL) && written == (DWORD)needed;
+        CloseHandle(file);
+        ok = ok && MoveFileExW(tempPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+        if (!ok) DeleteFileW(tempPath);
+    }
+    HeapFree(GetProcessHeap(), 0, text);
+    return ok;
+}
+
+// ============================================================================
+// SettingsStoreLoad - Pick the Backend and Read Everything
+// ============================================================================
+void SettingsStoreLoad(SettingsStore *store) {
+    ZeroMemory(store, sizeof(*store));
+    SettingsDefaults(&store->values);
+
+    // Portable mode: an INI file next to the executable wins
+    WCHAR exePath[MAX_PATH];
+    DWORD length = GetModuleFileNameW(NULL, exePath, ARRAYSIZE(exePath));
+    if (length > 0 && length < ARRAYSIZE(exePath)) {
+        WCHAR *slash = wcsrchr(exePath, L'\\');
+        if (slash) *slash = L'\0';
+        if (SUCCEEDED(StringCchPrintfW(store->filePath, ARRAYSIZE(store->filePath), L"%s\\%s",
+                                       exePath, SETTINGS_INI_NAME)) &&
+            GetFileAttributesW(store->filePath) != INVALID_FILE_ATTRIBUTES) {
+            store->backend = SETTINGS_BACKEND_FILE;
+        }
+    }
+
+    if (store->backend == SETTINGS_BACKEND_FILE) {
+        LoadFromFile(&store->values, store->filePath);
+    } else {
+        LoadFromRegistry(&store->values);
+    }
+    store->stored = store->values;
+}
+
+// ============================================================================
+// SettingsStoreChanged - Schedule a Deferred Write
+// ============================================================================
+void SettingsStoreChanged(SettingsStore *store, HWND hwnd) {
+    if (!SettingsDiffer(&store->values, &store->stored)) return;
+    // Re-arming the timer pushes the write back until changes settle
+    if (SetTimer(hwnd, SETTINGS_FLUSH_TIMER_ID, SETTINGS_FLUSH_DELAY_MS, NULL)) {
+        store->timerWindow = hwnd;
+    } else {
+        SettingsStoreFlush(store);
+    }
+}
+
+// ============================================================================
+// SettingsStoreFlush - Write Pending Changes Now
+// ============================================================================
+void SettingsStoreFlush(SettingsStore *store) {
+    if (store->timerWindow) {
+        KillTimer(store->timerWindow, SETTINGS_FLUSH_TIMER_ID);
+        store->timerWindow = NULL;
+    }
+    if (!SettingsDiffer(&store->values, &store->stored)) return;
+
+    BOOL ok = store->backend == SETTINGS_BACKEND_FILE
+        ? SaveToFile(&store->values, store->filePath)
+        : SaveToRegistry(&store->values, &store->stored);
+    // On failure keep the old baseline so the next flush tries again
+    if (ok) store->stored = store->values;
+}
@@ -0,0 +1,49 @@
+// ============================================================================
+// settings_store.h - Settings Persistence Header
+// ============================================================================
+// Loads every setting in one pass at startup and writes changes back lazily.
+// The application reads and modifies 'values' directly and then calls
+// SettingsStoreChanged; the store writes only the values that differ from
+// what the backend holds, once the changes have settled.
+// Two backends are available:
+//   - Registry: HKCU\Software\retropad (the default)
+//   - File:     retropad.ini next to retropad.exe. If that file exists,
+//               retropad runs in portable mode and never touches the registry.
+// ============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include "settings.h"
+
+#define SETTINGS_REG_KEY        L"Software\\retropad"
+#define SETTINGS_INI_NAME       L"retropad.ini"
+#define SETTINGS_FLUSH_TIMER_ID 0x5E77    // WM_TIMER id used for the deferred write
+#define SETTINGS_FLUSH_DELAY_MS 1000      // Changes within this window share one write
+
+typedef enum SettingsBackend {
+    SETTINGS_BACKEND_REGISTRY = 0,
+    SETTINGS_BACKEND_FILE = 1
+} SettingsBackend;
+
+// ============================================================================
+// Store State
+// ============================================================================
+typedef struct SettingsStore {
+    Settings values;                    // Current settings (owned by the app)
+    Settings stored;                    // What the backend holds
+    SettingsBackend backend;
+    WCHAR filePath[MAX_PATH];           // INI file (file backend)
+    HWND timerWindow;                   // Window the flush timer runs on (NULL = none pending)
+} SettingsStore;
+
+// Picks the backend and reads all settings. Missing values keep defaults.
+void SettingsStoreLoad(SettingsStore *store);
+
+// Schedules a deferred write of 'values' via a WM_TIMER on 'hwnd', whose
+// window procedure calls SettingsStoreFlush for SETTINGS_FLUSH_TIMER_ID.
+// Does nothing if nothing changed.
+void SettingsStoreChanged(SettingsStore *store, HWND hwnd);
+
+// Writes pending changes now (timer expiry, exit).
+void SettingsStoreFlush(SettingsStore *store);
@@ -0,0 +1,265 @@
+// ============================================================================
+// text_metrics.c - Text Metrics Cache Implementation
+// ============================================================================
+// A measurement walks the text once. Code units with cached advances are
+// summed; everything else is gathered into maximal runs that go through
+// the run cache. A simple code unit right before a non-simple one (a base
+// letter before its combining mark) joins the run, so the pair is measured
+// together the way the font engine draws it.
+// Runs are identified by a 64-bit hash of the font key and the text, plus
+// the length; the text itself is not kept.
+// ============================================================================
+
+#include "text_metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN_BUCKETS     2048        // Power of two, twice TEXT_METRICS_RUNS
+#define NO_RUN          UINT32_MAX
+#define PAGE_UNKNOWN    0
+#define PAGE_CACHED     1
+#define PAGE_FAILED     2
+#define FNV_OFFSET      0xCBF29CE484222325ULL
+#define FNV_PRIME       0x100000001B3ULL
+
+struct TextMetricsRun {
+    uint64_t hash;
+    size_t length;
+    int32_t width;
+    uint32_t newer;             // LRU neighbours
+    uint32_t older;
+    uint32_t chain;             // Next run in the same bucket
+};
+
+// ============================================================================
+// TextMetricsKey / Hashing
+// ============================================================================
+// FNV-1a over the 8 bytes of 'value'
+static uint64_t HashValue(uint64_t hash, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t TextMetricsKey(const void *data, size_t size, uint64_t seed) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t hash = HashValue(FNV_OFFSET, seed);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t HashRun(uint64_t font, const uint16_t *text, size_t count) {
+    uint64_t hash = HashValue(FNV_OFFSET, font);
+    for (size_t i = 0; i < count; ++i) {
+        hash ^= text[i];
+        hash *= FNV_PRIME;
+    }
+    return HashValue(hash, (uint64_t)count);
+}
+
+// ============================================================================
+// TextMetricsInit / TextMetricsFree / TextMetricsSelect
+// ============================================================================
+void TextMetricsInit(TextMetricsCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    cache->newest = NO_RUN;
+    cache->oldest = NO_RUN;
+}
+
+void TextMetricsFree(TextMetricsCache *cache) {
+    free(cache->runs);
+    free(cache->buckets);
+    TextMetricsInit(cache);
+}
+
+void TextMetricsSelect(TextMetricsCache *cache, uint64_t key, const TextMetricsProvider *provider) {
+    cache->provider = *provider;
+    cache->clock++;
+
+    TextMetricsFont *victim = &cache->fonts[0];
+    for (int i = 0; i < TEXT_METRICS_FONTS; ++i) {
+        TextMetricsFont *font = &cache->fonts[i];
+        if (font->used && font->key == key) {
+            font->lastUse = cache->clock;
+            cache->font = font;
+            return;
+        }
+        if (!font->used || (victim->used && font->lastUse < victim->lastUse)) victim = font;
+    }
+
+    // New font: its advances and line height are fetched on first use
+    memset(victim->pageState, PAGE_UNKNOWN, sizeof(victim->pageState));
+    victim->key = key;
+    victim->used = true;
+    victim->lastUse = cache->clock;
+    victim->lineHeight = 0;
+    cache->font = victim;
+    cache->stats.fontMisses++;
+}
+
+// ============================================================================
+// Advances
+// ============================================================================
+// True if 'unit' has a cached advance in the current font (fetching its
+// page on first use)
+static bool IsSimple(TextMetricsCache *cache, uint16_t unit) {
+    if (unit >= TEXT_METRICS_SIMPLE_LIMIT) return false;
+    TextMetricsFont *font = cache->font;
+    size_t page = unit / 256;
+    if (font->pageState[page] == PAGE_UNKNOWN) {
+        bool ok = cache->provider.advances &&
+                  cache->provider.advances(cache->provider.context, (uint16_t)(page * 256), 256,
+                                           font->advances + page * 256);
+        font->pageState[page] = ok ? PAGE_CACHED : PAGE_FAILED;
+        cache->stats.advancePages++;
+    }
+    return font->pageState[page] == PAGE_CACHED;
+}
+
+// ============================================================================
+// Run Cache
+// ============================================================================
+static bool EnsureRuns(TextMetricsCache *cache) {
+    if (cache->runs) return true;
+    cache->runs = (TextMetricsRun *)malloc(TEXT_METRICS_RUNS * sizeof(TextMetricsRun));
+    cache->buckets = (uint32_t *)malloc(RUN_BUCKETS * sizeof(uint32_t));
+    if (!cache->runs || !cache->buckets) {
+        free(cache->runs);
+        free(cache->buckets);
+        cache->runs = NULL;
+        cache->buckets = NULL;
+        return false;
+    }
+    for (size_t i = 0; i < RUN_BUCKETS; ++i) cache->buckets[i] = NO_RUN;
+    cache->runCount = 0;
+    cache->newest = NO_RUN;
+    cache->oldest = NO_RUN;
+    return true;
+}
+
+static void Unlink(TextMetricsCache *cache, uint32_t index) {
+    TextMetricsRun *run = &cache->runs[index];
+    if (run->newer != NO_RUN) cache->runs[run->newer].older = run->older;
+    else cache->newest = run->older;
+    if (run->older != NO_RUN) cache->runs[run->older].newer = run->newer;
+    else cache->oldest = run->newer;
+}
+
+static void PushNewest(TextMetricsCache *cache, uint32_t index) {
+    TextMetricsRun *run = &cache->runs[index];
+    run->newer = NO_RUN;
+    run->older = cache->newest;
+    if (cache->newest != NO_RUN) cache->runs[cache->newest].newer = index;
+    cache->newest = index;
+    if (cache->oldest == NO_RUN) cache->oldest = index;
+}
+
+// Takes a free entry, or evicts the least recently used one
+static uint32_t TakeEntry(TextMetricsCache *cache) {
+    if (cache->runCount < TEXT_METRICS_RUNS) return cache->runCount++;
+
+    uint32_t index = cache->oldest;
+    Unlink(cache, index);
+    uint32_t *link = &cache->buckets[cache->runs[index].hash & (RUN_BUCKETS - 1)];
+    while (*link != index) link = &cache->runs[*link].chain;
+    *link = cache->runs[index].chain;
+    cache->stats.runEvictions++;
+    return index;
+}
+
+static int32_t RunWidth(TextMetricsCache *cache, const uint16_t *text, size_t count) {
+    size_t fit = 0;
+    if (!EnsureRuns(cache)) {
+        cache->stats.runMisses++;
+        return cache->provider.measureRun(cache->provider.context, text, count, INT32_MAX, &fit);
+    }
+
+    uint64_t hash = HashRun(cache->font->key, text, count);
+    uint32_t *bucket = &cache->buckets[hash & (RUN_BUCKETS - 1)];
+    for (uint32_t index = *bucket; index != NO_RUN; index = cache->runs[index].chain) {
+        TextMetricsRun *run = &cache->runs[index];
+        if (run->hash == hash && run->length == count) {
+            Unlink(cache, index);
+            PushNewest(cache, index);
+            cache->stats.runHits++;
+            return run->width;
+        }
+    }
+
+    int32_t width = cache->provider.measureRun(cache->provider.context, text, count, INT32_MAX, &fit);
+    cache->stats.runMisses++;
+    uint32_t index = TakeEntry(cache);
+    TextMetricsRun *run = &cache->runs[index];
+    run->hash = hash;
+    run->length = count;
+    run->width = width;
+    run->chain = *bucket;
+    *bucket = index;
+    PushNewest(cache, index);
+    return width;
+}
+
+// ============================================================================
+// TextMetricsMeasure / TextMetricsLineHeight
+// ============================================================================
+int32_t TextMetricsMeasure(TextMetricsCache *cache, const uint16_t *text, size_t count, int32_t maxExtent,
+                           size_t *fitOut) {
+    size_t fit = count;
+    if (!cache->font || !cache->provider.measureRun) {
+        if (fitOut) *fitOut = 0;
+        return 0;
+    }
+
+    bool fitFound = false;
+    int64_t x = 0;
+    size_t i = 0;
+    while (i < count) {
+        if (IsSimple(cache, text[i]) && (i + 1 == count || IsSimple(cache, text[i + 1]))) {
+            int32_t advance = cache->font->advances[text[i]];
+            if (!fitFound && x + advance > maxExtent) {
+                fit = i;
+                fitFound = true;
+            }
+            x += advance;
+            cache->stats.advanceHits++;
+            i++;
+            continue;
+        }
+
+        // A run the font engine must shape: up to the next simple unit that
+        // is not followed by another non-simple one
+        size_t end = i + 1;
+        while (end < count && !(IsSimple(cache, text[end]) &&
+                                (end + 1 == count || IsSimple(cache, text[end + 1])))) {
+            end++;
+        }
+        int32_t width = RunWidth(cache, text + i, end - i);
+        if (!fitFound && x + width > maxExtent) {
+            size_t part = 0;
+            int64_t room = maxExtent - x;
+            cache->provider.measureRun(cache->provider.context, text + i, end - i,
+                                       room < 0 ? 0 : (int32_t)room, &part);
+            fit = i + part;
+            fitFound = true;
+        }
+        x += width;
+        i = end;
+    }
+
+    if (fitOut) *fitOut = fit;
+    return x > INT32_MAX ? INT32_MAX : (int32_t)x;
+}
+
+int32_t TextMetricsLineHeight(TextMetricsCache *cache) {
+    if (!cache->font) return 1;
+    if (cache->font->lineHeight <= 0) {
+        int32_t height = cache->provider.lineHeight ? cache->provider.lineHeight(cache->provider.context) : 0;
+        cache->font->lineHeight = height > 0 ? height : 1;
+    }
+    return cache->font->lineHeight;
+}
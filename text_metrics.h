@@ -0,0 +1,99 @@
+// ============================================================================
+// text_metrics.h - Text Metrics Cache Header
+// ============================================================================
+// Caches what measuring text asks of the font engine, per font:
+//   - The advance width of each code unit below TEXT_METRICS_SIMPLE_LIMIT
+//     (Latin, Greek and Cyrillic letters, digits, punctuation). Text made
+//     of those is not shaped, so a run's width is the sum of its advances.
+//     Widths are fetched a page of 256 code units at a time, on first use.
+//   - The width of each run of other text (combining marks, complex
+//     scripts, surrogate pairs), which only the font engine can shape. A
+//     fixed number of runs is kept, least recently used evicted first.
+// Fonts are told apart by a caller-chosen key (a hash of the font
+// description and the device resolution); the last few fonts stay cached,
+// so switching back to a font measures nothing again.
+// The font engine is a TextMetricsProvider: GDI in retropad, or a mock that
+// counts calls, so the cache policy and the hit counters can be exercised
+// without a display.
+// This module is plain C with no Windows dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TEXT_METRICS_SIMPLE_LIMIT  0x0300   // Code units below this are summed, not shaped
+#define TEXT_METRICS_FONTS         4        // Fonts kept
+#define TEXT_METRICS_RUNS          1024     // Shaped runs kept (all fonts together)
+
+// ============================================================================
+// Provider
+// ============================================================================
+// Measures with the font currently selected by the caller.
+typedef struct TextMetricsProvider {
+    void *context;
+    // Advance widths of code units first .. first + count - 1 into 'widths'.
+    // Returns false on failure (the run is then measured whole).
+    bool (*advances)(void *context, uint16_t first, size_t count, int32_t *widths);
+    // Width of text[0, count); *fitOut receives how many leading code units
+    // fit within 'maxExtent'.
+    int32_t (*measureRun)(void *context, const uint16_t *text, size_t count, int32_t maxExtent, size_t *fitOut);
+    // Distance from one line of text to the next.
+    int32_t (*lineHeight)(void *context);
+} TextMetricsProvider;
+
+// ============================================================================
+// Cache
+// ============================================================================
+typedef struct TextMetricsStats {
+    uint64_t advanceHits;       // Code units measured from cached advances
+    uint64_t advancePages;      // Pages of advances fetched from the provider
+    uint64_t runHits;           // Shaped runs found in the cache
+    uint64_t runMisses;         // Shaped runs measured by the provider
+    uint64_t runEvictions;
+    uint64_t fontMisses;        // Fonts (re)loaded
+} TextMetricsStats;
+
+typedef struct TextMetricsFont {
+    uint64_t key;
+    bool used;
+    uint64_t lastUse;                               // For choosing the font to evict
+    int32_t lineHeight;
+    uint8_t pageState[TEXT_METRICS_SIMPLE_LIMIT / 256];  // 0 unknown, 1 cached, 2 failed
+    int32_t advances[TEXT_METRICS_SIMPLE_LIMIT];
+} TextMetricsFont;
+
+typedef struct TextMetricsRun TextMetricsRun;
+
+typedef struct TextMetricsCache {
+    TextMetricsFont fonts[TEXT_METRICS_FONTS];
+    TextMetricsFont *font;                          // Selected font
+    TextMetricsProvider provider;                   // Selected provider
+    uint64_t clock;
+    TextMetricsRun *runs;                           // TEXT_METRICS_RUNS entries, allocated on first use
+    uint32_t *buckets;                              // Hash chains of 'runs'
+    uint32_t runCount;
+    uint32_t newest;                                // LRU list ends (run indices)
+    uint32_t oldest;
+    TextMetricsStats stats;
+} TextMetricsCache;
+
+void TextMetricsInit(TextMetricsCache *cache);
+void TextMetricsFree(TextMetricsCache *cache);
+
+// Makes 'key' the current font, measured through 'provider' from now on.
+void TextMetricsSelect(TextMetricsCache *cache, uint64_t key, const TextMetricsProvider *provider);
+
+// Width of text[0, count) in the current font; *fitOut (if not NULL)
+// receives how many leading code units fit within 'maxExtent'.
+int32_t TextMetricsMeasure(TextMetricsCache *cache, const uint16_t *text, size_t count, int32_t maxExtent,
+                           size_t *fitOut);
+
+// Line height of the current font.
+int32_t TextMetricsLineHeight(TextMetricsCache *cache);
+
+// A font key from a font description; 'seed' mixes in anything else the
+// widths depend on (device resolution).
+uint64_t TextMetricsKey(const void *data, size_t size, uint64_t seed);
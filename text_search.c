@@ -0,0 +1,362 @@
+// ============================================================================
+// text_search.c - Literal Text Search Implementation
+// ============================================================================
+
+#include "text_search.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Two-Way String Matching
+// ============================================================================
+// Crochemore and Perrin's algorithm: the needle is split at a critical
+// position; the right part is matched left to right, then the left part
+// right to left, and mismatches shift by amounts that never skip an
+// occurrence. Linear time, constant space. Units are compared in their
+// folded form, and the factorization orders them by folded value.
+// A sequence is read through a step: 1 reads it forward, -1 reads it
+// backward from its last unit (TextFindLast searches the reversed text for
+// the reversed needle).
+// ============================================================================
+static uint16_t UnitAt(const uint16_t *seq, ptrdiff_t step, size_t i, const uint16_t *fold) {
+    uint16_t ch = seq[(ptrdiff_t)i * step];
+    return fold ? fold[ch] : ch;
+}
+
+// Position of the maximal suffix of the needle under one unit order (or the
+// reverse order), and its period
+static size_t MaximalSuffix(const uint16_t *needle, ptrdiff_t step, size_t length, const uint16_t *fold,
+                            bool reverseOrder, size_t *periodOut) {
+    size_t suffix = (size_t)-1;     // One before the start; the arithmetic wraps
+    size_t j = 0, k = 1, period = 1;
+    while (j + k < length) {
+        uint16_t a = UnitAt(needle, step, j + k, fold);
+        uint16_t b = UnitAt(needle, step, suffix + k, fold);
+        if (reverseOrder ? a > b : a < b) {
+            j += k;
+            k = 1;
+            period = j - suffix;
+        } else if (a == b) {
+            if (k != period) {
+                k++;
+            } else {
+                j += period;
+                k = 1;
+            }
+        } else {
+            suffix = j++;
+            k = period = 1;
+        }
+    }
+    *periodOut = period;
+    return suffix;
+}
+
+static void TwoWayPrepare(TextNeedle *needle, ptrdiff_t step) {
+    const uint16_t *units = step > 0 ? needle->units : needle->units + needle->length - 1;
+    size_t period, reversePeriod;
+    size_t suffix = MaximalSuffix(units, step, needle->length, needle->fold, false, &period);
+    size_t reverseSuffix = MaximalSuffix(units, step, needle->length, needle->fold, true, &reversePeriod);
+    if (reverseSuffix + 1 > suffix + 1) {
+        suffix = reverseSuffix;
+        period = reversePeriod;
+    }
+    size_t critical = suffix + 1;
+
+    // Periodic if the left part also appears 'period' units on
+    bool periodic = critical + period <= needle->length;
+    for (size_t i = 0; periodic && i < critical; ++i) {
+        periodic = UnitAt(units, step, i, needle->fold) == UnitAt(units, step, i + period, needle->fold);
+    }
+    needle->twoWay = true;
+    needle->periodic = periodic;
+    needle->critical = critical;
+    needle->period = periodic ? period
+                              : (critical > needle->length - critical ? critical : needle->length - critical) + 1;
+}
+
+// First occurrence at or after 'from' in a sequence of 'length' units read
+// with 'step'; the needle was prepared with the same step
+static size_t TwoWaySearch(const TextNeedle *needle, ptrdiff_t step, const uint16_t *text, size_t length,
+                           size_t from) {
+    const uint16_t *units = step > 0 ? needle->units : needle->units + needle->length - 1;
+    const uint16_t *fold = needle->fold;
+    size_t n = needle->length;
+    size_t critical = needle->critical;
+    size_t memory = 0;          // Periodic needles: prefix known to match after a full-period shift
+    size_t j = from;
+    while (j <= length - n) {
+        size_t i = (critical > memory) ? critical : memory;
+        while (i < n && UnitAt(units, step, i, fold) == UnitAt(text, step, i + j, fold)) i++;
+        if (i < n) {
+            j += i - critical + 1;
+            memory = 0;
+            continue;
+        }
+        size_t stop = needle->periodic ? memory : 0;
+        i = critical;
+        while (i > stop && UnitAt(units, step, i - 1, fold) == UnitAt(text, step, i - 1 + j, fold)) i--;
+        if (i <= stop) return j;
+        j += needle->period;
+        if (needle->periodic) memory = n - needle->period;
+    }
+    return TEXT_NOT_FOUND;
+}
+
+// ============================================================================
+// TextNeedleInit / TextNeedleFind / TextFind - Next Occurrence of a String
+// ============================================================================
+void TextNeedleInit(TextNeedle *needle, const uint16_t *units, size_t length, const uint16_t *fold) {
+    memset(needle, 0, sizeof(*needle));
+    needle->units = units;
+    needle->length = length;
+    needle->fold = fold;
+    if (length >= TEXT_TWO_WAY_MIN) TwoWayPrepare(needle, 1);
+}
+
+// Short needles: candidates are the positions of the first unit
+static size_t ScanFirstUnit(const uint16_t *text, size_t length, size_t from,
+                            const uint16_t *needle, size_t needleLength, const uint16_t *fold) {
+    size_t last = length - needleLength;
+
+    if (!fold) {
+        uint16_t first = needle[0];
+        for (size_t i = from; i <= last; ++i) {
+            if (text[i] != first) continue;
+            size_t k = 1;
+            while (k < needleLength && text[i + k] == needle[k]) k++;
+            if (k == needleLength) return i;
+        }
+        return TEXT_NOT_FOUND;
+    }
+
+    uint16_t first = fold[needle[0]];
+    for (size_t i = from; i <= last; ++i) {
+        if (fold[text[i]] != first) continue;
+        size_t k = 1;
+        while (k < needleLength && fold[text[i + k]] == fold[needle[k]]) k++;
+        if (k == needleLength) return i;
+    }
+    return TEXT_NOT_FOUND;
+}
+
+size_t TextNeedleFind(const TextNeedle *needle, const uint16_t *text, size_t length, size_t from) {
+    size_t n = needle->length;
+    if (n == 0 || length < n || from > length - n) return TEXT_NOT_FOUND;
+    if (needle->twoWay) return TwoWaySearch(needle, 1, text, length, from);
+    return ScanFirstUnit(text, length, from, needle->units, n, needle->fold);
+}
+
+size_t TextFind(const uint16_t *text, size_t length, size_t from,
+                const uint16_t *needle, size_t needleLength, const uint16_t *fold) {
+    TextNeedle prepared;
+    TextNeedleInit(&prepared, needle, needleLength, fold);
+    return TextNeedleFind(&prepared, text, length, from);
+}
+
+// ============================================================================
+// TextFindLast - Previous Occurrence of a String
+// ============================================================================
+size_t TextFindLast(const uint16_t *text, size_t length, size_t before,
+                    const uint16_t *needle, size_t needleLength, const uint16_t *fold) {
+    if (needleLength == 0 || length < needleLength || before == 0) return TEXT_NOT_FOUND;
+    size_t i = (before - 1 < length - needleLength) ? before - 1 : length - needleLength;
+    if (needleLength >= TEXT_TWO_WAY_MIN) {
+        // The reversed text up to the end of the last candidate, searched
+        // for the reversed needle: its first occurrence is the last one here
+        size_t end = i + needleLength;
+        TextNeedle reversed;
+        memset(&reversed, 0, sizeof(reversed));
+        reversed.units = needle;
+        reversed.length = needleLength;
+        reversed.fold = fold;
+        TwoWayPrepare(&reversed, -1);
+        size_t j = TwoWaySearch(&reversed, -1, text + end - 1, end, 0);
+        return j == TEXT_NOT_FOUND ? TEXT_NOT_FOUND : end - j - needleLength;
+    }
+    for (;;) {
+        size_t k = 0;
+        if (fold) {
+            while (k < needleLength && fold[text[i + k]] == fold[needle[k]]) k++;
+        } else {
+            while (k < needleLength && text[i + k] == needle[k]) k++;
+        }
+        if (k == needleLength) return i;
+        if (i == 0) return TEXT_NOT_FOUND;
+        i--;
+    }
+}
+
+// ============================================================================
+// Whole Words
+// ============================================================================
+bool TextIsWordChar(const uint8_t *words, uint16_t ch) {
+    return (words[ch >> 3] >> (ch & 7)) & 1;
+}
+
+bool TextIsWholeWord(const uint16_t *text, size_t length, size_t start, size_t end, const uint8_t *words) {
+    if (start > 0 && start < end && TextIsWordChar(words, text[start - 1]) && TextIsWordChar(words, text[start])) {
+        return false;
+    }
+    if (end < length && end > start && TextIsWordChar(words, text[end - 1]) && TextIsWordChar(words, text[end])) {
+        return false;
+    }
+    return true;
+}
+
+size_t TextFindWord(const uint16_t *text, size_t length, size_t from,
+                    const uint16_t *needle, size_t needleLength, const uint16_t *fold, const uint8_t *words) {
+    TextNeedle prepared;
+    TextNeedleInit(&prepared, needle, needleLength, fold);
+    size_t i;
+    while ((i = TextNeedleFind(&prepared, text, length, from)) != TEXT_NOT_FOUND) {
+        if (!words || TextIsWholeWord(text, length, i, i + needleLength, words)) return i;
+        from = i + 1;
+    }
+    return TEXT_NOT_FOUND;
+}
+
+size_t TextFindLastWord(const uint16_t *text, size_t length, size_t before,
+                        const uint16_t *needle, size_t needleLength, const uint16_t *fold, const uint8_t *words) {
+    size_t i;
+    while ((i = TextFindLast(text, length, before, needle, needleLength, fold)) != TEXT_NOT_FOUND) {
+        if (!words || TextIsWholeWord(text, length, i, i + needleLength, words)) return i;
+        before = i;
+    }
+    return TEXT_NOT_FOUND;
+}
+
+// ============================================================================
+// IncSearchInit / IncSearchFree / IncSearchRestart
+// ============================================================================
+void IncSearchInit(IncSearch *search) {
+    memset(search, 0, sizeof(*search));
+    search->complete = true;
+}
+
+void IncSearchFree(IncSearch *search) {
+    free(search->needle);
+    free(search->positions);
+    IncSearchInit(search);
+}
+
+void IncSearchRestart(IncSearch *search) {
+    search->stored = 0;
+    search->count = 0;
+    search->scanned = 0;
+    search->overflow = false;
+    search->complete = search->needleLength == 0;
+}
+
+// ============================================================================
+// IncSearchSetQuery - New Query, Narrowing the Old Results if Possible
+// ============================================================================
+bool IncSearchSetQuery(IncSearch *search, const uint16_t *needle, size_t needleLength,
+                       const uint16_t *fold, const uint16_t *text, size_t length) {
+    bool extends = search->needleLength > 0 && needleLength >= search->needleLength &&
+                   fold == search->fold && !search->overflow &&
+                   memcmp(needle, search->needle, search->needleLength * sizeof(uint16_t)) == 0;
+
+    if (needleLength > search->needleCapacity) {
+        uint16_t *grown = (uint16_t *)realloc(search->needle, needleLength * sizeof(uint16_t));
+        if (!grown) {
+            search->needleLength = 0;
+            IncSearchRestart(search);
+            return false;
+        }
+        search->needle = grown;
+        search->needleCapacity = needleLength;
+    }
+    size_t oldLength = search->needleLength;
+    if (needleLength) memcpy(search->needle, needle, needleLength * sizeof(uint16_t));
+    search->needleLength = needleLength;
+    search->fold = fold;
+
+    if (!extends) {
+        IncSearchRestart(search);
+        return true;
+    }
+
+    // Keep the recorded occurrences the longer query still matches
+    size_t kept = 0;
+    for (size_t i = 0; i < search->stored; ++i) {
+        size_t pos = (size_t)search->positions[i];
+        if (pos + needleLength > length) continue;
+        size_t k = oldLength;
+        if (fold) {
+            while (k < needleLength && fold[text[pos + k]] == fold[needle[k]]) k++;
+        } else {
+            while (k < needleLength && text[pos + k] == needle[k]) k++;
+        }
+        if (k == needleLength) search->positions[kept++] = pos;
+    }
+    search->stored = kept;
+    search->count = kept;
+    return true;
+}
+
+// ============================================================================
+// IncSearchStep - Scan One Slice
+// ============================================================================
+bool IncSearchStep(IncSearch *search, const uint16_t *text, size_t length, size_t budget) {
+    if (search->complete) return true;
+    size_t stepEnd = (search->scanned < length && length - search->scanned > budget) ? search->scanned + budget : length;
+    size_t limit = (length - stepEnd >= search->needleLength) ? stepEnd + search->needleLength - 1 : length;
+
+    TextNeedle needle;
+    TextNeedleInit(&needle, search->needle, search->needleLength, search->fold);
+    size_t pos = search->scanned;
+    while ((pos = TextNeedleFind(&needle, text, limit, pos)) != TEXT_NOT_FOUND) {
+        search->count++;
+        if (!search->overflow) {
+            if (search->stored == search->capacity) {
+                size_t newCapacity = search->capacity ? search->capacity * 2 : 1024;
+                if (newCapacity > INCSEARCH_MAX_POSITIONS) newCapacity = INCSEARCH_MAX_POSITIONS;
+                uint64_t *grown = newCapacity > search->capacity
+                    ? (uint64_t *)realloc(search->positions, newCapacity * sizeof(uint64_t)) : NULL;
+                if (grown) {
+                    search->positions = grown;
+                    search->capacity = newCapacity;
+                } else {
+                    search->overflow = true;
+                }
+            }
+            if (!search->overflow) search->positions[search->stored++] = pos;
+        }
+        pos++;
+    }
+    search->scanned = stepEnd;
+    search->complete = stepEnd >= length;
+    return search->complete;
+}
+
+// ============================================================================
+// Lookups in the Recorded Occurrences
+// ============================================================================
+static size_t LowerBound(const IncSearch *search, uint64_t position) {
+    size_t lo = 0, hi = search->stored;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (search->positions[mid] < position) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t IncSearchNextKnown(const IncSearch *search, uint64_t position) {
+    if (search->overflow) return TEXT_NOT_FOUND;
+    size_t i = LowerBound(search, position);
+    if (i < search->stored) return (size_t)search->positions[i];
+    return TEXT_NOT_FOUND;
+}
+
+size_t IncSearchPrevKnown(const IncSearch *search, uint64_t position) {
+    if (search->overflow || position > search->scanned) return TEXT_NOT_FOUND;
+    size_t i = LowerBound(search, position);
+    return i > 0 ? (size_t)search->positions[i - 1] : TEXT_NOT_FOUND;
+}
+
+size_t IncSearchOrdinal(const IncSearch *search, uint64_t position) {
+    if (search->overflow || position > search->scanned) return TEXT_NOT_FOUND;
+    return LowerBound(search, position);
+}
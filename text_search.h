@@ -0,0 +1,126 @@
+// ============================================================================
+// text_search.h - Literal Text Search Header
+// ============================================================================
+// Literal (non-regex) search over UTF-16 text:
+//   - TextFind: the next occurrence of a string, exact or through a fold
+//     table (fold[u] is the comparison form of code unit u, e.g. lowercase).
+//     Needles of TEXT_TWO_WAY_MIN units or more (pasted blocks of text) use
+//     the Two-Way algorithm, which stays linear in the text length whatever
+//     the needle; shorter ones use a first-unit scan, faster in practice.
+//     TextNeedle keeps the preparation for repeated searches.
+//   - IncSearch: the state behind search-as-you-type. It counts and records
+//     every occurrence, scanning a slice at a time so the caller can spread
+//     the work over idle time. When a query is extended, the new matches
+//     are a subset of the old ones, so only the recorded positions are
+//     checked again instead of scanning the text.
+// Occurrences may overlap ("aa" occurs three times in "aaaa"); that is what
+// makes the subset rule hold. This module is plain C with no Windows
+// dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TEXT_NOT_FOUND            ((size_t)-1)
+#define INCSEARCH_MAX_POSITIONS   (1u << 20)    // Occurrences recorded; beyond this they are only counted
+#define TEXT_TWO_WAY_MIN          32            // Needle length from which Two-Way is used
+
+// Returns the first occurrence of the needle starting at or after 'from'
+// that lies entirely within text[0, length), or TEXT_NOT_FOUND.
+// 'fold' is a 65536-entry table, or NULL for exact matching.
+size_t TextFind(const uint16_t *text, size_t length, size_t from,
+                const uint16_t *needle, size_t needleLength, const uint16_t *fold);
+
+// A needle prepared for TextNeedleFind. It points to the needle units and
+// fold table, which must outlive it.
+typedef struct TextNeedle {
+    const uint16_t *units;
+    size_t length;
+    const uint16_t *fold;
+    bool twoWay;                // Long needle: the fields below are set
+    bool periodic;              // The left part repeats in the right part
+    size_t critical;            // Critical factorization position
+    size_t period;              // Shift after a complete match
+} TextNeedle;
+
+void TextNeedleInit(TextNeedle *needle, const uint16_t *units, size_t length, const uint16_t *fold);
+
+// TextFind with a prepared needle.
+size_t TextNeedleFind(const TextNeedle *needle, const uint16_t *text, size_t length, size_t from);
+
+// Returns the last occurrence starting before 'before', or TEXT_NOT_FOUND.
+size_t TextFindLast(const uint16_t *text, size_t length, size_t before,
+                    const uint16_t *needle, size_t needleLength, const uint16_t *fold);
+
+// ============================================================================
+// Whole Words
+// ============================================================================
+// A word table is a bitmap with one bit per code unit: bit (ch & 7) of byte
+// ch >> 3 is set if ch is a word character. An occurrence is a whole word
+// if it does not continue a word at either end: the unit before it and its
+// first unit are not both word characters, nor are its last unit and the
+// one after it. The check is made only at the candidates TextFind reports,
+// two table lookups each, so the scan itself runs as fast as plain search.
+// ============================================================================
+#define TEXT_WORD_TABLE_BYTES     (0x10000 / 8)
+
+bool TextIsWordChar(const uint8_t *words, uint16_t ch);
+
+// True if text[start, end) is a whole word within text[0, length).
+bool TextIsWholeWord(const uint16_t *text, size_t length, size_t start, size_t end, const uint8_t *words);
+
+// TextFind and TextFindLast for whole-word occurrences only. A NULL
+// 'words' table finds every occurrence.
+size_t TextFindWord(const uint16_t *text, size_t length, size_t from,
+                    const uint16_t *needle, size_t needleLength, const uint16_t *fold, const uint8_t *words);
+size_t TextFindLastWord(const uint16_t *text, size_t length, size_t before,
+                        const uint16_t *needle, size_t needleLength, const uint16_t *fold, const uint8_t *words);
+
+// ============================================================================
+// Incremental Search
+// ============================================================================
+typedef struct IncSearch {
+    uint16_t *needle;           // Current query
+    size_t needleLength;
+    size_t needleCapacity;
+    const uint16_t *fold;       // Fold table the query was set with
+    uint64_t *positions;        // Recorded occurrences, in order
+    size_t stored;
+    size_t capacity;
+    size_t count;               // Occurrences starting before 'scanned'
+    size_t scanned;             // Every start position before this has been checked
+    bool overflow;              // Not every occurrence was recorded
+    bool complete;              // The whole text has been scanned
+} IncSearch;
+
+void IncSearchInit(IncSearch *search);
+void IncSearchFree(IncSearch *search);
+
+// Sets a new query. If it extends the previous one (same fold table, all
+// occurrences recorded), the recorded positions are narrowed down and the
+// scan continues where it was; otherwise the scan starts over.
+// Returns false if out of memory (the search is then empty and complete).
+bool IncSearchSetQuery(IncSearch *search, const uint16_t *needle, size_t needleLength,
+                       const uint16_t *fold, const uint16_t *text, size_t length);
+
+// Starts the scan over, for when the text has changed.
+void IncSearchRestart(IncSearch *search);
+
+// Scans up to 'budget' more start positions.
+// Returns true once the whole text has been scanned.
+bool IncSearchStep(IncSearch *search, const uint16_t *text, size_t length, size_t budget);
+
+// Returns the first recorded occurrence at or after 'position', or
+// TEXT_NOT_FOUND if the scan has not yet shown where it is (or overflowed).
+size_t IncSearchNextKnown(const IncSearch *search, uint64_t position);
+
+// Returns the last occurrence before 'position', or TEXT_NOT_FOUND if
+// there is none or the scan has not yet shown where it is.
+size_t IncSearchPrevKnown(const IncSearch *search, uint64_t position);
+
+// Returns the number of occurrences before 'position', or TEXT_NOT_FOUND
+// if that is not known yet.
+size_t IncSearchOrdinal(const IncSearch *search, uint64_t position);
@@ -0,0 +1,338 @@
+// ============================================================================
+// trigram_index.c - Trigram Index of a Document Implementation
+// ============================================================================
+// Posting list layout: the list of bucket h is postings[listStart[h],
+// listStart[h + 1]). Each entry is the gap to the previous block number
+// plus one (the first entry is the block number plus one), written seven
+// bits at a time, low bits first, with the top bit set on every byte but
+// the last.
+// The sizing pass adds each list's byte count into listStart[h + 1]; these
+// are then turned into start offsets, still one slot up, so the filling
+// pass can use listStart[h + 1] as the write position of list h. When it
+// is done, that slot holds the end of list h, which is where list h + 1
+// starts.
+// ============================================================================
+
+#include "trigram_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REBUILD_FRACTION  4     // Rebuild once 1/4 of the blocks have changed
+
+// ============================================================================
+// Helpers
+// ============================================================================
+static uint32_t Bucket(uint16_t a, uint16_t b, uint16_t c) {
+    uint64_t key = (uint64_t)a | ((uint64_t)b << 16) | ((uint64_t)c << 32);
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - TRIGRAM_BUCKET_BITS));
+}
+
+static uint16_t Fold(const uint16_t *fold, uint16_t ch) {
+    return fold ? fold[ch] : ch;
+}
+
+static size_t VarintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static size_t PutVarint(uint8_t *out, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+static bool TestBit(const uint8_t *bits, size_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static void SetBit(uint8_t *bits, size_t i) {
+    bits[i >> 3] |= (uint8_t)(1u << (i & 7));
+}
+
+// First block that ends after 'pos' (blockCount if none)
+static size_t BlockAt(const TrigramIndex *index, size_t pos) {
+    size_t lo = 0, hi = index->blockCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->blockStart[mid + 1] > pos) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// ============================================================================
+// TrigramIndexInit / TrigramIndexFree
+// ============================================================================
+void TrigramIndexInit(TrigramIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void TrigramIndexFree(TrigramIndex *index) {
+    free(index->blockStart);
+    free(index->changed);
+    free(index->listStart);
+    free(index->postings);
+    free(index->lastBlock);
+    TrigramIndexInit(index);
+}
+
+// ============================================================================
+// TrigramIndexBegin
+// ============================================================================
+bool TrigramIndexBegin(TrigramIndex *index, const uint16_t *fold, size_t length) {
+    TrigramIndexFree(index);
+    index->fold = fold;
+    index->length = length;
+    index->blockCount = (length + TRIGRAM_BLOCK - 1) / TRIGRAM_BLOCK;
+    index->blockStart = (uint64_t *)malloc((index->blockCount + 1) * sizeof(uint64_t));
+    index->changed = (uint8_t *)calloc(index->blockCount / 8 + 1, 1);
+    index->listStart = (uint64_t *)calloc((size_t)TRIGRAM_BUCKETS + 1, sizeof(uint64_t));
+    index->lastBlock = (uint32_t *)calloc(TRIGRAM_BUCKETS, sizeof(uint32_t));
+    if (!index->blockStart || !index->changed || !index->listStart || !index->lastBlock) {
+        TrigramIndexFree(index);
+        return false;
+    }
+    for (size_t b = 0; b < index->blockCount; ++b) index->blockStart[b] = (uint64_t)b * TRIGRAM_BLOCK;
+    index->blockStart[index->blockCount] = length;
+    index->state = TRIGRAM_SIZING;
+    return true;
+}
+
+// ============================================================================
+// TrigramIndexStep
+// ============================================================================
+// Records the trigrams starting in block b; the last two read on into the
+// next block. Sizing counts the bytes each list needs, filling writes them.
+static void IndexBlock(TrigramIndex *index, const uint16_t *text, size_t length, size_t b, bool fill) {
+    size_t start = b * (size_t)TRIGRAM_BLOCK;
+    size_t end = start + TRIGRAM_BLOCK < length ? start + TRIGRAM_BLOCK : length;
+    if (length - start < 3) return;
+    if (end > length - 2) end = length - 2;
+
+    const uint16_t *fold = index->fold;
+    uint32_t mark = (uint32_t)b + 1;
+    uint16_t x = Fold(fold, text[start]);
+    uint16_t y = Fold(fold, text[start + 1]);
+    for (size_t i = start; i < end; ++i) {
+        uint16_t z = Fold(fold, text[i + 2]);
+        uint32_t h = Bucket(x, y, z);
+        if (index->lastBlock[h] != mark) {
+            uint32_t gap = mark - index->lastBlock[h];
+            index->lastBlock[h] = mark;
+            if (fill) {
+                index->listStart[h + 1] += PutVarint(index->postings + index->listStart[h + 1], gap);
+            } else {
+                index->listStart[h + 1] += VarintSize(gap);
+            }
+        }
+        x = y;
+        y = z;
+    }
+}
+
+bool TrigramIndexStep(TrigramIndex *index, const uint16_t *text, size_t length, size_t budget) {
+    if (index->state != TRIGRAM_SIZING && index->state != TRIGRAM_FILLING) return true;
+    size_t blocks = budget / TRIGRAM_BLOCK ? budget / TRIGRAM_BLOCK : 1;
+    size_t end = index->blockCount - index->built > blocks ? index->built + blocks : index->blockCount;
+    for (size_t b = index->built; b < end; ++b) {
+        IndexBlock(index, text, length, b, index->state == TRIGRAM_FILLING);
+    }
+    index->built = end;
+    if (index->built < index->blockCount) return false;
+
+    if (index->state == TRIGRAM_SIZING) {
+        // Byte counts to start offsets, one slot up (see the top of the file)
+        uint64_t total = 0;
+        for (size_t h = 0; h < TRIGRAM_BUCKETS; ++h) {
+            uint64_t size = index->listStart[h + 1];
+            index->listStart[h + 1] = total;
+            total += size;
+        }
+        index->postingBytes = (size_t)total;
+        index->postings = (uint8_t *)malloc(index->postingBytes ? index->postingBytes : 1);
+        if (!index->postings) {
+            TrigramIndexFree(index);
+            return true;
+        }
+        memset(index->lastBlock, 0, TRIGRAM_BUCKETS * sizeof(uint32_t));
+        index->state = TRIGRAM_FILLING;
+        index->built = 0;
+        return index->blockCount == 0 ? TrigramIndexStep(index, text, length, budget) : false;
+    }
+
+    free(index->lastBlock);
+    index->lastBlock = NULL;
+    index->state = TRIGRAM_READY;
+    return true;
+}
+
+// ============================================================================
+// TrigramIndexUpdate
+// ============================================================================
+// The changed blocks are those holding a trigram that reads any of the
+// replaced characters: from two before the edit up to its old end. Block
+// boundaries inside the edit collapse onto it; later ones shift by the
+// length change. A clean block therefore keeps its full length, which the
+// "b or b + 1" rule of the queries relies on.
+// ============================================================================
+bool TrigramIndexUpdate(TrigramIndex *index, size_t offset, size_t removed, size_t inserted) {
+    if (index->state == TRIGRAM_EMPTY) return true;
+    if (index->state != TRIGRAM_READY || index->blockCount == 0) return false;
+
+    size_t lo = offset >= 2 ? offset - 2 : 0;
+    size_t hi = offset + removed > lo ? offset + removed : lo + 1;
+    size_t first = BlockAt(index, lo);
+    if (first == index->blockCount) first = index->blockCount - 1;   // Appending at the end
+    size_t last = first;
+    for (size_t b = first; b < index->blockCount && index->blockStart[b] < hi; ++b) {
+        if (!TestBit(index->changed, b)) {
+            SetBit(index->changed, b);
+            index->changedCount++;
+        }
+        last = b;
+    }
+    for (size_t j = first + 1; j <= last; ++j) {
+        if (index->blockStart[j] > offset) index->blockStart[j] = offset + inserted;
+    }
+    for (size_t j = last + 1; j <= index->blockCount; ++j) {
+        index->blockStart[j] = index->blockStart[j] - removed + inserted;
+    }
+    index->length = index->length - removed + inserted;
+    return index->changedCount * REBUILD_FRACTION <= index->blockCount;
+}
+
+// ============================================================================
+// TrigramIndexMemory
+// ============================================================================
+size_t TrigramIndexMemory(const TrigramIndex *index) {
+    if (index->state == TRIGRAM_EMPTY) return 0;
+    size_t bytes = ((size_t)TRIGRAM_BUCKETS + 1) * sizeof(uint64_t) + index->postingBytes;
+    bytes += (index->blockCount + 1) * sizeof(uint64_t) + index->blockCount / 8 + 1;
+    if (index->lastBlock) bytes += TRIGRAM_BUCKETS * sizeof(uint32_t);
+    return bytes;
+}
+
+// ============================================================================
+// TrigramQueryInit
+// ============================================================================
+// Sets a bit in 'bits' for every block on the list of bucket h, and also
+// for the block before it if 'before' is set.
+static void MarkList(const TrigramIndex *index, uint32_t h, uint8_t *bits, bool before) {
+    const uint8_t *p = index->postings + index->listStart[h];
+    const uint8_t *end = index->postings + index->listStart[h + 1];
+    uint32_t block = 0;     // Last block plus one
+    while (p < end) {
+        uint32_t gap = 0;
+        int shift = 0;
+        while (p < end && (*p & 0x80)) {
+            gap |= (uint32_t)(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        if (p < end) gap |= (uint32_t)*p++ << shift;
+        block += gap;
+        SetBit(bits, block - 1);
+        if (before && block >= 2) SetBit(bits, block - 2);
+    }
+}
+
+bool TrigramQueryInit(TrigramQuery *query, const TrigramIndex *index, const uint16_t *literal, size_t length) {
+    memset(query, 0, sizeof(*query));
+    if (index->state != TRIGRAM_READY || index->blockCount == 0 || length < 3) return false;
+    size_t bytes = index->blockCount / 8 + 1;
+    uint8_t *candidates = (uint8_t *)calloc(bytes, 1);
+    uint8_t *scratch = (uint8_t *)malloc(bytes);
+    if (!candidates || !scratch) {
+        free(candidates);
+        free(scratch);
+        return false;
+    }
+
+    // A match starting in block b has its first trigram in b...
+    const uint16_t *fold = index->fold;
+    uint32_t seen[TRIGRAM_QUERY_MAX];
+    size_t seenCount = 0;
+    seen[seenCount++] = Bucket(Fold(fold, literal[0]), Fold(fold, literal[1]), Fold(fold, literal[2]));
+    MarkList(index, seen[0], candidates, false);
+    for (size_t i = 0; i < bytes; ++i) candidates[i] |= index->changed[i];
+
+    // ...and the trigram at offset k < TRIGRAM_BLOCK in b or b + 1 (a changed
+    // block could hold anything)
+    size_t trigrams = length - 2;
+    if (trigrams > TRIGRAM_BLOCK) trigrams = TRIGRAM_BLOCK;
+    for (size_t k = 1; k < trigrams && seenCount < TRIGRAM_QUERY_MAX; ++k) {
+        uint32_t h = Bucket(Fold(fold, literal[k]), Fold(fold, literal[k + 1]), Fold(fold, literal[k + 2]));
+        size_t s = 0;
+        while (s < seenCount && seen[s] != h) s++;
+        if (s < seenCount) continue;
+        seen[seenCount++] = h;
+
+        memset(scratch, 0, bytes);
+        MarkList(index, h, scratch, true);
+        for (size_t i = 0; i < bytes; ++i) {
+            uint8_t next = i + 1 < bytes ? index->changed[i + 1] : 0;
+            scratch[i] |= index->changed[i] | (uint8_t)(index->changed[i] >> 1) | (uint8_t)(next << 7);
+            candidates[i] &= scratch[i];
+        }
+    }
+    free(scratch);
+    query->index = index;
+    query->candidates = candidates;
+    return true;
+}
+
+void TrigramQueryFree(TrigramQuery *query) {
+    free(query->candidates);
+    memset(query, 0, sizeof(*query));
+}
+
+// ============================================================================
+// TrigramQueryNext / TrigramQueryPrev
+// ============================================================================
+bool TrigramQueryNext(const TrigramQuery *query, size_t from, size_t *startOut, size_t *endOut) {
+    const TrigramIndex *index = query->index;
+    size_t count = index->blockCount;
+    size_t b = BlockAt(index, from);
+    while (b < count && !TestBit(query->candidates, b)) {
+        // Skip empty bytes of the bitmap whole
+        if ((b & 7) == 0 && query->candidates[b >> 3] == 0) {
+            b += 8;
+        } else {
+            b++;
+        }
+    }
+    if (b >= count) return false;
+    size_t e = b;
+    while (e + 1 < count && TestBit(query->candidates, e + 1)) e++;
+    *startOut = (size_t)index->blockStart[b];
+    *endOut = (size_t)index->blockStart[e + 1];
+    return true;
+}
+
+bool TrigramQueryPrev(const TrigramQuery *query, size_t before, size_t *startOut, size_t *endOut) {
+    const TrigramIndex *index = query->index;
+    if (before == 0) return false;
+    size_t b = BlockAt(index, before - 1);
+    if (b >= index->blockCount) b = index->blockCount - 1;
+    for (;;) {
+        if (TestBit(query->candidates, b)) break;
+        if (b == 0) return false;
+        b--;
+    }
+    size_t s = b;
+    while (s > 0 && TestBit(query->candidates, s - 1)) s--;
+    *startOut = (size_t)index->blockStart[s];
+    *endOut = (size_t)index->blockStart[b + 1];
+    return true;
+}
@@ -0,0 +1,102 @@
+// ============================================================================
+// trigram_index.h - Trigram Index of a Document Header
+// ============================================================================
+// Lets repeated searches of a large document skip the parts that cannot
+// hold a match. The text is cut into blocks of TRIGRAM_BLOCK characters and
+// the index records, for every trigram (three consecutive code units, folded
+// through a lowercase table), which blocks contain it:
+//   - Trigrams are hashed into TRIGRAM_BUCKETS buckets. A bucket's posting
+//     list is the rising list of block numbers holding any of its trigrams,
+//     stored as gaps in a variable-length byte code (most gaps take one
+//     byte). A hash collision only adds candidates, never loses a match.
+//   - A query takes the trigrams of a literal that every match starts with
+//     and works out the candidate blocks: a match starting in block b has
+//     its first trigram in b and each later one in b or b + 1.
+//   - The index is built a slice at a time (TrigramIndexStep), in two
+//     passes: one sizes the posting lists, one fills them in.
+//   - Edits mark only the blocks they touch as changed; those are always
+//     candidates. Blocks after an edit keep their trigrams and just move.
+//     Once too much has changed, the index asks to be rebuilt.
+// Because the trigrams are folded, one index serves case-sensitive and
+// case-insensitive searches alike. This module is plain C with no Windows
+// dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRIGRAM_BLOCK          (1u << 16)   // Characters per block
+#define TRIGRAM_BUCKET_BITS    18
+#define TRIGRAM_BUCKETS        (1u << TRIGRAM_BUCKET_BITS) // Hash buckets (posting lists)
+#define TRIGRAM_QUERY_MAX      32           // Trigrams of a literal used by a query
+
+typedef enum TrigramIndexState {
+    TRIGRAM_EMPTY = 0,          // Not built
+    TRIGRAM_SIZING = 1,         // First pass: counting posting list bytes
+    TRIGRAM_FILLING = 2,        // Second pass: writing posting lists
+    TRIGRAM_READY = 3           // Usable by queries
+} TrigramIndexState;
+
+typedef struct TrigramIndex {
+    TrigramIndexState state;
+    const uint16_t *fold;       // Fold table trigrams go through (65536 entries, or NULL)
+    size_t length;              // Text length: as built, then as edited
+    size_t blockCount;
+    uint64_t *blockStart;       // blockCount + 1 block boundaries; moved by edits
+    uint8_t *changed;           // Bitmap of blocks edited since the build
+    size_t changedCount;
+    uint64_t *listStart;        // TRIGRAM_BUCKETS + 1 offsets into 'postings'
+    uint8_t *postings;          // Every posting list, one after another
+    size_t postingBytes;
+    uint32_t *lastBlock;        // While building: last block recorded per bucket, plus one
+    size_t built;               // While building: blocks done in the current pass
+} TrigramIndex;
+
+void TrigramIndexInit(TrigramIndex *index);
+void TrigramIndexFree(TrigramIndex *index);
+
+// Starts building an index of a text of 'length' characters; trigrams are
+// folded through 'fold', which must outlive the index.
+// Returns false if out of memory (the index is then empty).
+bool TrigramIndexBegin(TrigramIndex *index, const uint16_t *fold, size_t length);
+
+// Indexes up to about 'budget' more characters (whole blocks at a time) of
+// the text passed to TrigramIndexBegin. Returns true once the index is
+// ready; on running out of memory it is emptied, which also returns true.
+bool TrigramIndexStep(TrigramIndex *index, const uint16_t *text, size_t length, size_t budget);
+
+// Follows one edit: 'removed' characters at 'offset' were replaced by
+// 'inserted' characters. Returns false if the index should be rebuilt:
+// it was still being built, or too much of it has changed.
+bool TrigramIndexUpdate(TrigramIndex *index, size_t offset, size_t removed, size_t inserted);
+
+// Bytes of memory the index uses.
+size_t TrigramIndexMemory(const TrigramIndex *index);
+
+// ============================================================================
+// Queries
+// ============================================================================
+// The candidate blocks for one literal: only matches that start with it
+// and start in a candidate block can exist. A query is for the text as it
+// is now; make a new one after an edit.
+// ============================================================================
+typedef struct TrigramQuery {
+    const TrigramIndex *index;
+    uint8_t *candidates;        // Bitmap of candidate blocks
+} TrigramQuery;
+
+// Works out the candidate blocks for a literal of 3 or more units (folded
+// through the index's table before lookup). Returns false if the index
+// cannot narrow the search: not ready, literal too short, out of memory.
+bool TrigramQueryInit(TrigramQuery *query, const TrigramIndex *index, const uint16_t *literal, size_t length);
+void TrigramQueryFree(TrigramQuery *query);
+
+// The first run of consecutive candidate blocks ending after 'from', as
+// the text range [*startOut, *endOut). Returns false if there is none.
+bool TrigramQueryNext(const TrigramQuery *query, size_t from, size_t *startOut, size_t *endOut);
+
+// The last run of candidate blocks starting before 'before'.
+bool TrigramQueryPrev(const TrigramQuery *query, size_t before, size_t *startOut, size_t *endOut);
@@ -0,0 +1,421 @@
+// ============================================================================
+// undo_log.c - Unlimited Undo/Redo History Implementation
+// ============================================================================
+// Storage layout:
+//   arena   - every removed and inserted string, appended in edit order
+//   records - one delta per edit, pointing into the arena
+//   groups  - the first record of each undo step
+// Groups [0, current) are applied to the document; groups [current, count)
+// are redo history and are dropped (records and arena tail together) as soon
+// as a new edit is recorded.
+// ============================================================================
+
+#include "undo_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Growth Helpers
+// ============================================================================
+static bool Reserve(void **data, size_t *capacity, size_t needed, size_t elementSize) {
+    if (needed <= *capacity) return true;
+    size_t newCapacity = *capacity ? *capacity : 64;
+    while (newCapacity < needed) newCapacity *= 2;
+    void *grown = realloc(*data, newCapacity * elementSize);
+    if (!grown) return false;
+    *data = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Appends text to the arena and returns its start position
+static bool ArenaAppend(UndoLog *log, const uint16_t *text, size_t length, uint64_t *startOut) {
+    *startOut = log->arenaLength;
+    if (length == 0) return true;
+    if (!Reserve((void **)&log->arena, &log->arenaCapacity, log->arenaLength + length, sizeof(uint16_t))) {
+        return false;
+    }
+    memcpy(log->arena + log->arenaLength, text, length * sizeof(uint16_t));
+    log->arenaLength += length;
+    return true;
+}
+
+// Returns true if the arena holds exactly 'text' at 'start'
+static bool ArenaEquals(const UndoLog *log, uint64_t start, size_t storedLength, const uint16_t *text, size_t length) {
+    return storedLength == length && (length == 0 || memcmp(log->arena + start, text, length * sizeof(uint16_t)) == 0);
+}
+
+static bool IsSpace(uint16_t ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+// ============================================================================
+// UndoLogInit / UndoLogFree / UndoLogClear
+// ============================================================================
+void UndoLogInit(UndoLog *log, size_t memoryLimit) {
+    memset(log, 0, sizeof(*log));
+    log->memoryLimit = memoryLimit ? memoryLimit : UNDO_LOG_DEFAULT_LIMIT;
+    log->savePoint = 0;
+    log->sealed = true;
+}
+
+void UndoLogFree(UndoLog *log) {
+    size_t limit = log->memoryLimit;
+    free(log->arena);
+    free(log->records);
+    free(log->groups);
+    UndoLogInit(log, limit);
+}
+
+void UndoLogClear(UndoLog *log) {
+    // Keep the buffers; a cleared log is usually refilled right away
+    log->arenaLength = 0;
+    log->recordCount = 0;
+    log->groupCount = 0;
+    log->current = 0;
+    log->savePoint = 0;
+    log->groupDepth = 0;
+    log->sealed = true;
+}
+
+// ============================================================================
+// UndoLogMemoryUsage - Bytes Used by Live History
+// ============================================================================
+size_t UndoLogMemoryUsage(const UndoLog *log) {
+    return log->arenaLength * sizeof(uint16_t) +
+           log->recordCount * sizeof(UndoRecord) +
+           log->groupCount * sizeof(UndoGroup);
+}
+
+// ============================================================================
+// TrimToLimit - Drop the Oldest Groups While Over the Memory Cap
+// ============================================================================
+// Frees down to three quarters of the cap so that trimming (which shifts
+// the remaining history) only happens occasionally. The newest applied
+// group is never dropped, even if it alone exceeds the cap.
+// ============================================================================
+static void TrimToLimit(UndoLog *log) {
+    size_t usage = UndoLogMemoryUsage(log);
+    if (usage <= log->memoryLimit || log->current < 2) return;
+
+    size_t target = (log->memoryLimit / 4) * 3;
+    size_t drop = 0;
+    while (drop + 1 < log->current && usage > target) {
+        size_t nextRecord = log->groups[drop + 1].firstRecord;
+        size_t nextArena = log->groups[drop + 1].arenaStart;
+        usage -= (nextRecord - log->groups[drop].firstRecord) * sizeof(UndoRecord) +
+                 (nextArena - log->groups[drop].arenaStart) * sizeof(uint16_t) +
+                 sizeof(UndoGroup);
+        drop++;
+    }
+    if (drop == 0) return;
+
+    size_t recordShift = log->groups[drop].firstRecord;
+    size_t arenaShift = log->groups[drop].arenaStart;
+
+    memmove(log->arena, log->arena + arenaShift, (log->arenaLength - arenaShift) * sizeof(uint16_t));
+    log->arenaLength -= arenaShift;
+    memmove(log->records, log->records + recordShift, (log->recordCount - recordShift) * sizeof(UndoRecord));
+    log->recordCount -= recordShift;
+    memmove(log->groups, log->groups + drop, (log->groupCount - drop) * sizeof(UndoGroup));
+    log->groupCount -= drop;
+
+    for (size_t i = 0; i < log->recordCount; ++i) {
+        log->records[i].removedStart -= arenaShift;
+        log->records[i].insertedStart -= arenaShift;
+    }
+    for (size_t i = 0; i < log->groupCount; ++i) {
+        log->groups[i].firstRecord -= recordShift;
+        log->groups[i].arenaStart -= arenaShift;
+    }
+
+    log->current -= drop;
+    log->savePoint = (log->savePoint != SIZE_MAX && log->savePoint >= drop) ? log->savePoint - drop : SIZE_MAX;
+}
+
+void UndoLogSetLimit(UndoLog *log, size_t memoryLimit) {
+    log->memoryLimit = memoryLimit ? memoryLimit : UNDO_LOG_DEFAULT_LIMIT;
+    TrimToLimit(log);
+}
+
+// ============================================================================
+// DiscardRedo - Drop Undone Groups Before Recording a New Edit
+// ============================================================================
+static void DiscardRedo(UndoLog *log) {
+    if (log->current == log->groupCount) return;
+    log->recordCount = log->groups[log->current].firstRecord;
+    log->arenaLength = log->groups[log->current].arenaStart;
+    log->groupCount = log->current;
+    if (log->savePoint != SIZE_MAX && log->savePoint > log->current) {
+        log->savePoint = SIZE_MAX;  // The saved state can no longer be reached
+    }
+}
+
+// ============================================================================
+// CanCoalesce - Decide Whether an Edit Extends the Last Group
+// ============================================================================
+static bool CanCoalesce(const UndoLog *log, uint64_t offset, size_t removedLength,
+                        const uint16_t *inserted, size_t insertedLength, UndoKind kind) {
+    if (log->sealed || log->groupCount == 0 || log->groupDepth > 0) return false;
+    const UndoGroup *group = &log->groups[log->groupCount - 1];
+    if (group->kind != kind || kind == UNDO_KIND_OTHER) return false;
+    const UndoRecord *last = &log->records[log->recordCount - 1];
+
+    if (kind == UNDO_KIND_TYPING) {
+        if (removedLength != 0 || offset != last->offset + last->insertedLength) return false;
+        // Start a new step at each word: after whitespace, on the next word
+        if (last->insertedLength > 0 && insertedLength > 0) {
+            uint16_t previous = log->arena[last->insertedStart + last->insertedLength - 1];
+            if (IsSpace(previous) && !IsSpace(inserted[0])) return false;
+        }
+        return true;
+    }
+
+    // UNDO_KIND_DELETE: Backspace moves left, Delete stays put
+    if (insertedLength != 0) return false;
+    return offset + removedLength == last->offset || offset == last->offset;
+}
+
+// ============================================================================
+// UndoLogRecord - Append One Edit to the History
+// ============================================================================
+bool UndoLogRecord(UndoLog *log, uint64_t offset,
+                   const uint16_t *removed, size_t removedLength,
+                   const uint16_t *inserted, size_t insertedLength, UndoKind kind) {
+    if (removedLength == 0 && insertedLength == 0) return true;
+    if (removedLength > UINT32_MAX || insertedLength > UINT32_MAX) {
+        UndoLogClear(log);
+        return false;
+    }
+    DiscardRedo(log);
+
+    bool coalesce = CanCoalesce(log, offset, removedLength, inserted, insertedLength, kind);
+    bool joinGroup = coalesce || (log->groupDepth > 0 && !log->sealed && log->groupCount > 0);
+
+    // Typing right after typed text: grow the previous record in place
+    if (coalesce && kind == UNDO_KIND_TYPING) {
+        UndoRecord *last = &log->records[log->recordCount - 1];
+        if (last->removedLength == 0 && last->insertedStart + last->insertedLength == log->arenaLength) {
+            uint64_t ignored;
+            if (!ArenaAppend(log, inserted, insertedLength, &ignored)) {
+                UndoLogClear(log);
+                return false;
+            }
+            last->insertedLength += (uint32_t)insertedLength;
+            return true;
+        }
+    }
+
+    if (!joinGroup) {
+        if (!Reserve((void **)&log->groups, &log->groupCapacity, log->groupCount + 1, sizeof(UndoGroup))) {
+            UndoLogClear(log);
+            return false;
+        }
+        UndoGroup *group = &log->groups[log->groupCount++];
+        group->firstRecord = log->recordCount;
+        group->arenaStart = log->arenaLength;
+        group->kind = (log->groupDepth > 0) ? UNDO_KIND_OTHER : kind;
+        group->monotonic = true;
+        log->current = log->groupCount;
+    }
+    log->sealed = false;
+
+    if (!Reserve((void **)&log->records, &log->recordCapacity, log->recordCount + 1, sizeof(UndoRecord))) {
+        UndoLogClear(log);
+        return false;
+    }
+
+    // Within a group, reuse the previous record's strings when they repeat
+    UndoGroup *group = &log->groups[log->groupCount - 1];
+    const UndoRecord *previous = (log->recordCount > group->firstRecord) ? &log->records[log->recordCount - 1] : NULL;
+    UndoRecord record;
+    record.offset = offset;
+    record.removedLength = (uint32_t)removedLength;
+    record.insertedLength = (uint32_t)insertedLength;
+    if (previous && ArenaEquals(log, previous->removedStart, previous->removedLength, removed, removedLength)) {
+        record.removedStart = previous->removedStart;
+    } else if (!ArenaAppend(log, removed, removedLength, &record.removedStart)) {
+        UndoLogClear(log);
+        return false;
+    }
+    if (previous && ArenaEquals(log, previous->insertedStart, previous->insertedLength, inserted, insertedLength)) {
+        record.insertedStart = previous->insertedStart;
+    } else if (!ArenaAppend(log, inserted, insertedLength, &record.insertedStart)) {
+        UndoLogClear(log);
+        return false;
+    }
+
+    if (previous && offset < previous->offset + previous->insertedLength) {
+        group->monotonic = false;
+    }
+    log->records[log->recordCount++] = record;
+
+    TrimToLimit(log);
+    return true;
+}
+
+// ============================================================================
+// Grouping and Sealing
+// ============================================================================
+void UndoLogBeginGroup(UndoLog *log) {
+    if (log->groupDepth++ == 0) log->sealed = true;
+}
+
+void UndoLogEndGroup(UndoLog *log) {
+    if (log->groupDepth > 0 && --log->groupDepth == 0) log->sealed = true;
+}
+
+void UndoLogSeal(UndoLog *log) {
+    log->sealed = true;
+}
+
+bool UndoLogCanUndo(const UndoLog *log) {
+    return log->current > 0;
+}
+
+bool UndoLogCanRedo(const UndoLog *log) {
+    return log->current < log->groupCount;
+}
+
+void UndoLogMarkSavePoint(UndoLog *log) {
+    log->savePoint = log->current;
+    log->sealed = true;
+}
+
+bool UndoLogAtSavePoint(const UndoLog *log) {
+    return log->savePoint == log->current;
+}
+
+void UndoLogForgetSavePoint(UndoLog *log) {
+    log->savePoint = SIZE_MAX;
+}
+
+// ============================================================================
+// RebuildText - Apply a Whole Monotonic Group in One Linear Pass
+// ============================================================================
+// For undo the document currently contains the group's inserted strings at
+// the recorded offsets. For redo it contains the removed strings, shifted by
+// the running size difference of the records before them.
+// ============================================================================
+static bool RebuildText(const UndoLog *log, const UndoTarget *target, size_t first, size_t end, bool redo) {
+    size_t length = 0;
+    const uint16_t *text = target->lockText(target->context, &length);
+    if (!text) return false;
+
+    // Size the result
+    int64_t growth = 0;
+    for (size_t i = first; i < end; ++i) {
+        const UndoRecord *r = &log->records[i];
+        growth += redo ? (int64_t)r->insertedLength - r->removedLength
+                       : (int64_t)r->removedLength - r->insertedLength;
+    }
+    if ((int64_t)length + growth < 0) {
+        target->unlockText(target->context);
+        return false;
+    }
+    size_t newLength = (size_t)((int64_t)length + growth);
+    uint16_t *result = (uint16_t *)malloc((newLength + 1) * sizeof(uint16_t));
+    if (!result) {
+        target->unlockText(target->context);
+        return false;
+    }
+
+    size_t cursor = 0, out = 0;
+    int64_t shift = 0;  // Size change of earlier records (redo only)
+    for (size_t i = first; i < end; ++i) {
+        const UndoRecord *r = &log->records[i];
+        size_t pos = (size_t)((int64_t)r->offset - shift);
+        size_t skip = redo ? r->removedLength : r->insertedLength;
+        const uint16_t *emit = log->arena + (redo ? r->insertedStart : r->removedStart);
+        size_t emitLength = redo ? r->insertedLength : r->removedLength;
+        if (pos < cursor || pos + skip > length) {  // Document does not match the log
+            free(result);
+            target->unlockText(target->context);
+            return false;
+        }
+        memcpy(result + out, text + cursor, (pos - cursor) * sizeof(uint16_t));
+        out += pos - cursor;
+        memcpy(result + out, emit, emitLength * sizeof(uint16_t));
+        out += emitLength;
+        cursor = pos + skip;
+        if (redo) shift += (int64_t)r->insertedLength - r->removedLength;
+    }
+    memcpy(result + out, text + cursor, (length - cursor) * sizeof(uint16_t));
+    out += length - cursor;
+    result[out] = 0;
+
+    target->unlockText(target->context);
+    target->setText(target->context, result, out);
+    free(result);
+    return true;
+}
+
+// ============================================================================
+// GroupRange / ReplayRecords - Record Range of a Group and Per-Record Replay
+// ============================================================================
+static void GroupRange(const UndoLog *log, size_t groupIndex, size_t *firstOut, size_t *endOut) {
+    *firstOut = log->groups[groupIndex].firstRecord;
+    *endOut = (groupIndex + 1 < log->groupCount) ? log->groups[groupIndex + 1].firstRecord : log->recordCount;
+}
+
+static void ReplayRecords(const UndoLog *log, size_t first, size_t end, bool redo, UndoReplaceFn replace, void *context) {
+    if (redo) {
+        for (size_t i = first; i < end; ++i) {
+            const UndoRecord *r = &log->records[i];
+            replace(context, r->offset, r->removedLength, log->arena + r->insertedStart, r->insertedLength);
+        }
+    } else {
+        for (size_t i = end; i-- > first;) {
+            const UndoRecord *r = &log->records[i];
+            replace(context, r->offset, r->insertedLength, log->arena + r->removedStart, r->removedLength);
+        }
+    }
+}
+
+// ============================================================================
+// ReplayGroup - Undo or Redo the Records of One Group
+// ============================================================================
+static void ReplayGroup(UndoLog *log, const UndoTarget *target, size_t groupIndex, bool redo, uint64_t *caretOut) {
+    size_t first, end;
+    GroupRange(log, groupIndex, &first, &end);
+
+    bool bulk = (end - first) > UNDO_LOG_BULK_THRESHOLD && log->groups[groupIndex].monotonic &&
+                target->lockText && target->unlockText && target->setText &&
+                RebuildText(log, target, first, end, redo);
+    if (!bulk) ReplayRecords(log, first, end, redo, target->replace, target->context);
+
+    if (caretOut) {
+        const UndoRecord *r = redo ? &log->records[end - 1] : &log->records[first];
+        *caretOut = r->offset + (redo ? r->insertedLength : r->removedLength);
+    }
+}
+
+// ============================================================================
+// UndoLogDescribeLastStep - Report the Edits of the Latest Undo/Redo
+// ============================================================================
+void UndoLogDescribeLastStep(const UndoLog *log, bool redo, UndoReplaceFn replace, void *context) {
+    size_t groupIndex = redo ? log->current - 1 : log->current;
+    if ((redo && log->current == 0) || groupIndex >= log->groupCount) return;
+    size_t first, end;
+    GroupRange(log, groupIndex, &first, &end);
+    ReplayRecords(log, first, end, redo, replace, context);
+}
+
+// ============================================================================
+// UndoLogUndo / UndoLogRedo
+// ============================================================================
+bool UndoLogUndo(UndoLog *log, const UndoTarget *target, uint64_t *caretOut) {
+    if (!UndoLogCanUndo(log) || log->groupDepth > 0) return false;
+    ReplayGroup(log, target, log->current - 1, false, caretOut);
+    log->current--;
+    log->sealed = true;
+    return true;
+}
+
+bool UndoLogRedo(UndoLog *log, const UndoTarget *target, uint64_t *caretOut) {
+    if (!UndoLogCanRedo(log) || log->groupDepth > 0) return false;
+    ReplayGroup(log, target, log->current, true, caretOut);
+    log->current++;
+    log->sealed = true;
+    return true;
+}
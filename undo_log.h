@@ -0,0 +1,138 @@
+// ============================================================================
+// undo_log.h - Unlimited Undo/Redo History Header
+// ============================================================================
+// An editor-owned undo log that records edits as compact deltas instead of
+// document snapshots. Every edit is "at offset X, replace R code units with
+// I code units"; both the removed and the inserted text are appended to a
+// single growing arena, and a record only stores offsets into it.
+//   - Records are grouped: one Undo or Redo command replays one group.
+//   - Consecutive typing and deleting coalesce into a single group, and
+//     adjacent typed characters merge into a single record.
+//   - Identical strings repeated within a group (Replace All) share one copy
+//     in the arena, so a million replacements cost a million small records.
+//   - Once the log exceeds its memory cap the oldest groups are discarded.
+// Offsets are in UTF-16 code units. This module is plain C with no Windows
+// dependencies.
+// ============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UNDO_LOG_DEFAULT_LIMIT  (64u * 1024u * 1024u)  // Default memory cap in bytes
+#define UNDO_LOG_BULK_THRESHOLD 64                     // Groups larger than this are rebuilt in one pass
+
+// ============================================================================
+// Edit Kinds
+// ============================================================================
+// Used to decide which consecutive edits belong in the same undo group.
+// ============================================================================
+typedef enum UndoKind {
+    UNDO_KIND_TYPING = 0,   // Characters typed at the caret
+    UNDO_KIND_DELETE = 1,   // Backspace / Delete key
+    UNDO_KIND_OTHER = 2     // Paste, cut, replace and other one-off edits
+} UndoKind;
+
+// ============================================================================
+// Log Structures
+// ============================================================================
+typedef struct UndoRecord {
+    uint64_t offset;          // Position of the edit in the document at the time
+    uint64_t removedStart;    // Arena position of the removed text
+    uint64_t insertedStart;   // Arena position of the inserted text
+    uint32_t removedLength;   // Code units removed
+    uint32_t insertedLength;  // Code units inserted
+} UndoRecord;
+
+typedef struct UndoGroup {
+    size_t firstRecord;       // Index of the group's first record
+    size_t arenaStart;        // Arena size when the group was opened
+    UndoKind kind;            // Kind of edit, for coalescing
+    bool monotonic;           // Records are ordered and non-overlapping
+} UndoGroup;
+
+typedef struct UndoLog {
+    uint16_t *arena;          // Append-only storage for removed/inserted text
+    size_t arenaLength, arenaCapacity;
+    UndoRecord *records;
+    size_t recordCount, recordCapacity;
+    UndoGroup *groups;
+    size_t groupCount, groupCapacity;
+    size_t current;           // Number of groups currently applied (undo pointer)
+    size_t savePoint;         // Value of 'current' when the document was saved
+    size_t memoryLimit;       // Cap on total memory use in bytes
+    int groupDepth;           // Nesting depth of UndoLogBeginGroup
+    bool sealed;              // Next edit must start a new group
+} UndoLog;
+
+// ============================================================================
+// Replay Target
+// ============================================================================
+// Callbacks through which Undo and Redo change the document. 'replace' is
+// required. The three whole-text callbacks are optional; when present, large
+// monotonic groups (Replace All) are rebuilt in one linear pass instead of
+// one replace call per record.
+// ============================================================================
+typedef void (*UndoReplaceFn)(void *context, uint64_t offset, uint64_t removeLength, const uint16_t *insert, size_t insertLength);
+
+typedef struct UndoTarget {
+    void *context;
+    UndoReplaceFn replace;
+    const uint16_t *(*lockText)(void *context, size_t *lengthOut);
+    void (*unlockText)(void *context);
+    void (*setText)(void *context, const uint16_t *text, size_t length);  // 'text' is null-terminated
+} UndoTarget;
+
+// Prepares an empty log with a memory cap (0 selects UNDO_LOG_DEFAULT_LIMIT).
+void UndoLogInit(UndoLog *log, size_t memoryLimit);
+
+// Releases all memory held by the log.
+void UndoLogFree(UndoLog *log);
+
+// Forgets all history (e.g. after loading a new document).
+void UndoLogClear(UndoLog *log);
+
+// Changes the memory cap, trimming old history if needed.
+void UndoLogSetLimit(UndoLog *log, size_t memoryLimit);
+
+// Records one edit. Any redo history is discarded.
+// Returns false if memory could not be allocated (the log is then cleared).
+bool UndoLogRecord(UndoLog *log, uint64_t offset,
+                   const uint16_t *removed, size_t removedLength,
+                   const uint16_t *inserted, size_t insertedLength, UndoKind kind);
+
+// Brackets a compound edit so that everything recorded in between undoes as
+// one step. Calls may nest.
+void UndoLogBeginGroup(UndoLog *log);
+void UndoLogEndGroup(UndoLog *log);
+
+// Ends coalescing; the next edit starts a new group (caret moved, saved...).
+void UndoLogSeal(UndoLog *log);
+
+bool UndoLogCanUndo(const UndoLog *log);
+bool UndoLogCanRedo(const UndoLog *log);
+
+// Reverts or reapplies one group through the target. 'caretOut' receives
+// the position just after the last restored text. Returns false if there
+// was nothing to do.
+bool UndoLogUndo(UndoLog *log, const UndoTarget *target, uint64_t *caretOut);
+bool UndoLogRedo(UndoLog *log, const UndoTarget *target, uint64_t *caretOut);
+
+// Reports the edits made by the latest UndoLogUndo (redo = false) or
+// UndoLogRedo (redo = true) as replace calls in the order they apply, however
+// the step was actually carried out. Lets observers mirror undo and redo.
+void UndoLogDescribeLastStep(const UndoLog *log, bool redo, UndoReplaceFn replace, void *context);
+
+// Save point tracking: lets the editor clear its "modified" flag when undo
+// returns the document to the state it was saved in.
+void UndoLogMarkSavePoint(UndoLog *log);
+bool UndoLogAtSavePoint(const UndoLog *log);
+
+// Records that no state in the history matches the file on disk (e.g. the
+// document was restored from crash recovery and has never been saved).
+void UndoLogForgetSavePoint(UndoLog *log);
+
+// Approximate memory currently held by the log in bytes.
+size_t UndoLogMemoryUsage(const UndoLog *log);